@@ -0,0 +1,1045 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltfimporter.cpp
+// ============
+// read the triangle meshes of binary glTF 2.0 (.glb) files, so they can be
+// uploaded and drawn like the built-in shape meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GltfImporter.h"
+#include "JobSystem.h"
+#include "NormalGenerator.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// glb container layout, all values are little endian
+	const uint32_t g_GlbMagic = 0x46546C67;			// "glTF"
+	const uint32_t g_GlbVersion = 2;
+	const uint32_t g_JsonChunkType = 0x4E4F534A;	// "JSON"
+	const uint32_t g_BinChunkType = 0x004E4942;		// "BIN\0"
+	const size_t g_GlbHeaderSize = 12;
+	const size_t g_ChunkHeaderSize = 8;
+
+	// glTF primitive modes that describe triangles
+	const int g_ModeTriangles = 4;
+	const int g_ModeTriangleStrip = 5;
+	const int g_ModeTriangleFan = 6;
+
+	// number of elements converted by one job
+	const size_t g_ConversionChunkSize = 65536;
+
+	uint32_t ReadUint32(const unsigned char* data)
+	{
+		uint32_t value = 0;
+		memcpy(&value, data, sizeof(value));
+		return(value);
+	}
+
+	// the glTF component types use the GL enum values
+	size_t GetComponentSize(GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return(1);
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return(2);
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return(4);
+		default:
+			return(0);
+		}
+	}
+
+	GLint GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR")
+		{
+			return(1);
+		}
+		if (type == "VEC2")
+		{
+			return(2);
+		}
+		if (type == "VEC3")
+		{
+			return(3);
+		}
+		if (type == "VEC4")
+		{
+			return(4);
+		}
+		return(0);
+	}
+
+	// read one component as a float, mapping normalized integers
+	// the same way OpenGL does
+	float ReadComponent(const unsigned char* data, GLenum componentType, bool bNormalized)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		{
+			int8_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return((bNormalized == true) ? std::max(value / 127.0f, -1.0f) : (float)value);
+		}
+		case GL_UNSIGNED_BYTE:
+		{
+			uint8_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return((bNormalized == true) ? (value / 255.0f) : (float)value);
+		}
+		case GL_SHORT:
+		{
+			int16_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return((bNormalized == true) ? std::max(value / 32767.0f, -1.0f) : (float)value);
+		}
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return((bNormalized == true) ? (value / 65535.0f) : (float)value);
+		}
+		case GL_UNSIGNED_INT:
+		{
+			uint32_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return((float)value);
+		}
+		case GL_FLOAT:
+		{
+			float value = 0.0f;
+			memcpy(&value, data, sizeof(value));
+			return(value);
+		}
+		default:
+			return(0.0f);
+		}
+	}
+
+	GLuint ReadIndex(const unsigned char* data, GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_UNSIGNED_BYTE:
+			return(data[0]);
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return(value);
+		}
+		default:
+		{
+			uint32_t value = 0;
+			memcpy(&value, data, sizeof(value));
+			return(value);
+		}
+		}
+	}
+
+	glm::vec3 ReadPosition(
+		const unsigned char* data,
+		const GltfImporter::VERTEX_ATTRIBUTE& attribute,
+		size_t vertex)
+	{
+		const unsigned char* element = data + attribute.offset + vertex * attribute.stride;
+		size_t componentSize = GetComponentSize(attribute.componentType);
+		bool bNormalized = (attribute.bNormalized == GL_TRUE);
+		return(glm::vec3(
+			ReadComponent(element, attribute.componentType, bNormalized),
+			ReadComponent(element + componentSize, attribute.componentType, bNormalized),
+			ReadComponent(element + 2 * componentSize, attribute.componentType, bNormalized)));
+	}
+
+	/***********************************************************
+	 *  ReadFloats()
+	 *
+	 *  Get a vertex attribute as floats.  Float attributes are
+	 *  used in place and the others are converted into the
+	 *  scratch vector.  Returns the first element and sets
+	 *  the stride in bytes.
+	 ***********************************************************/
+	const GLfloat* ReadFloats(
+		const unsigned char* data,
+		const GltfImporter::VERTEX_ATTRIBUTE& attribute,
+		size_t nVertices,
+		std::vector<GLfloat>& scratch,
+		size_t& stride)
+	{
+		if (attribute.componentType == GL_FLOAT)
+		{
+			stride = attribute.stride;
+			return((const GLfloat*)(data + attribute.offset));
+		}
+
+		size_t componentSize = GetComponentSize(attribute.componentType);
+		bool bNormalized = (attribute.bNormalized == GL_TRUE);
+		scratch.resize(nVertices * attribute.components);
+		for (size_t v = 0; v < nVertices; v++)
+		{
+			const unsigned char* element = data + attribute.offset + v * attribute.stride;
+			for (GLint c = 0; c < attribute.components; c++)
+			{
+				scratch[v * attribute.components + c] =
+					ReadComponent(element + c * componentSize, attribute.componentType, bNormalized);
+			}
+		}
+		stride = attribute.components * sizeof(GLfloat);
+		return(scratch.data());
+	}
+
+	// get indices as 32 bit values, in place when they already are
+	const GLuint* ReadIndices(
+		const unsigned char* data,
+		GLenum type,
+		size_t count,
+		std::vector<GLuint>& scratch)
+	{
+		if (type == GL_UNSIGNED_INT)
+		{
+			return((const GLuint*)data);
+		}
+
+		size_t indexSize = GetComponentSize(type);
+		scratch.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[i] = ReadIndex(data + i * indexSize, type);
+		}
+		return(scratch.data());
+	}
+}
+
+/***********************************************************
+ *  GltfImporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GltfImporter::GltfImporter()
+{
+	m_bin = NULL;
+	m_binSize = 0;
+	m_convertedBytes = 0;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping a .glb file and reading
+ *  the triangle primitives of its meshes.  Primitives that
+ *  cannot be imported are skipped with a message, and the
+ *  method fails when none are left.
+ ***********************************************************/
+bool GltfImporter::Load(const char* filename)
+{
+	Release();
+
+	if (ReadContainer(filename) == false)
+	{
+		Release();
+		return(false);
+	}
+
+	const JsonValue* meshes = m_json.Find("meshes");
+	const JsonValue* bufferViews = m_json.Find("bufferViews");
+	if ((meshes == NULL) || (meshes->GetSize() == 0))
+	{
+		std::cout << "No meshes in glTF file: " << filename << std::endl;
+		Release();
+		return(false);
+	}
+
+	m_viewBuffers.assign((bufferViews != NULL) ? bufferViews->GetSize() : 0, -1);
+
+	// one flag per primitive, set by the jobs that check the indices
+	size_t nPrimitiveSlots = 0;
+	for (size_t i = 0; i < meshes->GetSize(); i++)
+	{
+		const JsonValue* primitives = meshes->GetElement(i).Find("primitives");
+		nPrimitiveSlots += (primitives != NULL) ? primitives->GetSize() : 0;
+	}
+	m_bInvalidPrimitive.reset(new std::atomic<bool>[nPrimitiveSlots + 1]);
+	for (size_t i = 0; i <= nPrimitiveSlots; i++)
+	{
+		m_bInvalidPrimitive[i] = false;
+	}
+
+	// describe the primitives, queuing the conversions they need
+	size_t slot = 0;
+	m_meshes.resize(meshes->GetSize());
+	for (size_t meshIndex = 0; meshIndex < meshes->GetSize(); meshIndex++)
+	{
+		const JsonValue& mesh = meshes->GetElement(meshIndex);
+		const JsonValue* name = mesh.Find("name");
+		m_meshes[meshIndex].name = (name != NULL) ? name->GetString() : std::string();
+
+		const JsonValue* primitives = mesh.Find("primitives");
+		size_t nPrimitives = (primitives != NULL) ? primitives->GetSize() : 0;
+		for (size_t i = 0; i < nPrimitives; i++)
+		{
+			PRIMITIVE primitive;
+			if (ReadPrimitive(primitives->GetElement(i), meshIndex,
+				m_meshes[meshIndex].primitives.size(), slot, primitive) == true)
+			{
+				m_meshes[meshIndex].primitives.push_back(primitive);
+				slot++;
+			}
+			else
+			{
+				std::cout << "Skipped unsupported primitive " << i << " of glTF mesh "
+					<< meshIndex << " in file: " << filename << std::endl;
+			}
+		}
+	}
+
+	RunConversionJobs();
+
+	// drop the primitives whose indices reference missing vertices
+	slot = 0;
+	bool bAnyPrimitive = false;
+	for (size_t meshIndex = 0; meshIndex < m_meshes.size(); meshIndex++)
+	{
+		std::vector<PRIMITIVE> validPrimitives;
+		for (size_t i = 0; i < m_meshes[meshIndex].primitives.size(); i++)
+		{
+			if (m_bInvalidPrimitive[slot++] == false)
+			{
+				validPrimitives.push_back(m_meshes[meshIndex].primitives[i]);
+			}
+			else
+			{
+				std::cout << "Skipped primitive with out of range indices in glTF mesh "
+					<< meshIndex << " in file: " << filename << std::endl;
+			}
+		}
+		m_meshes[meshIndex].primitives.swap(validPrimitives);
+		bAnyPrimitive = bAnyPrimitive || (m_meshes[meshIndex].primitives.empty() == false);
+	}
+
+	if (bAnyPrimitive == false)
+	{
+		std::cout << "No triangle primitives in glTF file: " << filename << std::endl;
+		Release();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for unmapping the file and freeing
+ *  the converted data.
+ ***********************************************************/
+void GltfImporter::Release()
+{
+	m_file.Close();
+	m_json = JsonValue();
+	m_bin = NULL;
+	m_binSize = 0;
+
+	m_buffers.clear();
+	m_convertedData.clear();
+	m_viewBuffers.clear();
+	m_meshes.clear();
+	m_convertedBytes = 0;
+
+	for (int i = 0; i < PHASE_COUNT; i++)
+	{
+		m_jobs[i].clear();
+	}
+	m_bInvalidPrimitive.reset();
+}
+
+/***********************************************************
+ *  GetBuffers()
+ *
+ *  This method is used for getting the blocks of bytes the
+ *  primitives read their vertices and indices from.
+ ***********************************************************/
+const std::vector<GltfImporter::SOURCE_BUFFER>& GltfImporter::GetBuffers() const
+{
+	return(m_buffers);
+}
+
+/***********************************************************
+ *  GetMeshes()
+ *
+ *  This method is used for getting the imported meshes, in
+ *  the order of the glTF meshes array.
+ ***********************************************************/
+const std::vector<GltfImporter::MESH>& GltfImporter::GetMeshes() const
+{
+	return(m_meshes);
+}
+
+/***********************************************************
+ *  GetConvertedBytes()
+ *
+ *  This method is used for getting the number of bytes that
+ *  were converted instead of used in place.
+ ***********************************************************/
+size_t GltfImporter::GetConvertedBytes() const
+{
+	return(m_convertedBytes);
+}
+
+/***********************************************************
+ *  ReadContainer()
+ *
+ *  This method is used for mapping the file, checking the
+ *  glb header and parsing the JSON chunk.  The BIN chunk is
+ *  optional, but every imported accessor must reside in it.
+ ***********************************************************/
+bool GltfImporter::ReadContainer(const char* filename)
+{
+	if (m_file.Open(filename) == false)
+	{
+		std::cout << "Could not open glTF file: " << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* data = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	if ((size < g_GlbHeaderSize + g_ChunkHeaderSize) ||
+		(ReadUint32(data) != g_GlbMagic) ||
+		(ReadUint32(data + 4) != g_GlbVersion))
+	{
+		std::cout << "Not a binary glTF 2.0 file: " << filename << std::endl;
+		return(false);
+	}
+
+	size_t length = std::min((size_t)ReadUint32(data + 8), size);
+	size_t jsonLength = ReadUint32(data + g_GlbHeaderSize);
+	size_t jsonStart = g_GlbHeaderSize + g_ChunkHeaderSize;
+	if ((ReadUint32(data + g_GlbHeaderSize + 4) != g_JsonChunkType) ||
+		(jsonLength > length - jsonStart))
+	{
+		std::cout << "Missing JSON chunk in glTF file: " << filename << std::endl;
+		return(false);
+	}
+
+	std::string error;
+	if (JsonValue::Parse((const char*)data + jsonStart, jsonLength, m_json, error) == false)
+	{
+		std::cout << "Could not parse the JSON of glTF file: " << filename
+			<< " (" << error << ")" << std::endl;
+		return(false);
+	}
+
+	const JsonValue* asset = m_json.Find("asset");
+	const JsonValue* version = (asset != NULL) ? asset->Find("version") : NULL;
+	if ((version == NULL) || (version->GetString().compare(0, 2, "2.") != 0))
+	{
+		std::cout << "Unsupported glTF version in file: " << filename << std::endl;
+		return(false);
+	}
+
+	// chunks start on 4 byte boundaries
+	size_t binHeader = jsonStart + ((jsonLength + 3) & ~(size_t)3);
+	if ((binHeader <= length) && (length - binHeader >= g_ChunkHeaderSize) &&
+		(ReadUint32(data + binHeader + 4) == g_BinChunkType))
+	{
+		size_t binLength = ReadUint32(data + binHeader);
+		if (binLength <= length - binHeader - g_ChunkHeaderSize)
+		{
+			m_bin = data + binHeader + g_ChunkHeaderSize;
+			m_binSize = binLength;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetBufferView()
+ *
+ *  This method is used for resolving a buffer view.  Only
+ *  views of the glb buffer, the first buffer without a uri,
+ *  can be imported.
+ ***********************************************************/
+bool GltfImporter::GetBufferView(
+	int bufferView,
+	const unsigned char*& data,
+	size_t& length,
+	size_t& stride)
+{
+	const JsonValue* bufferViews = m_json.Find("bufferViews");
+	const JsonValue* buffers = m_json.Find("buffers");
+	if ((m_bin == NULL) || (bufferViews == NULL) || (buffers == NULL) ||
+		(bufferView < 0) || ((size_t)bufferView >= bufferViews->GetSize()))
+	{
+		return(false);
+	}
+
+	const JsonValue& view = bufferViews->GetElement(bufferView);
+	if ((view.GetInt("buffer", -1) != 0) || (buffers->GetElement(0).Find("uri") != NULL))
+	{
+		return(false);
+	}
+
+	size_t offset = (size_t)view.GetNumber("byteOffset", 0.0);
+	length = (size_t)view.GetNumber("byteLength", 0.0);
+	stride = (size_t)view.GetNumber("byteStride", 0.0);
+	if ((offset > m_binSize) || (length > m_binSize - offset))
+	{
+		return(false);
+	}
+
+	data = m_bin + offset;
+	return(true);
+}
+
+/***********************************************************
+ *  GetAccessor()
+ *
+ *  This method is used for resolving an accessor and
+ *  checking that all of its elements are inside its view.
+ *  Accessors without a view are all zeros, unless sparse
+ *  substitutions are applied.
+ ***********************************************************/
+bool GltfImporter::GetAccessor(int accessorIndex, ACCESSOR& accessor)
+{
+	const JsonValue* accessors = m_json.Find("accessors");
+	if ((accessors == NULL) || (accessorIndex < 0) ||
+		((size_t)accessorIndex >= accessors->GetSize()))
+	{
+		return(false);
+	}
+
+	const JsonValue& json = accessors->GetElement(accessorIndex);
+	const JsonValue* type = json.Find("type");
+	const JsonValue* normalized = json.Find("normalized");
+
+	accessor.json = &json;
+	accessor.componentType = (GLenum)json.GetInt("componentType", 0);
+	accessor.components = GetComponentCount((type != NULL) ? type->GetString() : std::string());
+	accessor.count = (size_t)json.GetNumber("count", 0.0);
+	accessor.bNormalized = (normalized != NULL) && (normalized->GetBool() == true);
+	accessor.bufferView = json.GetInt("bufferView", -1);
+	accessor.offset = (size_t)json.GetNumber("byteOffset", 0.0);
+	accessor.data = NULL;
+
+	size_t componentSize = GetComponentSize(accessor.componentType);
+	if ((componentSize == 0) || (accessor.components == 0) || (accessor.count == 0))
+	{
+		return(false);
+	}
+	accessor.elementSize = componentSize * accessor.components;
+	accessor.stride = accessor.elementSize;
+
+	if (accessor.bufferView >= 0)
+	{
+		const unsigned char* viewData = NULL;
+		size_t viewLength = 0;
+		size_t viewStride = 0;
+		if (GetBufferView(accessor.bufferView, viewData, viewLength, viewStride) == false)
+		{
+			return(false);
+		}
+		if (viewStride != 0)
+		{
+			accessor.stride = viewStride;
+		}
+		if ((accessor.stride < accessor.elementSize) ||
+			(accessor.offset > viewLength) ||
+			(accessor.elementSize > viewLength - accessor.offset) ||
+			((accessor.count - 1) > (viewLength - accessor.offset - accessor.elementSize) / accessor.stride))
+		{
+			return(false);
+		}
+		accessor.data = viewData + accessor.offset;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetViewBuffer()
+ *
+ *  This method is used for getting the source buffer that
+ *  holds a buffer view straight from the mapped file.  The
+ *  primitives that share a view share its buffer.
+ ***********************************************************/
+int GltfImporter::GetViewBuffer(int bufferView)
+{
+	if (m_viewBuffers[bufferView] < 0)
+	{
+		const unsigned char* data = NULL;
+		size_t length = 0;
+		size_t stride = 0;
+		GetBufferView(bufferView, data, length, stride);
+
+		SOURCE_BUFFER buffer;
+		buffer.data = data;
+		buffer.size = length;
+		buffer.bConverted = false;
+		m_buffers.push_back(buffer);
+		m_viewBuffers[bufferView] = (int)m_buffers.size() - 1;
+	}
+	return(m_viewBuffers[bufferView]);
+}
+
+/***********************************************************
+ *  AddConvertedBuffer()
+ *
+ *  This method is used for allocating a source buffer that
+ *  is filled by conversion jobs.  Its bytes do not move when
+ *  more buffers are added.
+ ***********************************************************/
+int GltfImporter::AddConvertedBuffer(size_t size)
+{
+	m_convertedData.push_back(std::vector<unsigned char>(size));
+	m_convertedBytes += size;
+
+	SOURCE_BUFFER buffer;
+	buffer.data = m_convertedData.back().data();
+	buffer.size = size;
+	buffer.bConverted = true;
+	m_buffers.push_back(buffer);
+	return((int)m_buffers.size() - 1);
+}
+
+/***********************************************************
+ *  AddJob()
+ *
+ *  This method is used for queuing a conversion over count
+ *  elements, which runs in chunks on the job system.
+ ***********************************************************/
+void GltfImporter::AddJob(
+	CONVERSION_PHASE phase,
+	size_t count,
+	std::function<void(size_t, size_t)> run)
+{
+	CONVERSION_JOB job;
+	job.count = count;
+	job.run = run;
+	m_jobs[phase].push_back(job);
+}
+
+/***********************************************************
+ *  RunConversionJobs()
+ *
+ *  This method is used for running the queued conversions.
+ *  Every job is split into chunks, and the chunks of all
+ *  jobs in a phase run in parallel.
+ ***********************************************************/
+void GltfImporter::RunConversionJobs()
+{
+	struct CHUNK
+	{
+		const CONVERSION_JOB* job;
+		size_t begin;
+		size_t end;
+	};
+
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		std::vector<CHUNK> chunks;
+		for (size_t i = 0; i < m_jobs[phase].size(); i++)
+		{
+			const CONVERSION_JOB& job = m_jobs[phase][i];
+			for (size_t begin = 0; begin < job.count; begin += g_ConversionChunkSize)
+			{
+				CHUNK chunk;
+				chunk.job = &job;
+				chunk.begin = begin;
+				chunk.end = std::min(begin + g_ConversionChunkSize, job.count);
+				chunks.push_back(chunk);
+			}
+		}
+
+		JobSystem::Get().ParallelFor(chunks.size(), [&chunks](size_t i)
+		{
+			chunks[i].job->run(chunks[i].begin, chunks[i].end);
+		});
+		m_jobs[phase].clear();
+	}
+}
+
+/***********************************************************
+ *  ReadAttribute()
+ *
+ *  This method is used for describing a vertex attribute.
+ *  OpenGL reads every glTF component type natively, so the
+ *  accessor is used in place unless it is sparse, has no
+ *  view, or its elements are misaligned.  Otherwise jobs
+ *  convert it to tightly packed floats.
+ ***********************************************************/
+bool GltfImporter::ReadAttribute(
+	const ACCESSOR& accessor,
+	GLint components,
+	VERTEX_ATTRIBUTE& attribute)
+{
+	if ((accessor.components != components) || (accessor.componentType == GL_UNSIGNED_INT))
+	{
+		return(false);
+	}
+
+	size_t componentSize = GetComponentSize(accessor.componentType);
+	const JsonValue* sparse = accessor.json->Find("sparse");
+
+	if ((sparse == NULL) && (accessor.data != NULL) &&
+		((accessor.offset % componentSize) == 0) &&
+		((accessor.stride % componentSize) == 0))
+	{
+		attribute.bPresent = true;
+		attribute.buffer = GetViewBuffer(accessor.bufferView);
+		attribute.components = components;
+		attribute.componentType = accessor.componentType;
+		attribute.bNormalized = (accessor.bNormalized == true) ? GL_TRUE : GL_FALSE;
+		attribute.stride = (GLsizei)accessor.stride;
+		attribute.offset = accessor.offset;
+		return(true);
+	}
+
+	// resolve the sparse substitutions before queuing any job
+	size_t nSparse = 0;
+	const unsigned char* sparseIndices = NULL;
+	GLenum sparseIndexType = 0;
+	const unsigned char* sparseValues = NULL;
+	if (sparse != NULL)
+	{
+		const JsonValue* indices = sparse->Find("indices");
+		const JsonValue* values = sparse->Find("values");
+		if ((indices == NULL) || (values == NULL))
+		{
+			return(false);
+		}
+
+		nSparse = (size_t)sparse->GetNumber("count", 0.0);
+		sparseIndexType = (GLenum)indices->GetInt("componentType", 0);
+		size_t indexSize = GetComponentSize(sparseIndexType);
+		size_t indexOffset = (size_t)indices->GetNumber("byteOffset", 0.0);
+		size_t valueOffset = (size_t)values->GetNumber("byteOffset", 0.0);
+
+		const unsigned char* indexView = NULL;
+		const unsigned char* valueView = NULL;
+		size_t indexViewLength = 0;
+		size_t valueViewLength = 0;
+		size_t viewStride = 0;
+		if ((nSparse == 0) || (indexSize == 0) || (sparseIndexType == GL_BYTE) ||
+			(sparseIndexType == GL_SHORT) || (sparseIndexType == GL_FLOAT) ||
+			(GetBufferView(indices->GetInt("bufferView", -1), indexView, indexViewLength, viewStride) == false) ||
+			(GetBufferView(values->GetInt("bufferView", -1), valueView, valueViewLength, viewStride) == false) ||
+			(indexOffset > indexViewLength) ||
+			(nSparse > (indexViewLength - indexOffset) / indexSize) ||
+			(valueOffset > valueViewLength) ||
+			(nSparse > (valueViewLength - valueOffset) / accessor.elementSize))
+		{
+			return(false);
+		}
+		sparseIndices = indexView + indexOffset;
+		sparseValues = valueView + valueOffset;
+	}
+
+	int buffer = AddConvertedBuffer(accessor.count * components * sizeof(GLfloat));
+	GLfloat* output = (GLfloat*)m_convertedData.back().data();
+
+	ACCESSOR source = accessor;
+	AddJob(COPY_PHASE, accessor.count, [source, componentSize, output](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			for (GLint c = 0; c < source.components; c++)
+			{
+				output[i * source.components + c] = (source.data == NULL) ? 0.0f :
+					ReadComponent(source.data + i * source.stride + c * componentSize,
+						source.componentType, source.bNormalized);
+			}
+		}
+	});
+
+	if (sparse != NULL)
+	{
+		// sparse indices are strictly increasing, so chunks never
+		// write the same element
+		AddJob(SPARSE_PHASE, nSparse, [source, componentSize, output,
+			sparseIndices, sparseIndexType, sparseValues](size_t begin, size_t end)
+		{
+			size_t indexSize = GetComponentSize(sparseIndexType);
+			for (size_t i = begin; i < end; i++)
+			{
+				GLuint element = ReadIndex(sparseIndices + i * indexSize, sparseIndexType);
+				if (element >= source.count)
+				{
+					continue;
+				}
+				for (GLint c = 0; c < source.components; c++)
+				{
+					output[element * source.components + c] =
+						ReadComponent(sparseValues + i * source.elementSize + c * componentSize,
+							source.componentType, source.bNormalized);
+				}
+			}
+		});
+	}
+
+	attribute.bPresent = true;
+	attribute.buffer = buffer;
+	attribute.components = components;
+	attribute.componentType = GL_FLOAT;
+	attribute.bNormalized = GL_FALSE;
+	attribute.stride = (GLsizei)(components * sizeof(GLfloat));
+	attribute.offset = 0;
+	return(true);
+}
+
+/***********************************************************
+ *  ReadPrimitive()
+ *
+ *  This method is used for describing one primitive as an
+ *  indexed triangle list.  Triangle lists with 16 or 32 bit
+ *  indices are used in place, after checking the indices
+ *  in parallel.  Byte indices, strips, fans and primitives
+ *  without indices are converted to 32 bit triangle lists.
+ *  Missing normals are generated from the triangles.
+ ***********************************************************/
+bool GltfImporter::ReadPrimitive(
+	const JsonValue& json,
+	size_t meshIndex,
+	size_t primitiveIndex,
+	size_t slot,
+	PRIMITIVE& primitive)
+{
+	int mode = json.GetInt("mode", g_ModeTriangles);
+	const JsonValue* attributes = json.Find("attributes");
+	if (((mode != g_ModeTriangles) && (mode != g_ModeTriangleStrip) && (mode != g_ModeTriangleFan)) ||
+		(attributes == NULL))
+	{
+		return(false);
+	}
+
+	ACCESSOR positions;
+	if ((GetAccessor(attributes->GetInt("POSITION", -1), positions) == false) ||
+		(positions.count > 0xFFFFFFFFu))
+	{
+		return(false);
+	}
+	GLuint nVertices = (GLuint)positions.count;
+
+	ACCESSOR indices;
+	bool bIndexed = (json.Find("indices") != NULL);
+	if (bIndexed == true)
+	{
+		if ((GetAccessor(json.GetInt("indices", -1), indices) == false) ||
+			(indices.components != 1) || (indices.data == NULL) ||
+			(indices.json->Find("sparse") != NULL) ||
+			((indices.componentType != GL_UNSIGNED_BYTE) &&
+			 (indices.componentType != GL_UNSIGNED_SHORT) &&
+			 (indices.componentType != GL_UNSIGNED_INT)))
+		{
+			return(false);
+		}
+	}
+
+	size_t nSourceIndices = (bIndexed == true) ? indices.count : positions.count;
+	size_t nTriangles = 0;
+	if (mode == g_ModeTriangles)
+	{
+		nTriangles = nSourceIndices / 3;
+	}
+	else if (nSourceIndices >= 3)
+	{
+		nTriangles = nSourceIndices - 2;
+	}
+	if ((nTriangles == 0) || (nTriangles > 0xFFFFFFFFu / 3))
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		primitive.attributes[i].bPresent = false;
+	}
+
+	if (ReadAttribute(positions, 3, primitive.attributes[POSITION_ATTRIBUTE]) == false)
+	{
+		return(false);
+	}
+
+	// unusable normals are generated and unusable texture
+	// coordinates are left out, instead of dropping the primitive
+	ACCESSOR normals;
+	bool bNormals = (GetAccessor(attributes->GetInt("NORMAL", -1), normals) == true) &&
+		(normals.count == positions.count) &&
+		(ReadAttribute(normals, 3, primitive.attributes[NORMAL_ATTRIBUTE]) == true);
+
+	ACCESSOR texcoords;
+	if ((GetAccessor(attributes->GetInt("TEXCOORD_0", -1), texcoords) == true) &&
+		(texcoords.count == positions.count))
+	{
+		ReadAttribute(texcoords, 2, primitive.attributes[TEXCOORD_ATTRIBUTE]);
+	}
+
+	primitive.nVertices = nVertices;
+
+	INDEX_DATA indexData;
+	if ((bIndexed == true) && (mode == g_ModeTriangles) &&
+		(indices.componentType != GL_UNSIGNED_BYTE) &&
+		(indices.stride == indices.elementSize) &&
+		((indices.offset % indices.elementSize) == 0))
+	{
+		primitive.indexBuffer = GetViewBuffer(indices.bufferView);
+		primitive.indexType = indices.componentType;
+		primitive.indexOffset = indices.offset;
+		primitive.nIndices = (GLuint)(nTriangles * 3);
+
+		indexData.data = indices.data;
+		indexData.type = indices.componentType;
+		indexData.count = primitive.nIndices;
+
+		// the indices go to the GPU unchanged, so check them here;
+		// this also pages the index data in ahead of the upload
+		std::atomic<bool>* bInvalid = &m_bInvalidPrimitive[slot];
+		AddJob(COPY_PHASE, indexData.count, [indexData, nVertices, bInvalid](size_t begin, size_t end)
+		{
+			size_t indexSize = GetComponentSize(indexData.type);
+			for (size_t i = begin; i < end; i++)
+			{
+				if (ReadIndex(indexData.data + i * indexSize, indexData.type) >= nVertices)
+				{
+					*bInvalid = true;
+					return;
+				}
+			}
+		});
+	}
+	else
+	{
+		primitive.indexBuffer = AddConvertedBuffer(nTriangles * 3 * sizeof(GLuint));
+		primitive.indexType = GL_UNSIGNED_INT;
+		primitive.indexOffset = 0;
+		primitive.nIndices = (GLuint)(nTriangles * 3);
+
+		GLuint* output = (GLuint*)m_convertedData.back().data();
+		indexData.data = (const unsigned char*)output;
+		indexData.type = GL_UNSIGNED_INT;
+		indexData.count = primitive.nIndices;
+
+		ACCESSOR source = indices;
+		std::atomic<bool>* bInvalid = &m_bInvalidPrimitive[slot];
+		AddJob(COPY_PHASE, nTriangles, [source, bIndexed, mode, nVertices, output, bInvalid](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				// same vertex order as OpenGL for strips and fans
+				size_t corners[3];
+				if (mode == g_ModeTriangles)
+				{
+					corners[0] = 3 * t;
+					corners[1] = 3 * t + 1;
+					corners[2] = 3 * t + 2;
+				}
+				else if (mode == g_ModeTriangleStrip)
+				{
+					corners[0] = ((t & 1) == 0) ? t : t + 1;
+					corners[1] = ((t & 1) == 0) ? t + 1 : t;
+					corners[2] = t + 2;
+				}
+				else
+				{
+					corners[0] = 0;
+					corners[1] = t + 1;
+					corners[2] = t + 2;
+				}
+
+				for (int c = 0; c < 3; c++)
+				{
+					GLuint vertex = (bIndexed == true) ?
+						ReadIndex(source.data + corners[c] * source.stride, source.componentType) :
+						(GLuint)corners[c];
+					if (vertex >= nVertices)
+					{
+						*bInvalid = true;
+						vertex = 0;
+					}
+					output[3 * t + c] = vertex;
+				}
+			}
+		});
+	}
+
+	const unsigned char* positionData = m_buffers[primitive.attributes[POSITION_ATTRIBUTE].buffer].data;
+	VERTEX_ATTRIBUTE positionAttribute = primitive.attributes[POSITION_ATTRIBUTE];
+
+	if (bNormals == false)
+	{
+		int buffer = AddConvertedBuffer((size_t)nVertices * 3 * sizeof(GLfloat));
+		GLfloat* output = (GLfloat*)m_convertedData.back().data();
+
+		// area weighted vertex normals, one job per primitive since
+		// the triangles scatter into shared vertices
+		AddJob(DERIVE_PHASE, 1, [positionData, positionAttribute, indexData, nVertices, output](size_t, size_t)
+		{
+			std::vector<GLfloat> positions;
+			std::vector<GLuint> indices;
+			NormalGenerator::VERTEX_DATA vertices = {};
+			vertices.positions = ReadFloats(positionData, positionAttribute, nVertices, positions, vertices.positionStride);
+			vertices.nVertices = nVertices;
+			NormalGenerator::GenerateNormals(vertices,
+				ReadIndices(indexData.data, indexData.type, indexData.count, indices),
+				indexData.count, output, 3 * sizeof(GLfloat));
+		});
+
+		VERTEX_ATTRIBUTE& attribute = primitive.attributes[NORMAL_ATTRIBUTE];
+		attribute.bPresent = true;
+		attribute.buffer = buffer;
+		attribute.components = 3;
+		attribute.componentType = GL_FLOAT;
+		attribute.bNormalized = GL_FALSE;
+		attribute.stride = 3 * sizeof(GLfloat);
+		attribute.offset = 0;
+	}
+
+	// POSITION accessors must carry their float bounds, but
+	// quantized or sparse positions are measured instead
+	const JsonValue* minimum = positions.json->Find("min");
+	const JsonValue* maximum = positions.json->Find("max");
+	if ((minimum != NULL) && (maximum != NULL) &&
+		(minimum->GetSize() == 3) && (maximum->GetSize() == 3) &&
+		(positions.componentType == GL_FLOAT) && (positions.json->Find("sparse") == NULL))
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			primitive.boundsMin[i] = (float)minimum->GetElement(i).GetNumber();
+			primitive.boundsMax[i] = (float)maximum->GetElement(i).GetNumber();
+		}
+	}
+	else
+	{
+		primitive.boundsMin = glm::vec3(0.0f);
+		primitive.boundsMax = glm::vec3(0.0f);
+
+		std::vector<MESH>* meshes = &m_meshes;
+		AddJob(DERIVE_PHASE, 1, [meshes, meshIndex, primitiveIndex, positionData, positionAttribute, nVertices](size_t, size_t)
+		{
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+			for (GLuint v = 0; v < nVertices; v++)
+			{
+				glm::vec3 position = ReadPosition(positionData, positionAttribute, v);
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+			(*meshes)[meshIndex].primitives[primitiveIndex].boundsMin = boundsMin;
+			(*meshes)[meshIndex].primitives[primitiveIndex].boundsMax = boundsMax;
+		});
+	}
+
+	return(true);
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltfimporter.h
+// ============
+// read the triangle meshes of binary glTF 2.0 (.glb) files, so they can be
+// uploaded and drawn like the built-in shape meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "JsonValue.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GltfImporter
+ *
+ *  This class maps a .glb file into memory and describes
+ *  its mesh primitives as GL vertex attributes and indices.
+ *  Accessors that OpenGL can read as they are stay in the
+ *  mapped file, so they can be uploaded without a copy.
+ *  The others are converted by parallel jobs before Load()
+ *  returns.  The described data stays valid until Release()
+ *  is called or the importer is destroyed.
+ ***********************************************************/
+class GltfImporter
+{
+public:
+	// the imported vertex attributes, in the order of the
+	// vertex shader input locations
+	enum ATTRIBUTE
+	{
+		POSITION_ATTRIBUTE,
+		NORMAL_ATTRIBUTE,
+		TEXCOORD_ATTRIBUTE,
+		ATTRIBUTE_COUNT
+	};
+
+	// a block of bytes that becomes one GL buffer
+	struct SOURCE_BUFFER
+	{
+		const unsigned char* data;
+		size_t size;
+		bool bConverted;	// false when the bytes are in the mapped file
+	};
+
+	// how a vertex attribute is read from a source buffer
+	struct VERTEX_ATTRIBUTE
+	{
+		bool bPresent;
+		int buffer;				// index into GetBuffers()
+		GLint components;
+		GLenum componentType;
+		GLboolean bNormalized;
+		GLsizei stride;
+		size_t offset;			// byte offset of the first element
+	};
+
+	// one drawable part of a mesh as an indexed triangle list
+	struct PRIMITIVE
+	{
+		VERTEX_ATTRIBUTE attributes[ATTRIBUTE_COUNT];
+		int indexBuffer;		// index into GetBuffers()
+		GLenum indexType;		// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		size_t indexOffset;		// byte offset of the first index
+		GLuint nIndices;
+		GLuint nVertices;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	struct MESH
+	{
+		std::string name;
+		std::vector<PRIMITIVE> primitives;
+	};
+
+	// constructor
+	GltfImporter();
+
+	// map and read the passed in file, returns false when it
+	// is not a usable binary glTF 2.0 file
+	bool Load(const char* filename);
+	// free the mapped file and the converted data
+	void Release();
+
+	const std::vector<SOURCE_BUFFER>& GetBuffers() const;
+	const std::vector<MESH>& GetMeshes() const;
+
+	// number of bytes that had to be converted instead of
+	// being read straight from the mapped file
+	size_t GetConvertedBytes() const;
+
+private:
+	// an accessor resolved against its buffer view
+	struct ACCESSOR
+	{
+		const unsigned char* data;	// first element, NULL without a buffer view
+		int bufferView;
+		size_t offset;				// byte offset of the first element in the view
+		size_t count;
+		size_t stride;
+		size_t elementSize;
+		GLenum componentType;
+		GLint components;
+		bool bNormalized;
+		const JsonValue* json;
+	};
+
+	// index data of a primitive once it is imported
+	struct INDEX_DATA
+	{
+		const unsigned char* data;
+		GLenum type;
+		size_t count;
+	};
+
+	// a conversion that is split into chunks of elements
+	struct CONVERSION_JOB
+	{
+		size_t count;
+		std::function<void(size_t, size_t)> run;
+	};
+
+	// conversions of one phase only read the results of
+	// earlier phases
+	enum CONVERSION_PHASE
+	{
+		COPY_PHASE,		// dense copies, index widening and triangulation
+		SPARSE_PHASE,	// sparse accessor substitutions
+		DERIVE_PHASE,	// normals and bounds computed from the results
+		PHASE_COUNT
+	};
+
+	// called to parse the glb container and its JSON chunk
+	bool ReadContainer(const char* filename);
+	// called to describe one primitive, returns false when
+	// the primitive cannot be imported
+	bool ReadPrimitive(
+		const JsonValue& json,
+		size_t meshIndex,
+		size_t primitiveIndex,
+		size_t slot,
+		PRIMITIVE& primitive);
+	// called to resolve a buffer view inside the BIN chunk
+	bool GetBufferView(
+		int bufferView,
+		const unsigned char*& data,
+		size_t& length,
+		size_t& stride);
+	// called to resolve an accessor
+	bool GetAccessor(int accessorIndex, ACCESSOR& accessor);
+	// called to describe a vertex attribute, converting it
+	// when OpenGL cannot read it in place
+	bool ReadAttribute(
+		const ACCESSOR& accessor,
+		GLint components,
+		VERTEX_ATTRIBUTE& attribute);
+	// called to get the source buffer holding a buffer view
+	int GetViewBuffer(int bufferView);
+	// called to allocate a source buffer for converted data
+	int AddConvertedBuffer(size_t size);
+	// called to queue a conversion job
+	void AddJob(
+		CONVERSION_PHASE phase,
+		size_t count,
+		std::function<void(size_t, size_t)> run);
+	// called to run the queued jobs, phase by phase
+	void RunConversionJobs();
+
+	MappedFile m_file;
+	JsonValue m_json;
+	const unsigned char* m_bin;
+	size_t m_binSize;
+
+	std::vector<SOURCE_BUFFER> m_buffers;
+	std::vector<std::vector<unsigned char>> m_convertedData;
+	std::vector<int> m_viewBuffers;		// source buffer of each buffer view, or -1
+	std::vector<MESH> m_meshes;
+	size_t m_convertedBytes;
+
+	std::vector<CONVERSION_JOB> m_jobs[PHASE_COUNT];
+	// set by the jobs for primitives with out of range indices
+	std::unique_ptr<std::atomic<bool>[]> m_bInvalidPrimitive;
+};
\ No newline at end of file
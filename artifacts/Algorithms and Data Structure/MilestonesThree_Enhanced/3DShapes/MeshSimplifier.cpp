@@ -0,0 +1,798 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshsimplifier.cpp
+// ============
+// reduce the triangle count of indexed meshes with quadric error metrics,
+// for building level of detail chains
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshSimplifier.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+// declaration of global variables
+namespace
+{
+	// weights of the attribute changes caused by a collapse, relative
+	// to the squared position error in units of the mesh extent
+	const double g_NormalWeight = 0.01;
+	const double g_TexCoordWeight = 0.1;
+	// planes through open border edges keep the borders in place
+	const double g_BorderWeight = 10.0;
+
+	// bigger meshes are first simplified per spatial cluster in parallel
+	const size_t g_ClusterTriangleThreshold = 65536;
+	const size_t g_TrianglesPerCluster = 16384;
+	// every pass collapses independent edges, so few passes are needed
+	const int g_MaxPasses = 64;
+
+	// each level of a chain keeps this share of the previous triangles
+	const float g_LodReduction = 0.5f;
+	// levels that keep more than this share are not stored
+	const float g_LodMinReduction = 0.85f;
+	// error limit of one level, as a fraction of the mesh extent
+	const float g_LodMaxError = 0.05f;
+
+	// symmetric 4x4 error quadric of the planes around a vertex,
+	// weighted by the area the planes were taken from
+	struct QUADRIC
+	{
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+	};
+
+	void AddPlane(QUADRIC& quadric, const glm::dvec3& normal, double distance, double weight)
+	{
+		quadric.a00 += weight * normal.x * normal.x;
+		quadric.a01 += weight * normal.x * normal.y;
+		quadric.a02 += weight * normal.x * normal.z;
+		quadric.a11 += weight * normal.y * normal.y;
+		quadric.a12 += weight * normal.y * normal.z;
+		quadric.a22 += weight * normal.z * normal.z;
+		quadric.b0 += weight * normal.x * distance;
+		quadric.b1 += weight * normal.y * distance;
+		quadric.b2 += weight * normal.z * distance;
+		quadric.c += weight * distance * distance;
+		quadric.weight += weight;
+	}
+
+	void AddQuadric(QUADRIC& quadric, const QUADRIC& other)
+	{
+		quadric.a00 += other.a00;
+		quadric.a01 += other.a01;
+		quadric.a02 += other.a02;
+		quadric.a11 += other.a11;
+		quadric.a12 += other.a12;
+		quadric.a22 += other.a22;
+		quadric.b0 += other.b0;
+		quadric.b1 += other.b1;
+		quadric.b2 += other.b2;
+		quadric.c += other.c;
+		quadric.weight += other.weight;
+	}
+
+	// mean squared distance of the point to the planes of the quadric
+	double EvaluateQuadric(const QUADRIC& quadric, const glm::dvec3& p)
+	{
+		if (quadric.weight <= 0.0)
+		{
+			return(0.0);
+		}
+
+		double error =
+			quadric.a00 * p.x * p.x + quadric.a11 * p.y * p.y + quadric.a22 * p.z * p.z +
+			2.0 * (quadric.a01 * p.x * p.y + quadric.a02 * p.x * p.z + quadric.a12 * p.y * p.z) +
+			2.0 * (quadric.b0 * p.x + quadric.b1 * p.y + quadric.b2 * p.z) +
+			quadric.c;
+		return(std::max(error, 0.0) / quadric.weight);
+	}
+
+	uint64_t EdgeKey(GLuint a, GLuint b)
+	{
+		return(((uint64_t)a << 32) | b);
+	}
+
+	uint64_t UndirectedEdgeKey(GLuint a, GLuint b)
+	{
+		return((a < b) ? EdgeKey(a, b) : EdgeKey(b, a));
+	}
+
+	// vertex data shared by all the clusters of one simplification
+	struct MESH_VERTICES
+	{
+		std::vector<glm::vec3> positions;	// scaled into the unit cube
+		std::vector<glm::vec3> normals;		// empty without normals
+		std::vector<glm::vec2> texCoords;	// empty without texture coordinates
+		std::vector<GLuint> weld;			// first vertex with identical data
+		std::vector<GLuint> positionIds;	// first vertex with the same position
+		std::vector<unsigned char> bSeam;	// position shared by different attributes
+	};
+
+	// compact part of the mesh that is simplified by one thread
+	struct LOCAL_MESH
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<GLuint> positionIds;
+		std::vector<unsigned char> bLocked;
+		std::vector<GLuint> indices;
+		std::vector<GLuint> localToGlobal;
+	};
+
+	struct COLLAPSE
+	{
+		GLuint from;
+		GLuint to;
+		double cost;
+	};
+
+	/***********************************************************
+	 *  PrepareVertices()
+	 *
+	 *  Read the vertex attributes into the unit cube and find
+	 *  vertices that share a position.  Vertices with equal
+	 *  attributes are welded; vertices with different ones
+	 *  form seams that are kept as they are.
+	 ***********************************************************/
+	void PrepareVertices(
+		const MeshSimplifier::VERTEX_INPUT& input,
+		const glm::vec3& boundsMin,
+		float scale,
+		MESH_VERTICES& vertices)
+	{
+		size_t nVertices = input.nVertices;
+		vertices.positions.resize(nVertices);
+		vertices.normals.resize((input.normals != NULL) ? nVertices : 0);
+		vertices.texCoords.resize((input.texCoords != NULL) ? nVertices : 0);
+
+		for (size_t i = 0; i < nVertices; i++)
+		{
+			const GLfloat* position = (const GLfloat*)((const unsigned char*)input.positions + i * input.positionStride);
+			vertices.positions[i] = (glm::vec3(position[0], position[1], position[2]) - boundsMin) * scale;
+			if (input.normals != NULL)
+			{
+				const GLfloat* normal = (const GLfloat*)((const unsigned char*)input.normals + i * input.normalStride);
+				vertices.normals[i] = glm::vec3(normal[0], normal[1], normal[2]);
+			}
+			if (input.texCoords != NULL)
+			{
+				const GLfloat* texCoord = (const GLfloat*)((const unsigned char*)input.texCoords + i * input.texCoordStride);
+				vertices.texCoords[i] = glm::vec2(texCoord[0], texCoord[1]);
+			}
+		}
+
+		auto lessPosition = [&vertices](GLuint a, GLuint b)
+		{
+			const glm::vec3& pa = vertices.positions[a];
+			const glm::vec3& pb = vertices.positions[b];
+			if (pa.x != pb.x) return(pa.x < pb.x);
+			if (pa.y != pb.y) return(pa.y < pb.y);
+			return(pa.z < pb.z);
+		};
+		auto sameAttributes = [&vertices](GLuint a, GLuint b)
+		{
+			return(((vertices.normals.empty() == true) || (vertices.normals[a] == vertices.normals[b])) &&
+				((vertices.texCoords.empty() == true) || (vertices.texCoords[a] == vertices.texCoords[b])));
+		};
+
+		std::vector<GLuint> order(nVertices);
+		for (size_t i = 0; i < nVertices; i++)
+		{
+			order[i] = (GLuint)i;
+		}
+		std::sort(order.begin(), order.end(), lessPosition);
+
+		vertices.weld.resize(nVertices);
+		vertices.positionIds.resize(nVertices);
+		vertices.bSeam.assign(nVertices, 0);
+
+		size_t groupStart = 0;
+		while (groupStart < nVertices)
+		{
+			size_t groupEnd = groupStart + 1;
+			while ((groupEnd < nVertices) &&
+				(vertices.positions[order[groupEnd]] == vertices.positions[order[groupStart]]))
+			{
+				groupEnd++;
+			}
+
+			// the lowest vertex of the group identifies the position
+			GLuint positionId = *std::min_element(order.begin() + groupStart, order.begin() + groupEnd);
+			bool bSeam = false;
+			for (size_t i = groupStart; i < groupEnd; i++)
+			{
+				GLuint vertex = order[i];
+				vertices.positionIds[vertex] = positionId;
+				vertices.weld[vertex] = vertex;
+				for (size_t j = groupStart; j < i; j++)
+				{
+					if (sameAttributes(order[j], vertex) == true)
+					{
+						vertices.weld[vertex] = vertices.weld[order[j]];
+						break;
+					}
+				}
+				bSeam = bSeam || (vertices.weld[vertex] != vertices.weld[order[groupStart]]);
+			}
+
+			for (size_t i = groupStart; i < groupEnd; i++)
+			{
+				vertices.bSeam[order[i]] = (bSeam == true) ? 1 : 0;
+			}
+			groupStart = groupEnd;
+		}
+	}
+
+	/***********************************************************
+	 *  BuildLocalMesh()
+	 *
+	 *  Copy the vertices used by the passed in triangles into
+	 *  a compact mesh.  Seam vertices are always locked, and
+	 *  positions flagged in bLockedPositions are locked too.
+	 ***********************************************************/
+	void BuildLocalMesh(
+		const MESH_VERTICES& vertices,
+		const GLuint* indices,
+		size_t nIndices,
+		const std::vector<unsigned char>* bLockedPositions,
+		LOCAL_MESH& mesh)
+	{
+		mesh.localToGlobal.assign(indices, indices + nIndices);
+		std::sort(mesh.localToGlobal.begin(), mesh.localToGlobal.end());
+		mesh.localToGlobal.erase(std::unique(mesh.localToGlobal.begin(), mesh.localToGlobal.end()), mesh.localToGlobal.end());
+
+		size_t nVertices = mesh.localToGlobal.size();
+		mesh.positions.resize(nVertices);
+		mesh.normals.resize(vertices.normals.empty() ? 0 : nVertices);
+		mesh.texCoords.resize(vertices.texCoords.empty() ? 0 : nVertices);
+		mesh.positionIds.resize(nVertices);
+		mesh.bLocked.resize(nVertices);
+
+		for (size_t i = 0; i < nVertices; i++)
+		{
+			GLuint vertex = mesh.localToGlobal[i];
+			mesh.positions[i] = vertices.positions[vertex];
+			if (mesh.normals.empty() == false)
+			{
+				mesh.normals[i] = vertices.normals[vertex];
+			}
+			if (mesh.texCoords.empty() == false)
+			{
+				mesh.texCoords[i] = vertices.texCoords[vertex];
+			}
+			// only equality of the ids matters, so the global ids are kept
+			mesh.positionIds[i] = vertices.positionIds[vertex];
+			mesh.bLocked[i] = ((vertices.bSeam[vertex] != 0) ||
+				((bLockedPositions != NULL) && ((*bLockedPositions)[vertices.positionIds[vertex]] != 0))) ? 1 : 0;
+		}
+
+		mesh.indices.resize(nIndices);
+		for (size_t i = 0; i < nIndices; i++)
+		{
+			mesh.indices[i] = (GLuint)(std::lower_bound(mesh.localToGlobal.begin(), mesh.localToGlobal.end(), indices[i]) - mesh.localToGlobal.begin());
+		}
+	}
+
+	/***********************************************************
+	 *  SimplifyLocalMesh()
+	 *
+	 *  Collapse edges of the compact mesh until it has no more
+	 *  than the target number of indices, or until every
+	 *  remaining collapse costs more than the error limit.
+	 *  Each pass sorts the best collapse of every vertex by
+	 *  cost and applies the cheapest ones whose neighborhoods
+	 *  do not overlap, rejecting collapses that flip triangles.
+	 *  Returns the largest squared error that was accepted.
+	 ***********************************************************/
+	double SimplifyLocalMesh(
+		LOCAL_MESH& mesh,
+		size_t targetIndexCount,
+		double maxErrorSq)
+	{
+		size_t nVertices = mesh.positions.size();
+		std::vector<QUADRIC> quadrics(nVertices);
+		std::vector<unsigned char> bBorder(nVertices, 0);
+		std::unordered_set<uint64_t> borderEdges;
+		std::unordered_map<uint64_t, int> directedEdges;
+		directedEdges.reserve(mesh.indices.size());
+
+		// edges are matched by position, so seams are not mistaken for borders
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				GLuint a = mesh.positionIds[mesh.indices[t + e]];
+				GLuint b = mesh.positionIds[mesh.indices[t + (e + 1) % 3]];
+				directedEdges[EdgeKey(a, b)]++;
+			}
+		}
+
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+		{
+			const GLuint* triangle = &mesh.indices[t];
+			glm::dvec3 p0 = mesh.positions[triangle[0]];
+			glm::dvec3 p1 = mesh.positions[triangle[1]];
+			glm::dvec3 p2 = mesh.positions[triangle[2]];
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double length = glm::length(normal);
+			if (length <= 0.0)
+			{
+				continue;
+			}
+			normal /= length;
+
+			for (int c = 0; c < 3; c++)
+			{
+				AddPlane(quadrics[triangle[c]], normal, -glm::dot(normal, p0), length * 0.5);
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				GLuint va = triangle[e];
+				GLuint vb = triangle[(e + 1) % 3];
+				GLuint pa = mesh.positionIds[va];
+				GLuint pb = mesh.positionIds[vb];
+
+				// edges used twice in one direction are not manifold
+				if (directedEdges[EdgeKey(pa, pb)] > 1)
+				{
+					mesh.bLocked[va] = 1;
+					mesh.bLocked[vb] = 1;
+				}
+
+				if (directedEdges.find(EdgeKey(pb, pa)) == directedEdges.end())
+				{
+					bBorder[va] = 1;
+					bBorder[vb] = 1;
+					borderEdges.insert(UndirectedEdgeKey(va, vb));
+
+					glm::dvec3 edge = glm::dvec3(mesh.positions[vb]) - glm::dvec3(mesh.positions[va]);
+					glm::dvec3 borderNormal = glm::cross(edge, normal);
+					double borderLength = glm::length(borderNormal);
+					if (borderLength > 0.0)
+					{
+						borderNormal /= borderLength;
+						double distance = -glm::dot(borderNormal, glm::dvec3(mesh.positions[va]));
+						double weight = glm::dot(edge, edge) * g_BorderWeight;
+						AddPlane(quadrics[va], borderNormal, distance, weight);
+						AddPlane(quadrics[vb], borderNormal, distance, weight);
+					}
+				}
+			}
+		}
+
+		auto collapseCost = [&](GLuint from, GLuint to)
+		{
+			if ((mesh.bLocked[from] != 0) || (mesh.positionIds[from] == mesh.positionIds[to]))
+			{
+				return(DBL_MAX);
+			}
+			// border vertices may only slide along their border
+			if ((bBorder[from] != 0) && (borderEdges.count(UndirectedEdgeKey(from, to)) == 0))
+			{
+				return(DBL_MAX);
+			}
+
+			QUADRIC quadric = quadrics[from];
+			AddQuadric(quadric, quadrics[to]);
+			double cost = EvaluateQuadric(quadric, mesh.positions[to]);
+
+			// the triangles around the removed vertex take over the
+			// attributes of the kept vertex
+			if (mesh.normals.empty() == false)
+			{
+				glm::dvec3 normalChange = glm::dvec3(mesh.normals[to]) - glm::dvec3(mesh.normals[from]);
+				cost += g_NormalWeight * glm::dot(normalChange, normalChange);
+			}
+			if (mesh.texCoords.empty() == false)
+			{
+				glm::dvec2 texCoordChange = glm::dvec2(mesh.texCoords[to]) - glm::dvec2(mesh.texCoords[from]);
+				cost += g_TexCoordWeight * glm::dot(texCoordChange, texCoordChange);
+			}
+			return(cost);
+		};
+
+		double errorSq = 0.0;
+		std::vector<GLuint> triangleOffsets(nVertices + 1);
+		std::vector<GLuint> vertexTriangles;
+		std::vector<GLuint> remap(nVertices);
+		std::vector<unsigned char> bTouched(nVertices);
+		std::vector<double> bestCost(nVertices);
+		std::vector<GLuint> bestTarget(nVertices);
+		std::vector<COLLAPSE> collapses;
+
+		for (int pass = 0; (pass < g_MaxPasses) && (mesh.indices.size() > targetIndexCount); pass++)
+		{
+			size_t nTriangles = mesh.indices.size() / 3;
+
+			// triangles around each vertex
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				triangleOffsets[mesh.indices[i] + 1]++;
+			}
+			for (size_t v = 0; v < nVertices; v++)
+			{
+				triangleOffsets[v + 1] += triangleOffsets[v];
+			}
+			vertexTriangles.resize(mesh.indices.size());
+			std::vector<GLuint> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				vertexTriangles[fill[mesh.indices[i]]++] = (GLuint)(i / 3);
+			}
+
+			// cheapest collapse of every vertex
+			std::fill(bestCost.begin(), bestCost.end(), DBL_MAX);
+			for (size_t t = 0; t < nTriangles; t++)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					GLuint a = mesh.indices[3 * t + e];
+					GLuint b = mesh.indices[3 * t + (e + 1) % 3];
+					double cost = collapseCost(a, b);
+					if (cost < bestCost[a])
+					{
+						bestCost[a] = cost;
+						bestTarget[a] = b;
+					}
+					cost = collapseCost(b, a);
+					if (cost < bestCost[b])
+					{
+						bestCost[b] = cost;
+						bestTarget[b] = a;
+					}
+				}
+			}
+
+			collapses.clear();
+			for (size_t v = 0; v < nVertices; v++)
+			{
+				if (bestCost[v] <= maxErrorSq)
+				{
+					COLLAPSE collapse;
+					collapse.from = (GLuint)v;
+					collapse.to = bestTarget[v];
+					collapse.cost = bestCost[v];
+					collapses.push_back(collapse);
+				}
+			}
+			if (collapses.empty() == true)
+			{
+				break;
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const COLLAPSE& a, const COLLAPSE& b)
+			{
+				return(a.cost < b.cost);
+			});
+
+			for (size_t v = 0; v < nVertices; v++)
+			{
+				remap[v] = (GLuint)v;
+			}
+			std::fill(bTouched.begin(), bTouched.end(), 0);
+
+			size_t trianglesToRemove = (mesh.indices.size() - targetIndexCount + 2) / 3;
+			size_t removed = 0;
+			for (size_t i = 0; (i < collapses.size()) && (removed < trianglesToRemove); i++)
+			{
+				GLuint from = collapses[i].from;
+				GLuint to = collapses[i].to;
+				if ((bTouched[from] != 0) || (bTouched[to] != 0))
+				{
+					continue;
+				}
+
+				// reject collapses that would turn a triangle over
+				bool bFlips = false;
+				size_t collapsedTriangles = 0;
+				for (GLuint j = triangleOffsets[from]; j < triangleOffsets[from + 1]; j++)
+				{
+					const GLuint* triangle = &mesh.indices[3 * vertexTriangles[j]];
+					if ((triangle[0] == to) || (triangle[1] == to) || (triangle[2] == to))
+					{
+						collapsedTriangles++;
+						continue;
+					}
+
+					glm::vec3 corners[3];
+					glm::vec3 moved[3];
+					for (int c = 0; c < 3; c++)
+					{
+						corners[c] = mesh.positions[triangle[c]];
+						moved[c] = (triangle[c] == from) ? mesh.positions[to] : corners[c];
+					}
+					glm::vec3 oldNormal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					glm::vec3 newNormal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+					if (glm::dot(oldNormal, newNormal) <= 0.0f)
+					{
+						bFlips = true;
+						break;
+					}
+				}
+				if (bFlips == true)
+				{
+					continue;
+				}
+
+				remap[from] = to;
+				AddQuadric(quadrics[to], quadrics[from]);
+				errorSq = std::max(errorSq, collapses[i].cost);
+				removed += collapsedTriangles;
+
+				// the neighborhood changes, so it waits for the next pass
+				for (GLuint j = triangleOffsets[from]; j < triangleOffsets[from + 1]; j++)
+				{
+					const GLuint* triangle = &mesh.indices[3 * vertexTriangles[j]];
+					bTouched[triangle[0]] = 1;
+					bTouched[triangle[1]] = 1;
+					bTouched[triangle[2]] = 1;
+				}
+			}
+			if (removed == 0)
+			{
+				break;
+			}
+
+			// drop the triangles that collapsed
+			size_t written = 0;
+			for (size_t t = 0; t < nTriangles; t++)
+			{
+				GLuint a = remap[mesh.indices[3 * t]];
+				GLuint b = remap[mesh.indices[3 * t + 1]];
+				GLuint c = remap[mesh.indices[3 * t + 2]];
+				if ((mesh.positionIds[a] == mesh.positionIds[b]) ||
+					(mesh.positionIds[b] == mesh.positionIds[c]) ||
+					(mesh.positionIds[a] == mesh.positionIds[c]))
+				{
+					continue;
+				}
+				mesh.indices[written++] = a;
+				mesh.indices[written++] = b;
+				mesh.indices[written++] = c;
+			}
+			mesh.indices.resize(written);
+		}
+
+		return(errorSq);
+	}
+
+	/***********************************************************
+	 *  SimplifyClusters()
+	 *
+	 *  Sort the triangles into a grid of spatial clusters and
+	 *  simplify the clusters in parallel.  Positions used by
+	 *  more than one cluster are locked, so the clusters still
+	 *  fit together afterwards.
+	 ***********************************************************/
+	double SimplifyClusters(
+		const MESH_VERTICES& vertices,
+		std::vector<GLuint>& indices,
+		size_t targetIndexCount,
+		double maxErrorSq)
+	{
+		size_t nTriangles = indices.size() / 3;
+		size_t nClusters = (nTriangles + g_TrianglesPerCluster - 1) / g_TrianglesPerCluster;
+		int gridSize = std::max(1, (int)std::ceil(std::cbrt((double)nClusters)));
+		size_t nCells = (size_t)gridSize * gridSize * gridSize;
+
+		// cluster of every triangle by its centroid, the positions are in the unit cube
+		std::vector<GLuint> triangleCells(nTriangles);
+		std::vector<size_t> cellOffsets(nCells + 1, 0);
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			glm::vec3 centroid = (vertices.positions[indices[3 * t]] +
+				vertices.positions[indices[3 * t + 1]] +
+				vertices.positions[indices[3 * t + 2]]) / 3.0f;
+			glm::ivec3 cell = glm::clamp(glm::ivec3(centroid * (float)gridSize), glm::ivec3(0), glm::ivec3(gridSize - 1));
+			triangleCells[t] = (GLuint)((cell.z * gridSize + cell.y) * gridSize + cell.x);
+			cellOffsets[triangleCells[t] + 1]++;
+		}
+		for (size_t c = 0; c < nCells; c++)
+		{
+			cellOffsets[c + 1] += cellOffsets[c];
+		}
+
+		std::vector<GLuint> cellIndices(indices.size());
+		std::vector<size_t> fill(cellOffsets.begin(), cellOffsets.end() - 1);
+		std::vector<int> firstCell(vertices.positions.size(), -1);
+		std::vector<unsigned char> bBoundary(vertices.positions.size(), 0);
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			GLuint cell = triangleCells[t];
+			for (int c = 0; c < 3; c++)
+			{
+				GLuint vertex = indices[3 * t + c];
+				cellIndices[3 * fill[cell] + c] = vertex;
+
+				GLuint positionId = vertices.positionIds[vertex];
+				if (firstCell[positionId] < 0)
+				{
+					firstCell[positionId] = (int)cell;
+				}
+				else if (firstCell[positionId] != (int)cell)
+				{
+					bBoundary[positionId] = 1;
+				}
+			}
+			fill[cell]++;
+		}
+
+		std::vector<std::vector<GLuint>> results(nCells);
+		std::vector<double> errors(nCells, 0.0);
+		JobSystem::Get().ParallelFor(nCells, [&](size_t cell)
+		{
+			size_t first = 3 * cellOffsets[cell];
+			size_t count = 3 * cellOffsets[cell + 1] - first;
+			if (count == 0)
+			{
+				return;
+			}
+
+			LOCAL_MESH mesh;
+			BuildLocalMesh(vertices, &cellIndices[first], count, &bBoundary, mesh);
+
+			size_t target = (size_t)((double)count * targetIndexCount / indices.size()) / 3 * 3;
+			errors[cell] = SimplifyLocalMesh(mesh, target, maxErrorSq);
+
+			results[cell].resize(mesh.indices.size());
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				results[cell][i] = mesh.localToGlobal[mesh.indices[i]];
+			}
+		});
+
+		indices.clear();
+		double errorSq = 0.0;
+		for (size_t cell = 0; cell < nCells; cell++)
+		{
+			indices.insert(indices.end(), results[cell].begin(), results[cell].end());
+			errorSq = std::max(errorSq, errors[cell]);
+		}
+		return(errorSq);
+	}
+}
+
+/***********************************************************
+ *  Simplify()
+ *
+ *  This function is used for simplifying a triangle list.
+ *  Big meshes are simplified per cluster in parallel first,
+ *  and a final pass over the whole mesh then collapses the
+ *  cluster boundaries.  The output indexes the passed in
+ *  vertices, with identical vertices welded.
+ ***********************************************************/
+float MeshSimplifier::Simplify(
+	const VERTEX_INPUT& vertices,
+	const GLuint* indices,
+	size_t nIndices,
+	size_t targetIndexCount,
+	float targetError,
+	std::vector<GLuint>& output)
+{
+	output.assign(indices, indices + nIndices);
+	if ((nIndices < 3) || (vertices.nVertices == 0) || (targetIndexCount >= nIndices))
+	{
+		return(0.0f);
+	}
+
+	// errors are measured in units of the mesh extent
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	for (size_t i = 0; i < vertices.nVertices; i++)
+	{
+		const GLfloat* position = (const GLfloat*)((const unsigned char*)vertices.positions + i * vertices.positionStride);
+		boundsMin = glm::min(boundsMin, glm::vec3(position[0], position[1], position[2]));
+		boundsMax = glm::max(boundsMax, glm::vec3(position[0], position[1], position[2]));
+	}
+	glm::vec3 size = boundsMax - boundsMin;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+	if (extent <= 0.0f)
+	{
+		return(0.0f);
+	}
+
+	MESH_VERTICES meshVertices;
+	PrepareVertices(vertices, boundsMin, 1.0f / extent, meshVertices);
+
+	// weld identical vertices and drop degenerate triangles
+	std::vector<GLuint> triangles;
+	triangles.reserve(nIndices);
+	for (size_t t = 0; t + 2 < nIndices; t += 3)
+	{
+		if ((indices[t] >= vertices.nVertices) || (indices[t + 1] >= vertices.nVertices) ||
+			(indices[t + 2] >= vertices.nVertices))
+		{
+			continue;
+		}
+		GLuint a = meshVertices.weld[indices[t]];
+		GLuint b = meshVertices.weld[indices[t + 1]];
+		GLuint c = meshVertices.weld[indices[t + 2]];
+		if ((meshVertices.positionIds[a] == meshVertices.positionIds[b]) ||
+			(meshVertices.positionIds[b] == meshVertices.positionIds[c]) ||
+			(meshVertices.positionIds[a] == meshVertices.positionIds[c]))
+		{
+			continue;
+		}
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	double maxErrorSq = (double)targetError * targetError;
+	double errorSq = 0.0;
+	if (triangles.size() / 3 > g_ClusterTriangleThreshold)
+	{
+		errorSq = SimplifyClusters(meshVertices, triangles, targetIndexCount, maxErrorSq);
+	}
+
+	if ((triangles.size() > targetIndexCount) && (triangles.empty() == false))
+	{
+		LOCAL_MESH mesh;
+		BuildLocalMesh(meshVertices, triangles.data(), triangles.size(), NULL, mesh);
+		errorSq = std::max(errorSq, SimplifyLocalMesh(mesh, targetIndexCount, maxErrorSq));
+
+		triangles.resize(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			triangles[i] = mesh.localToGlobal[mesh.indices[i]];
+		}
+	}
+
+	output.swap(triangles);
+	return((float)std::sqrt(errorSq) * extent);
+}
+
+/***********************************************************
+ *  BuildLodChain()
+ *
+ *  This function is used for building a chain of levels of
+ *  detail.  Every level is simplified from the previous
+ *  one, so its error is the sum of the errors along the
+ *  chain.
+ ***********************************************************/
+void MeshSimplifier::BuildLodChain(
+	const VERTEX_INPUT& vertices,
+	const GLuint* indices,
+	size_t nIndices,
+	int maxLevels,
+	std::vector<GLuint>& lodIndices,
+	std::vector<LOD_LEVEL>& levels)
+{
+	std::vector<GLuint> current(indices, indices + nIndices);
+	std::vector<GLuint> next;
+	float error = 0.0f;
+
+	for (int level = 0; level < maxLevels; level++)
+	{
+		size_t target = (size_t)(current.size() / 3 * g_LodReduction) * 3;
+		float levelError = Simplify(vertices, current.data(), current.size(), target, g_LodMaxError, next);
+		if ((next.empty() == true) ||
+			((float)next.size() > (float)current.size() * g_LodMinReduction))
+		{
+			break;
+		}
+
+		error += levelError;
+
+		LOD_LEVEL lod;
+		lod.firstIndex = (GLuint)lodIndices.size();
+		lod.nIndices = (GLuint)next.size();
+		lod.error = error;
+		levels.push_back(lod);
+
+		lodIndices.insert(lodIndices.end(), next.begin(), next.end());
+		current.swap(next);
+	}
+}
\ No newline at end of file
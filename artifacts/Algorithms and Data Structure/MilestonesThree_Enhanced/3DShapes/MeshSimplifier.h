@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshsimplifier.h
+// ============
+// reduce the triangle count of indexed meshes with quadric error metrics,
+// for building level of detail chains
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  MeshSimplifier
+ *
+ *  These functions simplify indexed triangle lists by
+ *  collapsing edges onto one of their vertices, so every
+ *  simplified level indexes the vertices of the original
+ *  mesh and only needs its own indices.  The code has no
+ *  OpenGL dependency beyond the types and can also run in
+ *  an offline tool.
+ ***********************************************************/
+namespace MeshSimplifier
+{
+	// float vertex attributes of the mesh to simplify, with
+	// strides in bytes.  Normals and texture coordinates are
+	// optional, and steer the collapses away from visible
+	// attribute changes
+	struct VERTEX_INPUT
+	{
+		const GLfloat* positions;
+		size_t positionStride;
+		const GLfloat* normals;		// NULL when the mesh has no normals
+		size_t normalStride;
+		const GLfloat* texCoords;	// NULL when the mesh has no texture coordinates
+		size_t texCoordStride;
+		size_t nVertices;
+	};
+
+	// one simplified level, as a range of the level indices
+	struct LOD_LEVEL
+	{
+		GLuint firstIndex;
+		GLuint nIndices;
+		float error;	// largest surface deviation in object space units
+	};
+
+	// simplify a triangle list towards the target number of
+	// indices without exceeding the target error, which is a
+	// fraction of the mesh extent.  Returns the resulting
+	// error in object space units
+	float Simplify(
+		const VERTEX_INPUT& vertices,
+		const GLuint* indices,
+		size_t nIndices,
+		size_t targetIndexCount,
+		float targetError,
+		std::vector<GLuint>& output);
+
+	// build up to maxLevels levels, each with about half the
+	// triangles of the previous one, appending their indices
+	// to lodIndices.  The chain ends early when a level would
+	// barely remove triangles or deviate too far
+	void BuildLodChain(
+		const VERTEX_INPUT& vertices,
+		const GLuint* indices,
+		size_t nIndices,
+		int maxLevels,
+		std::vector<GLuint>& lodIndices,
+		std::vector<LOD_LEVEL>& levels);
+}
\ No newline at end of file
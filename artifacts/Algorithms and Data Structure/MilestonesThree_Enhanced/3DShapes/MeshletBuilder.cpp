@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletbuilder.cpp
+// ============
+// split indexed triangle lists into small clusters of neighboring triangles
+// that can be culled separately
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// meshlets grow up to this size, and end earlier when
+	// no connected triangle fits
+	const size_t g_MaxMeshletTriangles = 128;
+	// below this size any connected triangle is accepted
+	const size_t g_MinMeshletTriangles = 64;
+	// smallest cosine between a triangle and the meshlet
+	// direction once the meshlet has its minimum size
+	const float g_MeshletNormalLimit = 0.5f;
+
+	glm::vec3 ReadPosition(const GLfloat* positions, size_t stride, GLuint vertex)
+	{
+		const GLfloat* position = (const GLfloat*)((const unsigned char*)positions + vertex * stride);
+		return(glm::vec3(position[0], position[1], position[2]));
+	}
+
+	/***********************************************************
+	 *  ComputeBounds()
+	 *
+	 *  Fill in the bounding sphere and normal cone of a
+	 *  meshlet from its triangles.
+	 ***********************************************************/
+	void ComputeBounds(
+		const GLfloat* positions,
+		size_t positionStride,
+		const GLuint* indices,
+		const std::vector<glm::vec3>& triangleNormals,
+		const std::vector<GLuint>& triangles,
+		MeshletBuilder::MESHLET& meshlet)
+	{
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		glm::vec3 axis(0.0f);
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				glm::vec3 position = ReadPosition(positions, positionStride, indices[3 * triangles[i] + c]);
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+			axis += triangleNormals[triangles[i]];
+		}
+
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				glm::vec3 position = ReadPosition(positions, positionStride, indices[3 * triangles[i] + c]);
+				meshlet.radius = std::max(meshlet.radius, glm::length(position - meshlet.center));
+			}
+		}
+
+		// a cone wider than a hemisphere always has a triangle
+		// facing the camera
+		meshlet.coneAxis = glm::vec3(0.0f);
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = glm::length(axis);
+		if (axisLength <= 0.0f)
+		{
+			return;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.0f;
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			const glm::vec3& normal = triangleNormals[triangles[i]];
+			if (glm::dot(normal, normal) > 0.0f)
+			{
+				minDot = std::min(minDot, glm::dot(normal, axis));
+			}
+		}
+		if (minDot > 0.0f)
+		{
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildMeshlets()
+ *
+ *  This function is used for splitting a triangle list
+ *  into meshlets.  Every meshlet starts at the first
+ *  triangle that is not assigned yet and grows breadth
+ *  first over triangles sharing a vertex, so it stays
+ *  compact.  Past its minimum size it only accepts
+ *  triangles facing the meshlet direction, which keeps
+ *  the normal cones narrow enough to be culled.
+ ***********************************************************/
+void MeshletBuilder::BuildMeshlets(
+	const GLfloat* positions,
+	size_t positionStride,
+	size_t nVertices,
+	const GLuint* indices,
+	size_t nIndices,
+	std::vector<GLuint>& meshletIndices,
+	std::vector<MESHLET>& meshlets)
+{
+	size_t nTriangles = nIndices / 3;
+	meshletIndices.clear();
+	meshletIndices.reserve(nTriangles * 3);
+	meshlets.clear();
+
+	// unit normal of every triangle, zero for degenerate ones
+	std::vector<glm::vec3> triangleNormals(nTriangles);
+	for (size_t t = 0; t < nTriangles; t++)
+	{
+		glm::vec3 p0 = ReadPosition(positions, positionStride, indices[3 * t]);
+		glm::vec3 p1 = ReadPosition(positions, positionStride, indices[3 * t + 1]);
+		glm::vec3 p2 = ReadPosition(positions, positionStride, indices[3 * t + 2]);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		triangleNormals[t] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+	}
+
+	// triangles around each vertex
+	std::vector<GLuint> triangleOffsets(nVertices + 1, 0);
+	for (size_t i = 0; i < nTriangles * 3; i++)
+	{
+		triangleOffsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		triangleOffsets[v + 1] += triangleOffsets[v];
+	}
+	std::vector<GLuint> vertexTriangles(nTriangles * 3);
+	std::vector<GLuint> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t i = 0; i < nTriangles * 3; i++)
+	{
+		vertexTriangles[fill[indices[i]]++] = (GLuint)(i / 3);
+	}
+
+	std::vector<unsigned char> bAssigned(nTriangles, 0);
+	std::vector<unsigned char> bQueued(nTriangles, 0);
+	std::vector<GLuint> queue;
+	std::vector<GLuint> triangles;
+
+	for (size_t seed = 0; seed < nTriangles; seed++)
+	{
+		if (bAssigned[seed] != 0)
+		{
+			continue;
+		}
+
+		triangles.clear();
+		queue.clear();
+		queue.push_back((GLuint)seed);
+		bQueued[seed] = 1;
+		glm::vec3 direction(0.0f);
+
+		for (size_t head = 0; (head < queue.size()) && (triangles.size() < g_MaxMeshletTriangles); head++)
+		{
+			GLuint triangle = queue[head];
+			const glm::vec3& normal = triangleNormals[triangle];
+			if (triangles.size() >= g_MinMeshletTriangles)
+			{
+				float directionLength = glm::length(direction);
+				if ((directionLength > 0.0f) &&
+					(glm::dot(normal, direction / directionLength) < g_MeshletNormalLimit))
+				{
+					continue;
+				}
+			}
+
+			bAssigned[triangle] = 1;
+			triangles.push_back(triangle);
+			direction += normal;
+
+			for (int c = 0; c < 3; c++)
+			{
+				GLuint vertex = indices[3 * triangle + c];
+				for (GLuint j = triangleOffsets[vertex]; j < triangleOffsets[vertex + 1]; j++)
+				{
+					GLuint neighbor = vertexTriangles[j];
+					if ((bAssigned[neighbor] == 0) && (bQueued[neighbor] == 0))
+					{
+						bQueued[neighbor] = 1;
+						queue.push_back(neighbor);
+					}
+				}
+			}
+		}
+
+		// rejected and unvisited triangles can join later meshlets
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			bQueued[queue[i]] = 0;
+		}
+
+		MESHLET meshlet;
+		meshlet.firstIndex = (GLuint)meshletIndices.size();
+		meshlet.nIndices = (GLuint)(triangles.size() * 3);
+		ComputeBounds(positions, positionStride, indices, triangleNormals, triangles, meshlet);
+		meshlets.push_back(meshlet);
+
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			meshletIndices.push_back(indices[3 * triangles[i]]);
+			meshletIndices.push_back(indices[3 * triangles[i] + 1]);
+			meshletIndices.push_back(indices[3 * triangles[i] + 2]);
+		}
+	}
+}
\ No newline at end of file
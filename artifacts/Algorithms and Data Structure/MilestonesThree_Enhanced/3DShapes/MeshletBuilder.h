@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletbuilder.h
+// ============
+// split indexed triangle lists into small clusters of neighboring triangles
+// that can be culled separately
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  MeshletBuilder
+ *
+ *  These functions reorder the triangles of a mesh into
+ *  meshlets of up to 128 connected triangles that face
+ *  roughly the same way.  Each meshlet is a contiguous
+ *  range of the reordered indices, with a bounding sphere
+ *  for frustum culling and a normal cone for culling
+ *  meshlets that face away from the camera.
+ ***********************************************************/
+namespace MeshletBuilder
+{
+	struct MESHLET
+	{
+		GLuint firstIndex;		// first index in the reordered indices
+		GLuint nIndices;
+		glm::vec3 center;		// bounding sphere in object space
+		float radius;
+		glm::vec3 coneAxis;		// average facing direction of the triangles
+		float coneCutoff;		// sine of the cone spread, 1 when it cannot be culled
+	};
+
+	// split the triangle list into meshlets, writing the
+	// reordered indices with the triangles of each meshlet
+	// next to each other.  The positions are three floats
+	// with a stride in bytes
+	void BuildMeshlets(
+		const GLfloat* positions,
+		size_t positionStride,
+		size_t nVertices,
+		const GLuint* indices,
+		size_t nIndices,
+		std::vector<GLuint>& meshletIndices,
+		std::vector<MESHLET>& meshlets);
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletculler.cpp
+// ============
+// drop the meshlets of a mesh that are outside the view frustum or facing
+// away from the camera, and collect the rest into indirect draw commands
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshletCuller.h"
+#include "JobSystem.h"
+#include "SimdFloats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// meshlets tested together by one job
+	const size_t g_GroupsPerChunk = 256;
+
+	/***********************************************************
+	 *  AppendCommand()
+	 *
+	 *  Add an index range to the draw commands, extending the
+	 *  last command when the range follows it directly.
+	 ***********************************************************/
+	void AppendCommand(
+		std::vector<MeshletCuller::DRAW_COMMAND>& commands,
+		GLuint firstIndex,
+		GLuint count,
+		GLint baseVertex)
+	{
+		if ((commands.empty() == false) &&
+			(commands.back().baseVertex == baseVertex) &&
+			(commands.back().firstIndex + commands.back().count == firstIndex))
+		{
+			commands.back().count += count;
+			return;
+		}
+
+		MeshletCuller::DRAW_COMMAND command;
+		command.count = count;
+		command.instanceCount = 1;
+		command.firstIndex = firstIndex;
+		command.baseVertex = baseVertex;
+		command.baseInstance = 0;
+		commands.push_back(command);
+	}
+}
+
+/***********************************************************
+ *  MeshletCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshletCuller::MeshletCuller()
+{
+	m_nMeshlets = 0;
+}
+
+/***********************************************************
+ *  SetMeshlets()
+ *
+ *  This method is used for storing the meshlet bounds in
+ *  structure of arrays form.  The padding entries have a
+ *  huge negative radius, so every frustum plane culls them.
+ ***********************************************************/
+void MeshletCuller::SetMeshlets(const std::vector<MeshletBuilder::MESHLET>& meshlets)
+{
+	m_nMeshlets = meshlets.size();
+	size_t paddedCount = (m_nMeshlets + 3) & ~(size_t)3;
+
+	m_centerX.assign(paddedCount, 0.0f);
+	m_centerY.assign(paddedCount, 0.0f);
+	m_centerZ.assign(paddedCount, 0.0f);
+	m_radius.assign(paddedCount, -FLT_MAX);
+	m_coneAxisX.assign(paddedCount, 0.0f);
+	m_coneAxisY.assign(paddedCount, 0.0f);
+	m_coneAxisZ.assign(paddedCount, 0.0f);
+	m_coneCutoff.assign(paddedCount, 1.0f);
+	m_firstIndex.assign(paddedCount, 0);
+	m_nIndices.assign(paddedCount, 0);
+
+	for (size_t i = 0; i < m_nMeshlets; i++)
+	{
+		m_centerX[i] = meshlets[i].center.x;
+		m_centerY[i] = meshlets[i].center.y;
+		m_centerZ[i] = meshlets[i].center.z;
+		m_radius[i] = meshlets[i].radius;
+		m_coneAxisX[i] = meshlets[i].coneAxis.x;
+		m_coneAxisY[i] = meshlets[i].coneAxis.y;
+		m_coneAxisZ[i] = meshlets[i].coneAxis.z;
+		m_coneCutoff[i] = meshlets[i].coneCutoff;
+		m_firstIndex[i] = meshlets[i].firstIndex;
+		m_nIndices[i] = meshlets[i].nIndices;
+	}
+}
+
+/***********************************************************
+ *  GetMeshletCount()
+ *
+ *  This method is used for getting the number of meshlets
+ ***********************************************************/
+size_t MeshletCuller::GetMeshletCount() const
+{
+	return(m_nMeshlets);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for culling the meshlets for the
+ *  current view.  The frustum planes are extracted from
+ *  the model-view-projection matrix, so they are already
+ *  in object space and the meshlet bounds are tested
+ *  without transforming them.  Chunks of meshlets are
+ *  culled in parallel and their commands joined in order.
+ ***********************************************************/
+size_t MeshletCuller::Cull(
+	const glm::mat4& modelViewProjection,
+	const glm::vec3& cameraPosition,
+	GLuint firstIndex,
+	GLint baseVertex,
+	std::vector<DRAW_COMMAND>& commands)
+{
+	CULL_VIEW view;
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+	{
+		rows[r] = glm::vec4(modelViewProjection[0][r], modelViewProjection[1][r],
+			modelViewProjection[2][r], modelViewProjection[3][r]);
+	}
+	view.planes[0] = rows[3] + rows[0];	// left
+	view.planes[1] = rows[3] - rows[0];	// right
+	view.planes[2] = rows[3] + rows[1];	// bottom
+	view.planes[3] = rows[3] - rows[1];	// top
+	view.planes[4] = rows[3] + rows[2];	// near
+	view.planes[5] = rows[3] - rows[2];	// far
+	for (int p = 0; p < 6; p++)
+	{
+		float length = glm::length(glm::vec3(view.planes[p]));
+		if (length > 0.0f)
+		{
+			view.planes[p] /= length;
+		}
+	}
+	view.cameraPosition = cameraPosition;
+
+	size_t nGroups = m_centerX.size() / 4;
+	size_t nChunks = (nGroups + g_GroupsPerChunk - 1) / g_GroupsPerChunk;
+	if (nChunks <= 1)
+	{
+		return(CullGroups(view, 0, nGroups, firstIndex, baseVertex, commands));
+	}
+
+	m_chunkCommands.resize(nChunks);
+	m_chunkVisible.resize(nChunks);
+	JobSystem::Get().ParallelFor(nChunks, [&](size_t chunk)
+	{
+		m_chunkCommands[chunk].clear();
+		m_chunkVisible[chunk] = CullGroups(view,
+			chunk * g_GroupsPerChunk,
+			std::min(nGroups, (chunk + 1) * g_GroupsPerChunk),
+			firstIndex, baseVertex, m_chunkCommands[chunk]);
+	});
+
+	size_t nVisible = 0;
+	for (size_t chunk = 0; chunk < nChunks; chunk++)
+	{
+		for (size_t i = 0; i < m_chunkCommands[chunk].size(); i++)
+		{
+			const DRAW_COMMAND& command = m_chunkCommands[chunk][i];
+			AppendCommand(commands, command.firstIndex, command.count, command.baseVertex);
+		}
+		nVisible += m_chunkVisible[chunk];
+	}
+	return(nVisible);
+}
+
+/***********************************************************
+ *  CullGroups()
+ *
+ *  This method is used for testing groups of four meshlets.
+ *  A meshlet is culled when its bounding sphere is behind
+ *  one of the frustum planes, or when the camera is inside
+ *  the back side of its normal cone so all its triangles
+ *  face away.
+ ***********************************************************/
+size_t MeshletCuller::CullGroups(
+	const CULL_VIEW& view,
+	size_t firstGroup,
+	size_t lastGroup,
+	GLuint firstIndex,
+	GLint baseVertex,
+	std::vector<DRAW_COMMAND>& commands)
+{
+	size_t nVisible = 0;
+
+	for (size_t group = firstGroup; group < lastGroup; group++)
+	{
+		size_t first = group * 4;
+
+		FLOATS4 centerX = LoadFloats4(&m_centerX[first]);
+		FLOATS4 centerY = LoadFloats4(&m_centerY[first]);
+		FLOATS4 centerZ = LoadFloats4(&m_centerZ[first]);
+		FLOATS4 radius = LoadFloats4(&m_radius[first]);
+		FLOATS4 negativeRadius = Sub(SetFloats4(0.0f), radius);
+
+		// a meshlet faces away when the camera is inside its
+		// back facing cone
+		FLOATS4 offsetX = Sub(centerX, SetFloats4(view.cameraPosition.x));
+		FLOATS4 offsetY = Sub(centerY, SetFloats4(view.cameraPosition.y));
+		FLOATS4 offsetZ = Sub(centerZ, SetFloats4(view.cameraPosition.z));
+		FLOATS4 distance = Sqrt(Add(Add(Mul(offsetX, offsetX), Mul(offsetY, offsetY)), Mul(offsetZ, offsetZ)));
+		FLOATS4 facing = Add(Add(
+			Mul(offsetX, LoadFloats4(&m_coneAxisX[first])),
+			Mul(offsetY, LoadFloats4(&m_coneAxisY[first]))),
+			Mul(offsetZ, LoadFloats4(&m_coneAxisZ[first])));
+		FLOATS4 visible = Less(facing, Add(Mul(LoadFloats4(&m_coneCutoff[first]), distance), radius));
+
+		for (int p = 0; p < 6; p++)
+		{
+			FLOATS4 planeDistance = Add(
+				Add(Mul(centerX, SetFloats4(view.planes[p].x)), Mul(centerY, SetFloats4(view.planes[p].y))),
+				Add(Mul(centerZ, SetFloats4(view.planes[p].z)), SetFloats4(view.planes[p].w)));
+			visible = And(visible, GreaterEqual(planeDistance, negativeRadius));
+		}
+
+		int visibleMask = MaskBits(visible);
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((visibleMask & (1 << lane)) != 0)
+			{
+				AppendCommand(commands, firstIndex + m_firstIndex[first + lane], m_nIndices[first + lane], baseVertex);
+				nVisible++;
+			}
+		}
+	}
+
+	return(nVisible);
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletculler.h
+// ============
+// drop the meshlets of a mesh that are outside the view frustum or facing
+// away from the camera, and collect the rest into indirect draw commands
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshletBuilder.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  MeshletCuller
+ *
+ *  This class keeps the bounds of the meshlets of one mesh
+ *  in structure of arrays form, so four meshlets are tested
+ *  at once with SSE.  Large meshes are culled in chunks on
+ *  the job system.  The visible meshlets are written as
+ *  glMultiDrawElementsIndirect() commands in mesh order,
+ *  with neighboring meshlets merged into one command.
+ ***********************************************************/
+class MeshletCuller
+{
+public:
+	// layout of a glMultiDrawElementsIndirect() command
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// constructor
+	MeshletCuller();
+
+	// store the bounds of the passed in meshlets
+	void SetMeshlets(const std::vector<MeshletBuilder::MESHLET>& meshlets);
+
+	size_t GetMeshletCount() const;
+
+	// cull the meshlets against the object space view of
+	// the passed in model-view-projection matrix and camera
+	// position, and append the draw commands of the visible
+	// ones to the list.  The first index and base vertex of
+	// the mesh are added to the commands.  Returns the
+	// number of visible meshlets
+	size_t Cull(
+		const glm::mat4& modelViewProjection,
+		const glm::vec3& cameraPosition,
+		GLuint firstIndex,
+		GLint baseVertex,
+		std::vector<DRAW_COMMAND>& commands);
+
+private:
+	// the object space view shared by all the tests
+	struct CULL_VIEW
+	{
+		glm::vec4 planes[6];
+		glm::vec3 cameraPosition;
+	};
+
+	// called to test a range of groups of four meshlets and
+	// write the commands of the visible ones
+	size_t CullGroups(
+		const CULL_VIEW& view,
+		size_t firstGroup,
+		size_t lastGroup,
+		GLuint firstIndex,
+		GLint baseVertex,
+		std::vector<DRAW_COMMAND>& commands);
+
+	size_t m_nMeshlets;
+
+	// meshlet bounds, padded to a multiple of four with
+	// entries that are always culled
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+	std::vector<float> m_coneAxisX;
+	std::vector<float> m_coneAxisY;
+	std::vector<float> m_coneAxisZ;
+	std::vector<float> m_coneCutoff;
+	std::vector<GLuint> m_firstIndex;
+	std::vector<GLuint> m_nIndices;
+
+	// commands and visible counts of each chunk of a
+	// parallel cull, before they are joined
+	std::vector<std::vector<DRAW_COMMAND>> m_chunkCommands;
+	std::vector<size_t> m_chunkVisible;
+};
\ No newline at end of file
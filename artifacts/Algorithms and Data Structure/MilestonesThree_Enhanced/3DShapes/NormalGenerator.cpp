@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalgenerator.cpp
+// ============
+// generate smooth vertex normals and normal mapping tangents for whole
+// indexed triangle meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NormalGenerator.h"
+#include "SimdFloats.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// lengths below this are treated as zero
+	const float g_MinLength = 1e-20f;
+
+	// three float components in structure of arrays form
+	struct FLOAT3_ARRAYS
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+
+		void Resize(size_t count)
+		{
+			x.assign(count, 0.0f);
+			y.assign(count, 0.0f);
+			z.assign(count, 0.0f);
+		}
+	};
+
+	size_t RoundUp(size_t count)
+	{
+		return((count + g_Lanes - 1) / g_Lanes * g_Lanes);
+	}
+
+	const GLfloat* GetElement(const GLfloat* data, size_t stride, size_t i)
+	{
+		return((const GLfloat*)((const unsigned char*)data + i * stride));
+	}
+
+	// indices outside the vertex range make the triangle degenerate
+	bool IsValidTriangle(const GLuint* indices, size_t t, size_t nVertices)
+	{
+		return((indices[3 * t] < nVertices) && (indices[3 * t + 1] < nVertices) && (indices[3 * t + 2] < nVertices));
+	}
+
+	/***********************************************************
+	 *  GatherCorners()
+	 *
+	 *  Copy a vertex attribute of the three corners of every
+	 *  triangle into one array per corner and component, so
+	 *  the triangles can be processed lane by lane.
+	 ***********************************************************/
+	void GatherCorners(
+		const GLfloat* data,
+		size_t stride,
+		int components,
+		size_t nVertices,
+		const GLuint* indices,
+		size_t nTriangles,
+		FLOAT3_ARRAYS* corners)
+	{
+		size_t paddedCount = RoundUp(nTriangles);
+		for (int c = 0; c < 3; c++)
+		{
+			corners[c].Resize(paddedCount);
+		}
+
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			if (IsValidTriangle(indices, t, nVertices) == false)
+			{
+				continue;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				const GLfloat* element = GetElement(data, stride, indices[3 * t + c]);
+				corners[c].x[t] = element[0];
+				corners[c].y[t] = element[1];
+				if (components > 2)
+				{
+					corners[c].z[t] = element[2];
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  CornerCosine()
+	 *
+	 *  Cosine of the angle between two edges, or one for
+	 *  degenerate edges so their corner gets no weight.
+	 ***********************************************************/
+	FLOATS CornerCosine(
+		FLOATS ax, FLOATS ay, FLOATS az,
+		FLOATS bx, FLOATS by, FLOATS bz)
+	{
+		FLOATS lengths = Sqrt(Mul(
+			Add(Add(Mul(ax, ax), Mul(ay, ay)), Mul(az, az)),
+			Add(Add(Mul(bx, bx), Mul(by, by)), Mul(bz, bz))));
+		FLOATS dot = Add(Add(Mul(ax, bx), Mul(ay, by)), Mul(az, bz));
+		FLOATS cosine = Div(dot, Max(lengths, SetFloats(g_MinLength)));
+		cosine = Max(Min(cosine, SetFloats(1.0f)), SetFloats(-1.0f));
+		return(SelectPositive(Sub(lengths, SetFloats(g_MinLength)), cosine, SetFloats(1.0f)));
+	}
+}
+
+/***********************************************************
+ *  GenerateNormals()
+ *
+ *  This function is used for generating vertex normals.
+ *  The unnormalized cross product of each triangle is
+ *  twice its area along its normal, so summing them per
+ *  vertex weights every triangle by its area.
+ ***********************************************************/
+void NormalGenerator::GenerateNormals(
+	const VERTEX_DATA& vertices,
+	const GLuint* indices,
+	size_t nIndices,
+	GLfloat* normals,
+	size_t normalStride)
+{
+	size_t nTriangles = nIndices / 3;
+	size_t nVertices = vertices.nVertices;
+
+	FLOAT3_ARRAYS corners[3];
+	GatherCorners(vertices.positions, vertices.positionStride, 3, nVertices, indices, nTriangles, corners);
+
+	// face normals, a group of lanes at a time
+	FLOAT3_ARRAYS faceNormals;
+	faceNormals.Resize(RoundUp(nTriangles));
+	for (size_t t = 0; t < faceNormals.x.size(); t += g_Lanes)
+	{
+		FLOATS e1x = Sub(LoadFloats(&corners[1].x[t]), LoadFloats(&corners[0].x[t]));
+		FLOATS e1y = Sub(LoadFloats(&corners[1].y[t]), LoadFloats(&corners[0].y[t]));
+		FLOATS e1z = Sub(LoadFloats(&corners[1].z[t]), LoadFloats(&corners[0].z[t]));
+		FLOATS e2x = Sub(LoadFloats(&corners[2].x[t]), LoadFloats(&corners[0].x[t]));
+		FLOATS e2y = Sub(LoadFloats(&corners[2].y[t]), LoadFloats(&corners[0].y[t]));
+		FLOATS e2z = Sub(LoadFloats(&corners[2].z[t]), LoadFloats(&corners[0].z[t]));
+
+		StoreFloats(&faceNormals.x[t], Sub(Mul(e1y, e2z), Mul(e1z, e2y)));
+		StoreFloats(&faceNormals.y[t], Sub(Mul(e1z, e2x), Mul(e1x, e2z)));
+		StoreFloats(&faceNormals.z[t], Sub(Mul(e1x, e2y), Mul(e1y, e2x)));
+	}
+
+	// the corners scatter into shared vertices one at a time
+	FLOAT3_ARRAYS sums;
+	sums.Resize(RoundUp(nVertices));
+	for (size_t t = 0; t < nTriangles; t++)
+	{
+		if (IsValidTriangle(indices, t, nVertices) == false)
+		{
+			continue;
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			GLuint vertex = indices[3 * t + c];
+			sums.x[vertex] += faceNormals.x[t];
+			sums.y[vertex] += faceNormals.y[t];
+			sums.z[vertex] += faceNormals.z[t];
+		}
+	}
+
+	for (size_t v = 0; v < sums.x.size(); v += g_Lanes)
+	{
+		FLOATS x = LoadFloats(&sums.x[v]);
+		FLOATS y = LoadFloats(&sums.y[v]);
+		FLOATS z = LoadFloats(&sums.z[v]);
+		FLOATS length = Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)));
+		FLOATS valid = Sub(length, SetFloats(g_MinLength));
+		length = Max(length, SetFloats(g_MinLength));
+
+		StoreFloats(&sums.x[v], SelectPositive(valid, Div(x, length), SetFloats(0.0f)));
+		StoreFloats(&sums.y[v], SelectPositive(valid, Div(y, length), SetFloats(1.0f)));
+		StoreFloats(&sums.z[v], SelectPositive(valid, Div(z, length), SetFloats(0.0f)));
+	}
+
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		GLfloat* normal = (GLfloat*)((unsigned char*)normals + v * normalStride);
+		normal[0] = sums.x[v];
+		normal[1] = sums.y[v];
+		normal[2] = sums.z[v];
+	}
+}
+
+/***********************************************************
+ *  GenerateTangents()
+ *
+ *  This function is used for generating tangents the way
+ *  MikkTSpace defines them.  The tangent of each triangle
+ *  follows the increasing u texture coordinate, and its
+ *  handedness is the sign of the texture space area.  At
+ *  each corner the triangle tangent is projected onto the
+ *  plane of the vertex normal, normalized and weighted by
+ *  the corner angle.  Vertices shared by mirrored and
+ *  unmirrored triangles take the handedness of the larger
+ *  angle sum, since the vertex buffer cannot be split.
+ ***********************************************************/
+void NormalGenerator::GenerateTangents(
+	const VERTEX_DATA& vertices,
+	const GLuint* indices,
+	size_t nIndices,
+	GLfloat* tangents,
+	size_t tangentStride)
+{
+	size_t nTriangles = nIndices / 3;
+	size_t nVertices = vertices.nVertices;
+	size_t paddedTriangles = RoundUp(nTriangles);
+
+	FLOAT3_ARRAYS corners[3];
+	FLOAT3_ARRAYS texCoords[3];
+	GatherCorners(vertices.positions, vertices.positionStride, 3, nVertices, indices, nTriangles, corners);
+	GatherCorners(vertices.texCoords, vertices.texCoordStride, 2, nVertices, indices, nTriangles, texCoords);
+
+	// face tangents, handedness and corner angle cosines
+	FLOAT3_ARRAYS faceTangents;
+	faceTangents.Resize(paddedTriangles);
+	std::vector<float> faceSigns(paddedTriangles);
+	FLOAT3_ARRAYS cornerCosines;
+	cornerCosines.Resize(paddedTriangles);
+
+	for (size_t t = 0; t < paddedTriangles; t += g_Lanes)
+	{
+		FLOATS p0x = LoadFloats(&corners[0].x[t]);
+		FLOATS p0y = LoadFloats(&corners[0].y[t]);
+		FLOATS p0z = LoadFloats(&corners[0].z[t]);
+		FLOATS e1x = Sub(LoadFloats(&corners[1].x[t]), p0x);
+		FLOATS e1y = Sub(LoadFloats(&corners[1].y[t]), p0y);
+		FLOATS e1z = Sub(LoadFloats(&corners[1].z[t]), p0z);
+		FLOATS e2x = Sub(LoadFloats(&corners[2].x[t]), p0x);
+		FLOATS e2y = Sub(LoadFloats(&corners[2].y[t]), p0y);
+		FLOATS e2z = Sub(LoadFloats(&corners[2].z[t]), p0z);
+
+		FLOATS u0 = LoadFloats(&texCoords[0].x[t]);
+		FLOATS v0 = LoadFloats(&texCoords[0].y[t]);
+		FLOATS d1u = Sub(LoadFloats(&texCoords[1].x[t]), u0);
+		FLOATS d1v = Sub(LoadFloats(&texCoords[1].y[t]), v0);
+		FLOATS d2u = Sub(LoadFloats(&texCoords[2].x[t]), u0);
+		FLOATS d2v = Sub(LoadFloats(&texCoords[2].y[t]), v0);
+
+		// twice the signed texture space area
+		FLOATS area = Sub(Mul(d1u, d2v), Mul(d2u, d1v));
+		FLOATS sign = SelectPositive(area, SetFloats(1.0f),
+			SelectPositive(Sub(SetFloats(0.0f), area), SetFloats(-1.0f), SetFloats(0.0f)));
+
+		// the direction of increasing u, scaled by the sign of the
+		// area instead of its inverse, since only the direction is used
+		StoreFloats(&faceTangents.x[t], Mul(Sub(Mul(e1x, d2v), Mul(e2x, d1v)), sign));
+		StoreFloats(&faceTangents.y[t], Mul(Sub(Mul(e1y, d2v), Mul(e2y, d1v)), sign));
+		StoreFloats(&faceTangents.z[t], Mul(Sub(Mul(e1z, d2v), Mul(e2z, d1v)), sign));
+		StoreFloats(&faceSigns[t], sign);
+
+		// edges from corners 1 and 2 to the other corners
+		FLOATS e3x = Sub(e2x, e1x);
+		FLOATS e3y = Sub(e2y, e1y);
+		FLOATS e3z = Sub(e2z, e1z);
+		FLOATS zero = SetFloats(0.0f);
+		StoreFloats(&cornerCosines.x[t], CornerCosine(e1x, e1y, e1z, e2x, e2y, e2z));
+		StoreFloats(&cornerCosines.y[t], CornerCosine(Sub(zero, e1x), Sub(zero, e1y), Sub(zero, e1z), e3x, e3y, e3z));
+		StoreFloats(&cornerCosines.z[t], CornerCosine(Sub(zero, e2x), Sub(zero, e2y), Sub(zero, e2z),
+			Sub(zero, e3x), Sub(zero, e3y), Sub(zero, e3z)));
+	}
+
+	// vertex normals in structure of arrays form
+	size_t paddedVertices = RoundUp(nVertices);
+	FLOAT3_ARRAYS vertexNormals;
+	vertexNormals.Resize(paddedVertices);
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		const GLfloat* normal = GetElement(vertices.normals, vertices.normalStride, v);
+		vertexNormals.x[v] = normal[0];
+		vertexNormals.y[v] = normal[1];
+		vertexNormals.z[v] = normal[2];
+	}
+
+	// the corners scatter into shared vertices one at a time
+	FLOAT3_ARRAYS sums;
+	sums.Resize(paddedVertices);
+	std::vector<float> handedness(paddedVertices, 0.0f);
+	for (size_t t = 0; t < nTriangles; t++)
+	{
+		if ((faceSigns[t] == 0.0f) || (IsValidTriangle(indices, t, nVertices) == false))
+		{
+			continue;
+		}
+
+		glm::vec3 faceTangent(faceTangents.x[t], faceTangents.y[t], faceTangents.z[t]);
+		float cosines[3] = { cornerCosines.x[t], cornerCosines.y[t], cornerCosines.z[t] };
+		for (int c = 0; c < 3; c++)
+		{
+			GLuint vertex = indices[3 * t + c];
+			glm::vec3 normal(vertexNormals.x[vertex], vertexNormals.y[vertex], vertexNormals.z[vertex]);
+			glm::vec3 tangent = faceTangent - normal * glm::dot(normal, faceTangent);
+			float length = glm::length(tangent);
+			if (length <= g_MinLength)
+			{
+				continue;
+			}
+
+			float weight = std::acos(cosines[c]);
+			tangent *= weight / length;
+			sums.x[vertex] += tangent.x;
+			sums.y[vertex] += tangent.y;
+			sums.z[vertex] += tangent.z;
+			handedness[vertex] += weight * faceSigns[t];
+		}
+	}
+
+	// orthogonalize against the normal again and normalize
+	for (size_t v = 0; v < paddedVertices; v += g_Lanes)
+	{
+		FLOATS nx = LoadFloats(&vertexNormals.x[v]);
+		FLOATS ny = LoadFloats(&vertexNormals.y[v]);
+		FLOATS nz = LoadFloats(&vertexNormals.z[v]);
+		FLOATS x = LoadFloats(&sums.x[v]);
+		FLOATS y = LoadFloats(&sums.y[v]);
+		FLOATS z = LoadFloats(&sums.z[v]);
+		FLOATS dot = Add(Add(Mul(nx, x), Mul(ny, y)), Mul(nz, z));
+		x = Sub(x, Mul(nx, dot));
+		y = Sub(y, Mul(ny, dot));
+		z = Sub(z, Mul(nz, dot));
+
+		FLOATS length = Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)));
+		FLOATS valid = Sub(length, SetFloats(g_MinLength));
+		length = Max(length, SetFloats(g_MinLength));
+		FLOATS zero = SetFloats(0.0f);
+
+		StoreFloats(&sums.x[v], SelectPositive(valid, Div(x, length), zero));
+		StoreFloats(&sums.y[v], SelectPositive(valid, Div(y, length), zero));
+		StoreFloats(&sums.z[v], SelectPositive(valid, Div(z, length), zero));
+	}
+
+	for (size_t v = 0; v < nVertices; v++)
+	{
+		glm::vec3 tangent(sums.x[v], sums.y[v], sums.z[v]);
+
+		// vertices without texture space get any tangent
+		// orthogonal to their normal
+		if (glm::dot(tangent, tangent) == 0.0f)
+		{
+			glm::vec3 normal(vertexNormals.x[v], vertexNormals.y[v], vertexNormals.z[v]);
+			glm::vec3 axis = (std::fabs(normal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			tangent = axis - normal * glm::dot(normal, axis);
+			float length = glm::length(tangent);
+			tangent = (length > g_MinLength) ? tangent / length : glm::vec3(1.0f, 0.0f, 0.0f);
+		}
+
+		GLfloat* output = (GLfloat*)((unsigned char*)tangents + v * tangentStride);
+		output[0] = tangent.x;
+		output[1] = tangent.y;
+		output[2] = tangent.z;
+		output[3] = (handedness[v] < 0.0f) ? -1.0f : 1.0f;
+	}
+}
+
+/***********************************************************
+ *  GetLaneCount()
+ *
+ *  This function is used for reporting which of the kernel
+ *  builds was compiled in.
+ ***********************************************************/
+size_t NormalGenerator::GetLaneCount()
+{
+	return(g_Lanes);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalgenerator.h
+// ============
+// generate smooth vertex normals and normal mapping tangents for whole
+// indexed triangle meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  NormalGenerator
+ *
+ *  These functions compute vertex normals and tangents for
+ *  all the triangles of a mesh at once.  The triangle
+ *  corners are gathered into structure of arrays form, so
+ *  the per-triangle math runs on four (SSE) or eight (AVX)
+ *  triangles per instruction, and only the scatter into
+ *  the shared vertices is done one corner at a time.
+ ***********************************************************/
+namespace NormalGenerator
+{
+	// float vertex attributes of a mesh, with strides in
+	// bytes.  Missing attributes are NULL
+	struct VERTEX_DATA
+	{
+		const GLfloat* positions;
+		size_t positionStride;
+		const GLfloat* normals;
+		size_t normalStride;
+		const GLfloat* texCoords;
+		size_t texCoordStride;
+		size_t nVertices;
+	};
+
+	// write area weighted smooth normals of the positions
+	// as three floats per vertex.  Vertices without a
+	// triangle get (0, 1, 0)
+	void GenerateNormals(
+		const VERTEX_DATA& vertices,
+		const GLuint* indices,
+		size_t nIndices,
+		GLfloat* normals,
+		size_t normalStride);
+
+	// write tangents following the MikkTSpace conventions as
+	// four floats per vertex, needing normals and texture
+	// coordinates.  The tangent is orthogonal to the normal,
+	// and w holds the handedness, so the bitangent is
+	// w * cross(normal, tangent)
+	void GenerateTangents(
+		const VERTEX_DATA& vertices,
+		const GLuint* indices,
+		size_t nIndices,
+		GLfloat* tangents,
+		size_t tangentStride);
+
+	// triangles handled per instruction by this build, 8
+	// (AVX), 4 (SSE) or 1 without SIMD
+	size_t GetLaneCount();
+}
\ No newline at end of file
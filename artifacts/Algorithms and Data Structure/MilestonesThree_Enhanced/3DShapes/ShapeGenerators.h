@@ -0,0 +1,400 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegenerators.h
+// ============
+// constexpr generators for the interleaved vertex data of the 3D primitives,
+// so the default-resolution shapes are baked into the executable at compile
+// time while the same code still serves non-default parameters at runtime
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ShapeGenerators
+{
+	// interleaved floats per vertex - position, normal, texture coords
+	constexpr std::size_t FloatsPerVertex = 8;
+	// floats per vertex in the hand-written sphere table - position, texture coords
+	constexpr std::size_t FloatsPerSphereVertex = 5;
+
+	constexpr double Pi = 3.14159265358979323846;
+
+	/***********************************************************
+	 *  Sqrt()
+	 *
+	 *  Square root usable in constant expressions, computed
+	 *  with Newton-Raphson iterations at compile time.
+	 ***********************************************************/
+	constexpr float Sqrt(float value)
+	{
+		if (std::is_constant_evaluated() == false)
+		{
+			return std::sqrt(value);
+		}
+		if (value <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		double x = value;
+		double estimate = (x > 1.0) ? x : 1.0;
+		for (int i = 0; i < 64; i++)
+		{
+			double next = 0.5 * (estimate + x / estimate);
+			if (next == estimate)
+			{
+				break;
+			}
+			estimate = next;
+		}
+		return (float)estimate;
+	}
+
+	/***********************************************************
+	 *  Sin()
+	 *
+	 *  Sine usable in constant expressions.  The angle is
+	 *  reduced to [-pi, pi] and evaluated with a Taylor series
+	 *  that is accurate to float precision on that range.
+	 ***********************************************************/
+	constexpr float Sin(float radians)
+	{
+		if (std::is_constant_evaluated() == false)
+		{
+			return std::sin(radians);
+		}
+
+		double x = radians;
+		double turns = x / (2.0 * Pi);
+		long long wholeTurns = (long long)(turns + ((turns >= 0.0) ? 0.5 : -0.5));
+		x -= (double)wholeTurns * 2.0 * Pi;
+
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -(x * x) / (double)((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return (float)sum;
+	}
+
+	constexpr float Cos(float radians)
+	{
+		if (std::is_constant_evaluated() == false)
+		{
+			return std::cos(radians);
+		}
+		return Sin((float)(radians + Pi / 2.0));
+	}
+
+	/***********************************************************
+	 *  InterleaveSphere()
+	 *
+	 *  Combine the hand-written sphere positions and texture
+	 *  coordinates with the normals derived from the positions
+	 *  of the unit sphere into interleaved vertex data.
+	 ***********************************************************/
+	template <std::size_t N>
+	constexpr std::array<float, (N / FloatsPerSphereVertex) * FloatsPerVertex> InterleaveSphere(
+		const float (&verts)[N])
+	{
+		static_assert((N % FloatsPerSphereVertex) == 0, "sphere table must hold whole vertices");
+
+		std::array<float, (N / FloatsPerSphereVertex) * FloatsPerVertex> combined{};
+		std::size_t out = 0;
+		for (std::size_t i = 0; i < N; i += FloatsPerSphereVertex)
+		{
+			float x = verts[i];
+			float y = verts[i + 1];
+			float z = verts[i + 2];
+			float length = Sqrt(x * x + y * y + z * z);
+			float scale = (length > 0.0f) ? (1.0f / length) : 0.0f;
+
+			combined[out++] = x;
+			combined[out++] = y;
+			combined[out++] = z;
+			combined[out++] = x * scale;
+			combined[out++] = y * scale;
+			combined[out++] = z * scale;
+			combined[out++] = verts[i + 3];
+			combined[out++] = verts[i + 4];
+		}
+		return combined;
+	}
+
+	// the torus is a grid of rings around the main circle, with
+	// one extra ring and one extra vertex per ring on the texture
+	// seams, where the texture coordinates wrap
+	constexpr std::size_t TorusVertexCount(int mainSegments, int tubeSegments)
+	{
+		return (std::size_t)(mainSegments + 1) * (std::size_t)(tubeSegments + 1);
+	}
+
+	// two triangles for each cell of the grid
+	constexpr std::size_t TorusIndexCount(int mainSegments, int tubeSegments)
+	{
+		return (std::size_t)mainSegments * (std::size_t)tubeSegments * 6;
+	}
+
+	/***********************************************************
+	 *  GenerateTorus()
+	 *
+	 *  Write the interleaved torus vertices into the passed in
+	 *  buffer, which must hold TorusVertexCount() vertices.
+	 *  Ring i of the main circle holds tubeSegments + 1
+	 *  vertices, and the seam vertices take the position of
+	 *  the first ring or the first vertex of the ring, so they
+	 *  only differ in their texture coordinates.  The normals
+	 *  point away from the center of the tube.
+	 ***********************************************************/
+	constexpr void GenerateTorus(
+		float* out,
+		int mainSegments,
+		int tubeSegments,
+		float mainRadius,
+		float tubeRadius)
+	{
+		float mainSegmentAngleStep = (float)(2.0 * Pi / (double)mainSegments);
+		float tubeSegmentAngleStep = (float)(2.0 * Pi / (double)tubeSegments);
+		float horizontalStep = 1.0f / (float)mainSegments;
+		float verticalStep = 1.0f / (float)tubeSegments;
+
+		for (int i = 0; i <= mainSegments; i++)
+		{
+			int mainSegment = (i == mainSegments) ? 0 : i;
+			float sinMainSegment = Sin(mainSegmentAngleStep * (float)mainSegment);
+			float cosMainSegment = Cos(mainSegmentAngleStep * (float)mainSegment);
+
+			for (int j = 0; j <= tubeSegments; j++)
+			{
+				int tubeSegment = (j == tubeSegments) ? 0 : j;
+				float sinTubeSegment = Sin(tubeSegmentAngleStep * (float)tubeSegment);
+				float cosTubeSegment = Cos(tubeSegmentAngleStep * (float)tubeSegment);
+
+				// calculate vertex position on the surface of torus
+				float x = (mainRadius + tubeRadius * cosTubeSegment) * cosMainSegment;
+				float y = (mainRadius + tubeRadius * cosTubeSegment) * sinMainSegment;
+				float z = tubeRadius * sinTubeSegment;
+
+				*out++ = x;
+				*out++ = y;
+				*out++ = z;
+				// the normal points from the center of the tube
+				// through the vertex, which is already unit length
+				*out++ = cosTubeSegment * cosMainSegment;
+				*out++ = cosTubeSegment * sinMainSegment;
+				*out++ = sinTubeSegment;
+				*out++ = horizontalStep * (float)i;
+				*out++ = verticalStep * (float)j;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateTorusIndices()
+	 *
+	 *  Write the triangle list of the torus grid into the
+	 *  passed in buffer, which must hold TorusIndexCount()
+	 *  indices.  Each cell is split into two triangles that
+	 *  wind counter-clockwise seen from outside the torus.
+	 ***********************************************************/
+	constexpr void GenerateTorusIndices(
+		std::uint32_t* out,
+		int mainSegments,
+		int tubeSegments)
+	{
+		std::uint32_t ringVertices = (std::uint32_t)tubeSegments + 1;
+		for (int i = 0; i < mainSegments; i++)
+		{
+			for (int j = 0; j < tubeSegments; j++)
+			{
+				std::uint32_t corner = ((std::uint32_t)i * ringVertices) + (std::uint32_t)j;
+				std::uint32_t nextRing = corner + ringVertices;
+
+				*out++ = corner;
+				*out++ = nextRing;
+				*out++ = nextRing + 1;
+				*out++ = corner;
+				*out++ = nextRing + 1;
+				*out++ = corner + 1;
+			}
+		}
+	}
+
+	// primitive topology of a range of hand-written vertices
+	enum class Topology
+	{
+		TriangleList,
+		TriangleFan,
+		TriangleStrip
+	};
+
+	// a range of vertices drawn with a single topology, such as
+	// the bottom cap of a cylinder
+	struct TopologyRange
+	{
+		Topology topology;
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	/***********************************************************
+	 *  IsDegenerate()
+	 *
+	 *  Returns true when the three interleaved vertices enclose
+	 *  no area, like the stitching triangles of a strip.
+	 ***********************************************************/
+	constexpr bool IsDegenerate(
+		const float* verts,
+		std::uint32_t i0,
+		std::uint32_t i1,
+		std::uint32_t i2)
+	{
+		const float* p0 = verts + (i0 * FloatsPerVertex);
+		const float* p1 = verts + (i1 * FloatsPerVertex);
+		const float* p2 = verts + (i2 * FloatsPerVertex);
+		float ax = p1[0] - p0[0], ay = p1[1] - p0[1], az = p1[2] - p0[2];
+		float bx = p2[0] - p0[0], by = p2[1] - p0[1], bz = p2[2] - p0[2];
+		float cx = ay * bz - az * by;
+		float cy = az * bx - ax * bz;
+		float cz = ax * by - ay * bx;
+		return ((cx * cx + cy * cy + cz * cz) == 0.0f);
+	}
+
+	/***********************************************************
+	 *  AppendTriangleList()
+	 *
+	 *  Convert a fan, strip or list range into triangle list
+	 *  indices with the winding OpenGL uses for that topology.
+	 *  Degenerate fan and strip triangles are dropped.  When
+	 *  out is null only the number of indices is returned.
+	 ***********************************************************/
+	constexpr std::size_t AppendTriangleList(
+		std::uint32_t* out,
+		const float* verts,
+		const TopologyRange& range)
+	{
+		std::size_t written = 0;
+		auto triangle = [&](std::uint32_t i0, std::uint32_t i1, std::uint32_t i2)
+		{
+			if ((range.topology != Topology::TriangleList) && IsDegenerate(verts, i0, i1, i2))
+			{
+				return;
+			}
+			if (out != nullptr)
+			{
+				out[written] = i0;
+				out[written + 1] = i1;
+				out[written + 2] = i2;
+			}
+			written += 3;
+		};
+
+		for (std::uint32_t i = 0; (i + 2) < range.count; )
+		{
+			std::uint32_t v = range.first + i;
+			if (range.topology == Topology::TriangleList)
+			{
+				triangle(v, v + 1, v + 2);
+				i += 3;
+				continue;
+			}
+			if (range.topology == Topology::TriangleFan)
+			{
+				triangle(range.first, v + 1, v + 2);
+			}
+			else if ((i % 2) == 0)
+			{
+				triangle(v, v + 1, v + 2);
+			}
+			else
+			{
+				triangle(v + 1, v, v + 2);
+			}
+			i++;
+		}
+		return written;
+	}
+
+	template <std::size_t NVerts, std::size_t NRanges>
+	constexpr std::size_t TriangleListIndexCount(
+		const float (&verts)[NVerts],
+		const TopologyRange (&ranges)[NRanges])
+	{
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < NRanges; i++)
+		{
+			count += AppendTriangleList(nullptr, verts, ranges[i]);
+		}
+		return count;
+	}
+
+	/***********************************************************
+	 *  TriangleListOffsets()
+	 *
+	 *  Returns where the indices of each range start in the
+	 *  list built by BuildTriangleList(), followed by the
+	 *  total index count.
+	 ***********************************************************/
+	template <std::size_t NVerts, std::size_t NRanges>
+	constexpr std::array<std::uint32_t, NRanges + 1> TriangleListOffsets(
+		const float (&verts)[NVerts],
+		const TopologyRange (&ranges)[NRanges])
+	{
+		std::array<std::uint32_t, NRanges + 1> offsets{};
+		for (std::size_t i = 0; i < NRanges; i++)
+		{
+			offsets[i + 1] = offsets[i] + (std::uint32_t)AppendTriangleList(nullptr, verts, ranges[i]);
+		}
+		return offsets;
+	}
+
+	/***********************************************************
+	 *  BuildTriangleList()
+	 *
+	 *  Concatenate the triangle list indices of all the ranges,
+	 *  in order, so each range stays a contiguous sub-range.
+	 ***********************************************************/
+	template <std::size_t NIndices, std::size_t NVerts, std::size_t NRanges>
+	constexpr std::array<std::uint32_t, NIndices> BuildTriangleList(
+		const float (&verts)[NVerts],
+		const TopologyRange (&ranges)[NRanges])
+	{
+		std::array<std::uint32_t, NIndices> indices{};
+		std::size_t written = 0;
+		for (std::size_t i = 0; i < NRanges; i++)
+		{
+			written += AppendTriangleList(indices.data() + written, verts, ranges[i]);
+		}
+		return indices;
+	}
+
+	/***********************************************************
+	 *  BakeTorus()
+	 *
+	 *  Generate a torus with a fixed resolution into a
+	 *  std::array, for use in constant expressions.
+	 ***********************************************************/
+	template <int MainSegments, int TubeSegments>
+	constexpr std::array<float, TorusVertexCount(MainSegments, TubeSegments) * FloatsPerVertex> BakeTorus(
+		float mainRadius,
+		float tubeRadius)
+	{
+		std::array<float, TorusVertexCount(MainSegments, TubeSegments) * FloatsPerVertex> verts{};
+		GenerateTorus(verts.data(), MainSegments, TubeSegments, mainRadius, tubeRadius);
+		return verts;
+	}
+
+	template <int MainSegments, int TubeSegments>
+	constexpr std::array<std::uint32_t, TorusIndexCount(MainSegments, TubeSegments)> BakeTorusIndices()
+	{
+		std::array<std::uint32_t, TorusIndexCount(MainSegments, TubeSegments)> indices{};
+		GenerateTorusIndices(indices.data(), MainSegments, TubeSegments);
+		return indices;
+	}
+}
@@ -9,13 +9,25 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "shapemeshes.h"
+#include "ShapeGenerators.h"
+#include "GltfImporter.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "JobSystem.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <vector>
+#include <cstddef>
+#include <iterator>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
 
 namespace
 {
@@ -24,11 +36,538 @@ namespace
 	const GLuint g_FloatsPerVertex = 3;	// Number of coordinates per vertex
 	const GLuint g_FloatsPerNormal = 3;	// Number of values per vertex color
 	const GLuint g_FloatsPerUV = 2;		// Number of texture coordinate values
+	const GLuint g_FloatsPerMeshVertex = g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV;
+
+	// generic attribute slots holding the per-mesh position dequantization
+	const GLuint g_PositionScaleAttrib = 3;
+	const GLuint g_PositionOffsetAttrib = 4;
+	// generic attribute slot selecting where the vertex shader reads vertices
+	const GLuint g_VertexSourceAttrib = 6;
+	// generic attribute slot holding the recorded draw
+	const GLuint g_DrawRangeAttrib = 8;
+
+	// vertex sources understood by the vertex shader
+	const GLuint g_VertexSourceAttributes = 0;
+	const GLuint g_VertexSourcePulledFloat = 1;
+	const GLuint g_VertexSourcePulledCompact = 2;
+
+	// storage buffer binding of the pulled vertex data
+	const GLuint g_PulledVerticesBinding = 0;
+	// first allocation of each shared buffer
+	const size_t g_MinSharedBufferBytes = 1 << 20;
+
+	// screen space error in pixels that a level of detail may have
+	const float g_LodPixelError = 1.0f;
+
+	// primitives with fewer triangles are drawn whole
+	const GLuint g_MeshletTriangleThreshold = 4096;
+
+	// compact vertex - snorm16 position, 2_10_10_10 normal, half float UV
+	struct CompactVertex
+	{
+		GLshort position[4];	// xyz quantized to the mesh bounds, w is padding
+		GLuint normal;			// GL_INT_2_10_10_10_REV packed normal
+		GLuint uv;				// two GL_HALF_FLOAT texture coordinates
+	};
+
+	// quantize interleaved float vertices to the compact format,
+	// with the positions scaled to the bounds of the mesh
+	void PackCompactVertices(
+		const GLfloat* verts,
+		GLuint nVertices,
+		glm::vec3& positionScale,
+		glm::vec3& positionOffset,
+		std::vector<CompactVertex>& compactVerts)
+	{
+		// find the mesh bounds so positions can use the full snorm16 range
+		glm::vec3 minBounds(verts[0], verts[1], verts[2]);
+		glm::vec3 maxBounds = minBounds;
+		for (GLuint i = 1; i < nVertices; i++)
+		{
+			const GLfloat* vert = verts + (i * g_FloatsPerMeshVertex);
+			minBounds = glm::min(minBounds, glm::vec3(vert[0], vert[1], vert[2]));
+			maxBounds = glm::max(maxBounds, glm::vec3(vert[0], vert[1], vert[2]));
+		}
+		positionOffset = (maxBounds + minBounds) * 0.5f;
+		positionScale = glm::max((maxBounds - minBounds) * 0.5f, glm::vec3(1e-6f));
+
+		compactVerts.resize(nVertices);
+		for (GLuint i = 0; i < nVertices; i++)
+		{
+			const GLfloat* vert = verts + (i * g_FloatsPerMeshVertex);
+			glm::vec3 position = (glm::vec3(vert[0], vert[1], vert[2]) - positionOffset) / positionScale;
+			glm::vec3 normal(vert[3], vert[4], vert[5]);
+			if (glm::dot(normal, normal) > 0.0f)
+			{
+				normal = glm::normalize(normal);
+			}
+
+			compactVerts[i].position[0] = (GLshort)glm::packSnorm1x16(position.x);
+			compactVerts[i].position[1] = (GLshort)glm::packSnorm1x16(position.y);
+			compactVerts[i].position[2] = (GLshort)glm::packSnorm1x16(position.z);
+			compactVerts[i].position[3] = 0;
+			compactVerts[i].normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+			compactVerts[i].uv = glm::packHalf2x16(glm::vec2(vert[6], vert[7]));
+		}
+	}
+
+	// read one component of an imported vertex attribute as a
+	// float, with the normalization of the integer types
+	float ReadComponent(
+		const unsigned char* element,
+		GLenum componentType,
+		GLboolean bNormalized,
+		int component)
+	{
+		float value = 0.0f;
+		float maxValue = 1.0f;
+		switch (componentType)
+		{
+		case GL_FLOAT:
+			return(((const GLfloat*)element)[component]);
+		case GL_BYTE:
+			value = ((const GLbyte*)element)[component];
+			maxValue = 127.0f;
+			break;
+		case GL_UNSIGNED_BYTE:
+			value = ((const GLubyte*)element)[component];
+			maxValue = 255.0f;
+			break;
+		case GL_SHORT:
+			value = ((const GLshort*)element)[component];
+			maxValue = 32767.0f;
+			break;
+		case GL_UNSIGNED_SHORT:
+			value = ((const GLushort*)element)[component];
+			maxValue = 65535.0f;
+			break;
+		}
+		if (bNormalized == GL_TRUE)
+		{
+			value = std::max(value / maxValue, -1.0f);
+		}
+		return(value);
+	}
+
+	// make room for at least the needed bytes in a shared
+	// buffer.  The capacity at least doubles and the used bytes
+	// are copied on the GPU, so appending the meshes one at a
+	// time only copies each byte a few times.  Reallocating
+	// keeps the buffer name, so the VAOs and the meshes that
+	// refer to it stay valid
+	void ReserveSharedBuffer(
+		GLuint buffer,
+		size_t usedBytes,
+		size_t neededBytes,
+		size_t& capacity)
+	{
+		if (neededBytes <= capacity)
+		{
+			return;
+		}
+
+		GLuint copy = 0;
+		if (usedBytes > 0)
+		{
+			glGenBuffers(1, &copy);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+			glBufferData(GL_COPY_WRITE_BUFFER, usedBytes, NULL, GL_STREAM_COPY);
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+		}
+
+		capacity = std::max(std::max(capacity * 2, neededBytes), g_MinSharedBufferBytes);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+
+		if (copy != 0)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, copy);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+			glDeleteBuffers(1, &copy);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// expected sizes of the hand-written sphere tables
+	constexpr std::size_t g_SphereVertexCount = 257;
+	constexpr std::size_t g_SphereIndexCount = 1530;
+
+	// the torus with the default resolution and thickness is baked at compile time
+	constexpr int g_TorusMainSegments = 30;
+	constexpr int g_TorusTubeSegments = 30;
+	constexpr float g_TorusMainRadius = 1.0f;
+	constexpr float g_DefaultTorusThickness = 0.2f;
+	constexpr auto g_TorusVerts = ShapeGenerators::BakeTorus<g_TorusMainSegments, g_TorusTubeSegments>(
+		g_TorusMainRadius, g_DefaultTorusThickness);
+	static_assert(g_TorusVerts.size() == 961 * ShapeGenerators::FloatsPerVertex, "unexpected torus vertex count");
+	// the grid does not depend on the thickness, so every torus shares these indices
+	constexpr auto g_TorusIndices = ShapeGenerators::BakeTorusIndices<g_TorusMainSegments, g_TorusTubeSegments>();
 }
 
 ShapeMeshes::ShapeMeshes()
 {
 	m_bMemoryLayoutDone = false;
+	m_bCompactVertexFormat = false;
+	m_vertexFetch = VAO_PER_MESH;
+	m_bGenerateLods = false;
+	m_lodPixelsPerUnit = 0.0f;
+	m_bGenerateMeshlets = false;
+	m_bCullingView = false;
+	m_cullModelViewProjection = glm::mat4(1.0f);
+	m_cullCameraPosition = glm::vec3(0.0f);
+	m_indirectBuffer = 0;
+
+	m_sharedVao = 0;
+	m_pullingVao = 0;
+	m_sharedBuffers[0] = 0;
+	m_sharedBuffers[1] = 0;
+	m_bSharedCompact = false;
+	m_sharedBytes[0] = 0;
+	m_sharedBytes[1] = 0;
+	m_sharedCapacity[0] = 0;
+	m_sharedCapacity[1] = 0;
+	m_maxSharedTriangles = 0;
+
+	m_bRecordingDraws = false;
+	m_maxRecordedDraws = 0;
+	m_recordedObject = 0;
+	m_droppedDraws = 0;
+
+	// no geometry is available until a mesh is loaded
+	for (int shape = BOX_MESH; shape <= TORUS_MESH; shape++)
+	{
+		GLMesh* mesh = GetMesh((MESH_SHAPE)shape);
+		mesh->srcVerts = NULL;
+		mesh->srcIndices = NULL;
+		mesh->nLods = 0;
+		mesh->meshletCuller = -1;
+		mesh->boundsMin = glm::vec3(0.0f);
+		mesh->boundsMax = glm::vec3(0.0f);
+		mesh->boundingSphere = glm::vec4(0.0f);
+	}
+}
+
+///////////////////////////////////////////////////
+//	SetCompactVertexFormat()
+//
+//	Select the vertex format for the meshes that are
+//  loaded after this call.  The compact format packs
+//  each vertex into 16 bytes instead of 32 bytes and
+//  uses 16-bit indices whenever the vertex count allows.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetCompactVertexFormat(bool bCompact)
+{
+	m_bCompactVertexFormat = bCompact;
+}
+
+///////////////////////////////////////////////////
+//	SetVertexFetch()
+//
+//	Select how the vertices of the meshes that are
+//  loaded after this call are fetched.  The shared
+//  modes put all the meshes into one vertex buffer and
+//  one index buffer, so switching meshes only changes
+//  the base vertex and first index of the draw call.
+//  Vertex pulling additionally skips the fixed-function
+//  attribute fetch and reads the vertex buffer as a
+//  storage buffer in the vertex shader.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetVertexFetch(VERTEX_FETCH fetch)
+{
+	m_vertexFetch = fetch;
+}
+
+///////////////////////////////////////////////////
+//	SetLodGeneration()
+//
+//	Select whether simplified levels of detail are
+//  built for the meshes that are loaded after this
+//  call.  The levels index the vertices of the full
+//  mesh, so they only add indices behind the mesh
+//  indices in the same index buffer.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetLodGeneration(bool bGenerate)
+{
+	m_bGenerateLods = bGenerate;
+}
+
+///////////////////////////////////////////////////
+//	SetLodScale()
+//
+//	Set how many pixels one object space unit of the
+//  following draws covers on the screen, which is
+//  used to convert the level of detail errors into
+//  screen space.  Zero disables the selection.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetLodScale(float pixelsPerUnit)
+{
+	m_lodPixelsPerUnit = pixelsPerUnit;
+}
+
+///////////////////////////////////////////////////
+//	SetMeshletGeneration()
+//
+//	Select whether large meshes loaded after this
+//  call are split into meshlets.  The triangles of
+//  the mesh are reordered so every meshlet is one
+//  index range, which keeps whole mesh draws working.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetMeshletGeneration(bool bGenerate)
+{
+	m_bGenerateMeshlets = bGenerate;
+}
+
+///////////////////////////////////////////////////
+//	SetCullingView()
+//
+//	Set the model-view-projection matrix and the
+//  object space camera position of the following
+//  draws, which the meshlets are culled against.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetCullingView(
+	const glm::mat4& modelViewProjection,
+	const glm::vec3& cameraPosition)
+{
+	m_bCullingView = true;
+	m_cullModelViewProjection = modelViewProjection;
+	m_cullCameraPosition = cameraPosition;
+}
+
+///////////////////////////////////////////////////
+//	ClearCullingView()
+//
+//	Draw all the meshlets of the following draws.
+///////////////////////////////////////////////////
+void ShapeMeshes::ClearCullingView()
+{
+	m_bCullingView = false;
+}
+
+///////////////////////////////////////////////////
+//	BeginDrawRecording()
+//
+//	Record the draw calls of the following draws for
+//  the visibility buffer.  Every call gets its own
+//  range, so gl_PrimitiveID counts the triangles of
+//  that range, and the position of the range in the
+//  record goes to the vertex shader as a generic
+//  attribute.  Meshes outside the shared buffers, and
+//  the calls beyond the passed in number, are left out
+//  because the resolve pass could not find them.
+///////////////////////////////////////////////////
+void ShapeMeshes::BeginDrawRecording(GLuint maxDraws)
+{
+	m_bRecordingDraws = true;
+	m_maxRecordedDraws = maxDraws;
+	m_recordedObject = 0;
+	m_recordedDraws.clear();
+	m_droppedDraws = 0;
+}
+
+void ShapeMeshes::SetRecordedObject(GLuint object)
+{
+	m_recordedObject = object;
+}
+
+void ShapeMeshes::EndDrawRecording()
+{
+	m_bRecordingDraws = false;
+}
+
+const std::vector<ShapeMeshes::DRAW_RANGE>& ShapeMeshes::GetRecordedDraws() const
+{
+	return(m_recordedDraws);
+}
+
+GLuint ShapeMeshes::GetDroppedDrawCount() const
+{
+	return(m_droppedDraws);
+}
+
+GLuint ShapeMeshes::GetMaxSharedTriangles() const
+{
+	return(m_maxSharedTriangles);
+}
+
+///////////////////////////////////////////////////
+//	BindSharedBuffers()
+//
+//	Bind the shared vertex and index buffers as
+//  storage buffers, so a shader can fetch the
+//  triangles of the recorded draws.
+///////////////////////////////////////////////////
+bool ShapeMeshes::BindSharedBuffers(GLuint vertexBinding, GLuint indexBinding) const
+{
+	if (m_sharedVao == 0)
+	{
+		return(false);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, vertexBinding, m_sharedBuffers[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indexBinding, m_sharedBuffers[1]);
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshGeometry()
+//
+//	Copy the float vertex data and triangle list
+//  indices of a loaded mesh, independent of the
+//  vertex format used on the GPU.  Returns false
+//  when the mesh has not been loaded.
+///////////////////////////////////////////////////
+bool ShapeMeshes::GetMeshGeometry(
+	MESH_SHAPE shape,
+	std::vector<GLfloat>& verts,
+	std::vector<GLuint>& indices)
+{
+	GLMesh* mesh = GetMesh(shape);
+	if ((mesh == NULL) || (mesh->srcVerts == NULL) || (mesh->srcIndices == NULL))
+	{
+		return(false);
+	}
+
+	verts.assign(mesh->srcVerts, mesh->srcVerts + (mesh->nVertices * g_FloatsPerMeshVertex));
+	indices.assign(mesh->srcIndices, mesh->srcIndices + mesh->nIndices);
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshBounds()
+//
+//	Get the bounding box of the vertex positions of a
+//  loaded mesh, or the union of the primitive bounds
+//  of an imported mesh.  Returns false when the mesh
+//  has not been loaded.
+///////////////////////////////////////////////////
+bool ShapeMeshes::GetMeshBounds(
+	MESH_SHAPE shape,
+	int importedMesh,
+	glm::vec3& boundsMin,
+	glm::vec3& boundsMax)
+{
+	if (shape == IMPORTED_MESH)
+	{
+		if ((importedMesh < 0) || (importedMesh >= (int)m_importedMeshes.size()))
+		{
+			return(false);
+		}
+		boundsMin = m_importedMeshes[importedMesh].boundsMin;
+		boundsMax = m_importedMeshes[importedMesh].boundsMax;
+		return(true);
+	}
+
+	GLMesh* mesh = GetMesh(shape);
+	if ((mesh == NULL) || (mesh->srcVerts == NULL) || (mesh->nVertices == 0))
+	{
+		return(false);
+	}
+
+	boundsMin = mesh->boundsMin;
+	boundsMax = mesh->boundsMax;
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	GetMeshSphere()
+//
+//	Get the bounding sphere of a loaded mesh, whose
+//  radius reaches the farthest vertex from the center
+//  of the bounding box, or the sphere around the box
+//  of an imported mesh.  Returns false when the mesh
+//  has not been loaded.
+///////////////////////////////////////////////////
+bool ShapeMeshes::GetMeshSphere(
+	MESH_SHAPE shape,
+	int importedMesh,
+	glm::vec4& sphere)
+{
+	if (shape == IMPORTED_MESH)
+	{
+		if ((importedMesh < 0) || (importedMesh >= (int)m_importedMeshes.size()))
+		{
+			return(false);
+		}
+		sphere = m_importedMeshes[importedMesh].boundingSphere;
+		return(true);
+	}
+
+	GLMesh* mesh = GetMesh(shape);
+	if ((mesh == NULL) || (mesh->srcVerts == NULL) || (mesh->nVertices == 0))
+	{
+		return(false);
+	}
+
+	sphere = mesh->boundingSphere;
+
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	ComputeMeshBounds()
+//
+//	Compute the bounding box and bounding sphere of
+//  the vertex positions of a mesh once, when it is
+//  loaded.
+///////////////////////////////////////////////////
+void ShapeMeshes::ComputeMeshBounds(GLMesh& mesh, const GLfloat* verts)
+{
+	mesh.boundsMin = glm::vec3(0.0f);
+	mesh.boundsMax = glm::vec3(0.0f);
+	mesh.boundingSphere = glm::vec4(0.0f);
+	if ((verts == NULL) || (mesh.nVertices == 0))
+	{
+		return;
+	}
+
+	mesh.boundsMin = glm::vec3(verts[0], verts[1], verts[2]);
+	mesh.boundsMax = mesh.boundsMin;
+	for (GLuint i = 1; i < mesh.nVertices; i++)
+	{
+		const GLfloat* position = verts + i * g_FloatsPerMeshVertex;
+		mesh.boundsMin = glm::min(mesh.boundsMin, glm::vec3(position[0], position[1], position[2]));
+		mesh.boundsMax = glm::max(mesh.boundsMax, glm::vec3(position[0], position[1], position[2]));
+	}
+
+	// the farthest vertex is closer than the box corners for
+	// round shapes such as the sphere and the cylinder
+	glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (GLuint i = 0; i < mesh.nVertices; i++)
+	{
+		const GLfloat* position = verts + i * g_FloatsPerMeshVertex;
+		glm::vec3 offset = glm::vec3(position[0], position[1], position[2]) - center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	mesh.boundingSphere = glm::vec4(center, std::sqrt(radiusSquared));
+}
+
+///////////////////////////////////////////////////
+//	GetMesh()
+//
+//	Return the mesh that stores the passed in shape.
+///////////////////////////////////////////////////
+ShapeMeshes::GLMesh* ShapeMeshes::GetMesh(MESH_SHAPE shape)
+{
+	switch (shape)
+	{
+	case BOX_MESH: return(&m_BoxMesh);
+	case CONE_MESH: return(&m_ConeMesh);
+	case CYLINDER_MESH: return(&m_CylinderMesh);
+	case PLANE_MESH: return(&m_PlaneMesh);
+	case PRISM_MESH: return(&m_PrismMesh);
+	case PYRAMID3_MESH: return(&m_Pyramid3Mesh);
+	case PYRAMID4_MESH: return(&m_Pyramid4Mesh);
+	case SPHERE_MESH: return(&m_SphereMesh);
+	case TAPERED_CYLINDER_MESH: return(&m_TaperedCylinderMesh);
+	case TORUS_MESH: return(&m_TorusMesh);
+	case IMPORTED_MESH: break;
+	}
+	return(NULL);
 }
 
 ///////////////////////////////////////////////////
@@ -45,7 +584,7 @@ ShapeMeshes::ShapeMeshes()
 void ShapeMeshes::LoadBoxMesh()
 {
 	// Position and Color data
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		//Positions				//Normals
 		// ------------------------------------------------------
 
@@ -87,7 +626,7 @@ void ShapeMeshes::LoadBoxMesh()
 	};
 
 	// Index data
-	GLuint indices[] = {
+	static constexpr GLuint indices[] = {
 		0,1,2,
 		0,3,2,
 		4,5,6,
@@ -102,24 +641,15 @@ void ShapeMeshes::LoadBoxMesh()
 		20,23,22
 	};
 
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 24 * g_FloatsPerMeshVertex, "unexpected box vertex count");
+	static_assert(std::size(indices) == 36, "unexpected box index count");
+
 	m_BoxMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 	m_BoxMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	glGenVertexArrays(1, &m_BoxMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_BoxMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(2, m_BoxMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_BoxMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BoxMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_BoxMesh, verts, indices);
 }
 
 ///////////////////////////////////////////////////
@@ -129,14 +659,13 @@ void ShapeMeshes::LoadBoxMesh()
 //  store it in a VAO/VBO.  The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+//  The bottom fan and the side strip are converted
+//  into one indexed triangle list, with the bottom
+//  and the sides as separately drawable parts.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadConeMesh()
 {
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// cone bottom			// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -287,23 +816,24 @@ void ShapeMeshes::LoadConeMesh()
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 	1.0f, 0.5f
 	};
 
-	// store vertex and index count
-	m_ConeMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_ConeMesh.nIndices = 0;
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 144 * g_FloatsPerMeshVertex, "unexpected cone vertex count");
 
-	// Create VAO
-	glGenVertexArrays(1, &m_ConeMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_ConeMesh.vao);
+	// convert the bottom fan and the side strip into one
+	// indexed triangle list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleFan, 0, 36 },		//bottom
+		{ ShapeGenerators::Topology::TriangleStrip, 36, 108 }	//sides
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
 
-	// Create VBO
-	glGenBuffers(1, m_ConeMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ConeMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// store vertex and index count
+	m_ConeMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	m_ConeMesh.nIndices = (GLuint)indices.size();
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_ConeMesh, verts, indices.data(), offsets.data(), (GLuint)std::size(ranges));
 }
 
 ///////////////////////////////////////////////////
@@ -313,15 +843,13 @@ void ShapeMeshes::LoadConeMesh()
 //  store it in a VAO/VBO.  The normals and texture
 //  coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  The bottom and top fans and the side strip are
+//  converted into one indexed triangle list, with
+//  each of them as a separately drawable part.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadCylinderMesh()
 {
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// cylinder bottom		// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -551,23 +1079,25 @@ void ShapeMeshes::LoadCylinderMesh()
 
 	normal = CalculateTriangleNormal(glm::vec3(.98f, 1.0f, 0.17f), glm::vec3(.98f, 0.0f, 0.17f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-	// store vertex and index count
-	m_CylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_CylinderMesh.nIndices = 0;
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 218 * g_FloatsPerMeshVertex, "unexpected cylinder vertex count");
 
-	// Create VAO
-	glGenVertexArrays(1, &m_CylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_CylinderMesh.vao);
+	// convert the bottom and top fans and the side strip
+	// into one indexed triangle list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleFan, 0, 36 },		//bottom
+		{ ShapeGenerators::Topology::TriangleFan, 36, 36 },		//top
+		{ ShapeGenerators::Topology::TriangleStrip, 72, 146 }	//sides
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
 
-	// Create VBO
-	glGenBuffers(1, m_CylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_CylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	// store vertex and index count
+	m_CylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	m_CylinderMesh.nIndices = (GLuint)indices.size();
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_CylinderMesh, verts, indices.data(), offsets.data(), (GLuint)std::size(ranges));
 }
 
 ///////////////////////////////////////////////////
@@ -584,7 +1114,7 @@ void ShapeMeshes::LoadCylinderMesh()
 void ShapeMeshes::LoadPlaneMesh()
 {
 	// Vertex data
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// Vertex Positions		// Normals			// Texture coords	// Index
 		-1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	0.0f, 0.0f,			//0
 		1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 0.0f,			//1
@@ -593,31 +1123,21 @@ void ShapeMeshes::LoadPlaneMesh()
 	};
 
 	// Index data
-	GLuint indices[] = {
+	static constexpr GLuint indices[] = {
 		0,1,2,
 		0,3,2
 	};
 
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 4 * g_FloatsPerMeshVertex, "unexpected plane vertex count");
+	static_assert(std::size(indices) == 6, "unexpected plane index count");
+
 	// store vertex and index count
 	m_PlaneMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 	m_PlaneMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	// Generate the VAO for the mesh
-	glGenVertexArrays(1, &m_PlaneMesh.vao);
-	glBindVertexArray(m_PlaneMesh.vao);	// activate the VAO
-
-	// Create VBOs for the mesh
-	glGenBuffers(2, m_PlaneMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PlaneMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_PlaneMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_PlaneMesh, verts, indices);
 }
 
 ///////////////////////////////////////////////////
@@ -627,14 +1147,14 @@ void ShapeMeshes::LoadPlaneMesh()
 //  store it in a VAO/VBO.  The normals and texture
 //  coordinates are also set.
 //
-//	Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPrismMesh.nVertices);
+//  The triangle strip is converted into an
+//  indexed triangle list without the degenerate
+//  stitching triangles.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadPrismMesh()
 {
 	// Vertex data
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		//Positions				//Normals
 		// ------------------------------------------------------
 
@@ -682,20 +1202,22 @@ void ShapeMeshes::LoadPrismMesh()
 
 	};
 
-	m_PrismMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 32 * g_FloatsPerMeshVertex, "unexpected prism vertex count");
 
-	glGenVertexArrays(1, &m_PrismMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_PrismMesh.vao);
+	// convert the triangle strip into an indexed triangle
+	// list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleStrip, 0, 32 }
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
 
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(1, m_PrismMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PrismMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	m_PrismMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	m_PrismMesh.nIndices = (GLuint)indices.size();
 
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_PrismMesh, verts, indices.data());
 }
 
 ///////////////////////////////////////////////////
@@ -705,14 +1227,14 @@ void ShapeMeshes::LoadPrismMesh()
 //  vertices and store it in a VAO/VBO.  The normals 
 //  and texture coordinates are also set.
 //
-//  Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLE_STRIP, 0, gPyramid3Mesh.nVertices);
+//  The triangle strip is converted into an
+//  indexed triangle list without the degenerate
+//  stitching triangles.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadPyramid3Mesh()
 {
 	// Vertex data
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// Vertex Positions		// Normals			// Texture coords
 		//left side
 		0.0f, 0.5f, 0.0f,		-0.894427180f, 0.0f, -0.447213590f,	0.5f, 1.0f,		//top point	
@@ -736,20 +1258,23 @@ void ShapeMeshes::LoadPyramid3Mesh()
 		-0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f,	0.0f, 1.0f,     //front bottom left
 	};
 
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 16 * g_FloatsPerMeshVertex, "unexpected 3-sided pyramid vertex count");
+
+	// convert the triangle strip into an indexed triangle
+	// list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleStrip, 0, 16 }
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
+
 	// Calculate total defined vertices
 	m_Pyramid3Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	m_Pyramid3Mesh.nIndices = (GLuint)indices.size();
 
-	glGenVertexArrays(1, &m_Pyramid3Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid3Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid3Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid3Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_Pyramid3Mesh, verts, indices.data());
 }
 
 ///////////////////////////////////////////////////
@@ -759,14 +1284,14 @@ void ShapeMeshes::LoadPyramid3Mesh()
 //  vertices and store it in a VAO/VBO.  The normals 
 //  and texture coordinates are also set.
 //
-//  Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid4Mesh.nVertices);
+//  The triangle strip is converted into an
+//  indexed triangle list without the degenerate
+//  stitching triangles.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadPyramid4Mesh()
 {
 	// Vertex data
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// Vertex Positions		// Normals			// Texture coords
 		//bottom side
 		-0.5f, -0.5f, 0.5f,		0.0f, -1.0f, 0.0f,	0.0f, 1.0f,     //front bottom left
@@ -799,20 +1324,23 @@ void ShapeMeshes::LoadPyramid4Mesh()
 		0.0f, 0.5f, 0.0f,		0.0f, 0.0f, 1.0f,	0.5f, 1.0f,		//top point
 	};
 
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 24 * g_FloatsPerMeshVertex, "unexpected 4-sided pyramid vertex count");
+
+	// convert the triangle strip into an indexed triangle
+	// list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleStrip, 0, 24 }
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
+
 	// Calculate total defined vertices
 	m_Pyramid4Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
+	m_Pyramid4Mesh.nIndices = (GLuint)indices.size();
 
-	glGenVertexArrays(1, &m_Pyramid4Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid4Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid4Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid4Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_Pyramid4Mesh, verts, indices.data());
 }
 
 ///////////////////////////////////////////////////
@@ -828,7 +1356,7 @@ void ShapeMeshes::LoadPyramid4Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadSphereMesh()
 {
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// vertex data					// texture coords			// index
 		// top center point
 		0.0f, 1.0f, 0.0f,				0.5f, 1.0f,					//0
@@ -1107,7 +1635,7 @@ void ShapeMeshes::LoadSphereMesh()
 	};
 
 	// index data
-	GLuint indices[] = {
+	static constexpr GLuint indices[] = {
 		//ring 1 - top
 		0,10,11,
 		0,11,12,
@@ -1651,54 +2179,18 @@ void ShapeMeshes::LoadSphereMesh()
 		247,256,248
 	};
 
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
+	// combine interleaved vertices, normals, and texture coords
+	// at compile time - the normals point away from the center
+	static constexpr auto combined_values = ShapeGenerators::InterleaveSphere(verts);
+	static_assert(combined_values.size() == g_SphereVertexCount * ShapeGenerators::FloatsPerVertex, "unexpected sphere vertex count");
+	static_assert(std::size(indices) == g_SphereIndexCount, "unexpected sphere index count");
 
 	// store vertex and index count
-	m_SphereMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex));
+	m_SphereMesh.nVertices = combined_values.size() / ShapeGenerators::FloatsPerVertex;
 	m_SphereMesh.nIndices = sizeof(indices) / (sizeof(indices[0]));
 
-	glm::vec3 normal;
-	glm::vec3 vert;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	float u, v;
-	std::vector<GLfloat> combined_values;
-
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < sizeof(verts) / (sizeof(verts[0])); i += 5)
-	{
-		vert = glm::vec3(verts[i], verts[i + 1], verts[i + 2]);
-		normal = normalize(vert - center);
-		//u = atan2(normal.x, normal.z) / (2 * M_PI) + 0.5;
-		//v = normal.y * 0.5 + 0.5;
-		combined_values.push_back(vert.x);
-		combined_values.push_back(vert.y);
-		combined_values.push_back(vert.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(verts[i + 3]);
-		combined_values.push_back(verts[i + 4]);
-	}
-
-	// Create VAO
-	glGenVertexArrays(1, &m_SphereMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_SphereMesh.vao);
-
-	// Create VBOs
-	glGenBuffers(2, m_SphereMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_SphereMesh.vbos[0]); // Activates the vertex buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereMesh.vbos[1]); // Activates the index buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_SphereMesh, combined_values.data(), indices);
 }
 
 ///////////////////////////////////////////////////
@@ -1708,15 +2200,13 @@ void ShapeMeshes::LoadSphereMesh()
 //  vertices and store it in a VAO/VBO.  The normals 
 //  and texture coordinates are also set.
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  The bottom and top fans and the side strip are
+//  converted into one indexed triangle list, with
+//  each of them as a separately drawable part.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadTaperedCylinderMesh()
 {
-	GLfloat verts[] = {
+	static constexpr GLfloat verts[] = {
 		// cylinder bottom		// normals			// texture coords
 		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
 		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
@@ -1942,23 +2432,25 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, 0.116841137f,	1.0, 0.0
 	};
 
+	// the vertex data is baked into the executable at compile time
+	static_assert(std::size(verts) == 218 * g_FloatsPerMeshVertex, "unexpected tapered cylinder vertex count");
+
+	// convert the bottom and top fans and the side strip
+	// into one indexed triangle list at compile time
+	static constexpr ShapeGenerators::TopologyRange ranges[] = {
+		{ ShapeGenerators::Topology::TriangleFan, 0, 36 },		//bottom
+		{ ShapeGenerators::Topology::TriangleFan, 36, 36 },		//top
+		{ ShapeGenerators::Topology::TriangleStrip, 72, 146 }	//sides
+	};
+	static constexpr auto offsets = ShapeGenerators::TriangleListOffsets(verts, ranges);
+	static constexpr auto indices = ShapeGenerators::BuildTriangleList<offsets.back()>(verts, ranges);
+
 	// store vertex and index count
 	m_TaperedCylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_TaperedCylinderMesh.nIndices = 0;
+	m_TaperedCylinderMesh.nIndices = (GLuint)indices.size();
 
-	// Create VAO
-	glGenVertexArrays(1, &m_TaperedCylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_TaperedCylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TaperedCylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_TaperedCylinderMesh, verts, indices.data(), offsets.data(), (GLuint)std::size(ranges));
 }
 
 ///////////////////////////////////////////////////
@@ -1968,15 +2460,11 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 //  store it in a VAO/VBO.  The normals and texture
 //  coordinates are also set.
 //
-//	Correct triangle drawing command:
-//
-//	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
+//	The vertices form a grid of rings, and each cell
+//  of the grid is drawn as two indexed triangles.
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadTorusMesh(float thickness)
 {
-	int _mainSegments = 30;
-	int _tubeSegments = 30;
-	float _mainRadius = 1.0f;
 	float _tubeRadius = .1f;
 
 	if (thickness <= 1.0)
@@ -1984,204 +2472,408 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 		_tubeRadius = thickness;
 	}
 
-	auto mainSegmentAngleStep = glm::radians(360.0f / float(_mainSegments));
-	auto tubeSegmentAngleStep = glm::radians(360.0f / float(_tubeSegments));
-
-	std::vector<glm::vec3> vertex_list;
-	std::vector<std::vector<glm::vec3>> segments_list;
-	std::vector<glm::vec2> texture_coords;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	glm::vec3 normal;
-	glm::vec3 vertex;
-	glm::vec2 text_coord;
+	// store vertex and index count
+	m_TorusMesh.nVertices = ShapeGenerators::TorusVertexCount(g_TorusMainSegments, g_TorusTubeSegments);
+	m_TorusMesh.nIndices = (GLuint)g_TorusIndices.size();
 
-	// generate the torus vertices
-	auto currentMainSegmentAngle = 0.0f;
-	for (auto i = 0; i < _mainSegments; i++)
+	// the torus with the default thickness was generated at compile time
+	if (_tubeRadius == g_DefaultTorusThickness)
 	{
-		// Calculate sine and cosine of main segment angle
-		auto sinMainSegment = sin(currentMainSegmentAngle);
-		auto cosMainSegment = cos(currentMainSegmentAngle);
-		auto currentTubeSegmentAngle = 0.0f;
-		std::vector<glm::vec3> segment_points;
-		for (auto j = 0; j < _tubeSegments; j++)
-		{
-			// Calculate sine and cosine of tube segment angle
-			auto sinTubeSegment = sin(currentTubeSegmentAngle);
-			auto cosTubeSegment = cos(currentTubeSegmentAngle);
+		UploadMesh(m_TorusMesh, g_TorusVerts.data(), g_TorusIndices.data());
+		return;
+	}
 
-			// Calculate vertex position on the surface of torus
-			auto surfacePosition = glm::vec3(
-				(_mainRadius + _tubeRadius * cosTubeSegment) * cosMainSegment,
-				(_mainRadius + _tubeRadius * cosTubeSegment) * sinMainSegment,
-				_tubeRadius * sinTubeSegment);
+	// any other thickness is generated at runtime by the same code, and
+	// kept alive so the mesh geometry can be read back later
+	m_torusVerts.assign(m_TorusMesh.nVertices * ShapeGenerators::FloatsPerVertex, 0.0f);
+	ShapeGenerators::GenerateTorus(
+		m_torusVerts.data(),
+		g_TorusMainSegments,
+		g_TorusTubeSegments,
+		g_TorusMainRadius,
+		_tubeRadius);
+
+	// create the VAO/VBOs and send the mesh data to the GPU
+	UploadMesh(m_TorusMesh, m_torusVerts.data(), g_TorusIndices.data());
+}
 
-			//vertex_list.push_back(surfacePosition);
-			segment_points.push_back(surfacePosition);
+///////////////////////////////////////////////////
+//	LoadGltfFile()
+//
+//	Import the triangle meshes of a .glb file.  The
+//  file is memory mapped, and every buffer the
+//  importer describes that a primitive reads through
+//  its own VAO becomes one immutable GL buffer created
+//  straight from its bytes, so data OpenGL can read in
+//  place is never copied on the CPU.  Such a VAO reads
+//  the attributes with their stored types and strides,
+//  and primitives without texture coordinates read the
+//  default generic value (0, 0).
+//
+//	With a shared vertex fetch mode, the float
+//  primitives are converted to the vertex format of
+//  the shared buffers instead and appended to them.
+//  The conversions, the level of detail chains and the
+//  meshlets of all the primitives are built in
+//  parallel.  Each primitive with levels gets indices
+//  followed by the level indices, in its own index
+//  buffer or in the shared one, and meshlets reorder
+//  the indices in the same buffer.
+///////////////////////////////////////////////////
+bool ShapeMeshes::LoadGltfFile(const char* filename)
+{
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
 
-			// Update current tube angle
-			currentTubeSegmentAngle += tubeSegmentAngleStep;
-		}
-		segments_list.push_back(segment_points);
-		segment_points.clear();
+	GltfImporter importer;
+	if (importer.Load(filename) == false)
+	{
+		return(false);
+	}
 
-		// Update main segment angle
-		currentMainSegmentAngle += mainSegmentAngleStep;
+	const std::vector<GltfImporter::SOURCE_BUFFER>& sources = importer.GetBuffers();
+	const std::vector<GltfImporter::MESH>& meshes = importer.GetMeshes();
+	std::vector<const GltfImporter::PRIMITIVE*> primitives;
+	for (std::size_t i = 0; i < meshes.size(); i++)
+	{
+		for (std::size_t p = 0; p < meshes[i].primitives.size(); p++)
+		{
+			primitives.push_back(&meshes[i].primitives[p]);
+		}
 	}
 
-	float horizontalStep = 1.0 / _mainSegments;
-	float verticalStep = 1.0 / _tubeSegments;
-	float u = 0.0;
-	float v = 0.0;
+	// float primitives are copied into the shared buffers like
+	// the built-in shapes, so they are fetched the same way and
+	// the visibility buffer can find their triangles
+	bool bSharedFetch = (m_vertexFetch != VAO_PER_MESH) &&
+		((m_sharedVao == 0) || (m_bSharedCompact == m_bCompactVertexFormat));
+	std::vector<bool> shared(primitives.size(), false);
+	for (std::size_t i = 0; i < primitives.size(); i++)
+	{
+		shared[i] = (bSharedFetch == true) && (primitives[i]->nIndices > 0) &&
+			(primitives[i]->attributes[GltfImporter::POSITION_ATTRIBUTE].componentType == GL_FLOAT);
+	}
 
-	// connect the various segments together, forming triangles
-	for (int i = 0; i < _mainSegments; i++)
+	// indices followed by the level indices, for every primitive
+	// with levels or meshlets and every shared primitive
+	std::vector<std::vector<GLuint>> lodIndices(primitives.size());
+	std::vector<std::vector<MeshSimplifier::LOD_LEVEL>> lodLevels(primitives.size());
+	std::vector<std::vector<MeshletBuilder::MESHLET>> meshlets(primitives.size());
+	// vertices of the shared primitives, in the vertex format of
+	// the shared buffers
+	std::vector<std::vector<GLfloat>> sharedVerts(primitives.size());
+	std::vector<std::vector<CompactVertex>> sharedCompactVerts(primitives.size());
+	std::vector<glm::vec3> positionScales(primitives.size(), glm::vec3(1.0f));
+	std::vector<glm::vec3> positionOffsets(primitives.size(), glm::vec3(0.0f));
+	if ((m_bGenerateLods == true) || (m_bGenerateMeshlets == true) || (bSharedFetch == true))
 	{
-		for (int j = 0; j < _tubeSegments; j++)
+		JobSystem::Get().ParallelFor(primitives.size(), [&](std::size_t i)
 		{
-			if (((i + 1) < _mainSegments) && ((j + 1) < _tubeSegments))
+			const GltfImporter::PRIMITIVE& primitive = *primitives[i];
+			const GltfImporter::VERTEX_ATTRIBUTE& position = primitive.attributes[GltfImporter::POSITION_ATTRIBUTE];
+			const GltfImporter::VERTEX_ATTRIBUTE& normal = primitive.attributes[GltfImporter::NORMAL_ATTRIBUTE];
+			const GltfImporter::VERTEX_ATTRIBUTE& texCoord = primitive.attributes[GltfImporter::TEXCOORD_ATTRIBUTE];
+
+			// the simplifier reads float attributes, quantized
+			// attributes are left out and quantized positions
+			// keep the full detail
+			if ((position.componentType != GL_FLOAT) || (primitive.nIndices == 0))
 			{
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i][j + 1]);
-				texture_coords.push_back(glm::vec2(u, v + verticalStep));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v + verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i + 1][j]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v - verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
+				return;
 			}
-			else
+
+			MeshSimplifier::VERTEX_INPUT input;
+			input.positions = (const GLfloat*)(sources[position.buffer].data + position.offset);
+			input.positionStride = position.stride;
+			input.normals = NULL;
+			input.normalStride = 0;
+			input.texCoords = NULL;
+			input.texCoordStride = 0;
+			input.nVertices = primitive.nVertices;
+			if ((normal.bPresent == true) && (normal.componentType == GL_FLOAT))
 			{
-				if (((i + 1) == _mainSegments) && ((j + 1) == _tubeSegments))
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[0][0]);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][0]);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				else if ((i + 1) == _mainSegments)
+				input.normals = (const GLfloat*)(sources[normal.buffer].data + normal.offset);
+				input.normalStride = normal.stride;
+			}
+			if ((texCoord.bPresent == true) && (texCoord.componentType == GL_FLOAT))
+			{
+				input.texCoords = (const GLfloat*)(sources[texCoord.buffer].data + texCoord.offset);
+				input.texCoordStride = texCoord.stride;
+			}
+
+			std::vector<GLuint> indices(primitive.nIndices);
+			const unsigned char* indexData = sources[primitive.indexBuffer].data + primitive.indexOffset;
+			for (GLuint j = 0; j < primitive.nIndices; j++)
+			{
+				indices[j] = (primitive.indexType == GL_UNSIGNED_SHORT) ?
+					((const GLushort*)indexData)[j] : ((const GLuint*)indexData)[j];
+			}
+
+			if ((m_bGenerateMeshlets == true) && (primitive.nIndices / 3 >= g_MeshletTriangleThreshold))
+			{
+				std::vector<GLuint> meshletIndices;
+				MeshletBuilder::BuildMeshlets(input.positions, input.positionStride, input.nVertices,
+					indices.data(), indices.size(), meshletIndices, meshlets[i]);
+				indices.swap(meshletIndices);
+			}
+
+			std::vector<GLuint> levelIndices;
+			if (m_bGenerateLods == true)
+			{
+				MeshSimplifier::BuildLodChain(input, indices.data(), indices.size(), MAX_LODS, levelIndices, lodLevels[i]);
+			}
+			if ((lodLevels[i].empty() == false) || (meshlets[i].empty() == false) || (shared[i] == true))
+			{
+				indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+				lodIndices[i].swap(indices);
+			}
+
+			if (shared[i] == true)
+			{
+				// interleaved float position, normal and texture
+				// coordinates, the layout of the built-in shapes
+				std::vector<GLfloat>& verts = sharedVerts[i];
+				verts.assign((std::size_t)primitive.nVertices * g_FloatsPerMeshVertex, 0.0f);
+				const GLint components[3] = { (GLint)g_FloatsPerVertex, (GLint)g_FloatsPerNormal, (GLint)g_FloatsPerUV };
+				GLuint firstFloat = 0;
+				for (int a = GltfImporter::POSITION_ATTRIBUTE; a <= GltfImporter::TEXCOORD_ATTRIBUTE; a++)
 				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][j + 1]);
-					texture_coords.push_back(glm::vec2(u, v + verticalStep));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					texture_coords.push_back(glm::vec2(0, v + verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					texture_coords.push_back(glm::vec2(0, v + verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
+					const GltfImporter::VERTEX_ATTRIBUTE& attribute = primitive.attributes[a];
+					if (attribute.bPresent == true)
+					{
+						const unsigned char* data = sources[attribute.buffer].data + attribute.offset;
+						GLint nComponents = std::min(components[a], attribute.components);
+						for (GLuint v = 0; v < primitive.nVertices; v++)
+						{
+							for (GLint c = 0; c < nComponents; c++)
+							{
+								verts[(v * g_FloatsPerMeshVertex) + firstFloat + c] = ReadComponent(
+									data + ((std::size_t)v * attribute.stride), attribute.componentType, attribute.bNormalized, c);
+							}
+						}
+					}
+					firstFloat += components[a];
 				}
-				else if ((j + 1) == _tubeSegments)
+
+				if (m_bCompactVertexFormat == true)
 				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i + 1][j]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, v));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
+					PackCompactVertices(verts.data(), primitive.nVertices,
+						positionScales[i], positionOffsets[i], sharedCompactVerts[i]);
+					std::vector<GLfloat>().swap(verts);
 				}
-
 			}
-			v += verticalStep;
-		}
-		v = 0.0;
-		u += horizontalStep;
+		});
 	}
 
-	std::vector<GLfloat> combined_values;
-
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < vertex_list.size(); i++)
+	// immutable buffers, read from the mapped file by the driver.
+	// The shared primitives were converted above, so only the
+	// buffers read through the VAO of a primitive are created
+	std::vector<bool> bufferUsed(sources.size(), false);
+	for (std::size_t i = 0; i < primitives.size(); i++)
 	{
-		vertex = vertex_list[i];
-		normal = normalize(vertex);
-		if (vertex.x < 0)
+		if (shared[i] == true)
 		{
-			if (normal.x > 0)
-				normal.x *= -1;
+			continue;
 		}
-		else if (vertex.x > 0)
+		for (GLuint a = 0; a < GltfImporter::ATTRIBUTE_COUNT; a++)
 		{
-			if (normal.x < 0)
-				normal.x *= -1;
+			if (primitives[i]->attributes[a].bPresent == true)
+			{
+				bufferUsed[primitives[i]->attributes[a].buffer] = true;
+			}
 		}
-		if (vertex.y < 0)
+		if ((primitives[i]->nIndices > 0) && (lodIndices[i].empty() == true))
 		{
-			if (normal.y > 0)
-				normal.y *= -1;
+			bufferUsed[primitives[i]->indexBuffer] = true;
 		}
-		else if (vertex.y > 0)
+	}
+
+	std::vector<GLuint> buffers(sources.size(), 0);
+	for (std::size_t i = 0; i < sources.size(); i++)
+	{
+		if (bufferUsed[i] == true)
 		{
-			if (normal.y < 0)
-				normal.y *= -1;
+			glGenBuffers(1, &buffers[i]);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]);
+			glBufferStorage(GL_COPY_WRITE_BUFFER, sources[i].size, sources[i].data, 0);
 		}
-		if (vertex.z < 0)
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	std::size_t primitiveNumber = 0;
+	std::size_t nLevels = 0;
+	std::size_t nMeshlets = 0;
+	for (std::size_t i = 0; i < meshes.size(); i++)
+	{
+		if (meshes[i].primitives.empty() == true)
 		{
-			if (normal.z > 0)
-				normal.z *= -1;
+			continue;
 		}
-		else if (vertex.z > 0)
+
+		GLImportedMesh imported;
+		imported.name = meshes[i].name;
+		imported.boundsMin = meshes[i].primitives[0].boundsMin;
+		imported.boundsMax = meshes[i].primitives[0].boundsMax;
+
+		for (std::size_t p = 0; p < meshes[i].primitives.size(); p++)
 		{
-			if (normal.z < 0)
-				normal.z *= -1;
+			const GltfImporter::PRIMITIVE& primitive = meshes[i].primitives[p];
+			imported.boundsMin = glm::min(imported.boundsMin, primitive.boundsMin);
+			imported.boundsMax = glm::max(imported.boundsMax, primitive.boundsMax);
+			std::size_t indexSize = (primitive.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+			GLMesh mesh;
+			mesh.vbos[0] = buffers[primitive.attributes[GltfImporter::POSITION_ATTRIBUTE].buffer];
+			mesh.vbos[1] = buffers[primitive.indexBuffer];
+			mesh.nVertices = primitive.nVertices;
+			mesh.nIndices = primitive.nIndices;
+			mesh.indexType = primitive.indexType;
+			mesh.positionScale = glm::vec3(1.0f);
+			mesh.positionOffset = glm::vec3(0.0f);
+			mesh.nSubMeshes = 1;
+			mesh.subMeshFirst[0] = 0;
+			mesh.subMeshCount[0] = primitive.nIndices;
+			mesh.baseVertex = 0;
+			mesh.firstIndex = (GLuint)(primitive.indexOffset / indexSize);
+			mesh.vertexSource = g_VertexSourceAttributes;
+			mesh.srcVerts = NULL;
+			mesh.srcIndices = NULL;
+			mesh.nLods = 0;
+			mesh.meshletCuller = -1;
+			mesh.boundsMin = primitive.boundsMin;
+			mesh.boundsMax = primitive.boundsMax;
+			mesh.boundingSphere = glm::vec4((primitive.boundsMin + primitive.boundsMax) * 0.5f,
+				glm::length(primitive.boundsMax - primitive.boundsMin) * 0.5f);
+
+			bool bShared = shared[primitiveNumber];
+
+			// the levels of detail and meshlets need their own index
+			// buffer, unless the indices go into the shared one
+			const std::vector<MeshSimplifier::LOD_LEVEL>& levels = lodLevels[primitiveNumber];
+			if (lodIndices[primitiveNumber].empty() == false)
+			{
+				if (bShared == false)
+				{
+					const std::vector<GLuint>& indices = lodIndices[primitiveNumber];
+					glGenBuffers(1, &mesh.vbos[1]);
+					glBindBuffer(GL_COPY_WRITE_BUFFER, mesh.vbos[1]);
+					glBufferStorage(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), 0);
+					glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				}
+
+				mesh.indexType = GL_UNSIGNED_INT;
+				mesh.firstIndex = 0;
+				for (std::size_t l = 0; l < levels.size(); l++)
+				{
+					mesh.lodFirst[l] = primitive.nIndices + levels[l].firstIndex;
+					mesh.lodCount[l] = levels[l].nIndices;
+					mesh.lodError[l] = levels[l].error;
+				}
+				mesh.nLods = (GLuint)levels.size();
+				nLevels += levels.size();
+
+				if (meshlets[primitiveNumber].empty() == false)
+				{
+					mesh.meshletCuller = (int)m_meshletCullers.size();
+					m_meshletCullers.push_back(MeshletCuller());
+					m_meshletCullers.back().SetMeshlets(meshlets[primitiveNumber]);
+					nMeshlets += meshlets[primitiveNumber].size();
+				}
+			}
+
+			if (bShared == true)
+			{
+				const std::vector<GLuint>& indices = lodIndices[primitiveNumber];
+				mesh.indexType = GL_UNSIGNED_INT;
+				if (m_bCompactVertexFormat == true)
+				{
+					const std::vector<CompactVertex>& compactVerts = sharedCompactVerts[primitiveNumber];
+					mesh.positionScale = positionScales[primitiveNumber];
+					mesh.positionOffset = positionOffsets[primitiveNumber];
+					UploadSharedMesh(mesh, compactVerts.data(), sizeof(CompactVertex) * compactVerts.size(),
+						indices.data(), indices.size());
+				}
+				else
+				{
+					const std::vector<GLfloat>& verts = sharedVerts[primitiveNumber];
+					UploadSharedMesh(mesh, verts.data(), sizeof(GLfloat) * verts.size(), indices.data(), indices.size());
+				}
+
+				// the shared buffers hold the only copy from here on
+				std::vector<GLfloat>().swap(sharedVerts[primitiveNumber]);
+				std::vector<CompactVertex>().swap(sharedCompactVerts[primitiveNumber]);
+				std::vector<GLuint>().swap(lodIndices[primitiveNumber]);
+				primitiveNumber++;
+				imported.primitives.push_back(mesh);
+				continue;
+			}
+			primitiveNumber++;
+
+			glGenVertexArrays(1, &mesh.vao);
+			glBindVertexArray(mesh.vao);
+
+			for (GLuint a = 0; a < GltfImporter::ATTRIBUTE_COUNT; a++)
+			{
+				const GltfImporter::VERTEX_ATTRIBUTE& attribute = primitive.attributes[a];
+				if (attribute.bPresent == false)
+				{
+					glDisableVertexAttribArray(a);
+					continue;
+				}
+
+				glBindBuffer(GL_ARRAY_BUFFER, buffers[attribute.buffer]);
+				glVertexAttribPointer(a, attribute.components, attribute.componentType,
+					attribute.bNormalized, attribute.stride, (void*)attribute.offset);
+				glEnableVertexAttribArray(a);
+			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
+
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			imported.primitives.push_back(mesh);
 		}
-		text_coord = texture_coords[i];
-		combined_values.push_back(vertex.x);
-		combined_values.push_back(vertex.y);
-		combined_values.push_back(vertex.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(text_coord.x);
-		combined_values.push_back(text_coord.y);
-	}
 
-	// store vertex and index count
-	m_TorusMesh.nVertices = vertex_list.size();
-	m_TorusMesh.nIndices = 0;
+		imported.boundingSphere = glm::vec4((imported.boundsMin + imported.boundsMax) * 0.5f,
+			glm::length(imported.boundsMax - imported.boundsMin) * 0.5f);
+		m_importedMeshes.push_back(imported);
+	}
 
-	// Create VAO
-	glGenVertexArrays(1, &m_TorusMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TorusMesh.vao);
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+	std::cout << "Imported glTF file: " << filename
+		<< " (" << sources.size() << " buffers, "
+		<< importer.GetConvertedBytes() << " bytes converted, "
+		<< nLevels << " levels of detail, "
+		<< nMeshlets << " meshlets, "
+		<< loadTime.count() << " ms)" << std::endl;
 
-	// Create VBOs
-	glGenBuffers(1, m_TorusMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TorusMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	return(true);
+}
 
-	if (m_bMemoryLayoutDone == false)
+///////////////////////////////////////////////////
+//	FindImportedMesh()
+//
+//	Look up an imported mesh by its glTF name.
+///////////////////////////////////////////////////
+int ShapeMeshes::FindImportedMesh(const std::string& name)
+{
+	for (std::size_t i = 0; i < m_importedMeshes.size(); i++)
 	{
-		SetShaderMemoryLayout();
+		if (m_importedMeshes[i].name == name)
+		{
+			return((int)i);
+		}
 	}
+	return(-1);
+}
+
+///////////////////////////////////////////////////
+//	GetImportedMeshCount()
+//
+//	Get the number of imported meshes.
+///////////////////////////////////////////////////
+int ShapeMeshes::GetImportedMeshCount()
+{
+	return((int)m_importedMeshes.size());
 }
 
 
@@ -2194,11 +2886,11 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMesh()
 {
-	glBindVertexArray(m_BoxMesh.vao);
+	BindMesh(m_BoxMesh);
 
-	glDrawElements(GL_TRIANGLES, m_BoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	DrawMesh(m_BoxMesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_BoxMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2210,15 +2902,14 @@ void ShapeMeshes::DrawBoxMesh()
 void ShapeMeshes::DrawConeMesh(
 	bool bDrawBottom)
 {
-	glBindVertexArray(m_ConeMesh.vao);
+	// parts are ordered bottom, sides
+	const bool bDrawSubMesh[] = { bDrawBottom, true };
 
-	if (bDrawBottom == true)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	}
-	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+	BindMesh(m_ConeMesh);
+
+	DrawSubMeshes(m_ConeMesh, bDrawSubMesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_ConeMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2232,22 +2923,14 @@ void ShapeMeshes::DrawCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_CylinderMesh.vao);
+	// parts are ordered bottom, top, sides
+	const bool bDrawSubMesh[] = { bDrawBottom, bDrawTop, bDrawSides };
 
-	if (bDrawBottom == true)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
-	}
-	if (bDrawTop == true)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 36);	//top
-	}
-	if (bDrawSides == true)
-	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-	}
+	BindMesh(m_CylinderMesh);
 
-	glBindVertexArray(0);
+	DrawSubMeshes(m_CylinderMesh, bDrawSubMesh);
+
+	UnbindMesh(m_CylinderMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2258,11 +2941,11 @@ void ShapeMeshes::DrawCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPlaneMesh()
 {
-	glBindVertexArray(m_PlaneMesh.vao);
+	BindMesh(m_PlaneMesh);
 
-	glDrawElements(GL_TRIANGLES, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	DrawMesh(m_PlaneMesh);
 	
-	glBindVertexArray(0);
+	UnbindMesh(m_PlaneMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2273,11 +2956,11 @@ void ShapeMeshes::DrawPlaneMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPrismMesh()
 {
-	glBindVertexArray(m_PrismMesh.vao);
+	BindMesh(m_PrismMesh);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_PrismMesh.nVertices);
+	DrawMesh(m_PrismMesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_PrismMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2288,11 +2971,11 @@ void ShapeMeshes::DrawPrismMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid3Mesh()
 {
-	glBindVertexArray(m_Pyramid3Mesh.vao);
+	BindMesh(m_Pyramid3Mesh);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid3Mesh.nVertices);
+	DrawMesh(m_Pyramid3Mesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_Pyramid3Mesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2303,11 +2986,11 @@ void ShapeMeshes::DrawPyramid3Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid4Mesh()
 {
-	glBindVertexArray(m_Pyramid4Mesh.vao);
+	BindMesh(m_Pyramid4Mesh);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid4Mesh.nVertices);
+	DrawMesh(m_Pyramid4Mesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_Pyramid4Mesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2318,11 +3001,11 @@ void ShapeMeshes::DrawPyramid4Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
+	BindMesh(m_SphereMesh);
 
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	DrawMesh(m_SphereMesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_SphereMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2333,11 +3016,11 @@ void ShapeMeshes::DrawSphereMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
+	BindMesh(m_SphereMesh);
 
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices/2, GL_UNSIGNED_INT, (void*)0);
+	DrawElements(m_SphereMesh, 0, m_SphereMesh.nIndices/2);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_SphereMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2351,22 +3034,14 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
+	// parts are ordered bottom, top, sides
+	const bool bDrawSubMesh[] = { bDrawBottom, bDrawTop, bDrawSides };
 
-	if (bDrawBottom == true)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
-	}
-	if (bDrawTop == true)
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 72);	//top
-	}
-	if (bDrawSides == true)
-	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-	}
+	BindMesh(m_TaperedCylinderMesh);
 
-	glBindVertexArray(0);
+	DrawSubMeshes(m_TaperedCylinderMesh, bDrawSubMesh);
+
+	UnbindMesh(m_TaperedCylinderMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2377,11 +3052,11 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	BindMesh(m_TorusMesh);
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices);
+	DrawMesh(m_TorusMesh);
 
-	glBindVertexArray(0);
+	UnbindMesh(m_TorusMesh);
 }
 
 ///////////////////////////////////////////////////
@@ -2392,11 +3067,36 @@ void ShapeMeshes::DrawTorusMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	BindMesh(m_TorusMesh);
+
+	DrawElements(m_TorusMesh, 0, m_TorusMesh.nIndices/2);
+
+	UnbindMesh(m_TorusMesh);
+}
+
+///////////////////////////////////////////////////
+//	DrawImportedMesh()
+//
+//	Draw every primitive of an imported mesh.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawImportedMesh(int meshIndex)
+{
+	if ((meshIndex < 0) || (meshIndex >= (int)m_importedMeshes.size()))
+	{
+		return;
+	}
+
+	const GLImportedMesh& imported = m_importedMeshes[meshIndex];
+	for (std::size_t i = 0; i < imported.primitives.size(); i++)
+	{
+		const GLMesh& mesh = imported.primitives[i];
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices/2);
+		BindMesh(mesh);
 
-	glBindVertexArray(0);
+		DrawMesh(mesh);
+
+		UnbindMesh(mesh);
+	}
 }
 
 glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
@@ -2410,7 +3110,7 @@ glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::
 	float v2z = p2.z - p1.z;
 	Normal.x = v1y * v2z - v1z * v2y;
 	Normal.y = v1z * v2x - v1x * v2z;
-	Normal.y = v1x * v2y - v1y * v2x;
+	Normal.z = v1x * v2y - v1y * v2x;
 	float len = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
 	if (len == 0)
 	{
@@ -2426,12 +3126,509 @@ glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::
 }
 
 
+///////////////////////////////////////////////////
+//	UploadMesh()
+//
+//	Create the VAO/VBOs for the passed in mesh and send
+//  the interleaved position, normal and texture data
+//  to the GPU.  When the compact vertex format is
+//  selected, the vertices are quantized and the indices
+//  are narrowed to 16 bits if the vertex count allows.
+//  The optional sub-mesh offsets hold the first index
+//  of each drawable part followed by the index count.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadMesh(
+	GLMesh& mesh,
+	const GLfloat* verts,
+	const GLuint* indices,
+	const GLuint* subMeshOffsets,
+	GLuint nSubMeshes)
+{
+	const GLuint floatsPerMeshVertex = g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV;
+
+	if (indices == NULL)
+	{
+		mesh.nIndices = 0;
+	}
+	mesh.indexType = GL_UNSIGNED_INT;
+	mesh.baseVertex = 0;
+	mesh.firstIndex = 0;
+	mesh.vertexSource = g_VertexSourceAttributes;
+	mesh.srcVerts = verts;
+	mesh.srcIndices = indices;
+	mesh.positionScale = glm::vec3(1.0f);
+	mesh.positionOffset = glm::vec3(0.0f);
+	mesh.nLods = 0;
+	mesh.meshletCuller = -1;
+	ComputeMeshBounds(mesh, verts);
+
+	// without offsets the whole index buffer is a single part
+	if ((subMeshOffsets == NULL) || (nSubMeshes > MAX_SUBMESHES))
+	{
+		mesh.nSubMeshes = 1;
+		mesh.subMeshFirst[0] = 0;
+		mesh.subMeshCount[0] = mesh.nIndices;
+	}
+	else
+	{
+		mesh.nSubMeshes = nSubMeshes;
+		for (GLuint i = 0; i < nSubMeshes; i++)
+		{
+			mesh.subMeshFirst[i] = subMeshOffsets[i];
+			mesh.subMeshCount[i] = subMeshOffsets[i + 1] - subMeshOffsets[i];
+		}
+	}
+
+	// the levels of detail are stored behind the mesh indices
+	const GLuint* uploadIndices = indices;
+	size_t nUploadIndices = mesh.nIndices;
+	std::vector<GLuint> lodIndices;
+	if ((m_bGenerateLods == true) && (mesh.nIndices > 0))
+	{
+		MeshSimplifier::VERTEX_INPUT input;
+		input.positions = verts;
+		input.positionStride = sizeof(GLfloat) * floatsPerMeshVertex;
+		input.normals = verts + g_FloatsPerVertex;
+		input.normalStride = input.positionStride;
+		input.texCoords = verts + g_FloatsPerVertex + g_FloatsPerNormal;
+		input.texCoordStride = input.positionStride;
+		input.nVertices = mesh.nVertices;
+
+		std::vector<MeshSimplifier::LOD_LEVEL> levels;
+		MeshSimplifier::BuildLodChain(input, indices, mesh.nIndices, MAX_LODS, lodIndices, levels);
+		if (levels.empty() == false)
+		{
+			for (std::size_t i = 0; i < levels.size(); i++)
+			{
+				mesh.lodFirst[i] = mesh.nIndices + levels[i].firstIndex;
+				mesh.lodCount[i] = levels[i].nIndices;
+				mesh.lodError[i] = levels[i].error;
+			}
+			mesh.nLods = (GLuint)levels.size();
+
+			lodIndices.insert(lodIndices.begin(), indices, indices + mesh.nIndices);
+			uploadIndices = lodIndices.data();
+			nUploadIndices = lodIndices.size();
+		}
+	}
+
+	// the shared buffers hold a single vertex format, and every
+	// mesh in them needs indices for its base vertex to apply
+	bool bShared = (m_vertexFetch != VAO_PER_MESH) && (indices != NULL) &&
+		((m_sharedVao == 0) || (m_bSharedCompact == m_bCompactVertexFormat));
+
+	const void* vertexData = verts;
+	size_t vertexBytes = sizeof(GLfloat) * floatsPerMeshVertex * mesh.nVertices;
+	std::vector<CompactVertex> compactVerts;
+
+	if (m_bCompactVertexFormat == true)
+	{
+		PackCompactVertices(verts, mesh.nVertices, mesh.positionScale, mesh.positionOffset, compactVerts);
+		vertexData = compactVerts.data();
+		vertexBytes = sizeof(CompactVertex) * compactVerts.size();
+	}
+
+	if (bShared == true)
+	{
+		UploadSharedMesh(mesh, vertexData, vertexBytes, uploadIndices, nUploadIndices);
+		return;
+	}
+
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+
+	// Create 2 buffers: first one for the vertex data; second one for the indices
+	glGenBuffers((mesh.nIndices > 0) ? 2 : 1, mesh.vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
+
+	// Sends vertex or coordinate data to the GPU
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+
+	if (mesh.nIndices > 0)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]); // Activates the buffer
+
+		// 16-bit indices halve the index bandwidth for all the basic shapes
+		if ((m_bCompactVertexFormat == true) && (mesh.nVertices <= 0xFFFF))
+		{
+			std::vector<GLushort> shortIndices(uploadIndices, uploadIndices + nUploadIndices);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * shortIndices.size(), shortIndices.data(), GL_STATIC_DRAW);
+			mesh.indexType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * nUploadIndices, uploadIndices, GL_STATIC_DRAW);
+		}
+	}
+
+	if (m_bMemoryLayoutDone == false)
+	{
+		SetShaderMemoryLayout();
+	}
+}
+
+///////////////////////////////////////////////////
+//	UploadSharedMesh()
+//
+//	Append the converted vertices and the indices of
+//  the passed in mesh to the shared buffers.  Only
+//  the new data is sent to the GPU, into buffers that
+//  grow ahead of the meshes, and no copy of it is
+//  kept on the CPU.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadSharedMesh(
+	GLMesh& mesh,
+	const void* vertexData,
+	size_t vertexBytes,
+	const GLuint* indices,
+	size_t nIndices)
+{
+	size_t vertexSize = vertexBytes / mesh.nVertices;
+	size_t indexBytes = sizeof(GLuint) * nIndices;
+
+	if (m_sharedVao == 0)
+	{
+		glGenVertexArrays(1, &m_sharedVao);
+		glGenVertexArrays(1, &m_pullingVao);
+		glGenBuffers(2, m_sharedBuffers);
+		m_bSharedCompact = m_bCompactVertexFormat;
+
+		// the attribute VAO reads the vertex buffer through the memory layout
+		glBindVertexArray(m_sharedVao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_sharedBuffers[0]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sharedBuffers[1]);
+		SetShaderMemoryLayout();
+
+		// the pulling VAO only holds the indices, no attribute is fetched
+		glBindVertexArray(m_pullingVao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sharedBuffers[1]);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	mesh.vao = (m_vertexFetch == VERTEX_PULLING) ? m_pullingVao : m_sharedVao;
+	mesh.vbos[0] = m_sharedBuffers[0];
+	mesh.vbos[1] = m_sharedBuffers[1];
+	mesh.baseVertex = (GLint)(m_sharedBytes[0] / vertexSize);
+	mesh.firstIndex = (GLuint)(m_sharedBytes[1] / sizeof(GLuint));
+	if (m_vertexFetch == VERTEX_PULLING)
+	{
+		mesh.vertexSource = (m_bSharedCompact == true) ? g_VertexSourcePulledCompact : g_VertexSourcePulledFloat;
+	}
+
+	m_maxSharedTriangles = std::max(m_maxSharedTriangles, (GLuint)(nIndices / 3));
+
+	ReserveSharedBuffer(m_sharedBuffers[0], m_sharedBytes[0], m_sharedBytes[0] + vertexBytes, m_sharedCapacity[0]);
+	ReserveSharedBuffer(m_sharedBuffers[1], m_sharedBytes[1], m_sharedBytes[1] + indexBytes, m_sharedCapacity[1]);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_sharedBuffers[0]);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, m_sharedBytes[0], vertexBytes, vertexData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_sharedBuffers[1]);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, m_sharedBytes[1], indexBytes, indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_sharedBytes[0] += vertexBytes;
+	m_sharedBytes[1] += indexBytes;
+
+	// the binding point is reserved for the pulled vertices
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_PulledVerticesBinding, m_sharedBuffers[0]);
+}
+
+///////////////////////////////////////////////////
+//	IsSharedMesh()
+//
+//	Check whether a mesh is drawn from the shared
+//  buffers, whichever VAO fetches it.
+///////////////////////////////////////////////////
+bool ShapeMeshes::IsSharedMesh(const GLMesh& mesh) const
+{
+	return((m_sharedVao != 0) && ((mesh.vao == m_sharedVao) || (mesh.vao == m_pullingVao)));
+}
+
+///////////////////////////////////////////////////
+//	RecordDraw()
+//
+//	Add a draw call to the current recording and pass
+//  its position to the vertex shader.  The range keeps
+//  the first index and base vertex of the call, so the
+//  resolve pass finds a triangle from its position and
+//  gl_PrimitiveID.
+///////////////////////////////////////////////////
+bool ShapeMeshes::RecordDraw(
+	const GLMesh& mesh,
+	GLuint firstIndex,
+	GLint baseVertex)
+{
+	if ((IsSharedMesh(mesh) == false) || (m_recordedDraws.size() >= m_maxRecordedDraws))
+	{
+		m_droppedDraws++;
+		return(false);
+	}
+
+	DRAW_RANGE range;
+	for (int i = 0; i < 3; i++)
+	{
+		range.positionScale[i] = mesh.positionScale[i];
+		range.positionOffset[i] = mesh.positionOffset[i];
+	}
+	range.firstIndex = firstIndex;
+	range.baseVertex = baseVertex;
+	range.vertexFormat = (m_bSharedCompact == true) ? g_VertexSourcePulledCompact : g_VertexSourcePulledFloat;
+	range.object = m_recordedObject;
+	range.padding[0] = 0;
+	range.padding[1] = 0;
+
+	glVertexAttribI1ui(g_DrawRangeAttrib, (GLuint)m_recordedDraws.size());
+	m_recordedDraws.push_back(range);
+	return(true);
+}
+
+///////////////////////////////////////////////////
+//	BindMesh()
+//
+//	Activate the VAO for the passed in mesh and set the
+//  position dequantization values for the vertex shader.
+///////////////////////////////////////////////////
+void ShapeMeshes::BindMesh(const GLMesh& mesh)
+{
+	glBindVertexArray(mesh.vao);
+
+	// these generic attributes are not backed by an array, so the
+	// same values are used for every vertex of the drawn mesh
+	glVertexAttrib3fv(g_PositionScaleAttrib, glm::value_ptr(mesh.positionScale));
+	glVertexAttrib3fv(g_PositionOffsetAttrib, glm::value_ptr(mesh.positionOffset));
+	glVertexAttribI1ui(g_VertexSourceAttrib, mesh.vertexSource);
+}
+
+///////////////////////////////////////////////////
+//	UnbindMesh()
+//
+//	Deactivate the VAO of the passed in mesh.  Meshes
+//  in the shared buffers leave their VAO bound, since
+//  the next mesh most likely uses the same one.
+///////////////////////////////////////////////////
+void ShapeMeshes::UnbindMesh(const GLMesh& mesh)
+{
+	if ((mesh.vao != m_sharedVao) && (mesh.vao != m_pullingVao))
+	{
+		glBindVertexArray(0);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawElements()
+//
+//	Draw a range of the indices of the bound mesh.  The
+//  base vertex selects the mesh in the shared buffers,
+//  and is also added to gl_VertexID for vertex pulling.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawElements(
+	const GLMesh& mesh,
+	GLuint firstIndex,
+	GLuint nIndices)
+{
+	if ((m_bRecordingDraws == true) && (RecordDraw(mesh, mesh.firstIndex + firstIndex, mesh.baseVertex) == false))
+	{
+		return;
+	}
+
+	std::size_t indexSize = (mesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+	glDrawElementsBaseVertex(
+		GL_TRIANGLES,
+		nIndices,
+		mesh.indexType,
+		(void*)((mesh.firstIndex + firstIndex) * indexSize),
+		mesh.baseVertex);
+}
+
+///////////////////////////////////////////////////
+//	SelectLod()
+//
+//	Pick the coarsest level of detail of the mesh
+//  whose error, scaled to the screen, stays below
+//  the pixel error threshold.  The levels are ordered
+//  by increasing error.
+///////////////////////////////////////////////////
+GLuint ShapeMeshes::SelectLod(const GLMesh& mesh)
+{
+	GLuint level = 0;
+	if (m_lodPixelsPerUnit > 0.0f)
+	{
+		while ((level < mesh.nLods) &&
+			(mesh.lodError[level] * m_lodPixelsPerUnit <= g_LodPixelError))
+		{
+			level++;
+		}
+	}
+	return(level);
+}
+
+///////////////////////////////////////////////////
+//	DrawMesh()
+//
+//	Draw all the indices of the bound mesh, or the
+//  indices of its selected level of detail.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMesh(const GLMesh& mesh)
+{
+	GLuint level = SelectLod(mesh);
+	if ((level == 0) && (mesh.meshletCuller >= 0) && (m_bCullingView == true))
+	{
+		DrawMeshlets(mesh);
+	}
+	else if (level == 0)
+	{
+		DrawElements(mesh, 0, mesh.nIndices);
+	}
+	else
+	{
+		DrawElements(mesh, mesh.lodFirst[level - 1], mesh.lodCount[level - 1]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawMeshlets()
+//
+//	Cull the meshlets of the bound mesh and draw the
+//  visible ones.  A single remaining range is drawn
+//  directly, several ranges are drawn with one
+//  glMultiDrawElementsIndirect() call from a stream
+//  buffer that is refilled for every draw.  While
+//  draws are recorded, each range is drawn on its own.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawMeshlets(const GLMesh& mesh)
+{
+	m_drawCommands.clear();
+	m_meshletCullers[mesh.meshletCuller].Cull(
+		m_cullModelViewProjection, m_cullCameraPosition,
+		mesh.firstIndex, mesh.baseVertex, m_drawCommands);
+
+	std::size_t indexSize = (mesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+	if (m_bRecordingDraws == true)
+	{
+		for (std::size_t i = 0; i < m_drawCommands.size(); i++)
+		{
+			const MeshletCuller::DRAW_COMMAND& command = m_drawCommands[i];
+			if (RecordDraw(mesh, command.firstIndex, command.baseVertex) == true)
+			{
+				glDrawElementsBaseVertex(GL_TRIANGLES, command.count, mesh.indexType,
+					(void*)(command.firstIndex * indexSize), command.baseVertex);
+			}
+		}
+	}
+	else if (m_drawCommands.size() == 1)
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, m_drawCommands[0].count, mesh.indexType,
+			(void*)(m_drawCommands[0].firstIndex * indexSize), m_drawCommands[0].baseVertex);
+	}
+	else if (m_drawCommands.size() > 1)
+	{
+		if (m_indirectBuffer == 0)
+		{
+			glGenBuffers(1, &m_indirectBuffer);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(MeshletCuller::DRAW_COMMAND) * m_drawCommands.size(),
+			m_drawCommands.data(), GL_STREAM_DRAW);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, (void*)0, (GLsizei)m_drawCommands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawSubMeshes()
+//
+//	Draw the selected index parts of the bound mesh.
+//  Adjacent parts are merged into one range, so a
+//  single glDrawElementsBaseVertex() call is issued
+//  when the selection is contiguous and a single
+//  glMultiDrawElementsBaseVertex() call when it is not.
+//  The levels of detail cover the whole mesh, so they
+//  are only used when every part is selected.  While
+//  draws are recorded, each range is drawn on its own.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawSubMeshes(
+	const GLMesh& mesh,
+	const bool* bDrawSubMesh)
+{
+	bool bDrawAll = true;
+	for (GLuint i = 0; i < mesh.nSubMeshes; i++)
+	{
+		bDrawAll = bDrawAll && bDrawSubMesh[i];
+	}
+	if ((bDrawAll == true) && (SelectLod(mesh) > 0))
+	{
+		DrawMesh(mesh);
+		return;
+	}
+
+	GLsizei counts[MAX_SUBMESHES];
+	void* offsets[MAX_SUBMESHES];
+	GLint baseVertices[MAX_SUBMESHES];
+	GLsizei nRanges = 0;
+	GLuint nextFirst = 0;
+	std::size_t indexSize = (mesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+	for (GLuint i = 0; i < mesh.nSubMeshes; i++)
+	{
+		if ((bDrawSubMesh[i] == false) || (mesh.subMeshCount[i] == 0))
+		{
+			continue;
+		}
+
+		// extend the previous range when this part follows it directly
+		if ((nRanges > 0) && (mesh.subMeshFirst[i] == nextFirst))
+		{
+			counts[nRanges - 1] += mesh.subMeshCount[i];
+		}
+		else
+		{
+			counts[nRanges] = mesh.subMeshCount[i];
+			offsets[nRanges] = (void*)((mesh.firstIndex + mesh.subMeshFirst[i]) * indexSize);
+			baseVertices[nRanges] = mesh.baseVertex;
+			nRanges++;
+		}
+		nextFirst = mesh.subMeshFirst[i] + mesh.subMeshCount[i];
+	}
+
+	if (m_bRecordingDraws == true)
+	{
+		for (GLsizei r = 0; r < nRanges; r++)
+		{
+			DrawElements(mesh, (GLuint)((std::size_t)offsets[r] / indexSize) - mesh.firstIndex, counts[r]);
+		}
+	}
+	else if (nRanges == 1)
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, counts[0], mesh.indexType, offsets[0], baseVertices[0]);
+	}
+	else if (nRanges > 1)
+	{
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, mesh.indexType, offsets, nRanges, baseVertices);
+	}
+}
 
 void ShapeMeshes::SetShaderMemoryLayout()
 {
 	// The following code defines the layout of the mesh data in memory - each mesh needs
 	// to have the same memory layout so that the data is retrieved properly by the shaders
 
+	if (m_bCompactVertexFormat == true)
+	{
+		GLint compactStride = sizeof(CompactVertex);
+
+		// positions are normalized to [-1, 1] and rescaled in the vertex shader
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, compactStride, (void*)offsetof(CompactVertex, position));
+		glEnableVertexAttribArray(0);
+
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, compactStride, (void*)offsetof(CompactVertex, normal));
+		glEnableVertexAttribArray(1);
+
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, compactStride, (void*)offsetof(CompactVertex, uv));
+		glEnableVertexAttribArray(2);
+		return;
+	}
+
 	// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
 	GLint stride = sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV);// The number of floats before each
 
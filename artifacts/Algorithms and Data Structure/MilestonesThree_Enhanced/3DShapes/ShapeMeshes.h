@@ -10,10 +10,15 @@
 
 #pragma once
 
+#include "MeshletCuller.h"
+
 #include <GL/glew.h>
 
 #include <glm/glm.hpp>
 
+#include <string>
+#include <vector>
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -26,8 +31,120 @@ public:
 	// constructor
 	ShapeMeshes();
 
+	// the available 3D shapes, used for looking up
+	// the geometry of a loaded mesh
+	enum MESH_SHAPE
+	{
+		BOX_MESH,
+		CONE_MESH,
+		CYLINDER_MESH,
+		PLANE_MESH,
+		PRISM_MESH,
+		PYRAMID3_MESH,
+		PYRAMID4_MESH,
+		SPHERE_MESH,
+		TAPERED_CYLINDER_MESH,
+		TORUS_MESH,
+		IMPORTED_MESH	// a mesh imported from a glTF file
+	};
+
+	// how the vertex shader fetches the mesh vertices
+	enum VERTEX_FETCH
+	{
+		VAO_PER_MESH,	// each mesh has its own VAO and buffers
+		SHARED_VAO,		// all meshes share one VAO and its buffers
+		VERTEX_PULLING	// the vertex shader reads a storage buffer by gl_VertexID
+	};
+
+	// select the compact quantized vertex format for
+	// the meshes loaded after this call
+	void SetCompactVertexFormat(bool bCompact);
+
+	// select how the vertices of the meshes loaded
+	// after this call are fetched
+	void SetVertexFetch(VERTEX_FETCH fetch);
+
+	// build simplified levels of detail for the meshes
+	// loaded after this call
+	void SetLodGeneration(bool bGenerate);
+
+	// set the screen size of one object space unit for
+	// the following draws, which select the coarsest level
+	// of detail whose error stays below a pixel; zero
+	// always draws the full detail
+	void SetLodScale(float pixelsPerUnit);
+
+	// split large meshes loaded after this call into
+	// meshlets that are culled separately
+	void SetMeshletGeneration(bool bGenerate);
+
+	// set the object space view of the following draws,
+	// which culls the meshlets of the drawn meshes
+	void SetCullingView(
+		const glm::mat4& modelViewProjection,
+		const glm::vec3& cameraPosition);
+	// draw the following meshes without meshlet culling
+	void ClearCullingView();
+
+	// a draw call recorded for the visibility buffer, laid
+	// out like the DrawRange of the resolve shader
+	struct DRAW_RANGE
+	{
+		GLfloat positionScale[3];
+		GLuint firstIndex;		// first index in the shared index buffer
+		GLfloat positionOffset[3];
+		GLint baseVertex;		// first vertex in the shared vertex buffer
+		GLuint vertexFormat;	// pulled float or compact vertices
+		GLuint object;			// object of the caller the draw belongs to
+		GLuint padding[2];
+	};
+
+	// record every draw call of the following draws, up to
+	// the passed in number, and pass its position in the
+	// record to the vertex shader.  Only meshes in the shared
+	// buffers are drawn while recording
+	void BeginDrawRecording(GLuint maxDraws);
+	// set the object of the following recorded draws
+	void SetRecordedObject(GLuint object);
+	void EndDrawRecording();
+	const std::vector<DRAW_RANGE>& GetRecordedDraws() const;
+	// draws left out of the last recording
+	GLuint GetDroppedDrawCount() const;
+	// most triangles of one draw from the shared buffers,
+	// 0 when no mesh is in them
+	GLuint GetMaxSharedTriangles() const;
+	// bind the shared vertices and indices to storage buffer
+	// bindings, false when no mesh is in them
+	bool BindSharedBuffers(GLuint vertexBinding, GLuint indexBinding) const;
+
+	// copy the interleaved vertices and triangle list
+	// indices of a loaded mesh for processing on the CPU
+	bool GetMeshGeometry(
+		MESH_SHAPE shape,
+		std::vector<GLfloat>& verts,
+		std::vector<GLuint>& indices);
+
+	// get the object space bounding box of a loaded mesh,
+	// or of the passed in imported mesh for IMPORTED_MESH
+	bool GetMeshBounds(
+		MESH_SHAPE shape,
+		int importedMesh,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax);
+	// get the object space bounding sphere of a loaded mesh,
+	// centered on its bounding box, as center and radius
+	bool GetMeshSphere(
+		MESH_SHAPE shape,
+		int importedMesh,
+		glm::vec4& sphere);
+
 private:
 
+	// most index parts of a mesh - bottom cap, top cap, sides
+	static const int MAX_SUBMESHES = 3;
+	// most simplified levels of detail of a mesh
+	static const int MAX_LODS = 4;
+
 	// stores the GL data relative to a given mesh
 	struct GLMesh
 	{
@@ -35,6 +152,25 @@ private:
 		GLuint vbos[2];     // Handles for the vertex buffer objects
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		GLenum indexType;	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		glm::vec3 positionScale;	// dequantization scale for compact positions
+		glm::vec3 positionOffset;	// dequantization offset for compact positions
+		GLuint nSubMeshes;			// number of separately drawable index parts
+		GLuint subMeshFirst[MAX_SUBMESHES];	// first index of each part
+		GLuint subMeshCount[MAX_SUBMESHES];	// number of indices in each part
+		GLint baseVertex;			// first vertex of the mesh in the shared buffers
+		GLuint firstIndex;			// first index of the mesh in the shared buffers
+		GLuint vertexSource;		// where the vertex shader reads the vertices from
+		const GLfloat* srcVerts;	// uploaded float vertex data, kept for CPU passes
+		const GLuint* srcIndices;	// uploaded index data, kept for CPU passes
+		GLuint nLods;				// number of simplified levels
+		GLuint lodFirst[MAX_LODS];	// first index of each level, after the full mesh
+		GLuint lodCount[MAX_LODS];	// number of indices in each level
+		float lodError[MAX_LODS];	// object space error of each level
+		int meshletCuller;			// index into m_meshletCullers, or -1
+		glm::vec3 boundsMin;		// object space bounding box
+		glm::vec3 boundsMax;
+		glm::vec4 boundingSphere;	// object space center and radius
 	};
 
 	// the available 3D shapes
@@ -50,6 +186,57 @@ private:
 	GLMesh m_TorusMesh;
 
 	bool m_bMemoryLayoutDone;
+	bool m_bCompactVertexFormat;
+	VERTEX_FETCH m_vertexFetch;
+	bool m_bGenerateLods;
+	float m_lodPixelsPerUnit;
+
+	// meshlet bounds of the split meshes, the view they are
+	// culled against and the commands of the visible ones
+	bool m_bGenerateMeshlets;
+	std::vector<MeshletCuller> m_meshletCullers;
+	bool m_bCullingView;
+	glm::mat4 m_cullModelViewProjection;
+	glm::vec3 m_cullCameraPosition;
+	std::vector<MeshletCuller::DRAW_COMMAND> m_drawCommands;
+	GLuint m_indirectBuffer;
+
+	// vertex and index buffers shared by the meshes that are
+	// not fetched per VAO, with one VAO for attribute fetching
+	// and one VAO holding only the indices for vertex pulling
+	GLuint m_sharedVao;
+	GLuint m_pullingVao;
+	GLuint m_sharedBuffers[2];
+	bool m_bSharedCompact;
+	// bytes written to the shared buffers, and their allocated
+	// size, which grows ahead of the meshes being appended
+	size_t m_sharedBytes[2];
+	size_t m_sharedCapacity[2];
+	GLuint m_maxSharedTriangles;
+
+	// draw calls of the current recording, and the draws that
+	// did not fit or were not in the shared buffers
+	bool m_bRecordingDraws;
+	GLuint m_maxRecordedDraws;
+	GLuint m_recordedObject;
+	std::vector<DRAW_RANGE> m_recordedDraws;
+	GLuint m_droppedDraws;
+
+	// torus vertices generated at runtime for a non-default thickness
+	std::vector<GLfloat> m_torusVerts;
+
+	// meshes imported from glTF files, each primitive with
+	// its own VAO over the buffers of its file, or in the
+	// shared buffers when the vertex fetch shares them
+	struct GLImportedMesh
+	{
+		std::string name;
+		std::vector<GLMesh> primitives;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		glm::vec4 boundingSphere;
+	};
+	std::vector<GLImportedMesh> m_importedMeshes;
 
 public:
 	// methods for loading the shape mesh data 
@@ -65,6 +252,13 @@ public:
 	void LoadTaperedCylinderMesh();
 	void LoadTorusMesh(float thickness = 0.2);
 
+	// import the triangle meshes of a binary glTF 2.0
+	// (.glb) file, returns false when none were imported
+	bool LoadGltfFile(const char* filename);
+	// index of an imported mesh by its glTF name, or -1
+	int FindImportedMesh(const std::string& name);
+	int GetImportedMeshCount();
+
 	// methods for drawing the shape mesh in the
 	// display window
 	void DrawBoxMesh();
@@ -86,6 +280,7 @@ public:
 		bool bDrawSides = true);
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
+	void DrawImportedMesh(int meshIndex);
 
 
 private:
@@ -95,6 +290,69 @@ private:
 	glm::vec3 CalculateTriangleNormal(
 		glm::vec3 px, glm::vec3 py, glm::vec3 pz);
 
+	// called to create the GPU buffers and send
+	// the mesh data to them
+	void UploadMesh(
+		GLMesh& mesh,
+		const GLfloat* verts,
+		const GLuint* indices,
+		const GLuint* subMeshOffsets = NULL,
+		GLuint nSubMeshes = 1);
+
+	// called to look up the mesh of a shape
+	GLMesh* GetMesh(MESH_SHAPE shape);
+	// called to compute the object space bounds of a
+	// mesh from its vertex positions
+	void ComputeMeshBounds(GLMesh& mesh, const GLfloat* verts);
+
+	// called to append the mesh data to the end of the
+	// shared buffers on the GPU
+	void UploadSharedMesh(
+		GLMesh& mesh,
+		const void* vertexData,
+		size_t vertexBytes,
+		const GLuint* indices,
+		size_t nIndices);
+
+	// called to check whether a mesh is drawn from the
+	// shared buffers
+	bool IsSharedMesh(const GLMesh& mesh) const;
+	// called to record a draw call of a mesh before it is
+	// issued, false when it must be left out
+	bool RecordDraw(
+		const GLMesh& mesh,
+		GLuint firstIndex,
+		GLint baseVertex);
+
+	// called to activate a mesh before drawing
+	void BindMesh(const GLMesh& mesh);
+	// called to deactivate a mesh after drawing
+	void UnbindMesh(const GLMesh& mesh);
+
+	// called to draw a range of the mesh indices
+	void DrawElements(
+		const GLMesh& mesh,
+		GLuint firstIndex,
+		GLuint nIndices);
+
+	// called to pick the level of detail of the mesh
+	// for the current scale, 0 being the full mesh
+	GLuint SelectLod(const GLMesh& mesh);
+
+	// called to draw the whole bound mesh at the
+	// selected level of detail
+	void DrawMesh(const GLMesh& mesh);
+
+	// called to draw the meshlets of the bound mesh that
+	// are visible in the culling view
+	void DrawMeshlets(const GLMesh& mesh);
+
+	// called to draw the selected index parts of
+	// the bound mesh with a single draw call
+	void DrawSubMeshes(
+		const GLMesh& mesh,
+		const bool* bDrawSubMesh);
+
 	// called to set the memory layout 
 	// template for shader data
 	void SetShaderMemoryLayout();
@@ -0,0 +1,371 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.cpp
+// ============
+// split the view frustum into a grid of clusters and find the lights that
+// reach each cluster, so a fragment only shades with the lights around it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLights.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// storage buffer bindings of the fragment shader
+	const GLuint g_LightsBinding = 5;
+	const GLuint g_ClustersBinding = 6;
+	const GLuint g_LightIndicesBinding = 7;
+
+	// clusters of one slice
+	const int g_SliceClusters = ClusteredLights::GRID_X * ClusteredLights::GRID_Y;
+
+	// tile of a coordinate in normalized device coordinates
+	int GetTile(float ndc, int tiles)
+	{
+		return((int)std::floor((ndc * 0.5f + 0.5f) * (float)tiles));
+	}
+}
+
+/***********************************************************
+ *  ClusteredLights()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLights::ClusteredLights()
+{
+	m_globalLightCount = 0;
+	m_bLightsChanged = true;
+	m_projection = glm::mat4(1.0f);
+	m_nearDepth = 0.1f;
+	m_farDepth = 100.0f;
+	m_bLogDepth = true;
+	m_depthScale = 0.0f;
+	m_depthBias = 0.0f;
+	m_clusterRanges.assign(2 * g_SliceClusters * GRID_Z, 0);
+	m_sliceIndices.resize(GRID_Z);
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ClusteredLights()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLights::~ClusteredLights()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the lights of the
+ *  scene.  The lights without a range are moved in front
+ *  of the others, keeping their order, so each light keeps
+ *  the shadow map layer of its place in the passed in list.
+ ***********************************************************/
+void ClusteredLights::SetLights(const std::vector<SceneFile::SCENE_LIGHT>& lights, int shadowedLights)
+{
+	m_lights.clear();
+	m_globalLightCount = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t i = 0; i < lights.size(); i++)
+		{
+			const SceneFile::SCENE_LIGHT& light = lights[i];
+			bool bGlobal = (light.range <= 0.0f);
+			if (bGlobal != (pass == 0))
+			{
+				continue;
+			}
+
+			GPU_LIGHT gpuLight;
+			for (int c = 0; c < 3; c++)
+			{
+				gpuLight.position[c] = light.position[c];
+				gpuLight.ambientColor[c] = light.ambientColor[c];
+				gpuLight.diffuseColor[c] = light.diffuseColor[c];
+				gpuLight.specularColor[c] = light.specularColor[c];
+			}
+			gpuLight.range = (bGlobal == true) ? 0.0f : light.range;
+			gpuLight.focalStrength = light.focalStrength;
+			gpuLight.specularIntensity = light.specularIntensity;
+			gpuLight.shadowLayer = ((int)i < shadowedLights) ? (float)i : -1.0f;
+			m_lights.push_back(gpuLight);
+		}
+		if (pass == 0)
+		{
+			m_globalLightCount = (int)m_lights.size();
+		}
+	}
+	m_bLightsChanged = true;
+}
+
+int ClusteredLights::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+int ClusteredLights::GetGlobalLightCount() const
+{
+	return(m_globalLightCount);
+}
+
+/***********************************************************
+ *  AssignLights()
+ *
+ *  This method is used for finding the lights of every
+ *  cluster of the passed in view.  The near and far depths
+ *  are taken from the projection, each slice is assigned
+ *  by its own job, and the index lists of the slices are
+ *  then joined into one list and uploaded.
+ ***********************************************************/
+void ClusteredLights::AssignLights(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_projection = projection;
+	m_bLogDepth = (projection[3][3] != 1.0f);
+	if (m_bLogDepth == true)
+	{
+		m_nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+		m_farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+		float logRatio = std::log(m_farDepth / m_nearDepth);
+		m_depthScale = (float)GRID_Z / logRatio;
+		m_depthBias = -(float)GRID_Z * std::log(m_nearDepth) / logRatio;
+	}
+	else
+	{
+		m_nearDepth = (projection[3][2] + 1.0f) / projection[2][2];
+		m_farDepth = (projection[3][2] - 1.0f) / projection[2][2];
+		m_depthScale = (float)GRID_Z / (m_farDepth - m_nearDepth);
+		m_depthBias = -m_nearDepth * m_depthScale;
+	}
+
+	m_viewSpheres.resize(m_lights.size() - m_globalLightCount);
+	for (size_t i = 0; i < m_viewSpheres.size(); i++)
+	{
+		const GPU_LIGHT& light = m_lights[m_globalLightCount + i];
+		glm::vec4 center = view * glm::vec4(light.position[0], light.position[1], light.position[2], 1.0f);
+		m_viewSpheres[i] = glm::vec4(glm::vec3(center), light.range);
+	}
+
+	JobSystem::Get().ParallelFor(GRID_Z, [this](size_t slice)
+		{
+			AssignSlice((int)slice);
+		});
+
+	m_indices.clear();
+	for (int slice = 0; slice < GRID_Z; slice++)
+	{
+		GLuint base = (GLuint)m_indices.size();
+		for (int i = 0; i < g_SliceClusters; i++)
+		{
+			m_clusterRanges[2 * (slice * g_SliceClusters + i)] += base;
+		}
+		m_indices.insert(m_indices.end(), m_sliceIndices[slice].begin(), m_sliceIndices[slice].end());
+	}
+
+	if (m_buffers[0] == 0)
+	{
+		glGenBuffers(BUFFER_COUNT, m_buffers);
+	}
+	// the buffers are never empty, so they can always be bound
+	if (m_bLightsChanged == true)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[LIGHT_BUFFER]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPU_LIGHT) * std::max(m_lights.size(), (size_t)1),
+			NULL, GL_STATIC_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPU_LIGHT) * m_lights.size(), m_lights.data());
+		m_bLightsChanged = false;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[CLUSTER_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * m_clusterRanges.size(),
+		m_clusterRanges.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[INDEX_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * std::max(m_indices.size(), (size_t)1),
+		NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint) * m_indices.size(), m_indices.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  AssignSlice()
+ *
+ *  This method is used for assigning the lights to the
+ *  clusters of one slice.  The part of a light sphere
+ *  inside the slice fits in a box as wide as the widest
+ *  circle of the sphere in the slice, and the tiles the
+ *  corners of that box project to are the clusters the
+ *  light can reach.  The light indices are counted per
+ *  cluster first, so each cluster gets one range.
+ ***********************************************************/
+void ClusteredLights::AssignSlice(int slice)
+{
+	float nearDepth = GetSliceDepth(slice);
+	float farDepth = GetSliceDepth(slice + 1);
+	GLuint* ranges = &m_clusterRanges[2 * slice * g_SliceClusters];
+
+	std::vector<glm::ivec4> tileRects;
+	std::vector<GLuint> lights;
+	for (size_t i = 0; i < m_viewSpheres.size(); i++)
+	{
+		const glm::vec4& sphere = m_viewSpheres[i];
+		float depth = -sphere.z;
+		float radius = sphere.w;
+		if ((depth + radius < nearDepth) || (depth - radius > farDepth))
+		{
+			continue;
+		}
+
+		// widest circle of the sphere between the slice depths
+		float outside = std::max(std::max(nearDepth - depth, depth - farDepth), 0.0f);
+		float circle = std::sqrt(std::max(radius * radius - outside * outside, 0.0f));
+		float boxDepths[2] = { std::max(nearDepth, depth - radius), std::min(farDepth, depth + radius) };
+
+		glm::vec2 ndcMin(1.0e30f);
+		glm::vec2 ndcMax(-1.0e30f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec4 position(
+				sphere.x + (((corner & 1) != 0) ? circle : -circle),
+				sphere.y + (((corner & 2) != 0) ? circle : -circle),
+				-boxDepths[corner >> 2],
+				1.0f);
+			glm::vec4 clip = m_projection * position;
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+
+		glm::ivec4 rect(GetTile(ndcMin.x, GRID_X), GetTile(ndcMin.y, GRID_Y),
+			GetTile(ndcMax.x, GRID_X), GetTile(ndcMax.y, GRID_Y));
+		if ((rect.z < 0) || (rect.w < 0) || (rect.x >= GRID_X) || (rect.y >= GRID_Y))
+		{
+			continue;
+		}
+		rect = glm::clamp(rect, glm::ivec4(0), glm::ivec4(GRID_X - 1, GRID_Y - 1, GRID_X - 1, GRID_Y - 1));
+		tileRects.push_back(rect);
+		lights.push_back((GLuint)(m_globalLightCount + i));
+	}
+
+	// count the lights of each cluster, and give each cluster
+	// its range of the slice list
+	for (int i = 0; i < g_SliceClusters; i++)
+	{
+		ranges[2 * i + 1] = 0;
+	}
+	for (size_t i = 0; i < tileRects.size(); i++)
+	{
+		const glm::ivec4& rect = tileRects[i];
+		for (int y = rect.y; y <= rect.w; y++)
+		{
+			for (int x = rect.x; x <= rect.z; x++)
+			{
+				ranges[2 * (y * GRID_X + x) + 1]++;
+			}
+		}
+	}
+	GLuint offset = 0;
+	for (int i = 0; i < g_SliceClusters; i++)
+	{
+		ranges[2 * i] = offset;
+		offset += ranges[2 * i + 1];
+		ranges[2 * i + 1] = 0;
+	}
+
+	std::vector<GLuint>& indices = m_sliceIndices[slice];
+	indices.resize(offset);
+	for (size_t i = 0; i < tileRects.size(); i++)
+	{
+		const glm::ivec4& rect = tileRects[i];
+		for (int y = rect.y; y <= rect.w; y++)
+		{
+			for (int x = rect.x; x <= rect.z; x++)
+			{
+				GLuint* range = &ranges[2 * (y * GRID_X + x)];
+				indices[range[0] + range[1]] = lights[i];
+				range[1]++;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetSliceDepth()
+ *
+ *  This method is used for getting the view depth where a
+ *  slice starts, the inverse of the slice of a depth.
+ ***********************************************************/
+float ClusteredLights::GetSliceDepth(int slice) const
+{
+	if (slice <= 0)
+	{
+		return(m_nearDepth);
+	}
+	if (slice >= GRID_Z)
+	{
+		return(m_farDepth);
+	}
+	float depth = ((float)slice - m_depthBias) / m_depthScale;
+	return((m_bLogDepth == true) ? std::exp(depth) : depth);
+}
+
+int ClusteredLights::GetAssignedCount() const
+{
+	return((int)m_indices.size());
+}
+
+bool ClusteredLights::IsLogDepth() const
+{
+	return(m_bLogDepth);
+}
+
+float ClusteredLights::GetDepthScale() const
+{
+	return(m_depthScale);
+}
+
+float ClusteredLights::GetDepthBias() const
+{
+	return(m_depthBias);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the buffers to the
+ *  bindings the fragment shader reads them from.
+ ***********************************************************/
+void ClusteredLights::Bind() const
+{
+	if (m_buffers[0] == 0)
+	{
+		return;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightsBinding, m_buffers[LIGHT_BUFFER]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ClustersBinding, m_buffers[CLUSTER_BUFFER]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightIndicesBinding, m_buffers[INDEX_BUFFER]);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffers.
+ ***********************************************************/
+void ClusteredLights::Destroy()
+{
+	if (m_buffers[0] != 0)
+	{
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	m_bLightsChanged = true;
+}
\ No newline at end of file
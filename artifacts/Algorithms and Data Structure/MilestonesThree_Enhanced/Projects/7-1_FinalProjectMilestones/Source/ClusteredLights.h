@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.h
+// ============
+// split the view frustum into a grid of clusters and find the lights that
+// reach each cluster, so a fragment only shades with the lights around it
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ClusteredLights
+ *
+ *  This class keeps the lights of the scene in a storage
+ *  buffer.  Lights without a range reach every fragment and
+ *  are kept first.  Every frame the view frustum is split
+ *  into tiles on screen and slices along the depth, whose
+ *  thickness grows with the depth for perspective views,
+ *  and the lights with a range are assigned to the clusters
+ *  their sphere touches.  The slices are assigned on the
+ *  job system.  Each cluster gets a range of a light index
+ *  list, so a fragment only loops over the lights of its
+ *  cluster, however many lights the scene has.
+ ***********************************************************/
+class ClusteredLights
+{
+public:
+	// constructor
+	ClusteredLights();
+	// destructor
+	~ClusteredLights();
+
+	// number of tiles across and down the screen, and of
+	// slices along the depth
+	static const int GRID_X = 16;
+	static const int GRID_Y = 9;
+	static const int GRID_Z = 24;
+
+	// a light, laid out like the LightSource of the fragment
+	// shader
+	struct GPU_LIGHT
+	{
+		GLfloat position[3];
+		GLfloat range;				// 0 reaches every fragment
+		GLfloat ambientColor[3];
+		GLfloat focalStrength;
+		GLfloat diffuseColor[3];
+		GLfloat specularIntensity;
+		GLfloat specularColor[3];
+		GLfloat shadowLayer;		// -1 without a shadow map
+	};
+
+	// set the lights of the scene, uploaded by the next
+	// AssignLights().  The first shadowedLights lights of the
+	// list read the shadow map layer of their index
+	void SetLights(const std::vector<SceneFile::SCENE_LIGHT>& lights, int shadowedLights);
+	int GetLightCount() const;
+	// number of lights without a range, stored first
+	int GetGlobalLightCount() const;
+
+	// assign the lights with a range to the clusters of the
+	// passed in view, and upload the clusters
+	void AssignLights(const glm::mat4& view, const glm::mat4& projection);
+	// number of light indices of all the clusters of the last
+	// assignment
+	int GetAssignedCount() const;
+
+	// slice of a view depth, as log(depth) * scale + bias for
+	// perspective views, or depth * scale + bias otherwise
+	bool IsLogDepth() const;
+	float GetDepthScale() const;
+	float GetDepthBias() const;
+
+	// bind the lights, the cluster ranges and the light index
+	// list to their storage buffer bindings
+	void Bind() const;
+
+	// free the buffers
+	void Destroy();
+
+private:
+	// assign the lights to the clusters of one slice
+	void AssignSlice(int slice);
+	// view depth of the near side of a slice
+	float GetSliceDepth(int slice) const;
+
+	enum BUFFER
+	{
+		LIGHT_BUFFER,
+		CLUSTER_BUFFER,
+		INDEX_BUFFER,
+		BUFFER_COUNT
+	};
+
+	std::vector<GPU_LIGHT> m_lights;
+	int m_globalLightCount;
+	bool m_bLightsChanged;
+
+	// view of the assignment, and the view space sphere of
+	// each light with a range
+	glm::mat4 m_projection;
+	std::vector<glm::vec4> m_viewSpheres;
+	float m_nearDepth;
+	float m_farDepth;
+	bool m_bLogDepth;
+	float m_depthScale;
+	float m_depthBias;
+
+	// first light index and number of lights of each cluster,
+	// the light indices of each slice, and of all the slices
+	// one after another
+	std::vector<GLuint> m_clusterRanges;
+	std::vector<std::vector<GLuint>> m_sliceIndices;
+	std::vector<GLuint> m_indices;
+
+	GLuint m_buffers[BUFFER_COUNT];
+};
\ No newline at end of file
@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// draw the surfaces of the scene into a compact G-buffer, and light every
+// pixel once from it in a full screen pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const char* g_LightingVertexShaderFile = "../../Utilities/shaders/deferredVertexShader.glsl";
+	const char* g_LightingFragmentShaderFile = "../../Utilities/shaders/deferredFragmentShader.glsl";
+
+	// storage buffer binding of the material table.  GL only
+	// guarantees bindings 0 to 7, so it shares one with the
+	// culling shader and is bound again before each pass
+	const GLuint g_MaterialsBinding = 2;
+	// texture units of the G-buffer, after the scene textures
+	// and the impostor atlas
+	const GLuint g_AlbedoUnit = 18;
+	const GLuint g_NormalUnit = 19;
+	const GLuint g_DepthUnit = 20;
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_framebuffer = 0;
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		m_targets[i] = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_previousFramebuffer = 0;
+	m_bBlendEnabled = false;
+	m_lightingShader = NULL;
+	m_bShaderFailed = false;
+	m_emptyVao = 0;
+	m_materialBuffer = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for setting the material table.  It
+ *  is only uploaded when it differs from the last one, so
+ *  it can be passed every frame.
+ ***********************************************************/
+void DeferredRenderer::SetMaterials(const std::vector<GPU_MATERIAL>& materials)
+{
+	size_t count = std::min(materials.size(), (size_t)MAX_MATERIALS);
+	if ((m_materialBuffer != 0) && (count == m_materials.size()) &&
+		((count == 0) || (memcmp(materials.data(), m_materials.data(), sizeof(GPU_MATERIAL) * count) == 0)))
+	{
+		return;
+	}
+	m_materials.assign(materials.begin(), materials.begin() + count);
+
+	if (m_materialBuffer == 0)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
+	// the buffer is never empty, so it can always be bound
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPU_MATERIAL) * std::max(count, (size_t)1), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPU_MATERIAL) * count, m_materials.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int DeferredRenderer::GetMaterialCount() const
+{
+	return((int)m_materials.size());
+}
+
+void DeferredRenderer::BindMaterials() const
+{
+	if (m_materialBuffer != 0)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_MaterialsBinding, m_materialBuffer);
+	}
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the G-buffer for the
+ *  geometry pass.  The lighting shader is loaded the first
+ *  time, and the targets are created again when the size
+ *  of the viewport changes.
+ ***********************************************************/
+bool DeferredRenderer::BeginGeometryPass()
+{
+	if (m_bShaderFailed == true)
+	{
+		return(false);
+	}
+	if (m_lightingShader == NULL)
+	{
+		m_lightingShader = new ShaderManager();
+		m_lightingShader->m_programID = 0;
+		m_lightingShader->LoadShaders(g_LightingVertexShaderFile, g_LightingFragmentShaderFile);
+		GLint linked = GL_FALSE;
+		if (m_lightingShader->m_programID != 0)
+		{
+			glGetProgramiv(m_lightingShader->m_programID, GL_LINK_STATUS, &linked);
+		}
+		if (linked == GL_FALSE)
+		{
+			std::cout << "Deferred lighting shader failed, using forward shading" << std::endl;
+			m_bShaderFailed = true;
+			return(false);
+		}
+		glGenVertexArrays(1, &m_emptyVao);
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (((viewport[2] != m_width) || (viewport[3] != m_height)) &&
+		(CreateTargets(viewport[2], viewport[3]) == false))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	m_bBlendEnabled = (glIsEnabled(GL_BLEND) == GL_TRUE);
+	glDisable(GL_BLEND);
+	return(true);
+}
+
+/***********************************************************
+ *  EndGeometryPass()
+ *
+ *  This method is used for binding the framebuffer that
+ *  was bound before the geometry pass, with its blending.
+ ***********************************************************/
+void DeferredRenderer::EndGeometryPass()
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_previousFramebuffer);
+	if (m_bBlendEnabled == true)
+	{
+		glEnable(GL_BLEND);
+	}
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the G-buffer.  The
+ *  color is 8 bits per channel with the material index in
+ *  alpha, the folded normal 16 bits per channel, and the
+ *  depth a texture so the lighting pass can read it.
+ ***********************************************************/
+bool DeferredRenderer::CreateTargets(int width, int height)
+{
+	if (m_targets[0] != 0)
+	{
+		glDeleteTextures(TARGET_COUNT, m_targets);
+	}
+	if (m_framebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_framebuffer);
+	}
+	m_width = width;
+	m_height = height;
+
+	const GLenum formats[TARGET_COUNT] = { GL_RGBA8, GL_RG16_SNORM, GL_DEPTH_COMPONENT24 };
+	glGenTextures(TARGET_COUNT, m_targets);
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_targets[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_targets[ALBEDO_TARGET], 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_targets[NORMAL_TARGET], 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_targets[DEPTH_TARGET], 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "G-buffer is not complete, using forward shading" << std::endl;
+		m_bShaderFailed = true;
+	}
+	return(bComplete);
+}
+
+/***********************************************************
+ *  LightScene()
+ *
+ *  This method is used for shading every covered pixel of
+ *  the G-buffer with one full screen triangle.  The depth
+ *  test passes everywhere, and the depth of the G-buffer is
+ *  written with the color, so the forward draws after it
+ *  are hidden by the lit surfaces.
+ ***********************************************************/
+void DeferredRenderer::LightScene(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition,
+	const ClusteredLights& lights)
+{
+	if ((m_lightingShader == NULL) || (m_bShaderFailed == true))
+	{
+		return;
+	}
+
+	m_lightingShader->use();
+	m_lightingShader->setMat4Value("view", view);
+	m_lightingShader->setMat4Value("projection", projection);
+	m_lightingShader->setMat4Value("inverseViewProjection", glm::inverse(projection * view));
+	m_lightingShader->setVec3Value("viewPosition", viewPosition);
+	m_lightingShader->setIntValue("lightCount", lights.GetLightCount());
+	m_lightingShader->setIntValue("globalLightCount", lights.GetGlobalLightCount());
+	m_lightingShader->setBoolValue("bClusterLogDepth", lights.IsLogDepth());
+	m_lightingShader->setFloatValue("clusterDepthScale", lights.GetDepthScale());
+	m_lightingShader->setFloatValue("clusterDepthBias", lights.GetDepthBias());
+	m_lightingShader->setIntValue("materialCount", (int)m_materials.size());
+	m_lightingShader->setSampler2DValue("gBufferAlbedo", g_AlbedoUnit);
+	m_lightingShader->setSampler2DValue("gBufferNormal", g_NormalUnit);
+	m_lightingShader->setSampler2DValue("gBufferDepth", g_DepthUnit);
+
+	const GLuint units[TARGET_COUNT] = { g_AlbedoUnit, g_NormalUnit, g_DepthUnit };
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + units[i]);
+		glBindTexture(GL_TEXTURE_2D, m_targets[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	BindMaterials();
+
+	glDepthFunc(GL_ALWAYS);
+	glBindVertexArray(m_emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthFunc(GL_LESS);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the G-buffer, the
+ *  material table and the lighting shader.
+ ***********************************************************/
+void DeferredRenderer::Destroy()
+{
+	if (m_targets[0] != 0)
+	{
+		glDeleteTextures(TARGET_COUNT, m_targets);
+		for (int i = 0; i < TARGET_COUNT; i++)
+		{
+			m_targets[i] = 0;
+		}
+	}
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+	m_materials.clear();
+	if (m_emptyVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVao);
+		m_emptyVao = 0;
+	}
+	if (m_lightingShader != NULL)
+	{
+		if (m_lightingShader->m_programID != 0)
+		{
+			glDeleteProgram(m_lightingShader->m_programID);
+		}
+		delete m_lightingShader;
+		m_lightingShader = NULL;
+	}
+	m_bShaderFailed = false;
+}
\ No newline at end of file
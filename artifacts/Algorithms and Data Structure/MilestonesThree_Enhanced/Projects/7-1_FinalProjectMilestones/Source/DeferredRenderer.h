@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// draw the surfaces of the scene into a compact G-buffer, and light every
+// pixel once from it in a full screen pass
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ClusteredLights.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class keeps the G-buffer of the deferred path.  The
+ *  geometry pass writes the surface color with the index of
+ *  its material in one RGBA8 target, and the world normal
+ *  folded onto the octahedron in one RG16 target, so a
+ *  pixel costs 8 bytes besides its depth.  The position is
+ *  rebuilt from the depth.  The lighting pass then shades
+ *  each pixel once with the lights of its cluster, whatever
+ *  the overdraw of the geometry pass was.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// a material, laid out like the Material of the lighting
+	// shader
+	struct GPU_MATERIAL
+	{
+		GLfloat ambientColor[3];
+		GLfloat ambientStrength;
+		GLfloat diffuseColor[3];
+		GLfloat shininess;
+		GLfloat specularColor[3];
+		GLfloat padding;
+	};
+
+	// the material index is stored in 8 bits, one value of
+	// which marks surfaces without a material
+	static const int MAX_MATERIALS = 255;
+
+	// set the material table the material indices refer to
+	void SetMaterials(const std::vector<GPU_MATERIAL>& materials);
+	int GetMaterialCount() const;
+	// bind the material table to its storage buffer binding,
+	// where the visibility buffer reads it as well
+	void BindMaterials() const;
+
+	// bind and clear the G-buffer, sized to the current
+	// viewport.  False when the lighting shader or the
+	// G-buffer could not be created
+	bool BeginGeometryPass();
+	// go back to the framebuffer that was bound before
+	void EndGeometryPass();
+
+	// light the G-buffer into the bound framebuffer, and
+	// write its depth there for the forward draws that follow.
+	// The current program is changed, so the caller activates
+	// its own program again
+	void LightScene(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition,
+		const ClusteredLights& lights);
+
+	// free the G-buffer and the lighting shader
+	void Destroy();
+
+private:
+	// create the G-buffer targets at the passed in size
+	bool CreateTargets(int width, int height);
+
+	enum TARGET
+	{
+		ALBEDO_TARGET,
+		NORMAL_TARGET,
+		DEPTH_TARGET,
+		TARGET_COUNT
+	};
+
+	GLuint m_framebuffer;
+	GLuint m_targets[TARGET_COUNT];
+	int m_width;
+	int m_height;
+	GLint m_previousFramebuffer;
+	// blending is off while the G-buffer is drawn, since its
+	// alpha holds the material index
+	bool m_bBlendEnabled;
+
+	ShaderManager* m_lightingShader;
+	bool m_bShaderFailed;
+	// no vertex buffers, the full screen triangle comes from
+	// the vertex index
+	GLuint m_emptyVao;
+
+	std::vector<GPU_MATERIAL> m_materials;
+	GLuint m_materialBuffer;
+};
\ No newline at end of file
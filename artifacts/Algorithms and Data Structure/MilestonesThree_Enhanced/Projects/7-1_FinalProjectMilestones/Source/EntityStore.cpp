@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.cpp
+// ============
+// store the components of the renderable scene entities in chunks grouped
+// by archetype, one array per component, so systems walk contiguous memory
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EntityStore.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// number of component types, in the bit order of the mask
+	const int g_ComponentCount = 6;
+
+	const size_t g_ComponentSizes[g_ComponentCount] = {
+		sizeof(EntityStore::TRANSFORM_COMPONENT),
+		sizeof(EntityStore::MESH_COMPONENT),
+		sizeof(EntityStore::MATERIAL_COMPONENT),
+		sizeof(EntityStore::TEXTURE_COMPONENT),
+		sizeof(EntityStore::BOUNDS_COMPONENT),
+		sizeof(EntityStore::FLAGS_COMPONENT) };
+
+	// the arrays of a chunk start on cache line boundaries
+	// relative to the chunk memory
+	const size_t g_ArrayAlignment = 64;
+
+	/***********************************************************
+	 *  GetArray()
+	 *
+	 *  Get the array of a component of a chunk as bytes, so
+	 *  the components can be moved without knowing their type.
+	 ***********************************************************/
+	unsigned char* GetArray(const EntityStore::CHUNK* chunk, int component)
+	{
+		switch (component)
+		{
+		case 0:
+			return((unsigned char*)chunk->transforms);
+		case 1:
+			return((unsigned char*)chunk->meshes);
+		case 2:
+			return((unsigned char*)chunk->materials);
+		case 3:
+			return((unsigned char*)chunk->textures);
+		case 4:
+			return((unsigned char*)chunk->bounds);
+		case 5:
+			return((unsigned char*)chunk->flags);
+		}
+		return(NULL);
+	}
+
+	/***********************************************************
+	 *  CreateChunk()
+	 *
+	 *  Allocate an empty chunk with one array per component of
+	 *  the passed in archetype, carved out of one allocation.
+	 ***********************************************************/
+	EntityStore::CHUNK* CreateChunk(unsigned int mask)
+	{
+		size_t offsets[g_ComponentCount];
+		size_t totalSize = 0;
+		for (int c = 0; c < g_ComponentCount; c++)
+		{
+			offsets[c] = totalSize;
+			if ((mask & (1u << c)) != 0)
+			{
+				size_t arraySize = g_ComponentSizes[c] * EntityStore::CHUNK_CAPACITY;
+				totalSize += (arraySize + g_ArrayAlignment - 1) / g_ArrayAlignment * g_ArrayAlignment;
+			}
+		}
+
+		EntityStore::CHUNK* chunk = new EntityStore::CHUNK;
+		chunk->mask = mask;
+		chunk->count = 0;
+		chunk->memory = new unsigned char[totalSize];
+
+		unsigned char* arrays[g_ComponentCount];
+		for (int c = 0; c < g_ComponentCount; c++)
+		{
+			arrays[c] = ((mask & (1u << c)) != 0) ? chunk->memory + offsets[c] : NULL;
+		}
+		chunk->transforms = (EntityStore::TRANSFORM_COMPONENT*)arrays[0];
+		chunk->meshes = (EntityStore::MESH_COMPONENT*)arrays[1];
+		chunk->materials = (EntityStore::MATERIAL_COMPONENT*)arrays[2];
+		chunk->textures = (EntityStore::TEXTURE_COMPONENT*)arrays[3];
+		chunk->bounds = (EntityStore::BOUNDS_COMPONENT*)arrays[4];
+		chunk->flags = (EntityStore::FLAGS_COMPONENT*)arrays[5];
+
+		return(chunk);
+	}
+
+	void DestroyChunk(EntityStore::CHUNK* chunk)
+	{
+		delete[] chunk->memory;
+		delete chunk;
+	}
+}
+
+/***********************************************************
+ *  EntityStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EntityStore::EntityStore()
+{
+	m_entityCount = 0;
+}
+
+/***********************************************************
+ *  ~EntityStore()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+EntityStore::~EntityStore()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  CreateEntity()
+ *
+ *  This method is used for adding an entity, reusing the id
+ *  of a destroyed entity when there is one.
+ ***********************************************************/
+int EntityStore::CreateEntity(unsigned int mask)
+{
+	int entity = 0;
+	if (m_freeEntities.empty() == false)
+	{
+		entity = m_freeEntities.back();
+		m_freeEntities.pop_back();
+	}
+	else
+	{
+		entity = (int)m_locations.size();
+		m_locations.push_back(ENTITY_LOCATION());
+	}
+
+	AddToArchetype(entity, FindArchetype(mask));
+	m_entityCount++;
+
+	return(entity);
+}
+
+/***********************************************************
+ *  DestroyEntity()
+ *
+ *  This method is used for removing an entity and its
+ *  components.
+ ***********************************************************/
+void EntityStore::DestroyEntity(int entity)
+{
+	if (IsAlive(entity) == false)
+	{
+		return;
+	}
+
+	RemoveFromArchetype(entity);
+	m_locations[entity].archetype = -1;
+	m_freeEntities.push_back(entity);
+	m_entityCount--;
+}
+
+/***********************************************************
+ *  SetComponents()
+ *
+ *  This method is used for adding and removing components
+ *  of an entity.  The entity moves to the chunks of its new
+ *  archetype, taking the components both archetypes have.
+ ***********************************************************/
+void EntityStore::SetComponents(int entity, unsigned int mask)
+{
+	if ((IsAlive(entity) == false) || (GetComponents(entity) == mask))
+	{
+		return;
+	}
+
+	int oldIndex = 0;
+	CHUNK* oldChunk = GetChunk(entity, oldIndex);
+	ENTITY_LOCATION oldLocation = m_locations[entity];
+
+	AddToArchetype(entity, FindArchetype(mask));
+	int newIndex = 0;
+	CHUNK* newChunk = GetChunk(entity, newIndex);
+	for (int c = 0; c < g_ComponentCount; c++)
+	{
+		if ((oldChunk->mask & newChunk->mask & (1u << c)) != 0)
+		{
+			std::memcpy(GetArray(newChunk, c) + newIndex * g_ComponentSizes[c],
+				GetArray(oldChunk, c) + oldIndex * g_ComponentSizes[c],
+				g_ComponentSizes[c]);
+		}
+	}
+
+	// remove the old slot, then point the entity at the new one
+	ENTITY_LOCATION newLocation = m_locations[entity];
+	m_locations[entity] = oldLocation;
+	RemoveFromArchetype(entity);
+	m_locations[entity] = newLocation;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the entities and
+ *  freeing the chunks.
+ ***********************************************************/
+void EntityStore::Clear()
+{
+	for (size_t a = 0; a < m_archetypes.size(); a++)
+	{
+		for (size_t c = 0; c < m_archetypes[a].chunks.size(); c++)
+		{
+			DestroyChunk(m_archetypes[a].chunks[c]);
+		}
+	}
+	m_archetypes.clear();
+	m_locations.clear();
+	m_freeEntities.clear();
+	m_entityCount = 0;
+}
+
+/***********************************************************
+ *  IsAlive()
+ *
+ *  This method is used for checking whether an id belongs
+ *  to an existing entity.
+ ***********************************************************/
+bool EntityStore::IsAlive(int entity) const
+{
+	return((entity >= 0) && (entity < (int)m_locations.size()) && (m_locations[entity].archetype >= 0));
+}
+
+/***********************************************************
+ *  GetComponents()
+ *
+ *  This method is used for getting the component mask of
+ *  an entity, 0 for ids without an entity.
+ ***********************************************************/
+unsigned int EntityStore::GetComponents(int entity) const
+{
+	if (IsAlive(entity) == false)
+	{
+		return(0);
+	}
+	return(m_archetypes[m_locations[entity].archetype].mask);
+}
+
+/***********************************************************
+ *  GetEntityCount()
+ *
+ *  This method is used for getting the number of entities.
+ ***********************************************************/
+int EntityStore::GetEntityCount() const
+{
+	return(m_entityCount);
+}
+
+/***********************************************************
+ *  GetTransform()
+ *
+ *  This method is used for getting the transform component
+ *  of an entity.
+ ***********************************************************/
+EntityStore::TRANSFORM_COMPONENT* EntityStore::GetTransform(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->transforms != NULL)) ? &chunk->transforms[index] : NULL);
+}
+
+/***********************************************************
+ *  GetMesh()
+ *
+ *  This method is used for getting the mesh component of
+ *  an entity.
+ ***********************************************************/
+EntityStore::MESH_COMPONENT* EntityStore::GetMesh(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->meshes != NULL)) ? &chunk->meshes[index] : NULL);
+}
+
+/***********************************************************
+ *  GetMaterial()
+ *
+ *  This method is used for getting the material component
+ *  of an entity.
+ ***********************************************************/
+EntityStore::MATERIAL_COMPONENT* EntityStore::GetMaterial(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->materials != NULL)) ? &chunk->materials[index] : NULL);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the texture component
+ *  of an entity.
+ ***********************************************************/
+EntityStore::TEXTURE_COMPONENT* EntityStore::GetTexture(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->textures != NULL)) ? &chunk->textures[index] : NULL);
+}
+
+/***********************************************************
+ *  GetBounds()
+ *
+ *  This method is used for getting the bounds component of
+ *  an entity.
+ ***********************************************************/
+EntityStore::BOUNDS_COMPONENT* EntityStore::GetBounds(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->bounds != NULL)) ? &chunk->bounds[index] : NULL);
+}
+
+/***********************************************************
+ *  GetFlags()
+ *
+ *  This method is used for getting the flags component of
+ *  an entity.
+ ***********************************************************/
+EntityStore::FLAGS_COMPONENT* EntityStore::GetFlags(int entity)
+{
+	int index = 0;
+	CHUNK* chunk = GetChunk(entity, index);
+	return(((chunk != NULL) && (chunk->flags != NULL)) ? &chunk->flags[index] : NULL);
+}
+
+/***********************************************************
+ *  GetChunks()
+ *
+ *  This method is used for collecting the chunks a system
+ *  walks.  The chunks of an archetype are appended in
+ *  order, so the entities are visited in memory order.
+ ***********************************************************/
+void EntityStore::GetChunks(unsigned int mask, std::vector<CHUNK*>& chunks) const
+{
+	chunks.clear();
+	for (size_t a = 0; a < m_archetypes.size(); a++)
+	{
+		if ((m_archetypes[a].mask & mask) != mask)
+		{
+			continue;
+		}
+		for (size_t c = 0; c < m_archetypes[a].chunks.size(); c++)
+		{
+			if (m_archetypes[a].chunks[c]->count > 0)
+			{
+				chunks.push_back(m_archetypes[a].chunks[c]);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FindArchetype()
+ *
+ *  This method is used for getting the index of the
+ *  archetype with the passed in components, adding it the
+ *  first time it is needed.
+ ***********************************************************/
+int EntityStore::FindArchetype(unsigned int mask)
+{
+	for (size_t a = 0; a < m_archetypes.size(); a++)
+	{
+		if (m_archetypes[a].mask == mask)
+		{
+			return((int)a);
+		}
+	}
+
+	ARCHETYPE archetype;
+	archetype.mask = mask;
+	m_archetypes.push_back(archetype);
+	return((int)m_archetypes.size() - 1);
+}
+
+/***********************************************************
+ *  AddToArchetype()
+ *
+ *  This method is used for appending an entity to the last
+ *  chunk of an archetype, adding a chunk when it is full.
+ ***********************************************************/
+void EntityStore::AddToArchetype(int entity, int archetype)
+{
+	ARCHETYPE& target = m_archetypes[archetype];
+	if ((target.chunks.empty() == true) || (target.chunks.back()->count >= CHUNK_CAPACITY))
+	{
+		target.chunks.push_back(CreateChunk(target.mask));
+	}
+
+	CHUNK* chunk = target.chunks.back();
+	int index = chunk->count++;
+	chunk->entities[index] = entity;
+	for (int c = 0; c < g_ComponentCount; c++)
+	{
+		if ((chunk->mask & (1u << c)) != 0)
+		{
+			std::memset(GetArray(chunk, c) + index * g_ComponentSizes[c], 0, g_ComponentSizes[c]);
+		}
+	}
+
+	m_locations[entity].archetype = archetype;
+	m_locations[entity].chunk = (int)target.chunks.size() - 1;
+	m_locations[entity].index = index;
+}
+
+/***********************************************************
+ *  RemoveFromArchetype()
+ *
+ *  This method is used for removing the slot of an entity.
+ *  The last entity of the archetype is moved into the slot,
+ *  and the last chunk is freed once it is empty.
+ ***********************************************************/
+void EntityStore::RemoveFromArchetype(int entity)
+{
+	const ENTITY_LOCATION location = m_locations[entity];
+	ARCHETYPE& archetype = m_archetypes[location.archetype];
+	CHUNK* chunk = archetype.chunks[location.chunk];
+	CHUNK* lastChunk = archetype.chunks.back();
+	int lastIndex = lastChunk->count - 1;
+
+	if ((chunk != lastChunk) || (location.index != lastIndex))
+	{
+		int movedEntity = lastChunk->entities[lastIndex];
+		for (int c = 0; c < g_ComponentCount; c++)
+		{
+			if ((chunk->mask & (1u << c)) != 0)
+			{
+				std::memcpy(GetArray(chunk, c) + location.index * g_ComponentSizes[c],
+					GetArray(lastChunk, c) + lastIndex * g_ComponentSizes[c],
+					g_ComponentSizes[c]);
+			}
+		}
+		chunk->entities[location.index] = movedEntity;
+		m_locations[movedEntity].chunk = location.chunk;
+		m_locations[movedEntity].index = location.index;
+	}
+
+	lastChunk->count--;
+	if (lastChunk->count == 0)
+	{
+		DestroyChunk(lastChunk);
+		archetype.chunks.pop_back();
+	}
+}
+
+/***********************************************************
+ *  GetChunk()
+ *
+ *  This method is used for getting the chunk and the index
+ *  in the chunk of an entity, NULL for ids without one.
+ ***********************************************************/
+EntityStore::CHUNK* EntityStore::GetChunk(int entity, int& index) const
+{
+	if (IsAlive(entity) == false)
+	{
+		return(NULL);
+	}
+
+	const ENTITY_LOCATION& location = m_locations[entity];
+	index = location.index;
+	return(m_archetypes[location.archetype].chunks[location.chunk]);
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.h
+// ============
+// store the components of the renderable scene entities in chunks grouped
+// by archetype, one array per component, so systems walk contiguous memory
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  EntityStore
+ *
+ *  This class keeps entities as plain ids, and their
+ *  components in chunks.  All the entities of a chunk have
+ *  the same set of components, their archetype, and each
+ *  component of the chunk is one array, so a system that
+ *  reads a few components of many entities touches only
+ *  those arrays.  Removing an entity moves the last entity
+ *  of its archetype into the hole, which keeps the chunks
+ *  full, and adding or removing a component moves the
+ *  entity to the chunks of its new archetype.
+ ***********************************************************/
+class EntityStore
+{
+public:
+	// constructor
+	EntityStore();
+	// destructor
+	~EntityStore();
+
+	// component bits of an archetype
+	enum COMPONENT_MASK
+	{
+		TRANSFORM = 0x01,
+		MESH = 0x02,
+		MATERIAL = 0x04,
+		TEXTURE = 0x08,
+		BOUNDS = 0x10,
+		FLAGS = 0x20
+	};
+
+	// bits of FLAGS_COMPONENT::flags
+	enum ENTITY_FLAG
+	{
+		STATIC_FLAG = 0x01,		// never moves after the scene is prepared
+		BATCHED_FLAG = 0x02,	// merged into the static batch
+		CULLED_FLAG = 0x04		// outside the view, or too small, this frame
+	};
+
+	// scene graph node holding the world matrix
+	struct TRANSFORM_COMPONENT
+	{
+		int node;
+	};
+
+	struct MESH_COMPONENT
+	{
+		ShapeMeshes::MESH_SHAPE shape;
+		int importedMesh;		// imported mesh index of IMPORTED_MESH entities
+	};
+
+	// index of the lighting material, and the color of
+	// entities without a texture
+	struct MATERIAL_COMPONENT
+	{
+		int material;
+		glm::vec4 color;
+	};
+
+	struct TEXTURE_COMPONENT
+	{
+		int textureSlot;
+		glm::vec2 UVscale;
+	};
+
+	// bounding sphere and box of the mesh, and the same bounds
+	// in world space as of the last transform update.  The
+	// boxes are kept as center and half size
+	struct BOUNDS_COMPONENT
+	{
+		glm::vec4 localSphere;
+		glm::vec4 worldSphere;
+		glm::vec3 localCenter;
+		glm::vec3 localExtent;
+		glm::vec3 worldCenter;
+		glm::vec3 worldExtent;
+	};
+
+	struct FLAGS_COMPONENT
+	{
+		unsigned int flags;
+		int impostor;			// impostor index, -1 until drawn as one
+		int batchEntry;			// static batch entry, -1 when not batched
+	};
+
+	// entities per chunk
+	static const int CHUNK_CAPACITY = 256;
+
+	// entities of one archetype, with one array per component.
+	// The arrays of the components outside the archetype are
+	// NULL
+	struct CHUNK
+	{
+		unsigned int mask;
+		int count;
+		int entities[CHUNK_CAPACITY];
+		TRANSFORM_COMPONENT* transforms;
+		MESH_COMPONENT* meshes;
+		MATERIAL_COMPONENT* materials;
+		TEXTURE_COMPONENT* textures;
+		BOUNDS_COMPONENT* bounds;
+		FLAGS_COMPONENT* flags;
+		unsigned char* memory;
+	};
+
+	// create an entity with the passed in components, which
+	// are zero until they are set, and return its id
+	int CreateEntity(unsigned int mask);
+	// remove an entity, whose id may be reused
+	void DestroyEntity(int entity);
+	// change the components of an entity, keeping the values
+	// of the components it already had
+	void SetComponents(int entity, unsigned int mask);
+	// remove all the entities
+	void Clear();
+
+	bool IsAlive(int entity) const;
+	unsigned int GetComponents(int entity) const;
+	int GetEntityCount() const;
+
+	// components of an entity, NULL when it does not have
+	// the component.  The pointers are valid until entities
+	// are created, destroyed or change their components
+	TRANSFORM_COMPONENT* GetTransform(int entity);
+	MESH_COMPONENT* GetMesh(int entity);
+	MATERIAL_COMPONENT* GetMaterial(int entity);
+	TEXTURE_COMPONENT* GetTexture(int entity);
+	BOUNDS_COMPONENT* GetBounds(int entity);
+	FLAGS_COMPONENT* GetFlags(int entity);
+
+	// collect the non-empty chunks of every archetype that has
+	// at least the passed in components
+	void GetChunks(unsigned int mask, std::vector<CHUNK*>& chunks) const;
+
+private:
+	// all the chunks of one set of components
+	struct ARCHETYPE
+	{
+		unsigned int mask;
+		std::vector<CHUNK*> chunks;
+	};
+
+	// where the components of an entity are, archetype -1
+	// for unused ids
+	struct ENTITY_LOCATION
+	{
+		int archetype;
+		int chunk;
+		int index;
+	};
+
+	// find or add the archetype of the passed in components
+	int FindArchetype(unsigned int mask);
+	// append an entity to its archetype, with zero components
+	void AddToArchetype(int entity, int archetype);
+	// remove an entity from its chunk, filling the hole
+	void RemoveFromArchetype(int entity);
+	// get the chunk and index of a live entity
+	CHUNK* GetChunk(int entity, int& index) const;
+
+	std::vector<ARCHETYPE> m_archetypes;
+	std::vector<ENTITY_LOCATION> m_locations;
+	std::vector<int> m_freeEntities;
+	int m_entityCount;
+};
\ No newline at end of file
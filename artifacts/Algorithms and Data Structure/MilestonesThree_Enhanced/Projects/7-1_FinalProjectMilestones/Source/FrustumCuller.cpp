@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+// ============
+// test the world bounds of many objects at once against the planes of the
+// view frustum, and against a smallest size on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+#include "SimdFloats.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// components of BOUNDS_ARRAYS, in member order
+	const int g_InputCount = 7;
+	const int g_PlaneCount = 6;
+
+	// row of a column major matrix
+	glm::vec4 GetRow(const glm::mat4& matrix, int row)
+	{
+		return(glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]));
+	}
+}
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The constructor for the class.  Every object is visible
+ *  until a view is set.
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+	for (int i = 0; i < g_PlaneCount; i++)
+	{
+		m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	m_depthPlane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	m_pixelsPerUnit = 0.0f;
+	m_bPerspective = false;
+	m_minPixels = 0.0f;
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the frustum planes and
+ *  the values of the size test from a view.
+ ***********************************************************/
+void FrustumCuller::SetView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+	ExtractPlanes(projection * view, m_planes);
+
+	// the camera looks down the negative Z axis of the view
+	m_depthPlane = -GetRow(view, 2);
+	m_bPerspective = (projection[3][3] != 1.0f);
+	m_pixelsPerUnit = (viewportHeight > 0) ? projection[1][1] * 0.5f * (float)viewportHeight : 0.0f;
+}
+
+/***********************************************************
+ *  ExtractPlanes()
+ *
+ *  This method is used for taking the frustum planes from
+ *  the rows of the view projection matrix, normalized so
+ *  the plane equations give world space distances.
+ ***********************************************************/
+void FrustumCuller::ExtractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	glm::vec4 rowX = GetRow(viewProjection, 0);
+	glm::vec4 rowY = GetRow(viewProjection, 1);
+	glm::vec4 rowZ = GetRow(viewProjection, 2);
+	glm::vec4 rowW = GetRow(viewProjection, 3);
+
+	planes[0] = rowW + rowX;
+	planes[1] = rowW - rowX;
+	planes[2] = rowW + rowY;
+	planes[3] = rowW - rowY;
+	planes[4] = rowW + rowZ;
+	planes[5] = rowW - rowZ;
+	for (int i = 0; i < g_PlaneCount; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+		{
+			planes[i] /= length;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetMinPixels()
+ *
+ *  This method is used for setting the smallest size on
+ *  screen of the objects that are kept.
+ ***********************************************************/
+void FrustumCuller::SetMinPixels(float minPixels)
+{
+	m_minPixels = std::max(minPixels, 0.0f);
+}
+
+float FrustumCuller::GetMinPixels() const
+{
+	return(m_minPixels);
+}
+
+/***********************************************************
+ *  CullBounds()
+ *
+ *  This method is used for testing all the objects.  A box
+ *  is outside when it is entirely behind one of the planes,
+ *  which is when its center is farther behind the plane
+ *  than the box reaches along the plane normal.  Full
+ *  groups load straight from the arrays, and the last
+ *  partial group is copied and padded with empty boxes.
+ ***********************************************************/
+size_t FrustumCuller::CullBounds(const BOUNDS_ARRAYS& bounds, size_t count, unsigned char* results) const
+{
+	const float* arrays[g_InputCount] = {
+		bounds.centerX, bounds.centerY, bounds.centerZ,
+		bounds.extentX, bounds.extentY, bounds.extentZ,
+		bounds.radius };
+
+	// the plane values are the same for every group
+	FLOATS planes[g_PlaneCount][7];
+	for (int p = 0; p < g_PlaneCount; p++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			planes[p][c] = SetFloats(m_planes[p][c]);
+			planes[p][3 + c] = SetFloats(std::fabs(m_planes[p][c]));
+		}
+		planes[p][6] = SetFloats(m_planes[p].w);
+	}
+
+	// an object is too small when 2 * radius * pixelsPerUnit,
+	// divided by the depth for perspective views, is less
+	// than the smallest size
+	bool bSizeTest = (m_minPixels > 0.0f) && (m_pixelsPerUnit > 0.0f);
+	FLOATS diameterPixels = SetFloats(2.0f * m_pixelsPerUnit);
+	FLOATS depthPlane[4];
+	for (int c = 0; c < 4; c++)
+	{
+		depthPlane[c] = SetFloats((m_bPerspective == true) ? m_depthPlane[c] * m_minPixels : 0.0f);
+	}
+	if (m_bPerspective == false)
+	{
+		depthPlane[3] = SetFloats(m_minPixels);
+	}
+	FLOATS zero = SetFloats(0.0f);
+
+	size_t nVisible = 0;
+	FLOATS inputs[g_InputCount];
+	for (size_t first = 0; first < count; first += g_Lanes)
+	{
+		size_t nObjects = std::min(g_Lanes, count - first);
+		for (int i = 0; i < g_InputCount; i++)
+		{
+			if (nObjects == g_Lanes)
+			{
+				inputs[i] = LoadFloats(arrays[i] + first);
+			}
+			else
+			{
+				float padded[g_Lanes];
+				for (size_t lane = 0; lane < g_Lanes; lane++)
+				{
+					padded[lane] = (lane < nObjects) ? arrays[i][first + lane] : 0.0f;
+				}
+				inputs[i] = LoadFloats(padded);
+			}
+		}
+
+		// no lane is outside until a plane rejects it
+		FLOATS outside = Less(zero, zero);
+		for (int p = 0; p < g_PlaneCount; p++)
+		{
+			FLOATS distance = Add(Add(Mul(planes[p][0], inputs[0]), Mul(planes[p][1], inputs[1])),
+				Add(Mul(planes[p][2], inputs[2]), planes[p][6]));
+			FLOATS reach = Add(Add(Mul(planes[p][3], inputs[3]), Mul(planes[p][4], inputs[4])),
+				Mul(planes[p][5], inputs[5]));
+			outside = Or(outside, Less(Add(distance, reach), zero));
+		}
+		int outsideBits = MaskBits(outside);
+
+		int smallBits = 0;
+		if (bSizeTest == true)
+		{
+			FLOATS limit = Add(Add(Mul(depthPlane[0], inputs[0]), Mul(depthPlane[1], inputs[1])),
+				Add(Mul(depthPlane[2], inputs[2]), depthPlane[3]));
+			smallBits = MaskBits(Less(Mul(diameterPixels, inputs[6]), limit));
+		}
+
+		for (size_t lane = 0; lane < nObjects; lane++)
+		{
+			unsigned char result = VISIBLE;
+			if (((outsideBits >> lane) & 1) != 0)
+			{
+				result = OUTSIDE_FRUSTUM;
+			}
+			else if (((smallBits >> lane) & 1) != 0)
+			{
+				result = TOO_SMALL;
+			}
+			else
+			{
+				nVisible++;
+			}
+			results[first + lane] = result;
+		}
+	}
+
+	return(nVisible);
+}
+
+/***********************************************************
+ *  CullBox()
+ *
+ *  This method is used for testing one object, the same
+ *  way CullBounds() does.
+ ***********************************************************/
+FrustumCuller::CULL_RESULT FrustumCuller::CullBox(const glm::vec3& center, const glm::vec3& extent, float radius) const
+{
+	for (int p = 0; p < g_PlaneCount; p++)
+	{
+		glm::vec3 normal = glm::vec3(m_planes[p]);
+		float distance = glm::dot(normal, center) + m_planes[p].w;
+		if (distance + glm::dot(glm::abs(normal), extent) < 0.0f)
+		{
+			return(OUTSIDE_FRUSTUM);
+		}
+	}
+
+	if ((m_minPixels > 0.0f) && (m_pixelsPerUnit > 0.0f))
+	{
+		float limit = m_minPixels;
+		if (m_bPerspective == true)
+		{
+			limit *= glm::dot(glm::vec3(m_depthPlane), center) + m_depthPlane.w;
+		}
+		if (2.0f * m_pixelsPerUnit * radius < limit)
+		{
+			return(TOO_SMALL);
+		}
+	}
+
+	return(VISIBLE);
+}
\ No newline at end of file
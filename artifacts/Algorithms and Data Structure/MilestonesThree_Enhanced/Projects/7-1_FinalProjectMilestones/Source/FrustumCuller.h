@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+// ============
+// test the world bounds of many objects at once against the planes of the
+// view frustum, and against a smallest size on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class keeps the six planes of a view frustum and
+ *  tests the bounding boxes of eight (AVX) or four (SSE)
+ *  objects per instruction against each of them.  The
+ *  bounds are passed as one array per component, so a
+ *  group of objects loads with one instruction per
+ *  component.  Objects whose bounding sphere covers fewer
+ *  pixels than a threshold are culled by the same pass.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// constructor
+	FrustumCuller();
+
+	// world bounds of the objects, one array per component.
+	// The boxes are given as center and half size
+	struct BOUNDS_ARRAYS
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* extentX;
+		const float* extentY;
+		const float* extentZ;
+		const float* radius;		// bounding sphere around the center
+	};
+
+	// why an object was culled
+	enum CULL_RESULT
+	{
+		VISIBLE = 0,
+		OUTSIDE_FRUSTUM = 1,
+		TOO_SMALL = 2
+	};
+
+	// take the planes from the passed in view, and the pixel
+	// size from the projection and the viewport height
+	void SetView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+	// get the left, right, bottom, top, near and far planes
+	// of a view projection matrix, pointing inside
+	static void ExtractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+	// cull objects whose bounding sphere is less than this many
+	// pixels across, 0 to keep objects of any size
+	void SetMinPixels(float minPixels);
+	float GetMinPixels() const;
+
+	// write a CULL_RESULT for every object, and return the
+	// number of visible objects
+	size_t CullBounds(const BOUNDS_ARRAYS& bounds, size_t count, unsigned char* results) const;
+	// test one object
+	CULL_RESULT CullBox(const glm::vec3& center, const glm::vec3& extent, float radius) const;
+
+private:
+	// left, right, bottom, top, near and far, pointing inside
+	glm::vec4 m_planes[6];
+	// view depth of a world position
+	glm::vec4 m_depthPlane;
+	// pixels across one world unit at depth 1, or at any depth
+	// for orthographic views
+	float m_pixelsPerUnit;
+	bool m_bPerspective;
+	float m_minPixels;
+};
\ No newline at end of file
@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull draws against the view frustum in a compute shader, which writes the
+// visible ones as indirect draw commands the GPU draws without the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "FrustumCuller.h"
+
+// declaration of global variables
+namespace
+{
+	// storage buffer bindings of the compute shader
+	const GLuint g_TemplatesBinding = 2;
+	const GLuint g_CommandsBinding = 3;
+	const GLuint g_CountsBinding = 4;
+	// invocations of a work group of the compute shader
+	const GLuint g_GroupSize = 64;
+	// size of a glMultiDrawElementsIndirect() command
+	const GLsizeiptr g_CommandSize = 5 * sizeof(GLuint);
+
+	// row of a column major matrix
+	glm::vec4 GetRow(const glm::mat4& matrix, int row)
+	{
+		return(glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]));
+	}
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_program = 0;
+	m_drawCountLocation = -1;
+	m_planesLocation = -1;
+	m_diameterLocation = -1;
+	m_sizePlaneLocation = -1;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+	m_drawCount = 0;
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the functions
+ *  of the GPU path were loaded.
+ ***********************************************************/
+bool GpuCuller::IsSupported()
+{
+	return((glDispatchCompute != NULL) && (glMultiDrawElementsIndirectCount != NULL));
+}
+
+/***********************************************************
+ *  SetProgram()
+ *
+ *  This method is used for setting the compute program and
+ *  looking up its uniforms.
+ ***********************************************************/
+void GpuCuller::SetProgram(GLuint cullProgram)
+{
+	m_program = cullProgram;
+	if (m_program == 0)
+	{
+		return;
+	}
+	m_drawCountLocation = glGetUniformLocation(m_program, "drawCount");
+	m_planesLocation = glGetUniformLocation(m_program, "frustumPlanes");
+	m_diameterLocation = glGetUniformLocation(m_program, "diameterPixels");
+	m_sizePlaneLocation = glGetUniformLocation(m_program, "sizePlane");
+}
+
+bool GpuCuller::HasProgram() const
+{
+	return(m_program != 0);
+}
+
+/***********************************************************
+ *  SetDraws()
+ *
+ *  This method is used for uploading the draws.  The
+ *  command buffer holds the ranges of all the groups one
+ *  after another, each as long as the draws of its group,
+ *  and the count buffer one counter per group.
+ ***********************************************************/
+void GpuCuller::SetDraws(const std::vector<DRAW_TEMPLATE>& draws, int nGroups)
+{
+	m_groupDrawCount.assign(nGroups, 0);
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		m_groupDrawCount[draws[i].group]++;
+	}
+	m_groupCommandBase.assign(nGroups, 0);
+	for (int i = 1; i < nGroups; i++)
+	{
+		m_groupCommandBase[i] = m_groupCommandBase[i - 1] + m_groupDrawCount[i - 1];
+	}
+
+	std::vector<DRAW_TEMPLATE> templates = draws;
+	for (size_t i = 0; i < templates.size(); i++)
+	{
+		templates[i].commandBase = m_groupCommandBase[templates[i].group];
+	}
+	m_drawCount = (int)templates.size();
+
+	if (m_buffers[0] == 0)
+	{
+		glGenBuffers(BUFFER_COUNT, m_buffers);
+	}
+	// the buffers are never empty, so they can always be bound
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[TEMPLATE_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DRAW_TEMPLATE) * std::max(templates.size(), (size_t)1),
+		NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DRAW_TEMPLATE) * templates.size(), templates.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COMMAND_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, g_CommandSize * std::max(templates.size(), (size_t)1),
+		NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COUNT_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * std::max(nGroups, 1), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int GpuCuller::GetDrawCount() const
+{
+	return(m_drawCount);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for clearing the group counters and
+ *  running the compute shader over all the draws.  The
+ *  planes and the size test match FrustumCuller, and the
+ *  barrier makes the commands and counters visible to the
+ *  indirect draws.
+ ***********************************************************/
+void GpuCuller::Cull(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportHeight,
+	float minPixels)
+{
+	if ((m_program == 0) || (m_drawCount == 0))
+	{
+		return;
+	}
+
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COUNT_BUFFER]);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glm::vec4 planes[6];
+	FrustumCuller::ExtractPlanes(projection * view, planes);
+
+	// the size test compares the diameter in pixels with
+	// the smallest size, times the depth for perspective views
+	bool bPerspective = (projection[3][3] != 1.0f);
+	float diameterPixels = 0.0f;
+	glm::vec4 sizePlane = glm::vec4(0.0f, 0.0f, 0.0f, minPixels);
+	if ((minPixels > 0.0f) && (viewportHeight > 0))
+	{
+		diameterPixels = projection[1][1] * (float)viewportHeight;
+		if (bPerspective == true)
+		{
+			// the camera looks down the negative Z axis of the view
+			sizePlane = -GetRow(view, 2) * minPixels;
+		}
+	}
+
+	glUseProgram(m_program);
+	glUniform1ui(m_drawCountLocation, (GLuint)m_drawCount);
+	glUniform4fv(m_planesLocation, 6, &planes[0][0]);
+	glUniform1f(m_diameterLocation, diameterPixels);
+	glUniform4fv(m_sizePlaneLocation, 1, &sizePlane[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_TemplatesBinding, m_buffers[TEMPLATE_BUFFER]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandsBinding, m_buffers[COMMAND_BUFFER]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CountsBinding, m_buffers[COUNT_BUFFER]);
+	glDispatchCompute(((GLuint)m_drawCount + g_GroupSize - 1) / g_GroupSize, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing the commands the compute
+ *  shader wrote for a group.  The draw count is read from
+ *  the counter of the group, up to the size of its range.
+ ***********************************************************/
+void GpuCuller::DrawGroup(int group) const
+{
+	if ((m_program == 0) || (group >= (int)m_groupDrawCount.size()) || (m_groupDrawCount[group] == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[COMMAND_BUFFER]);
+	glBindBuffer(GL_PARAMETER_BUFFER, m_buffers[COUNT_BUFFER]);
+	glMultiDrawElementsIndirectCount(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(const void*)(g_CommandSize * m_groupCommandBase[group]),
+		(GLintptr)(sizeof(GLuint) * group),
+		(GLsizei)m_groupDrawCount[group],
+		0);
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffers.
+ ***********************************************************/
+void GpuCuller::Destroy()
+{
+	if (m_buffers[0] != 0)
+	{
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	m_drawCount = 0;
+	m_groupCommandBase.clear();
+	m_groupDrawCount.clear();
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull draws against the view frustum in a compute shader, which writes the
+// visible ones as indirect draw commands the GPU draws without the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class keeps the world box and index range of every
+ *  draw in a storage buffer.  Each frame a compute shader
+ *  tests all of them against the frustum planes and the
+ *  smallest size on screen, and appends the visible ones
+ *  to the command range of their group with an atomic
+ *  counter.  Each group is then drawn with one
+ *  glMultiDrawElementsIndirectCount() call that reads its
+ *  counter as the draw count, so the CPU work per frame
+ *  does not depend on the number of draws.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// world box and index range of a draw, laid out like the
+	// DrawTemplate of the compute shader
+	struct DRAW_TEMPLATE
+	{
+		GLfloat center[3];
+		GLuint firstIndex;
+		GLfloat extent[3];
+		GLuint nIndices;
+		GLuint group;
+		GLuint commandBase;		// set by SetDraws()
+		GLuint padding[2];
+	};
+
+	// check whether the context has compute shaders and
+	// indirect draw counts, both core in OpenGL 4.6
+	static bool IsSupported();
+
+	// use the passed in compute program, which stays owned
+	// by the caller
+	void SetProgram(GLuint cullProgram);
+	bool HasProgram() const;
+
+	// upload the draws, each group getting a command range as
+	// long as its number of draws
+	void SetDraws(const std::vector<DRAW_TEMPLATE>& draws, int nGroups);
+	int GetDrawCount() const;
+
+	// run the compute shader for the passed in view.  The
+	// current program is changed, so the caller activates its
+	// own program again
+	void Cull(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportHeight,
+		float minPixels);
+
+	// draw the visible draws of one group, with the vertex
+	// array and index buffer of the draws bound
+	void DrawGroup(int group) const;
+
+	// free the buffers
+	void Destroy();
+
+private:
+	enum BUFFER
+	{
+		TEMPLATE_BUFFER,
+		COMMAND_BUFFER,
+		COUNT_BUFFER,
+		BUFFER_COUNT
+	};
+
+	GLuint m_program;
+	GLint m_drawCountLocation;
+	GLint m_planesLocation;
+	GLint m_diameterLocation;
+	GLint m_sizePlaneLocation;
+
+	GLuint m_buffers[BUFFER_COUNT];
+	int m_drawCount;
+	// command range of each group
+	std::vector<GLuint> m_groupCommandBase;
+	std::vector<GLuint> m_groupDrawCount;
+};
\ No newline at end of file
@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostoratlas.cpp
+// ============
+// capture an object from many view directions into an octahedral texture
+// atlas, so it can be drawn far away as a single camera facing quad
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorAtlas.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// the atlas holds this many frames along each side, and
+	// the fragment shader must use the same value
+	const int g_FramesPerSide = 8;
+	// width and height of one frame in texels
+	const int g_FrameSize = 64;
+
+	float SignNotZero(float value)
+	{
+		return((value >= 0.0f) ? 1.0f : -1.0f);
+	}
+
+	/***********************************************************
+	 *  GetFrameUp()
+	 *
+	 *  Up vector of the camera of a frame.  The vertex and
+	 *  fragment shaders build the same basis, so they project
+	 *  onto the frames the way they were captured.
+	 ***********************************************************/
+	glm::vec3 GetFrameUp(const glm::vec3& direction)
+	{
+		return((std::fabs(direction.y) > 0.999f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+}
+
+/***********************************************************
+ *  ImpostorAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorAtlas::ImpostorAtlas()
+{
+	m_textures[0] = 0;
+	m_textures[1] = 0;
+	m_center = glm::vec3(0.0f);
+	m_radius = 0.0f;
+	m_bCaptured = false;
+}
+
+/***********************************************************
+ *  ~ImpostorAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorAtlas::~ImpostorAtlas()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for rendering the object into every
+ *  frame of the atlas.  Each frame looks at the bounding
+ *  sphere from its octahedral direction with an orthographic
+ *  projection that just encloses the sphere, so the depth
+ *  buffer value maps linearly to the distance from the
+ *  plane through the sphere center.
+ ***********************************************************/
+bool ImpostorAtlas::Capture(
+	const glm::vec3& center,
+	float radius,
+	const DRAW_FUNCTION& drawObject)
+{
+	Destroy();
+	if (radius <= 0.0f)
+	{
+		return(false);
+	}
+
+	int atlasSize = g_FramesPerSide * g_FrameSize;
+
+	// the surface color with coverage in alpha, and the normal
+	// with the depth, which needs more than 8 bits
+	const GLenum formats[2] = { GL_RGBA8, GL_RGBA16F };
+	glGenTextures(2, m_textures);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], atlasSize, atlasSize);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLuint depthBuffer = 0;
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// the capture can happen in the middle of a frame
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+	GLfloat previousClearColor[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textures[0], 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_textures[1], 0);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	if (bComplete == true)
+	{
+		// uncovered texels stay zero in both textures
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+		for (int row = 0; row < g_FramesPerSide; row++)
+		{
+			for (int column = 0; column < g_FramesPerSide; column++)
+			{
+				glm::vec3 direction = GetFrameDirection(column, row);
+				glm::mat4 view = glm::lookAt(center + direction * (2.0f * radius), center, GetFrameUp(direction));
+
+				glViewport(column * g_FrameSize, row * g_FrameSize, g_FrameSize, g_FrameSize);
+				drawObject(view, projection);
+			}
+		}
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+
+	if (bComplete == false)
+	{
+		Destroy();
+		return(false);
+	}
+
+	m_center = center;
+	m_radius = radius;
+	m_bCaptured = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the atlas textures.
+ ***********************************************************/
+void ImpostorAtlas::Destroy()
+{
+	if (m_textures[0] != 0)
+	{
+		glDeleteTextures(2, m_textures);
+		m_textures[0] = 0;
+		m_textures[1] = 0;
+	}
+	m_bCaptured = false;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the atlas textures for
+ *  drawing the impostors.
+ ***********************************************************/
+void ImpostorAtlas::Bind(GLuint colorUnit, GLuint normalDepthUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + colorUnit);
+	glBindTexture(GL_TEXTURE_2D, m_textures[0]);
+	glActiveTexture(GL_TEXTURE0 + normalDepthUnit);
+	glBindTexture(GL_TEXTURE_2D, m_textures[1]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  GetCenter()
+ *
+ *  This method is used for getting the center of the
+ *  captured bounding sphere.
+ ***********************************************************/
+const glm::vec3& ImpostorAtlas::GetCenter() const
+{
+	return(m_center);
+}
+
+/***********************************************************
+ *  GetRadius()
+ *
+ *  This method is used for getting the radius of the
+ *  captured bounding sphere.
+ ***********************************************************/
+float ImpostorAtlas::GetRadius() const
+{
+	return(m_radius);
+}
+
+/***********************************************************
+ *  GetFramesPerSide()
+ *
+ *  This method is used for getting the number of frames
+ *  along each side of the atlas.
+ ***********************************************************/
+int ImpostorAtlas::GetFramesPerSide()
+{
+	return(g_FramesPerSide);
+}
+
+/***********************************************************
+ *  GetFrameDirection()
+ *
+ *  This method is used for getting the view direction of
+ *  a frame.  The frames sample the octahedral square from
+ *  corner to corner, and the square folds onto the sphere
+ *  with +Y at its center and -Y at its corners.
+ ***********************************************************/
+glm::vec3 ImpostorAtlas::GetFrameDirection(int column, int row)
+{
+	glm::vec2 octahedral = glm::vec2((float)column, (float)row) / (float)(g_FramesPerSide - 1) * 2.0f - 1.0f;
+
+	glm::vec3 direction(octahedral.x, 1.0f - std::fabs(octahedral.x) - std::fabs(octahedral.y), octahedral.y);
+	if (direction.y < 0.0f)
+	{
+		float x = (1.0f - std::fabs(direction.z)) * SignNotZero(direction.x);
+		float z = (1.0f - std::fabs(direction.x)) * SignNotZero(direction.z);
+		direction.x = x;
+		direction.z = z;
+	}
+	return(glm::normalize(direction));
+}
\ No newline at end of file
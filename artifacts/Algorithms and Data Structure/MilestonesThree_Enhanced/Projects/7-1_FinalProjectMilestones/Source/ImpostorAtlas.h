@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostoratlas.h
+// ============
+// capture an object from many view directions into an octahedral texture
+// atlas, so it can be drawn far away as a single camera facing quad
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <functional>
+
+/***********************************************************
+ *  ImpostorAtlas
+ *
+ *  This class renders an object once from a grid of view
+ *  directions that is laid out with the octahedral mapping
+ *  of the sphere.  Every frame of the atlas holds the
+ *  lighting inputs of the fragment shader instead of a lit
+ *  color - the surface color, and the world space normal
+ *  with the depth from an orthographic view - so impostors
+ *  are lit like the real objects.  The colors are stored
+ *  premultiplied by the coverage, which makes filtering at
+ *  the silhouettes correct.
+ ***********************************************************/
+class ImpostorAtlas
+{
+public:
+	// called to draw the object with the passed in view and
+	// projection, and its model transformation without the
+	// translation
+	typedef std::function<void(const glm::mat4& view, const glm::mat4& projection)> DRAW_FUNCTION;
+
+	// constructor
+	ImpostorAtlas();
+	// destructor
+	~ImpostorAtlas();
+
+	// render the object into the atlas from every direction,
+	// framing the passed in bounding sphere.  The current
+	// framebuffer and viewport are restored afterwards
+	bool Capture(
+		const glm::vec3& center,
+		float radius,
+		const DRAW_FUNCTION& drawObject);
+	// free the atlas textures
+	void Destroy();
+
+	// bind the color and normal-depth textures to the
+	// passed in texture units
+	void Bind(GLuint colorUnit, GLuint normalDepthUnit) const;
+
+	// bounding sphere of the captured object, relative to
+	// its position
+	const glm::vec3& GetCenter() const;
+	float GetRadius() const;
+
+	// number of frames along each side of the atlas
+	static int GetFramesPerSide();
+	// direction from the object towards the camera of a frame
+	static glm::vec3 GetFrameDirection(int column, int row);
+
+private:
+	GLuint m_textures[2];	// color, normal and depth
+	glm::vec3 m_center;
+	float m_radius;
+	bool m_bCaptured;
+};
\ No newline at end of file
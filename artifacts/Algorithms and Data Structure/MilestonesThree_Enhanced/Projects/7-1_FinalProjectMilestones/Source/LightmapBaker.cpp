@@ -0,0 +1,1063 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// lay the static geometry out in a lightmap atlas, and bake the lighting that
+// does not depend on the view into it on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+#include "JobSystem.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+// declaration of global variables
+namespace
+{
+	// atlas size and chart density unless others are set
+	const int g_DefaultAtlasSize = 1024;
+	const float g_DefaultTexelDensity = 32.0f;
+	// empty texels on each side of a chart, which are filled
+	// from the chart after the bake, so filtering at the edge
+	// of a chart never reads the light of another
+	const int g_GutterTexels = 2;
+	// a triangle joins the chart of its neighbour when its
+	// normal is within about 37 degrees of the normal the
+	// chart started with, which keeps the projection of the
+	// chart from folding over itself
+	const float g_ChartNormalLimit = 0.8f;
+	// the density is lowered by this step until the charts fit
+	const float g_DensityStep = 0.8f;
+	const int g_MaxPackAttempts = 16;
+	// rays start this far off the surface, so they do not hit
+	// the triangle they start on
+	const float g_RayOffset = 1.0e-3f;
+	// most triangles of a leaf of the tree, and the deepest
+	// tree a ray can walk
+	const int g_MaxLeafTriangles = 4;
+	const int g_StackSize = 64;
+	// covered texels lit by one job
+	const size_t g_TexelsPerJob = 256;
+	const float g_Pi = 3.14159265f;
+
+	// edge of a mesh between two vertices, by the lower
+	// vertex index first, and the triangle it belongs to
+	struct MESH_EDGE
+	{
+		GLuint first;
+		GLuint second;
+		int triangle;
+	};
+
+	float Cross2(const glm::vec2& a, const glm::vec2& b)
+	{
+		return(a.x * b.y - a.y * b.x);
+	}
+
+	/***********************************************************
+	 *  GetPlaneAxes()
+	 *
+	 *  Two perpendicular unit vectors spanning the plane that
+	 *  the passed in unit normal points away from.
+	 ***********************************************************/
+	void GetPlaneAxes(const glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent)
+	{
+		glm::vec3 reference = (std::fabs(normal.y) < 0.999f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		tangent = glm::normalize(glm::cross(reference, normal));
+		bitangent = glm::cross(normal, tangent);
+	}
+
+	/***********************************************************
+	 *  RadicalInverse()
+	 *
+	 *  The bits of the passed in value mirrored behind the
+	 *  binary point, which spreads consecutive values evenly
+	 *  over [0, 1).
+	 ***********************************************************/
+	float RadicalInverse(unsigned int bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return((float)(bits >> 8) / 16777216.0f);
+	}
+
+	/***********************************************************
+	 *  HashTexel()
+	 *
+	 *  A value in [0, 1) that changes unpredictably from one
+	 *  texel to the next, so neighbouring texels turn their
+	 *  occlusion rays differently and the noise stays fine.
+	 ***********************************************************/
+	float HashTexel(unsigned int value)
+	{
+		value ^= value >> 16;
+		value *= 0x7FEB352Du;
+		value ^= value >> 15;
+		value *= 0x846CA68Bu;
+		value ^= value >> 16;
+		return((float)(value >> 8) / 16777216.0f);
+	}
+
+	/***********************************************************
+	 *  RayBox()
+	 *
+	 *  Slab test of a ray against a box, with the inverse of
+	 *  the ray direction.
+	 ***********************************************************/
+	bool RayBox(
+		const glm::vec3& boxMin,
+		const glm::vec3& boxMax,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance)
+	{
+		glm::vec3 toMin = (boxMin - origin) * inverseDirection;
+		glm::vec3 toMax = (boxMax - origin) * inverseDirection;
+		glm::vec3 entry = glm::min(toMin, toMax);
+		glm::vec3 exit = glm::max(toMin, toMax);
+		float enter = std::max(std::max(entry.x, entry.y), std::max(entry.z, 0.0f));
+		float leave = std::min(std::min(exit.x, exit.y), std::min(exit.z, maxDistance));
+		return(enter <= leave);
+	}
+
+	/***********************************************************
+	 *  RayTriangle()
+	 *
+	 *  Check whether a ray hits a triangle in front of its
+	 *  origin and before the passed in distance, from both
+	 *  sides.
+	 ***********************************************************/
+	bool RayTriangle(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const glm::vec3& a,
+		const glm::vec3& b,
+		const glm::vec3& c,
+		float maxDistance)
+	{
+		glm::vec3 edge1 = b - a;
+		glm::vec3 edge2 = c - a;
+		glm::vec3 p = glm::cross(direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (std::fabs(determinant) < 1.0e-12f)
+		{
+			return(false);
+		}
+
+		float inverseDeterminant = 1.0f / determinant;
+		glm::vec3 s = origin - a;
+		float u = glm::dot(s, p) * inverseDeterminant;
+		if ((u < 0.0f) || (u > 1.0f))
+		{
+			return(false);
+		}
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(direction, q) * inverseDeterminant;
+		if ((v < 0.0f) || ((u + v) > 1.0f))
+		{
+			return(false);
+		}
+
+		float distance = glm::dot(edge2, q) * inverseDeterminant;
+		return((distance > 0.0f) && (distance < maxDistance));
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker()
+{
+	m_atlasSize = g_DefaultAtlasSize;
+	m_texelDensity = g_DefaultTexelDensity;
+	m_packedDensity = 0.0f;
+	m_aoSamples = 0;
+	m_aoDistance = 0.0f;
+	m_bPacked = false;
+	m_texture = 0;
+}
+
+/***********************************************************
+ *  ~LightmapBaker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightmapBaker::~LightmapBaker()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetAtlasSize()
+ *
+ *  This method is used for setting the width and height of
+ *  the atlas, used by the next PackCharts().
+ ***********************************************************/
+void LightmapBaker::SetAtlasSize(int size)
+{
+	m_atlasSize = std::max(size, 2 * g_GutterTexels + 1);
+	m_bPacked = false;
+}
+
+/***********************************************************
+ *  SetTexelDensity()
+ *
+ *  This method is used for setting the texels per world
+ *  unit the next PackCharts() tries first.
+ ***********************************************************/
+void LightmapBaker::SetTexelDensity(float texelsPerUnit)
+{
+	m_texelDensity = (texelsPerUnit > 0.0f) ? texelsPerUnit : g_DefaultTexelDensity;
+	m_bPacked = false;
+}
+
+/***********************************************************
+ *  SetAmbientOcclusion()
+ *
+ *  This method is used for setting the number of rays each
+ *  texel casts over its hemisphere, and the distance within
+ *  which a surface they hit occludes the ambient light.
+ ***********************************************************/
+void LightmapBaker::SetAmbientOcclusion(int sampleCount, float distance)
+{
+	m_aoSamples = ((sampleCount > 0) && (distance > 0.0f)) ? sampleCount : 0;
+	m_aoDistance = distance;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for forgetting the meshes, their
+ *  charts and the tree over their triangles.  The atlas
+ *  texture is kept until the next bake.
+ ***********************************************************/
+void LightmapBaker::Clear()
+{
+	m_vertices.clear();
+	m_triangles.clear();
+	m_meshes.clear();
+	m_charts.clear();
+	m_nodes.clear();
+	m_treeTriangles.clear();
+	m_bPacked = false;
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for splitting a mesh into charts.
+ *  Starting from the first triangle that has no chart yet,
+ *  a chart grows across the shared edges to the triangles
+ *  that face about the way its first triangle does.  The
+ *  chart is then projected onto the plane of that triangle,
+ *  which keeps the world size of the triangles, so every
+ *  chart gets the same texel density.
+ ***********************************************************/
+int LightmapBaker::AddMesh(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices,
+	int material,
+	std::vector<GLuint>& chartedVertices,
+	std::vector<GLuint>& chartedIndices)
+{
+	chartedVertices.clear();
+	chartedIndices.clear();
+	m_nodes.clear();
+	m_bPacked = false;
+
+	int nTriangles = (int)(indices.size() / 3);
+	std::vector<glm::vec3> faceNormals(nTriangles);
+	for (int t = 0; t < nTriangles; t++)
+	{
+		const glm::vec3& a = positions[indices[t * 3]];
+		const glm::vec3& b = positions[indices[t * 3 + 1]];
+		const glm::vec3& c = positions[indices[t * 3 + 2]];
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		if (glm::dot(normal, normal) <= 0.0f)
+		{
+			normal = normals[indices[t * 3]] + normals[indices[t * 3 + 1]] + normals[indices[t * 3 + 2]];
+		}
+		faceNormals[t] = (glm::dot(normal, normal) > 0.0f) ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	// triangles that share an edge are neighbours
+	std::vector<MESH_EDGE> edges;
+	edges.reserve(indices.size());
+	for (int t = 0; t < nTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint first = indices[t * 3 + k];
+			GLuint second = indices[t * 3 + (k + 1) % 3];
+			MESH_EDGE edge;
+			edge.first = std::min(first, second);
+			edge.second = std::max(first, second);
+			edge.triangle = t;
+			edges.push_back(edge);
+		}
+	}
+	std::sort(edges.begin(), edges.end(), [](const MESH_EDGE& a, const MESH_EDGE& b)
+	{
+		return((a.first < b.first) || ((a.first == b.first) && (a.second < b.second)));
+	});
+	std::vector<std::vector<int>> neighbours(nTriangles);
+	for (size_t i = 0; i < edges.size(); )
+	{
+		size_t end = i + 1;
+		while ((end < edges.size()) && (edges[end].first == edges[i].first) && (edges[end].second == edges[i].second))
+		{
+			end++;
+		}
+		for (size_t j = i; j < end; j++)
+		{
+			for (size_t k = i; k < end; k++)
+			{
+				if (edges[j].triangle != edges[k].triangle)
+				{
+					neighbours[edges[j].triangle].push_back(edges[k].triangle);
+				}
+			}
+		}
+		i = end;
+	}
+
+	LIGHTMAP_MESH mesh;
+	mesh.firstVertex = (GLuint)m_vertices.size();
+
+	std::vector<int> triangleCharts(nTriangles, -1);
+	std::vector<int> chartTriangles;
+	// charted vertex of each source vertex in the current chart
+	std::vector<int> chartVertices(positions.size(), -1);
+	for (int seed = 0; seed < nTriangles; seed++)
+	{
+		if (triangleCharts[seed] >= 0)
+		{
+			continue;
+		}
+
+		int chart = (int)m_charts.size();
+		glm::vec3 axis = faceNormals[seed];
+		chartTriangles.clear();
+		chartTriangles.push_back(seed);
+		triangleCharts[seed] = chart;
+		for (size_t i = 0; i < chartTriangles.size(); i++)
+		{
+			const std::vector<int>& adjacent = neighbours[chartTriangles[i]];
+			for (size_t j = 0; j < adjacent.size(); j++)
+			{
+				int neighbour = adjacent[j];
+				if ((triangleCharts[neighbour] < 0) &&
+					(glm::dot(faceNormals[neighbour], axis) >= g_ChartNormalLimit))
+				{
+					triangleCharts[neighbour] = chart;
+					chartTriangles.push_back(neighbour);
+				}
+			}
+		}
+
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+		GetPlaneAxes(axis, tangent, bitangent);
+
+		size_t chartFirst = chartedVertices.size();
+		glm::vec2 chartMin = glm::vec2(FLT_MAX);
+		glm::vec2 chartMax = glm::vec2(-FLT_MAX);
+		for (size_t i = 0; i < chartTriangles.size(); i++)
+		{
+			CHART_TRIANGLE triangle;
+			triangle.chart = chart;
+			triangle.material = material;
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint source = indices[chartTriangles[i] * 3 + k];
+				if (chartVertices[source] < 0)
+				{
+					chartVertices[source] = (int)chartedVertices.size();
+					chartedVertices.push_back(source);
+
+					CHART_VERTEX vertex;
+					vertex.position = positions[source];
+					vertex.normal = normals[source];
+					vertex.chartPosition = glm::vec2(glm::dot(vertex.position, tangent), glm::dot(vertex.position, bitangent));
+					vertex.atlasPosition = glm::vec2(0.0f);
+					chartMin = glm::min(chartMin, vertex.chartPosition);
+					chartMax = glm::max(chartMax, vertex.chartPosition);
+					m_vertices.push_back(vertex);
+				}
+				triangle.vertices[k] = mesh.firstVertex + (GLuint)chartVertices[source];
+				chartedIndices.push_back((GLuint)chartVertices[source]);
+			}
+			m_triangles.push_back(triangle);
+		}
+
+		// the chart starts at its corner, and its vertices are
+		// copied again by the next chart that uses them
+		for (size_t i = chartFirst; i < chartedVertices.size(); i++)
+		{
+			m_vertices[mesh.firstVertex + i].chartPosition -= chartMin;
+			chartVertices[chartedVertices[i]] = -1;
+		}
+
+		CHART newChart;
+		newChart.size = chartMax - chartMin;
+		newChart.x = 0;
+		newChart.y = 0;
+		newChart.width = 0;
+		newChart.height = 0;
+		m_charts.push_back(newChart);
+	}
+
+	mesh.nVertices = (GLuint)m_vertices.size() - mesh.firstVertex;
+	m_meshes.push_back(mesh);
+
+	return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  PackCharts()
+ *
+ *  This method is used for placing the charts of all the
+ *  meshes in the atlas, tallest first, and setting the atlas
+ *  position of every charted vertex.  When the charts do
+ *  not fit at the selected density, it is lowered in steps
+ *  until they do.
+ ***********************************************************/
+bool LightmapBaker::PackCharts()
+{
+	m_bPacked = false;
+	if (m_charts.empty() == true)
+	{
+		return(false);
+	}
+
+	std::vector<int> order(m_charts.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		return((m_charts[a].size.y > m_charts[b].size.y) ||
+			((m_charts[a].size.y == m_charts[b].size.y) && (m_charts[a].size.x > m_charts[b].size.x)));
+	});
+
+	float density = m_texelDensity;
+	for (int attempt = 0; (attempt < g_MaxPackAttempts) && (m_bPacked == false); attempt++)
+	{
+		if (PlaceCharts(density, order) == true)
+		{
+			m_packedDensity = density;
+			m_bPacked = true;
+		}
+		else
+		{
+			density *= g_DensityStep;
+		}
+	}
+	if (m_bPacked == false)
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_triangles.size(); i++)
+	{
+		const CHART& chart = m_charts[m_triangles[i].chart];
+		glm::vec2 corner = glm::vec2((float)(chart.x + g_GutterTexels), (float)(chart.y + g_GutterTexels));
+		for (int k = 0; k < 3; k++)
+		{
+			CHART_VERTEX& vertex = m_vertices[m_triangles[i].vertices[k]];
+			vertex.atlasPosition = corner + vertex.chartPosition * m_packedDensity;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  PlaceCharts()
+ *
+ *  This method is used for laying the charts out in rows,
+ *  in the passed in order.  A row is as tall as its first
+ *  chart, and the next row starts when a chart does not fit
+ *  in the width that is left.
+ ***********************************************************/
+bool LightmapBaker::PlaceCharts(float density, const std::vector<int>& order)
+{
+	int x = 0;
+	int y = 0;
+	int rowHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		CHART& chart = m_charts[order[i]];
+		chart.width = std::max((int)std::ceil(chart.size.x * density), 1) + 2 * g_GutterTexels;
+		chart.height = std::max((int)std::ceil(chart.size.y * density), 1) + 2 * g_GutterTexels;
+		if ((x + chart.width) > m_atlasSize)
+		{
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		if (((x + chart.width) > m_atlasSize) || ((y + chart.height) > m_atlasSize))
+		{
+			return(false);
+		}
+
+		chart.x = x;
+		chart.y = y;
+		x += chart.width;
+		rowHeight = std::max(rowHeight, chart.height);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetMeshCoordinates()
+ *
+ *  This method is used for getting the texture coordinates
+ *  of the charted vertices of a mesh in the atlas.
+ ***********************************************************/
+void LightmapBaker::GetMeshCoordinates(int mesh, std::vector<glm::vec2>& coordinates) const
+{
+	coordinates.clear();
+	if ((mesh < 0) || (mesh >= (int)m_meshes.size()))
+	{
+		return;
+	}
+
+	const LIGHTMAP_MESH& lightmapMesh = m_meshes[mesh];
+	coordinates.resize(lightmapMesh.nVertices);
+	for (GLuint i = 0; i < lightmapMesh.nVertices; i++)
+	{
+		coordinates[i] = m_vertices[lightmapMesh.firstVertex + i].atlasPosition / (float)m_atlasSize;
+	}
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for lighting every texel that a
+ *  triangle covers, filling the gutters, and sending the
+ *  atlas to the GPU as half floats, since several lights
+ *  can add up to more than 1.  The texels are only kept
+ *  while baking.
+ ***********************************************************/
+bool LightmapBaker::Bake(
+	const std::vector<SceneFile::SCENE_LIGHT>& lights,
+	const std::vector<BAKE_MATERIAL>& materials)
+{
+	if ((m_bPacked == false) || (m_triangles.empty() == true))
+	{
+		return(false);
+	}
+
+	RasterizeCharts();
+	if (m_nodes.empty() == true)
+	{
+		BuildTree();
+	}
+
+	size_t nJobs = (m_bakeTexels.size() + g_TexelsPerJob - 1) / g_TexelsPerJob;
+	JobSystem::Get().ParallelFor(nJobs, [this, &lights, &materials](size_t job)
+	{
+		size_t end = std::min(m_bakeTexels.size(), (job + 1) * g_TexelsPerJob);
+		for (size_t i = job * g_TexelsPerJob; i < end; i++)
+		{
+			m_texels[m_bakeTexels[i].texel] = glm::vec4(BakeTexel(m_bakeTexels[i], lights, materials), 1.0f);
+		}
+	});
+	FillGutters();
+
+	Destroy();
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, m_atlasSize, m_atlasSize);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_atlasSize, m_atlasSize, GL_RGBA, GL_FLOAT, m_texels.data());
+	// no mipmaps, a smaller level would mix neighbouring charts
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	std::vector<BAKE_TEXEL>().swap(m_bakeTexels);
+	std::vector<glm::vec4>().swap(m_texels);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RasterizeCharts()
+ *
+ *  This method is used for finding the texels of the atlas
+ *  whose center is inside a triangle, with the barycentric
+ *  coordinates of the center.  A triangle too thin to cover
+ *  any texel center gets the texel of its middle, so every
+ *  triangle has light to filter from.  The alpha of the
+ *  covered texels is set, the rest of the atlas is cleared.
+ ***********************************************************/
+void LightmapBaker::RasterizeCharts()
+{
+	m_bakeTexels.clear();
+	m_texels.assign((size_t)m_atlasSize * m_atlasSize, glm::vec4(0.0f));
+
+	for (size_t t = 0; t < m_triangles.size(); t++)
+	{
+		const glm::vec2& a = m_vertices[m_triangles[t].vertices[0]].atlasPosition;
+		const glm::vec2& b = m_vertices[m_triangles[t].vertices[1]].atlasPosition;
+		const glm::vec2& c = m_vertices[m_triangles[t].vertices[2]].atlasPosition;
+		float area = Cross2(b - a, c - a);
+		if (area == 0.0f)
+		{
+			continue;
+		}
+
+		glm::vec2 boxMin = glm::min(a, glm::min(b, c));
+		glm::vec2 boxMax = glm::max(a, glm::max(b, c));
+		int x0 = std::max((int)std::floor(boxMin.x), 0);
+		int y0 = std::max((int)std::floor(boxMin.y), 0);
+		int x1 = std::min((int)std::ceil(boxMax.x), m_atlasSize - 1);
+		int y1 = std::min((int)std::ceil(boxMax.y), m_atlasSize - 1);
+
+		bool bCovered = false;
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				glm::vec2 center = glm::vec2((float)x + 0.5f, (float)y + 0.5f);
+				float weightB = Cross2(center - a, c - a) / area;
+				float weightC = Cross2(b - a, center - a) / area;
+				if ((weightB < -1.0e-5f) || (weightC < -1.0e-5f) || ((weightB + weightC) > 1.0f + 1.0e-5f))
+				{
+					continue;
+				}
+
+				int texel = y * m_atlasSize + x;
+				bCovered = true;
+				if (m_texels[texel].w > 0.0f)
+				{
+					continue;
+				}
+				m_texels[texel].w = 1.0f;
+
+				BAKE_TEXEL bakeTexel;
+				bakeTexel.texel = texel;
+				bakeTexel.triangle = (int)t;
+				bakeTexel.barycentrics = glm::vec2(weightB, weightC);
+				m_bakeTexels.push_back(bakeTexel);
+			}
+		}
+
+		if (bCovered == false)
+		{
+			glm::vec2 middle = (a + b + c) / 3.0f;
+			int x = std::min(std::max((int)middle.x, 0), m_atlasSize - 1);
+			int y = std::min(std::max((int)middle.y, 0), m_atlasSize - 1);
+			int texel = y * m_atlasSize + x;
+			if (m_texels[texel].w == 0.0f)
+			{
+				m_texels[texel].w = 1.0f;
+
+				BAKE_TEXEL bakeTexel;
+				bakeTexel.texel = texel;
+				bakeTexel.triangle = (int)t;
+				bakeTexel.barycentrics = glm::vec2(1.0f / 3.0f, 1.0f / 3.0f);
+				m_bakeTexels.push_back(bakeTexel);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildTree()
+ *
+ *  This method is used for building the tree over all the
+ *  triangles that the shadow and occlusion rays are cast
+ *  through.  The triangles are static, so it is only built
+ *  again when the meshes change.
+ ***********************************************************/
+void LightmapBaker::BuildTree()
+{
+	m_nodes.clear();
+	m_treeTriangles.resize(m_triangles.size());
+	std::iota(m_treeTriangles.begin(), m_treeTriangles.end(), 0);
+	if (m_triangles.empty() == true)
+	{
+		return;
+	}
+
+	m_nodes.reserve(m_triangles.size() * 2);
+	m_nodes.push_back(BVH_NODE());
+	BuildNode(0, 0, (int)m_triangles.size());
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for setting the box of a node around
+ *  its triangles, and splitting them in half along the
+ *  longest side of the box around their centers, until a
+ *  node has few enough for a leaf.  The two children of a
+ *  node are next to each other.
+ ***********************************************************/
+void LightmapBaker::BuildNode(int node, int first, int count)
+{
+	glm::vec3 boxMin = glm::vec3(FLT_MAX);
+	glm::vec3 boxMax = glm::vec3(-FLT_MAX);
+	glm::vec3 centerMin = glm::vec3(FLT_MAX);
+	glm::vec3 centerMax = glm::vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		const CHART_TRIANGLE& triangle = m_triangles[m_treeTriangles[i]];
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec3& position = m_vertices[triangle.vertices[k]].position;
+			boxMin = glm::min(boxMin, position);
+			boxMax = glm::max(boxMax, position);
+			center += position;
+		}
+		centerMin = glm::min(centerMin, center);
+		centerMax = glm::max(centerMax, center);
+	}
+	m_nodes[node].boxMin = boxMin;
+	m_nodes[node].boxMax = boxMax;
+
+	glm::vec3 extent = centerMax - centerMin;
+	int axis = ((extent.x >= extent.y) && (extent.x >= extent.z)) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+	if ((count <= g_MaxLeafTriangles) || (extent[axis] <= 0.0f))
+	{
+		m_nodes[node].first = first;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	// three times the center, which sorts the same
+	auto GetCenter = [this, axis](int t)
+	{
+		const CHART_TRIANGLE& triangle = m_triangles[t];
+		return(m_vertices[triangle.vertices[0]].position[axis] +
+			m_vertices[triangle.vertices[1]].position[axis] +
+			m_vertices[triangle.vertices[2]].position[axis]);
+	};
+	int half = count / 2;
+	int* triangles = m_treeTriangles.data() + first;
+	std::nth_element(triangles, triangles + half, triangles + count, [&](int a, int b)
+	{
+		return(GetCenter(a) < GetCenter(b));
+	});
+
+	int left = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+	m_nodes.push_back(BVH_NODE());
+	m_nodes[node].first = left;
+	m_nodes[node].count = 0;
+	BuildNode(left, first, half);
+	BuildNode(left + 1, first + half, count - half);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for checking whether a ray hits any
+ *  triangle before the passed in distance.  The tree is
+ *  walked with an explicit stack, and the walk stops at the
+ *  first hit, since which triangle is hit does not matter.
+ ***********************************************************/
+bool LightmapBaker::IsOccluded(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance) const
+{
+	if (m_nodes.empty() == true)
+	{
+		return(false);
+	}
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	int stack[g_StackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--top]];
+		if (RayBox(node.boxMin, node.boxMax, origin, inverseDirection, maxDistance) == false)
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			if ((top + 2) <= g_StackSize)
+			{
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+			continue;
+		}
+
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			const CHART_TRIANGLE& triangle = m_triangles[m_treeTriangles[i]];
+			if (RayTriangle(origin, direction,
+				m_vertices[triangle.vertices[0]].position,
+				m_vertices[triangle.vertices[1]].position,
+				m_vertices[triangle.vertices[2]].position,
+				maxDistance) == true)
+			{
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  BakeTexel()
+ *
+ *  This method is used for lighting the point of a texel
+ *  like CalcLightSource() of the fragment shader does, with
+ *  the ambient and diffuse terms only.  The diffuse term of
+ *  a light is dropped when a shadow ray towards it hits a
+ *  triangle, and the ambient terms are darkened by the
+ *  occlusion of the hemisphere when it is selected.
+ ***********************************************************/
+glm::vec3 LightmapBaker::BakeTexel(
+	const BAKE_TEXEL& texel,
+	const std::vector<SceneFile::SCENE_LIGHT>& lights,
+	const std::vector<BAKE_MATERIAL>& materials) const
+{
+	const CHART_TRIANGLE& triangle = m_triangles[texel.triangle];
+	const CHART_VERTEX& a = m_vertices[triangle.vertices[0]];
+	const CHART_VERTEX& b = m_vertices[triangle.vertices[1]];
+	const CHART_VERTEX& c = m_vertices[triangle.vertices[2]];
+	float weightB = texel.barycentrics.x;
+	float weightC = texel.barycentrics.y;
+	float weightA = 1.0f - weightB - weightC;
+
+	glm::vec3 position = a.position * weightA + b.position * weightB + c.position * weightC;
+	glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+	faceNormal = (glm::dot(faceNormal, faceNormal) > 0.0f) ? glm::normalize(faceNormal) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 normal = a.normal * weightA + b.normal * weightB + c.normal * weightC;
+	normal = (glm::dot(normal, normal) > 0.0f) ? glm::normalize(normal) : faceNormal;
+	// the rays leave from the side the surface is lit on
+	if (glm::dot(faceNormal, normal) < 0.0f)
+	{
+		faceNormal = -faceNormal;
+	}
+	glm::vec3 origin = position + faceNormal * g_RayOffset;
+
+	// an unknown material lights like the zeroed material of
+	// the shader
+	BAKE_MATERIAL material = {};
+	if ((triangle.material >= 0) && (triangle.material < (int)materials.size()))
+	{
+		material = materials[triangle.material];
+	}
+	float openness = (m_aoSamples > 0) ? GetAmbientOcclusion(origin, normal, texel.texel) : 1.0f;
+
+	glm::vec3 light = glm::vec3(0.0f);
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const SceneFile::SCENE_LIGHT& source = lights[i];
+		glm::vec3 toLight = glm::make_vec3(source.position) - position;
+
+		float attenuation = 1.0f;
+		if (source.range > 0.0f)
+		{
+			float falloff = glm::clamp(1.0f - glm::dot(toLight, toLight) / (source.range * source.range), 0.0f, 1.0f);
+			attenuation = falloff * falloff;
+			if (attenuation <= 0.0f)
+			{
+				continue;
+			}
+		}
+
+		glm::vec3 ambient = glm::make_vec3(source.ambientColor) + material.ambientColor * material.ambientStrength;
+		float distance = glm::length(toLight);
+		float impact = 0.0f;
+		if (distance > 0.0f)
+		{
+			glm::vec3 direction = toLight / distance;
+			impact = std::max(glm::dot(normal, direction), 0.0f);
+			if ((impact > 0.0f) && (IsOccluded(origin, direction, distance - g_RayOffset) == true))
+			{
+				impact = 0.0f;
+			}
+		}
+
+		light += (ambient * openness + material.diffuseColor * impact) * attenuation;
+	}
+
+	return(light);
+}
+
+/***********************************************************
+ *  GetAmbientOcclusion()
+ *
+ *  This method is used for casting rays over the hemisphere
+ *  around a normal, more of them near the normal since the
+ *  light from there counts more, and returning the fraction
+ *  that hit nothing within the occlusion distance.  The ray
+ *  directions are a fixed evenly spread set, turned by a
+ *  different amount for each texel.
+ ***********************************************************/
+float LightmapBaker::GetAmbientOcclusion(
+	const glm::vec3& origin,
+	const glm::vec3& normal,
+	int texel) const
+{
+	glm::vec3 tangent;
+	glm::vec3 bitangent;
+	GetPlaneAxes(normal, tangent, bitangent);
+	float turn = HashTexel((unsigned int)texel);
+
+	int nOccluded = 0;
+	for (int i = 0; i < m_aoSamples; i++)
+	{
+		float u = ((float)i + 0.5f) / (float)m_aoSamples;
+		float v = RadicalInverse((unsigned int)i) + turn;
+		v -= std::floor(v);
+
+		float radius = std::sqrt(u);
+		float angle = 2.0f * g_Pi * v;
+		glm::vec3 direction =
+			tangent * (radius * std::cos(angle)) +
+			bitangent * (radius * std::sin(angle)) +
+			normal * std::sqrt(std::max(1.0f - u, 0.0f));
+		if (IsOccluded(origin, direction, m_aoDistance) == true)
+		{
+			nOccluded++;
+		}
+	}
+
+	return(1.0f - (float)nOccluded / (float)m_aoSamples);
+}
+
+/***********************************************************
+ *  FillGutters()
+ *
+ *  This method is used for growing the lit texels into the
+ *  empty texels next to them, one texel per pass, as the
+ *  average of their lit neighbours.  As many passes as the
+ *  gutter is wide keep the charts from reaching each other.
+ ***********************************************************/
+void LightmapBaker::FillGutters()
+{
+	std::vector<glm::vec4> filled;
+	for (int pass = 0; pass < g_GutterTexels; pass++)
+	{
+		filled = m_texels;
+		JobSystem::Get().ParallelFor((size_t)m_atlasSize, [this, &filled](size_t row)
+		{
+			int y = (int)row;
+			for (int x = 0; x < m_atlasSize; x++)
+			{
+				if (m_texels[y * m_atlasSize + x].w > 0.0f)
+				{
+					continue;
+				}
+
+				glm::vec3 sum = glm::vec3(0.0f);
+				int nLit = 0;
+				for (int dy = std::max(y - 1, 0); dy <= std::min(y + 1, m_atlasSize - 1); dy++)
+				{
+					for (int dx = std::max(x - 1, 0); dx <= std::min(x + 1, m_atlasSize - 1); dx++)
+					{
+						const glm::vec4& neighbour = m_texels[dy * m_atlasSize + dx];
+						if (neighbour.w > 0.0f)
+						{
+							sum += glm::vec3(neighbour);
+							nLit++;
+						}
+					}
+				}
+				if (nLit > 0)
+				{
+					filled[y * m_atlasSize + x] = glm::vec4(sum / (float)nLit, 1.0f);
+				}
+			}
+		});
+		m_texels.swap(filled);
+	}
+}
+
+/***********************************************************
+ *  IsBaked()
+ *
+ *  This method is used for checking whether the atlas was
+ *  baked and sent to the GPU.
+ ***********************************************************/
+bool LightmapBaker::IsBaked() const
+{
+	return(m_texture != 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the atlas to the passed
+ *  in texture unit.
+ ***********************************************************/
+void LightmapBaker::Bind(GLuint unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  GetChartCount()
+ *
+ *  This method is used for getting the number of charts of
+ *  all the meshes.
+ ***********************************************************/
+int LightmapBaker::GetChartCount() const
+{
+	return((int)m_charts.size());
+}
+
+/***********************************************************
+ *  GetAtlasSize()
+ *
+ *  This method is used for getting the width and height of
+ *  the atlas in texels.
+ ***********************************************************/
+int LightmapBaker::GetAtlasSize() const
+{
+	return(m_atlasSize);
+}
+
+/***********************************************************
+ *  GetPackedDensity()
+ *
+ *  This method is used for getting the texels per world
+ *  unit of the last packing, which is lower than the
+ *  selected density when the charts did not fit.
+ ***********************************************************/
+float LightmapBaker::GetPackedDensity() const
+{
+	return(m_packedDensity);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the atlas texture.
+ ***********************************************************/
+void LightmapBaker::Destroy()
+{
+	if (m_texture != 0)
+	{
+		glDeleteTextures(1, &m_texture);
+		m_texture = 0;
+	}
+}
\ No newline at end of file
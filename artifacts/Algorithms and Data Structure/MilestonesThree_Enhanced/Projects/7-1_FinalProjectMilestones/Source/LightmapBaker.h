@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// lay the static geometry out in a lightmap atlas, and bake the lighting that
+// does not depend on the view into it on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class gives static world space meshes a second set
+ *  of texture coordinates in a lightmap atlas.  Each mesh
+ *  is split into charts of connected triangles that face
+ *  about the same way, each chart is projected onto its
+ *  plane at a number of texels per world unit, and the
+ *  charts are packed into rows of the atlas with a gutter
+ *  around them, so no two triangles share a texel.  The
+ *  bake lights the center of every covered texel with the
+ *  ambient and diffuse terms of the lighting shader, with a
+ *  shadow ray through a tree over all the triangles to each
+ *  light, and can darken the ambient term by how much of
+ *  the hemisphere is occluded.  The texels are baked on the
+ *  job system, and the gutters are filled from the charts
+ *  so filtering never reads an unlit texel.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	// constructor
+	LightmapBaker();
+	// destructor
+	~LightmapBaker();
+
+	// the material terms of the lighting shader the bake
+	// needs, the specular terms stay in the shader
+	struct BAKE_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+	};
+
+	// width and height of the atlas in texels, and texels per
+	// world unit of the charts.  The density is lowered when
+	// the charts do not fit in the atlas
+	void SetAtlasSize(int size);
+	void SetTexelDensity(float texelsPerUnit);
+	// number of hemisphere rays per texel for the ambient
+	// occlusion, 0 for none, and how far a surface occludes
+	void SetAmbientOcclusion(int sampleCount, float distance);
+
+	// forget the meshes and their charts
+	void Clear();
+	// split a world space mesh into charts, and return the
+	// index of the mesh.  A source vertex that is used by more
+	// than one chart is copied for each, so the charted mesh
+	// is passed back as the source vertex of each of its
+	// vertices, and the triangles over those vertices
+	int AddMesh(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& normals,
+		const std::vector<GLuint>& indices,
+		int material,
+		std::vector<GLuint>& chartedVertices,
+		std::vector<GLuint>& chartedIndices);
+	// place the charts of all the meshes in the atlas, false
+	// when they do not fit at any density
+	bool PackCharts();
+	// get the atlas coordinates of the charted vertices of a
+	// mesh, after the charts were packed
+	void GetMeshCoordinates(int mesh, std::vector<glm::vec2>& coordinates) const;
+
+	// light the texels of the packed charts with the passed in
+	// lights, and the material table the mesh materials index,
+	// and send the atlas to the GPU
+	bool Bake(
+		const std::vector<SceneFile::SCENE_LIGHT>& lights,
+		const std::vector<BAKE_MATERIAL>& materials);
+	bool IsBaked() const;
+	// bind the atlas to the passed in texture unit
+	void Bind(GLuint unit) const;
+
+	int GetChartCount() const;
+	int GetAtlasSize() const;
+	// texels per world unit the charts were packed with
+	float GetPackedDensity() const;
+
+	// free the atlas texture
+	void Destroy();
+
+private:
+	// vertex of a charted mesh, with its position in its
+	// chart in world units, and in the atlas in texels
+	struct CHART_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 chartPosition;
+		glm::vec2 atlasPosition;
+	};
+
+	// triangle of a charted mesh, over the charted vertices
+	// of all the meshes
+	struct CHART_TRIANGLE
+	{
+		GLuint vertices[3];
+		int chart;
+		int material;
+	};
+
+	// charted vertices of a mesh
+	struct LIGHTMAP_MESH
+	{
+		GLuint firstVertex;
+		GLuint nVertices;
+	};
+
+	// size of a chart in world units, and the texels it was
+	// given in the atlas, gutter included
+	struct CHART
+	{
+		glm::vec2 size;
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	// node of the tree over the triangles.  A leaf has its
+	// triangles from first on, an inner node its two children
+	struct BVH_NODE
+	{
+		glm::vec3 boxMin;
+		int first;
+		glm::vec3 boxMax;
+		int count;		// 0 for an inner node
+	};
+
+	// covered texel, and where in its triangle its center is
+	struct BAKE_TEXEL
+	{
+		int texel;
+		int triangle;
+		glm::vec2 barycentrics;
+	};
+
+	// lay the charts out in rows at the passed in density,
+	// false when they do not fit
+	bool PlaceCharts(float density, const std::vector<int>& order);
+	// find the texels whose center is inside a triangle
+	void RasterizeCharts();
+	// build the tree over the triangles for the shadow rays
+	void BuildTree();
+	void BuildNode(int node, int first, int count);
+	// check whether a ray hits a triangle before maxDistance
+	bool IsOccluded(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance) const;
+	// light of one covered texel
+	glm::vec3 BakeTexel(
+		const BAKE_TEXEL& texel,
+		const std::vector<SceneFile::SCENE_LIGHT>& lights,
+		const std::vector<BAKE_MATERIAL>& materials) const;
+	// fraction of the hemisphere above a point that is open
+	float GetAmbientOcclusion(
+		const glm::vec3& origin,
+		const glm::vec3& normal,
+		int texel) const;
+	// spread the lit texels into the gutters around them
+	void FillGutters();
+
+	int m_atlasSize;
+	float m_texelDensity;
+	float m_packedDensity;
+	int m_aoSamples;
+	float m_aoDistance;
+
+	std::vector<CHART_VERTEX> m_vertices;
+	std::vector<CHART_TRIANGLE> m_triangles;
+	std::vector<LIGHTMAP_MESH> m_meshes;
+	std::vector<CHART> m_charts;
+	bool m_bPacked;
+
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<int> m_treeTriangles;
+
+	// the covered texels, and the light of every atlas texel
+	// with whether it is lit in alpha, only kept during a bake
+	std::vector<BAKE_TEXEL> m_bakeTexels;
+	std::vector<glm::vec4> m_texels;
+
+	GLuint m_texture;
+};
\ No newline at end of file
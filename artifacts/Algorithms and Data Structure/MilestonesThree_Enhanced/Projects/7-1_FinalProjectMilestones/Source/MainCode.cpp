@@ -1,5 +1,6 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <string>           // command line options
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +14,10 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "FrameTimer.h"
+#include "TransformBenchmark.h"
+#include "SpatialBenchmark.h"
+#include "NormalSelfTest.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,6 +34,19 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// number of frames rendered in benchmark mode, 0 when not benchmarking
+	int g_BenchmarkFrames = 0;
+	// number of extra dynamic objects drawn in benchmark mode
+	int g_BenchmarkObjects = 4096;
+	// number of small lights added in benchmark mode
+	int g_BenchmarkLights = 0;
+	// frames rendered before the benchmark measurement starts
+	const int g_BenchmarkWarmupFrames = 60;
+
+	// oldest OpenGL version the shaders compile with
+	const int g_RequiredGLMajor = 4;
+	const int g_RequiredGLMinor = 4;
 }
 
 // Function declarations - all functions that are called manually
@@ -45,6 +63,181 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// command line options for comparing the vertex fetch paths:
+	//   --vertex-fetch vao|shared|pulling
+	//   --no-static-batching
+	//   --benchmark <frames> [--benchmark-objects <count>]
+	//     [--benchmark-lights <count>]
+	// for timing the per-object and batch transform paths:
+	//   --transform-benchmark
+	// for timing the spatial index against testing every object:
+	//   --bvh-benchmark
+	// for checking the SIMD normals and tangents against scalar math:
+	//   --normals-selftest
+	// and for placing an imported model on the desk:
+	//   --model <file.glb>
+	// and for drawing the objects beyond a distance as impostors:
+	//   --impostors <distance>
+	// and for building another scene, and compiling the loaded
+	// scene into a binary scene file that loads without parsing:
+	//   --scene <file> [--save-scene <file.scnb>]
+	// and for drawing objects outside the view, or too small
+	// on screen, or setting the smallest size in pixels:
+	//   --no-culling
+	//   --min-pixels <pixels>
+	// or only the objects hidden behind large boxes and planes:
+	//   --no-occlusion
+	// and for testing the static batch in a compute shader that
+	// writes the draws of the visible objects:
+	//   --gpu-culling
+	// and for drawing the depth of the opaque objects before
+	// shading them, which the P key turns on and off:
+	//   --depth-prepass
+	// or for lighting every pixel once from a G-buffer:
+	//   --deferred
+	// or from the triangle IDs of a visibility buffer, which
+	// selects vertex pulling unless shared is selected:
+	//   --visibility-buffer
+	// and for baking the ambient and diffuse light of the static
+	// batch into a lightmap, with ambient occlusion rays per texel:
+	//   --lightmaps [--lightmap-ao <samples>]
+	// and for shadows of the first lights of the scene, from
+	// cube maps that are only drawn again when they change:
+	//   --shadows
+	ShapeMeshes::VERTEX_FETCH vertexFetch = ShapeMeshes::VAO_PER_MESH;
+	std::string modelFile;
+	std::string vertexFetchName = "vao";
+	bool bStaticBatching = true;
+	float impostorDistance = 0.0f;
+	bool bTransformBenchmark = false;
+	bool bSpatialBenchmark = false;
+	bool bNormalsSelfTest = false;
+	std::string sceneFile;
+	std::string binarySceneFile;
+	bool bCulling = true;
+	bool bOcclusion = true;
+	bool bGpuCulling = false;
+	bool bDepthPrepass = false;
+	bool bDeferred = false;
+	bool bVisibilityBuffer = false;
+	bool bLightmaps = false;
+	int lightmapAoSamples = 0;
+	bool bShadows = false;
+	float minPixels = 1.0f;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if ((option == "--vertex-fetch") && ((i + 1) < argc))
+		{
+			vertexFetchName = argv[++i];
+			if (vertexFetchName == "shared")
+				vertexFetch = ShapeMeshes::SHARED_VAO;
+			else if (vertexFetchName == "pulling")
+				vertexFetch = ShapeMeshes::VERTEX_PULLING;
+			else
+				vertexFetchName = "vao";
+		}
+		else if (option == "--no-static-batching")
+		{
+			bStaticBatching = false;
+		}
+		else if ((option == "--benchmark") && ((i + 1) < argc))
+		{
+			g_BenchmarkFrames = std::atoi(argv[++i]);
+		}
+		else if ((option == "--benchmark-objects") && ((i + 1) < argc))
+		{
+			g_BenchmarkObjects = std::atoi(argv[++i]);
+		}
+		else if ((option == "--benchmark-lights") && ((i + 1) < argc))
+		{
+			g_BenchmarkLights = std::atoi(argv[++i]);
+		}
+		else if ((option == "--model") && ((i + 1) < argc))
+		{
+			modelFile = argv[++i];
+		}
+		else if (option == "--transform-benchmark")
+		{
+			bTransformBenchmark = true;
+		}
+		else if (option == "--bvh-benchmark")
+		{
+			bSpatialBenchmark = true;
+		}
+		else if (option == "--normals-selftest")
+		{
+			bNormalsSelfTest = true;
+		}
+		else if ((option == "--impostors") && ((i + 1) < argc))
+		{
+			impostorDistance = (float)std::atof(argv[++i]);
+		}
+		else if ((option == "--scene") && ((i + 1) < argc))
+		{
+			sceneFile = argv[++i];
+		}
+		else if ((option == "--save-scene") && ((i + 1) < argc))
+		{
+			binarySceneFile = argv[++i];
+		}
+		else if (option == "--no-culling")
+		{
+			bCulling = false;
+		}
+		else if (option == "--no-occlusion")
+		{
+			bOcclusion = false;
+		}
+		else if (option == "--gpu-culling")
+		{
+			bGpuCulling = true;
+		}
+		else if (option == "--depth-prepass")
+		{
+			bDepthPrepass = true;
+		}
+		else if (option == "--deferred")
+		{
+			bDeferred = true;
+		}
+		else if (option == "--visibility-buffer")
+		{
+			bVisibilityBuffer = true;
+		}
+		else if (option == "--lightmaps")
+		{
+			bLightmaps = true;
+		}
+		else if ((option == "--lightmap-ao") && ((i + 1) < argc))
+		{
+			lightmapAoSamples = std::atoi(argv[++i]);
+		}
+		else if (option == "--shadows")
+		{
+			bShadows = true;
+		}
+		else if ((option == "--min-pixels") && ((i + 1) < argc))
+		{
+			minPixels = (float)std::atof(argv[++i]);
+		}
+	}
+
+	// the visibility buffer fetches the triangles from the
+	// shared mesh buffers
+	if ((bVisibilityBuffer == true) && (vertexFetch == ShapeMeshes::VAO_PER_MESH))
+	{
+		vertexFetch = ShapeMeshes::VERTEX_PULLING;
+		vertexFetchName = "pulling";
+	}
+
+	// the normals self test only uses the CPU, so it runs
+	// without a window
+	if (bNormalsSelfTest == true)
+	{
+		return((NormalSelfTest::Run() == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -66,6 +259,26 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the transform benchmark only needs the OpenGL context
+	// for its mapped buffer, and the spatial benchmark only
+	// the CPU, so no scene is prepared
+	if ((bTransformBenchmark == true) || (bSpatialBenchmark == true))
+	{
+		if (bTransformBenchmark == true)
+		{
+			TransformBenchmark::Run();
+		}
+		if (bSpatialBenchmark == true)
+		{
+			SpatialBenchmark::Run();
+		}
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+		exit(EXIT_SUCCESS);
+	}
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
 		"../../Utilities/shaders/vertexShader.glsl",
@@ -74,7 +287,37 @@ int main(int argc, char* argv[])
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetVertexFetch(vertexFetch);
+	g_SceneManager->SetStaticBatching(bStaticBatching);
+	g_SceneManager->SetImpostors(impostorDistance > 0.0f, impostorDistance);
+	g_SceneManager->SetCulling(bCulling, minPixels);
+	g_SceneManager->SetOcclusionCulling(bOcclusion);
+	g_SceneManager->SetGpuCulling(bGpuCulling);
+	g_SceneManager->SetDepthPrepass(bDepthPrepass);
+	g_SceneManager->SetDeferredShading(bDeferred);
+	g_SceneManager->SetVisibilityBuffer(bVisibilityBuffer);
+	g_SceneManager->SetLightmaps(bLightmaps, lightmapAoSamples);
+	g_SceneManager->SetShadows(bShadows);
+	g_SceneManager->SetSceneFile(sceneFile, binarySceneFile);
 	g_SceneManager->PrepareScene();
+	if (modelFile.empty() == false)
+	{
+		g_SceneManager->AddModel(modelFile.c_str(),
+			glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 5.1f, 5.5f));
+	}
+
+	// the benchmark renders unthrottled with extra objects
+	// so the vertex fetch path dominates the frame time
+	FrameTimer* frameTimer = NULL;
+	if (g_BenchmarkFrames > 0)
+	{
+		g_SceneManager->AddBenchmarkObjects(g_BenchmarkObjects);
+		g_SceneManager->AddBenchmarkLights(g_BenchmarkLights);
+		g_SceneManager->SetFragmentCounting(true);
+		glfwSwapInterval(0);
+		frameTimer = new FrameTimer();
+	}
+	int frameNumber = 0;
 
 	std::cout << "\n*** KEY FUNCTIONS: ***\n";
 	std::cout << "ESC - close the window and exit\n";
@@ -85,6 +328,13 @@ int main(int argc, char* argv[])
 	std::cout << "2 - side view (ortho)\n";
 	std::cout << "3 - top view (ortho)\n";
 	std::cout << "4 - perspective view\n";
+	std::cout << "R - reload the scene file\n";
+	std::cout << "P - depth pre-pass on/off\n";
+
+	// the scene is reloaded, and the depth pre-pass switched,
+	// once per press of the key
+	bool bReloadKeyDown = false;
+	bool bPrepassKeyDown = false;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
@@ -99,9 +349,71 @@ int main(int argc, char* argv[])
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetSceneView(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetViewportHeight());
+
+		// reload the scene file when the key goes down, applying
+		// only what changed since it was loaded
+		bool bReloadKey = (glfwGetKey(g_Window, GLFW_KEY_R) == GLFW_PRESS);
+		if ((bReloadKey == true) && (bReloadKeyDown == false))
+		{
+			g_SceneManager->ReloadScene();
+		}
+		bReloadKeyDown = bReloadKey;
+		bool bPrepassKey = (glfwGetKey(g_Window, GLFW_KEY_P) == GLFW_PRESS);
+		if ((bPrepassKey == true) && (bPrepassKeyDown == false))
+		{
+			g_SceneManager->SetDepthPrepass(!g_SceneManager->GetDepthPrepass());
+			std::cout << "Depth pre-pass " << (g_SceneManager->GetDepthPrepass() ? "on" : "off") << std::endl;
+		}
+		bPrepassKeyDown = bPrepassKey;
 
-		// refresh the 3D scene
+		// refresh the 3D scene, measuring it after the warm-up frames
+		bool bMeasureFrame = (frameTimer != NULL) && (frameNumber >= g_BenchmarkWarmupFrames);
+		if (bMeasureFrame == true)
+		{
+			frameTimer->BeginFrame();
+		}
 		g_SceneManager->RenderScene();
+		if (bMeasureFrame == true)
+		{
+			frameTimer->EndFrame();
+		}
+		frameNumber++;
+
+		// report the benchmark results and close the window
+		if ((frameTimer != NULL) && (frameTimer->GetFrameCount() >= g_BenchmarkFrames))
+		{
+			std::string label = "vertex fetch " + vertexFetchName +
+				", static batching " + (bStaticBatching ? "on" : "off") +
+				", impostors " + ((impostorDistance > 0.0f) ? std::to_string(impostorDistance) : "off") +
+				", culling " + (bCulling ? "on" : "off") +
+				", occlusion " + ((bCulling && bOcclusion) ? "on" : "off") +
+				", gpu culling " + ((bCulling && bGpuCulling) ? "on" : "off") +
+				", depth pre-pass " + (g_SceneManager->GetDepthPrepass() ? "on" : "off") +
+				", shading " + (bVisibilityBuffer ? "visibility buffer" : (bDeferred ? "deferred" : "forward")) +
+				", lightmaps " + (bLightmaps ? "on" : "off") +
+				", shadows " + (bShadows ? "on" : "off") +
+				", " + std::to_string(g_BenchmarkObjects) + " objects" +
+				", " + std::to_string(g_BenchmarkLights) + " lights";
+			frameTimer->PrintReport(label.c_str());
+
+			// the counters of the last measured frame
+			const SceneManager::CULLING_STATS& culling = g_SceneManager->GetCullingStats();
+			std::cout << "BENCHMARK: culling | submitted: " << culling.submitted
+				<< " | outside frustum: " << culling.outsideFrustum
+				<< " | too small: " << culling.tooSmall
+				<< " | occluded: " << culling.occluded << std::endl;
+			if (g_SceneManager->IsCountingFragments() == true)
+			{
+				std::cout << "BENCHMARK: fragments | shaded: " << g_SceneManager->GetFragmentCount() << std::endl;
+			}
+			delete frameTimer;
+			frameTimer = NULL;
+			glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+		}
 
 
 		// Flips the the back buffer with the front buffer every frame.
@@ -143,16 +455,15 @@ bool InitializeGLFW()
 	// --------------------------------------
 	glfwInit();
 
+	// set the version of OpenGL and profile to use.  The shaders
+	// and storage buffers need 4.4 on every platform, and the
+	// drivers return their newest compatible version, so the
+	// GPU culling can still find the 4.6 indirect count draws
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, g_RequiredGLMajor);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, g_RequiredGLMinor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
 	// GLFW: end -------------------------------
 
@@ -179,6 +490,18 @@ bool InitializeGLEW()
 	}
 	// GLEW: end -------------------------------
 
+	// a context older than the shaders need cannot draw the scene
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if ((major < g_RequiredGLMajor) || ((major == g_RequiredGLMajor) && (minor < g_RequiredGLMinor)))
+	{
+		std::cerr << "ERROR: OpenGL " << g_RequiredGLMajor << "." << g_RequiredGLMinor
+			<< " or newer is required, the context is " << major << "." << minor << std::endl;
+		return false;
+	}
+
 	// Displays a successful OpenGL initialization message
 	std::cout << "INFO: OpenGL Successfully Initialized\n";
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
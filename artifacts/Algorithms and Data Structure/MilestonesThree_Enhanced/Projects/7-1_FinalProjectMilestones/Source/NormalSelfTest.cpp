@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalselftest.cpp
+// ============
+// check the SIMD normal and tangent generator against a plain scalar version
+// of the same math
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NormalSelfTest.h"
+#include "NormalGenerator.h"
+#include "ShapeGenerators.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// largest difference of a normal or tangent component
+	const float g_Tolerance = 1e-4f;
+	// lengths below this are treated as zero, as in the generator
+	const float g_MinLength = 1e-20f;
+	// vertices whose handedness weights nearly cancel may pick
+	// either sign, so their handedness is not compared
+	const float g_MinHandedness = 1e-3f;
+
+	// torus resolution of the first mesh
+	const int g_TorusSegments = 30;
+	// vertices across the grid of the second mesh
+	const int g_GridSize = 33;
+
+	// interleaved position, normal and texture coordinates,
+	// with indices
+	struct TEST_MESH
+	{
+		std::string name;
+		std::vector<GLfloat> verts;
+		std::vector<GLuint> indices;
+		size_t nVertices;
+	};
+
+	// linear congruential generator, in [0, 1)
+	float NextRandom(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return((float)(seed >> 8) / 16777216.0f);
+	}
+
+	glm::vec3 GetPosition(const TEST_MESH& mesh, GLuint v)
+	{
+		const GLfloat* vert = &mesh.verts[v * ShapeGenerators::FloatsPerVertex];
+		return(glm::vec3(vert[0], vert[1], vert[2]));
+	}
+
+	glm::vec2 GetTexCoord(const TEST_MESH& mesh, GLuint v)
+	{
+		const GLfloat* vert = &mesh.verts[v * ShapeGenerators::FloatsPerVertex];
+		return(glm::vec2(vert[6], vert[7]));
+	}
+
+	/***********************************************************
+	 *  MakeTorus()
+	 *
+	 *  Make the torus grid of the shape meshes.
+	 ***********************************************************/
+	void MakeTorus(TEST_MESH& mesh)
+	{
+		mesh.name = "torus";
+		mesh.nVertices = ShapeGenerators::TorusVertexCount(g_TorusSegments, g_TorusSegments);
+		mesh.verts.assign(mesh.nVertices * ShapeGenerators::FloatsPerVertex, 0.0f);
+		mesh.indices.resize(ShapeGenerators::TorusIndexCount(g_TorusSegments, g_TorusSegments));
+		ShapeGenerators::GenerateTorus(mesh.verts.data(), g_TorusSegments, g_TorusSegments, 1.0f, 0.2f);
+		ShapeGenerators::GenerateTorusIndices(mesh.indices.data(), g_TorusSegments, g_TorusSegments);
+	}
+
+	/***********************************************************
+	 *  MakeGrid()
+	 *
+	 *  Make a height field with jittered vertices, whose right
+	 *  half has mirrored texture coordinates.  A few triangles
+	 *  repeat a corner or point past the last vertex, and the
+	 *  triangle count is not a multiple of the lanes.
+	 ***********************************************************/
+	void MakeGrid(TEST_MESH& mesh)
+	{
+		mesh.name = "grid";
+		mesh.nVertices = g_GridSize * g_GridSize;
+		mesh.verts.assign(mesh.nVertices * ShapeGenerators::FloatsPerVertex, 0.0f);
+
+		unsigned int seed = 4321;
+		float step = 1.0f / (float)(g_GridSize - 1);
+		for (int row = 0; row < g_GridSize; row++)
+		{
+			for (int column = 0; column < g_GridSize; column++)
+			{
+				GLfloat* vert = &mesh.verts[(row * g_GridSize + column) * ShapeGenerators::FloatsPerVertex];
+				float u = (float)column * step;
+				vert[0] = u + (NextRandom(seed) - 0.5f) * step * 0.5f;
+				vert[1] = NextRandom(seed) * 0.2f;
+				vert[2] = (float)row * step + (NextRandom(seed) - 0.5f) * step * 0.5f;
+				vert[6] = (u > 0.5f) ? (1.0f - u) : u;
+				vert[7] = (float)row * step;
+			}
+		}
+
+		for (int row = 0; (row + 1) < g_GridSize; row++)
+		{
+			for (int column = 0; (column + 1) < g_GridSize; column++)
+			{
+				GLuint corner = (GLuint)(row * g_GridSize + column);
+				GLuint nextRow = corner + (GLuint)g_GridSize;
+				GLuint quad[6] = { corner, nextRow, nextRow + 1, corner, nextRow + 1, corner + 1 };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+		GLuint degenerate[3] = { 5, 5, 40 };
+		GLuint invalid[3] = { 7, (GLuint)mesh.nVertices, 8 };
+		mesh.indices.insert(mesh.indices.end(), degenerate, degenerate + 3);
+		mesh.indices.insert(mesh.indices.end(), invalid, invalid + 3);
+		mesh.indices.push_back(0);
+		mesh.indices.push_back(1);
+		mesh.indices.push_back(g_GridSize);
+	}
+
+	bool IsValidTriangle(const TEST_MESH& mesh, size_t t)
+	{
+		return((mesh.indices[3 * t] < mesh.nVertices) && (mesh.indices[3 * t + 1] < mesh.nVertices) &&
+			(mesh.indices[3 * t + 2] < mesh.nVertices));
+	}
+
+	/***********************************************************
+	 *  ReferenceNormals()
+	 *
+	 *  Sum the cross products of the triangles one at a time,
+	 *  as the generator defines the area weighted normals.
+	 ***********************************************************/
+	void ReferenceNormals(const TEST_MESH& mesh, std::vector<glm::vec3>& normals)
+	{
+		std::vector<glm::vec3> sums(mesh.nVertices, glm::vec3(0.0f));
+		for (size_t t = 0; t < mesh.indices.size() / 3; t++)
+		{
+			if (IsValidTriangle(mesh, t) == false)
+			{
+				continue;
+			}
+			const GLuint* corners = &mesh.indices[3 * t];
+			glm::vec3 p0 = GetPosition(mesh, corners[0]);
+			glm::vec3 faceNormal = glm::cross(GetPosition(mesh, corners[1]) - p0, GetPosition(mesh, corners[2]) - p0);
+			for (int c = 0; c < 3; c++)
+			{
+				sums[corners[c]] += faceNormal;
+			}
+		}
+
+		normals.resize(mesh.nVertices);
+		for (size_t v = 0; v < mesh.nVertices; v++)
+		{
+			float length = glm::length(sums[v]);
+			normals[v] = (length > g_MinLength) ? (sums[v] / length) : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	// cosine of the angle between two edges, one for degenerate edges
+	float CornerCosine(const glm::vec3& a, const glm::vec3& b)
+	{
+		float lengths = std::sqrt(glm::dot(a, a) * glm::dot(b, b));
+		if (lengths <= g_MinLength)
+		{
+			return(1.0f);
+		}
+		return(std::max(std::min(glm::dot(a, b) / lengths, 1.0f), -1.0f));
+	}
+
+	/***********************************************************
+	 *  ReferenceTangents()
+	 *
+	 *  Sum the angle weighted tangents of the triangles one at
+	 *  a time, with the normals passed in, and keep the
+	 *  handedness sums so cancelling vertices can be skipped.
+	 ***********************************************************/
+	void ReferenceTangents(
+		const TEST_MESH& mesh,
+		const std::vector<glm::vec3>& normals,
+		std::vector<glm::vec4>& tangents,
+		std::vector<float>& handedness)
+	{
+		std::vector<glm::vec3> sums(mesh.nVertices, glm::vec3(0.0f));
+		handedness.assign(mesh.nVertices, 0.0f);
+		for (size_t t = 0; t < mesh.indices.size() / 3; t++)
+		{
+			if (IsValidTriangle(mesh, t) == false)
+			{
+				continue;
+			}
+			const GLuint* corners = &mesh.indices[3 * t];
+			glm::vec3 p0 = GetPosition(mesh, corners[0]);
+			glm::vec3 e1 = GetPosition(mesh, corners[1]) - p0;
+			glm::vec3 e2 = GetPosition(mesh, corners[2]) - p0;
+			glm::vec2 uv0 = GetTexCoord(mesh, corners[0]);
+			glm::vec2 d1 = GetTexCoord(mesh, corners[1]) - uv0;
+			glm::vec2 d2 = GetTexCoord(mesh, corners[2]) - uv0;
+
+			float area = d1.x * d2.y - d2.x * d1.y;
+			float sign = (area > 0.0f) ? 1.0f : ((area < 0.0f) ? -1.0f : 0.0f);
+			if (sign == 0.0f)
+			{
+				continue;
+			}
+
+			glm::vec3 faceTangent = (e1 * d2.y - e2 * d1.y) * sign;
+			glm::vec3 e3 = e2 - e1;
+			float cosines[3] = { CornerCosine(e1, e2), CornerCosine(-e1, e3), CornerCosine(-e2, -e3) };
+			for (int c = 0; c < 3; c++)
+			{
+				const glm::vec3& normal = normals[corners[c]];
+				glm::vec3 tangent = faceTangent - normal * glm::dot(normal, faceTangent);
+				float length = glm::length(tangent);
+				if (length <= g_MinLength)
+				{
+					continue;
+				}
+
+				float weight = std::acos(cosines[c]);
+				sums[corners[c]] += tangent * (weight / length);
+				handedness[corners[c]] += weight * sign;
+			}
+		}
+
+		tangents.resize(mesh.nVertices);
+		for (size_t v = 0; v < mesh.nVertices; v++)
+		{
+			const glm::vec3& normal = normals[v];
+			glm::vec3 tangent = sums[v] - normal * glm::dot(normal, sums[v]);
+			float length = glm::length(tangent);
+			tangent = (length > g_MinLength) ? (tangent / length) : glm::vec3(0.0f);
+			if (glm::dot(tangent, tangent) == 0.0f)
+			{
+				glm::vec3 axis = (std::fabs(normal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				tangent = axis - normal * glm::dot(normal, axis);
+				length = glm::length(tangent);
+				tangent = (length > g_MinLength) ? (tangent / length) : glm::vec3(1.0f, 0.0f, 0.0f);
+			}
+			tangents[v] = glm::vec4(tangent, (handedness[v] < 0.0f) ? -1.0f : 1.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  CheckMesh()
+	 *
+	 *  Generate the normals and tangents of a mesh both ways,
+	 *  print the largest differences, and return whether they
+	 *  are within the tolerance.
+	 ***********************************************************/
+	bool CheckMesh(const TEST_MESH& mesh)
+	{
+		const size_t vertexStride = ShapeGenerators::FloatsPerVertex * sizeof(GLfloat);
+		NormalGenerator::VERTEX_DATA vertices = {};
+		vertices.positions = mesh.verts.data();
+		vertices.positionStride = vertexStride;
+		vertices.texCoords = mesh.verts.data() + 6;
+		vertices.texCoordStride = vertexStride;
+		vertices.nVertices = mesh.nVertices;
+
+		std::vector<glm::vec3> normals(mesh.nVertices);
+		NormalGenerator::GenerateNormals(vertices, mesh.indices.data(), mesh.indices.size(),
+			&normals[0].x, sizeof(glm::vec3));
+		std::vector<glm::vec3> referenceNormals;
+		ReferenceNormals(mesh, referenceNormals);
+
+		// both tangent versions start from the same normals
+		vertices.normals = &normals[0].x;
+		vertices.normalStride = sizeof(glm::vec3);
+		std::vector<glm::vec4> tangents(mesh.nVertices);
+		NormalGenerator::GenerateTangents(vertices, mesh.indices.data(), mesh.indices.size(),
+			&tangents[0].x, sizeof(glm::vec4));
+		std::vector<glm::vec4> referenceTangents;
+		std::vector<float> handedness;
+		ReferenceTangents(mesh, normals, referenceTangents, handedness);
+
+		float normalError = 0.0f;
+		float tangentError = 0.0f;
+		int flippedSigns = 0;
+		for (size_t v = 0; v < mesh.nVertices; v++)
+		{
+			glm::vec3 normalDifference = glm::abs(normals[v] - referenceNormals[v]);
+			glm::vec3 tangentDifference = glm::abs(glm::vec3(tangents[v]) - glm::vec3(referenceTangents[v]));
+			normalError = std::max(normalError, std::max(normalDifference.x, std::max(normalDifference.y, normalDifference.z)));
+			tangentError = std::max(tangentError, std::max(tangentDifference.x, std::max(tangentDifference.y, tangentDifference.z)));
+			if ((std::fabs(handedness[v]) > g_MinHandedness) && (tangents[v].w != referenceTangents[v].w))
+			{
+				flippedSigns++;
+			}
+		}
+
+		bool bPassed = (normalError <= g_Tolerance) && (tangentError <= g_Tolerance) && (flippedSigns == 0);
+		std::cout << "SELFTEST: normals | " << mesh.name
+			<< " | vertices: " << mesh.nVertices
+			<< " | triangles: " << mesh.indices.size() / 3
+			<< " | normal error: " << normalError
+			<< " | tangent error: " << tangentError
+			<< " | flipped signs: " << flippedSigns
+			<< " | " << ((bPassed == true) ? "passed" : "FAILED") << std::endl;
+		return(bPassed);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This function is used for checking every test mesh, and
+ *  returns whether all of them passed.
+ ***********************************************************/
+bool NormalSelfTest::Run()
+{
+	std::cout << "SELFTEST: normals | lanes: " << NormalGenerator::GetLaneCount() << std::endl;
+
+	TEST_MESH torus;
+	MakeTorus(torus);
+	TEST_MESH grid;
+	MakeGrid(grid);
+
+	bool bPassed = CheckMesh(torus);
+	bPassed = (CheckMesh(grid) == true) && (bPassed == true);
+	return(bPassed);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalselftest.h
+// ============
+// check the SIMD normal and tangent generator against a plain scalar version
+// of the same math
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  NormalSelfTest
+ *
+ *  This function runs the normal generator over a torus
+ *  and a jittered, partly mirrored grid with degenerate
+ *  and invalid triangles, runs a one triangle at a time
+ *  scalar version over the same meshes, and prints the
+ *  largest difference of each mesh.
+ ***********************************************************/
+namespace NormalSelfTest
+{
+	// run all the meshes, which only use the CPU, and return
+	// whether every difference was within the tolerance
+	bool Run();
+}
\ No newline at end of file
@@ -0,0 +1,440 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// rasterize large boxes and planes into a small depth buffer on the CPU, and
+// test the world boxes of the other objects against it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "SimdFloats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// rows of the depth buffer rasterized by one job, a whole
+	// number of tile rows
+	const int g_BandHeight = 16;
+	const int g_BandCount = OcclusionCuller::BUFFER_HEIGHT / g_BandHeight;
+	const int g_TilesX = OcclusionCuller::BUFFER_WIDTH / OcclusionCuller::TILE_SIZE;
+	const int g_TilesY = OcclusionCuller::BUFFER_HEIGHT / OcclusionCuller::TILE_SIZE;
+	// a box is only occluded by depths at least this much
+	// closer than its nearest corner, so the faces of an
+	// occluder never hide its own box through rounding
+	const float g_DepthBias = 1e-5f;
+
+	// x of the pixel centers of the lanes, from the first pixel
+	// of a group
+	const float g_LaneOffsets[8] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+	// lanes of a group as a step between pixel columns
+	const int g_PixelLanes = (int)g_Lanes;
+
+	// row of a column major matrix
+	glm::vec4 GetRow(const glm::mat4& matrix, int row)
+	{
+		return(glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]));
+	}
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class.  Nothing is occluded
+ *  until occluders are rasterized.
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+{
+	m_viewProjection = glm::mat4(1.0f);
+	m_depthPlane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	m_pixelsPerUnit = 0.0f;
+	m_bPerspective = false;
+	m_depth.assign(BUFFER_WIDTH * BUFFER_HEIGHT, FLT_MAX);
+	m_tileMaxDepth.assign(g_TilesX * g_TilesY, FLT_MAX);
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the view the occluders
+ *  are rasterized with, and starting a new list of
+ *  occluders.
+ ***********************************************************/
+void OcclusionCuller::SetView(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_viewProjection = projection * view;
+
+	// the camera looks down the negative Z axis of the view
+	m_depthPlane = -GetRow(view, 2);
+	m_bPerspective = (projection[3][3] != 1.0f);
+	m_pixelsPerUnit = projection[1][1] * 0.5f * (float)BUFFER_HEIGHT;
+
+	m_faces.clear();
+}
+
+/***********************************************************
+ *  GetScreenSize()
+ *
+ *  This method is used for getting the number of depth
+ *  buffer pixels across a bounding sphere.
+ ***********************************************************/
+float OcclusionCuller::GetScreenSize(const glm::vec4& worldSphere) const
+{
+	float size = 2.0f * worldSphere.w * m_pixelsPerUnit;
+	if (m_bPerspective == true)
+	{
+		float depth = glm::dot(glm::vec3(m_depthPlane), glm::vec3(worldSphere)) + m_depthPlane.w;
+		if (depth <= worldSphere.w)
+		{
+			// the camera is inside or close to the sphere
+			return(FLT_MAX);
+		}
+		size /= depth;
+	}
+	return(size);
+}
+
+/***********************************************************
+ *  AddOccluderBox()
+ *
+ *  This method is used for adding the six faces of a
+ *  transformed box mesh.  The faces that point away from
+ *  the camera are added too, which fills the pixels along
+ *  the edges between the faces that point toward it.
+ ***********************************************************/
+void OcclusionCuller::AddOccluderBox(const glm::mat4& world)
+{
+	glm::mat4 transform = m_viewProjection * world;
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 local = glm::vec4(
+			((i & 1) != 0) ? 0.5f : -0.5f,
+			((i & 2) != 0) ? 0.5f : -0.5f,
+			((i & 4) != 0) ? 0.5f : -0.5f,
+			1.0f);
+		corners[i] = transform * local;
+	}
+
+	// corners of each face, in order around it
+	static const int faces[6][4] = {
+		{ 0, 1, 3, 2 }, { 4, 5, 7, 6 },
+		{ 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+		{ 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
+	for (int f = 0; f < 6; f++)
+	{
+		glm::vec4 face[4];
+		for (int c = 0; c < 4; c++)
+		{
+			face[c] = corners[faces[f][c]];
+		}
+		AddFace(face);
+	}
+}
+
+/***********************************************************
+ *  AddOccluderPlane()
+ *
+ *  This method is used for adding a transformed plane mesh.
+ ***********************************************************/
+void OcclusionCuller::AddOccluderPlane(const glm::mat4& world)
+{
+	glm::mat4 transform = m_viewProjection * world;
+	glm::vec4 face[4] = {
+		transform * glm::vec4(-1.0f, 0.0f, -1.0f, 1.0f),
+		transform * glm::vec4(1.0f, 0.0f, -1.0f, 1.0f),
+		transform * glm::vec4(1.0f, 0.0f, 1.0f, 1.0f),
+		transform * glm::vec4(-1.0f, 0.0f, 1.0f, 1.0f) };
+	AddFace(face);
+}
+
+int OcclusionCuller::GetOccluderFaceCount() const
+{
+	return((int)m_faces.size());
+}
+
+/***********************************************************
+ *  AddFace()
+ *
+ *  This method is used for clipping a quad to the near
+ *  plane, projecting it to the depth buffer, and setting
+ *  up its edge functions and depth plane.  Each edge
+ *  function is moved inside by half the pixel it may cross,
+ *  and the depth plane back by the most it changes over
+ *  half a pixel, so they hold for the whole pixel.
+ ***********************************************************/
+void OcclusionCuller::AddFace(const glm::vec4 corners[4])
+{
+	// the near plane keeps z >= -w, which clips the corners
+	// behind the camera too
+	glm::vec4 clipped[5];
+	int nClipped = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec4& a = corners[i];
+		const glm::vec4& b = corners[(i + 1) % 4];
+		float distanceA = a.z + a.w;
+		float distanceB = b.z + b.w;
+		if (distanceA >= 0.0f)
+		{
+			clipped[nClipped++] = a;
+		}
+		if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+		{
+			clipped[nClipped++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+		}
+	}
+	if (nClipped < 3)
+	{
+		return;
+	}
+
+	glm::vec3 screen[5];
+	for (int i = 0; i < nClipped; i++)
+	{
+		float w = std::max(clipped[i].w, 1e-6f);
+		screen[i] = glm::vec3(
+			(clipped[i].x / w * 0.5f + 0.5f) * (float)BUFFER_WIDTH,
+			(clipped[i].y / w * 0.5f + 0.5f) * (float)BUFFER_HEIGHT,
+			clipped[i].z / w);
+	}
+
+	// the fan triangle with the largest area gives the most
+	// precise depth plane
+	float area = 0.0f;
+	int planeCorner = 1;
+	float planeArea = 0.0f;
+	for (int i = 1; i + 1 < nClipped; i++)
+	{
+		glm::vec3 edge1 = screen[i] - screen[0];
+		glm::vec3 edge2 = screen[i + 1] - screen[0];
+		float triangleArea = edge1.x * edge2.y - edge1.y * edge2.x;
+		area += triangleArea;
+		if (std::fabs(triangleArea) > std::fabs(planeArea))
+		{
+			planeArea = triangleArea;
+			planeCorner = i;
+		}
+	}
+	// faces seen edge on cover no pixel
+	if (std::fabs(area) < 1e-6f)
+	{
+		return;
+	}
+
+	FACE face;
+	face.nEdges = nClipped;
+	float orientation = (area > 0.0f) ? 1.0f : -1.0f;
+	glm::vec2 boxMin = glm::vec2(FLT_MAX);
+	glm::vec2 boxMax = glm::vec2(-FLT_MAX);
+	for (int i = 0; i < nClipped; i++)
+	{
+		const glm::vec3& a = screen[i];
+		const glm::vec3& b = screen[(i + 1) % nClipped];
+		float edgeA = (a.y - b.y) * orientation;
+		float edgeB = (b.x - a.x) * orientation;
+		face.edgeA[i] = edgeA;
+		face.edgeB[i] = edgeB;
+		face.edgeC[i] = (a.x * b.y - a.y * b.x) * orientation - 0.5f * (std::fabs(edgeA) + std::fabs(edgeB));
+		boxMin = glm::min(boxMin, glm::vec2(a));
+		boxMax = glm::max(boxMax, glm::vec2(a));
+	}
+
+	glm::vec3 edge1 = screen[planeCorner] - screen[0];
+	glm::vec3 edge2 = screen[planeCorner + 1] - screen[0];
+	glm::vec3 normal = glm::cross(edge1, edge2);
+	face.depthA = -normal.x / normal.z;
+	face.depthB = -normal.y / normal.z;
+	face.depthC = screen[0].z - face.depthA * screen[0].x - face.depthB * screen[0].y +
+		0.5f * (std::fabs(face.depthA) + std::fabs(face.depthB));
+
+	face.minX = std::max((int)std::floor(boxMin.x), 0);
+	face.minY = std::max((int)std::floor(boxMin.y), 0);
+	face.maxX = std::min((int)std::ceil(boxMax.x), BUFFER_WIDTH) - 1;
+	face.maxY = std::min((int)std::ceil(boxMax.y), BUFFER_HEIGHT) - 1;
+	if ((face.minX > face.maxX) || (face.minY > face.maxY))
+	{
+		return;
+	}
+
+	m_faces.push_back(face);
+}
+
+/***********************************************************
+ *  RasterizeOccluders()
+ *
+ *  This method is used for rasterizing the faces of the
+ *  occluders, one band of rows per job.
+ ***********************************************************/
+void OcclusionCuller::RasterizeOccluders()
+{
+	JobSystem::Get().ParallelFor(g_BandCount, [this](size_t band)
+	{
+		RasterizeBand((int)band);
+	});
+}
+
+/***********************************************************
+ *  RasterizeBand()
+ *
+ *  This method is used for rasterizing every face that
+ *  reaches the rows of a band.  A group of pixels of a row
+ *  evaluates the edge functions and the depth plane of all
+ *  its lanes at once, and keeps the closer of the face and
+ *  the buffer where the face covers the pixel.
+ ***********************************************************/
+void OcclusionCuller::RasterizeBand(int band)
+{
+	int firstRow = band * g_BandHeight;
+	int lastRow = firstRow + g_BandHeight - 1;
+	std::fill(m_depth.begin() + firstRow * BUFFER_WIDTH, m_depth.begin() + (lastRow + 1) * BUFFER_WIDTH, FLT_MAX);
+
+	FLOATS laneOffsets = LoadFloats(g_LaneOffsets);
+	FLOATS zero = SetFloats(0.0f);
+	for (size_t f = 0; f < m_faces.size(); f++)
+	{
+		const FACE& face = m_faces[f];
+		int minY = std::max(face.minY, firstRow);
+		int maxY = std::min(face.maxY, lastRow);
+		if (minY > maxY)
+		{
+			continue;
+		}
+
+		FLOATS edgeA[5];
+		for (int e = 0; e < face.nEdges; e++)
+		{
+			edgeA[e] = SetFloats(face.edgeA[e]);
+		}
+		FLOATS depthA = SetFloats(face.depthA);
+		int minX = face.minX - (face.minX % g_PixelLanes);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float centerY = (float)y + 0.5f;
+			float* row = m_depth.data() + y * BUFFER_WIDTH;
+			for (int x = minX; x <= face.maxX; x += g_PixelLanes)
+			{
+				FLOATS centerX = Add(SetFloats((float)x), laneOffsets);
+				FLOATS inside = GreaterEqual(
+					Add(Mul(edgeA[0], centerX), SetFloats(face.edgeB[0] * centerY + face.edgeC[0])), zero);
+				for (int e = 1; e < face.nEdges; e++)
+				{
+					inside = And(inside, GreaterEqual(
+						Add(Mul(edgeA[e], centerX), SetFloats(face.edgeB[e] * centerY + face.edgeC[e])), zero));
+				}
+				if (MaskBits(inside) == 0)
+				{
+					continue;
+				}
+
+				FLOATS depth = Add(Mul(depthA, centerX), SetFloats(face.depthB * centerY + face.depthC));
+				FLOATS current = LoadFloats(row + x);
+				StoreFloats(row + x, Select(inside, Min(current, depth), current));
+			}
+		}
+	}
+
+	// farthest depth of each tile of the band
+	for (int tileY = firstRow / TILE_SIZE; tileY <= lastRow / TILE_SIZE; tileY++)
+	{
+		for (int tileX = 0; tileX < g_TilesX; tileX++)
+		{
+			FLOATS farthest = SetFloats(-FLT_MAX);
+			for (int y = tileY * TILE_SIZE; y < (tileY + 1) * TILE_SIZE; y++)
+			{
+				const float* row = m_depth.data() + y * BUFFER_WIDTH + tileX * TILE_SIZE;
+				for (int x = 0; x < TILE_SIZE; x += g_PixelLanes)
+				{
+					farthest = Max(farthest, LoadFloats(row + x));
+				}
+			}
+			float lanes[8];
+			StoreFloats(lanes, farthest);
+			m_tileMaxDepth[tileY * g_TilesX + tileX] = *std::max_element(lanes, lanes + g_Lanes);
+		}
+	}
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing a world box.  The box
+ *  is occluded when every pixel its corners reach on screen
+ *  is closer than its nearest corner.  Tiles that are
+ *  closer everywhere pass without reading their pixels,
+ *  and the others compare a group of pixels at a time.
+ *  Boxes that cross the near plane are never occluded.
+ ***********************************************************/
+bool OcclusionCuller::IsOccluded(const glm::vec3& center, const glm::vec3& extent) const
+{
+	glm::vec2 boxMin = glm::vec2(FLT_MAX);
+	glm::vec2 boxMax = glm::vec2(-FLT_MAX);
+	float nearest = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = center + glm::vec3(
+			((i & 1) != 0) ? extent.x : -extent.x,
+			((i & 2) != 0) ? extent.y : -extent.y,
+			((i & 4) != 0) ? extent.z : -extent.z);
+		glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+		if ((clip.w <= 0.0f) || (clip.z < -clip.w))
+		{
+			return(false);
+		}
+		glm::vec2 screen = glm::vec2(
+			(clip.x / clip.w * 0.5f + 0.5f) * (float)BUFFER_WIDTH,
+			(clip.y / clip.w * 0.5f + 0.5f) * (float)BUFFER_HEIGHT);
+		boxMin = glm::min(boxMin, screen);
+		boxMax = glm::max(boxMax, screen);
+		nearest = std::min(nearest, clip.z / clip.w);
+	}
+
+	int minX = std::max((int)std::floor(boxMin.x), 0);
+	int minY = std::max((int)std::floor(boxMin.y), 0);
+	int maxX = std::min((int)std::ceil(boxMax.x), BUFFER_WIDTH) - 1;
+	int maxY = std::min((int)std::ceil(boxMax.y), BUFFER_HEIGHT) - 1;
+	if ((minX > maxX) || (minY > maxY))
+	{
+		return(false);
+	}
+
+	float limit = nearest - g_DepthBias;
+	FLOATS limits = SetFloats(limit);
+	FLOATS laneOffsets = LoadFloats(g_LaneOffsets);
+	FLOATS first = SetFloats((float)minX);
+	FLOATS last = SetFloats((float)maxX + 1.0f);
+	for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++)
+		{
+			if (m_tileMaxDepth[tileY * g_TilesX + tileX] < limit)
+			{
+				continue;
+			}
+
+			// pixels of the tile outside the box are masked off
+			// by their x, since the groups start on tile edges
+			int rowStart = std::max(tileY * TILE_SIZE, minY);
+			int rowEnd = std::min((tileY + 1) * TILE_SIZE - 1, maxY);
+			for (int y = rowStart; y <= rowEnd; y++)
+			{
+				const float* row = m_depth.data() + y * BUFFER_WIDTH;
+				for (int x = tileX * TILE_SIZE; x < (tileX + 1) * TILE_SIZE; x += g_PixelLanes)
+				{
+					FLOATS centerX = Add(SetFloats((float)x), laneOffsets);
+					FLOATS inBox = And(GreaterEqual(centerX, first), Less(centerX, last));
+					if (MaskBits(And(inBox, GreaterEqual(LoadFloats(row + x), limits))) != 0)
+					{
+						return(false);
+					}
+				}
+			}
+		}
+	}
+
+	return(true);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// rasterize large boxes and planes into a small depth buffer on the CPU, and
+// test the world boxes of the other objects against it
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class keeps a low resolution depth buffer of the
+ *  occluders of a frame.  Each face of an occluder is
+ *  rasterized as one convex polygon, eight (AVX) or four
+ *  (SSE) pixels at a time, and the rows of the buffer are
+ *  split into bands that are rasterized on the job system.
+ *  A pixel is only written when the face covers all of it,
+ *  with the farthest depth of the face over the pixel, so
+ *  the buffer never hides more than the occluders do.  The
+ *  farthest depth of each tile of pixels lets a box test
+ *  skip the tiles that are closer than the whole box.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	// constructor
+	OcclusionCuller();
+
+	// size of the depth buffer, and of the tiles that keep the
+	// farthest depth of their pixels
+	static const int BUFFER_WIDTH = 256;
+	static const int BUFFER_HEIGHT = 128;
+	static const int TILE_SIZE = 8;
+
+	// set the view of the frame and remove the occluders of
+	// the last frame
+	void SetView(const glm::mat4& view, const glm::mat4& projection);
+
+	// get how many pixels of the depth buffer a bounding
+	// sphere covers, to pick the largest occluders
+	float GetScreenSize(const glm::vec4& worldSphere) const;
+
+	// add the box mesh, from -0.5 to 0.5 along each axis, or
+	// the plane mesh, from -1 to 1 along X and Z, transformed
+	// by the passed in world matrix
+	void AddOccluderBox(const glm::mat4& world);
+	void AddOccluderPlane(const glm::mat4& world);
+	int GetOccluderFaceCount() const;
+
+	// rasterize the occluders that were added
+	void RasterizeOccluders();
+
+	// check whether a world box, given as center and half
+	// size, is behind the occluders at every pixel it covers
+	bool IsOccluded(const glm::vec3& center, const glm::vec3& extent) const;
+
+private:
+	// convex face in screen space.  A pixel is inside when
+	// every edge function is at least 0 over all of the pixel,
+	// and the depth plane gives the farthest depth over it
+	struct FACE
+	{
+		int nEdges;
+		float edgeA[5];
+		float edgeB[5];
+		float edgeC[5];
+		float depthA;
+		float depthB;
+		float depthC;
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+	};
+
+	// clip a quad in clip space to the near plane and add the
+	// face that is left
+	void AddFace(const glm::vec4 corners[4]);
+	// rasterize the faces into the rows of one band, and
+	// update the tiles of the band
+	void RasterizeBand(int band);
+
+	glm::mat4 m_viewProjection;
+	// view depth of a world position, and the pixels across
+	// one world unit at depth 1, or at any depth for
+	// orthographic views
+	glm::vec4 m_depthPlane;
+	float m_pixelsPerUnit;
+	bool m_bPerspective;
+
+	std::vector<FACE> m_faces;
+	// depth of each pixel in normalized device coordinates,
+	// row by row from the bottom, and the farthest depth of
+	// each tile
+	std::vector<float> m_depth;
+	std::vector<float> m_tileMaxDepth;
+};
\ No newline at end of file
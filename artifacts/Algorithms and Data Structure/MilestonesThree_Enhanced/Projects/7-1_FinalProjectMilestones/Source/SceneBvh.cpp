@@ -0,0 +1,892 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the world boxes of the scene objects, for
+// frustum, ray and nearest object queries that do not visit every object
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBvh.h"
+#include "SimdFloats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// centroid bins of the surface area heuristic
+	const int g_BinCount = 16;
+	// below this depth the ranges are split at the median, so
+	// the depth, and with it the traversal stack, stays bounded
+	const int g_MaxSahDepth = 48;
+	// entries of the traversal stacks, enough for the deepest
+	// tree - three entries stay on the stack per level
+	const int g_StackSize = 256;
+
+	float SurfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		glm::vec3 size = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	// distance along a ray, in units of its direction, where
+	// it enters a box, false when it misses the box before
+	// the passed in distance
+	bool RayBox(
+		const glm::vec3& boxMin,
+		const glm::vec3& boxMax,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance,
+		float& distance)
+	{
+		glm::vec3 t1 = (boxMin - origin) * inverseDirection;
+		glm::vec3 t2 = (boxMax - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t1, t2);
+		glm::vec3 tFar = glm::max(t1, t2);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float leave = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		distance = enter;
+		return(enter <= leave);
+	}
+
+	float PointBoxDistanceSquared(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& position)
+	{
+		glm::vec3 offset = glm::max(glm::max(boxMin - position, position - boxMax), glm::vec3(0.0f));
+		return(glm::dot(offset, offset));
+	}
+
+	// sort up to four child slots by their distance
+	void SortSlots(int* slots, const float* distances, int count)
+	{
+		for (int i = 1; i < count; i++)
+		{
+			int slot = slots[i];
+			int j = i - 1;
+			while ((j >= 0) && (distances[slots[j]] > distances[slot]))
+			{
+				slots[j + 1] = slots[j];
+				j--;
+			}
+			slots[j + 1] = slot;
+		}
+	}
+}
+
+/***********************************************************
+ *  SceneBvh()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBvh::SceneBvh()
+{
+	m_itemCount = 0;
+	m_bNeedsBuild = false;
+}
+
+/***********************************************************
+ *  ~SceneBvh()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBvh::~SceneBvh()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  SetItem()
+ *
+ *  This method is used for adding an item, or for moving
+ *  it.  New items wait for the next build, and items that
+ *  are in the tree are refit by the next Refit().  Setting
+ *  the box an item already has does nothing.
+ ***********************************************************/
+void SceneBvh::SetItem(int id, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	if ((id >= 0) && (id < (int)m_items.size()) && (m_items[id].bLive == true) &&
+		(m_items[id].boxMin == boxMin) && (m_items[id].boxMax == boxMax))
+	{
+		return;
+	}
+	if (id >= (int)m_items.size())
+	{
+		BVH_ITEM empty;
+		empty.boxMin = glm::vec3(0.0f);
+		empty.boxMax = glm::vec3(0.0f);
+		empty.node = -1;
+		empty.slot = -1;
+		empty.bLive = false;
+		empty.bMoved = false;
+		m_items.resize(id + 1, empty);
+	}
+
+	BVH_ITEM& item = m_items[id];
+	item.boxMin = boxMin;
+	item.boxMax = boxMax;
+	if (item.bLive == false)
+	{
+		item.bLive = true;
+		item.node = -1;
+		m_itemCount++;
+		m_bNeedsBuild = true;
+	}
+	else if ((item.node >= 0) && (item.bMoved == false))
+	{
+		item.bMoved = true;
+		m_movedItems.push_back(id);
+	}
+}
+
+/***********************************************************
+ *  RemoveItem()
+ *
+ *  This method is used for removing an item, which leaves
+ *  the tree until the next build.  Queries skip it.
+ ***********************************************************/
+void SceneBvh::RemoveItem(int id)
+{
+	if ((id < 0) || (id >= (int)m_items.size()) || (m_items[id].bLive == false))
+	{
+		return;
+	}
+
+	m_items[id].bLive = false;
+	m_itemCount--;
+	m_bNeedsBuild = true;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the items.
+ ***********************************************************/
+void SceneBvh::Clear()
+{
+	m_items.clear();
+	m_nodes.clear();
+	m_leafItems.clear();
+	m_movedItems.clear();
+	m_buildRefs.clear();
+	m_itemCount = 0;
+	m_bNeedsBuild = false;
+}
+
+/***********************************************************
+ *  NeedsBuild()
+ *
+ *  This method is used for checking whether the tree is
+ *  missing added items, or holds removed ones.
+ ***********************************************************/
+bool SceneBvh::NeedsBuild() const
+{
+	return(m_bNeedsBuild);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over all the
+ *  live items, from the root down.
+ ***********************************************************/
+void SceneBvh::Build()
+{
+	m_nodes.clear();
+	m_leafItems.clear();
+	m_movedItems.clear();
+	m_buildRefs.clear();
+	m_bNeedsBuild = false;
+
+	for (int id = 0; id < (int)m_items.size(); id++)
+	{
+		BVH_ITEM& item = m_items[id];
+		item.node = -1;
+		item.slot = -1;
+		item.bMoved = false;
+		if (item.bLive == true)
+		{
+			BUILD_REF ref;
+			ref.boxMin = item.boxMin;
+			ref.boxMax = item.boxMax;
+			ref.centroid = (item.boxMin + item.boxMax) * 0.5f;
+			ref.id = id;
+			m_buildRefs.push_back(ref);
+		}
+	}
+	if (m_buildRefs.empty() == true)
+	{
+		return;
+	}
+
+	m_nodes.reserve(m_buildRefs.size() / 2 + 1);
+	BuildNode(0, (int)m_buildRefs.size(), -1, -1, 0);
+
+	// the leaves refer to the items in the reordered order
+	m_leafItems.resize(m_buildRefs.size());
+	for (size_t i = 0; i < m_buildRefs.size(); i++)
+	{
+		m_leafItems[i] = m_buildRefs[i].id;
+	}
+	m_buildRefs.clear();
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building a node.  The range is
+ *  split in two, then the child range with the largest
+ *  surface area is split again, until there are four
+ *  children or every child is small enough for a leaf.
+ ***********************************************************/
+int SceneBvh::BuildNode(int first, int count, int parent, int parentSlot, int depth)
+{
+	int nodeIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+	m_nodes[nodeIndex].parent = parent;
+	m_nodes[nodeIndex].parentSlot = parentSlot;
+	for (int slot = 0; slot < NODE_WIDTH; slot++)
+	{
+		m_nodes[nodeIndex].child[slot] = -1;
+		m_nodes[nodeIndex].count[slot] = 0;
+		SetSlotBox(nodeIndex, slot, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+	}
+
+	// past the depth limit the range with the most items is
+	// split, so every level at least halves the largest range
+	bool bMedian = (depth >= g_MaxSahDepth);
+	int rangeFirst[NODE_WIDTH];
+	int rangeCount[NODE_WIDTH];
+	int nRanges = 1;
+	rangeFirst[0] = first;
+	rangeCount[0] = count;
+	while (nRanges < NODE_WIDTH)
+	{
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (int r = 0; r < nRanges; r++)
+		{
+			if (rangeCount[r] <= MAX_LEAF_ITEMS)
+			{
+				continue;
+			}
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			GetRangeBox(rangeFirst[r], rangeCount[r], boxMin, boxMax);
+			float area = (bMedian == true) ? (float)rangeCount[r] : SurfaceArea(boxMin, boxMax);
+			if (area > largestArea)
+			{
+				largest = r;
+				largestArea = area;
+			}
+		}
+		if (largest < 0)
+		{
+			break;
+		}
+
+		int nLeft = SplitRange(rangeFirst[largest], rangeCount[largest], bMedian);
+		rangeFirst[nRanges] = rangeFirst[largest] + nLeft;
+		rangeCount[nRanges] = rangeCount[largest] - nLeft;
+		rangeCount[largest] = nLeft;
+		nRanges++;
+	}
+
+	for (int r = 0; r < nRanges; r++)
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		GetRangeBox(rangeFirst[r], rangeCount[r], boxMin, boxMax);
+		SetSlotBox(nodeIndex, r, boxMin, boxMax);
+
+		if (rangeCount[r] <= MAX_LEAF_ITEMS)
+		{
+			m_nodes[nodeIndex].child[r] = rangeFirst[r];
+			m_nodes[nodeIndex].count[r] = rangeCount[r];
+			for (int i = rangeFirst[r]; i < rangeFirst[r] + rangeCount[r]; i++)
+			{
+				m_items[m_buildRefs[i].id].node = nodeIndex;
+				m_items[m_buildRefs[i].id].slot = r;
+			}
+		}
+		else
+		{
+			// the child is built before it is stored, since
+			// building it may move the nodes in memory
+			int child = BuildNode(rangeFirst[r], rangeCount[r], nodeIndex, r, depth + 1);
+			m_nodes[nodeIndex].child[r] = child;
+			m_nodes[nodeIndex].count[r] = 0;
+		}
+	}
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  SplitRange()
+ *
+ *  This method is used for splitting a range of references
+ *  along the longest axis of their centroids.  The
+ *  centroids are sorted into bins, and the split between
+ *  two bins with the lowest surface area cost - the area
+ *  of each side times its number of items - is used.  The
+ *  median is used when all the centroids are in one place,
+ *  or when the best split leaves a side empty.
+ ***********************************************************/
+int SceneBvh::SplitRange(int first, int count, bool bMedian)
+{
+	BUILD_REF* refs = m_buildRefs.data() + first;
+
+	glm::vec3 centroidMin = refs[0].centroid;
+	glm::vec3 centroidMax = refs[0].centroid;
+	for (int i = 1; i < count; i++)
+	{
+		centroidMin = glm::min(centroidMin, refs[i].centroid);
+		centroidMax = glm::max(centroidMax, refs[i].centroid);
+	}
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = 0;
+	if (extent.y > extent[axis])
+	{
+		axis = 1;
+	}
+	if (extent.z > extent[axis])
+	{
+		axis = 2;
+	}
+
+	int nLeft = 0;
+	if ((bMedian == false) && (extent[axis] > 0.0f))
+	{
+		struct BIN
+		{
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			int count;
+		};
+		BIN bins[g_BinCount];
+		for (int b = 0; b < g_BinCount; b++)
+		{
+			bins[b].boxMin = glm::vec3(FLT_MAX);
+			bins[b].boxMax = glm::vec3(-FLT_MAX);
+			bins[b].count = 0;
+		}
+
+		float binScale = (float)g_BinCount / extent[axis];
+		float binOrigin = centroidMin[axis];
+		auto GetBin = [&](const BUILD_REF& ref)
+		{
+			int bin = (int)((ref.centroid[axis] - binOrigin) * binScale);
+			return(std::min(std::max(bin, 0), g_BinCount - 1));
+		};
+		for (int i = 0; i < count; i++)
+		{
+			BIN& bin = bins[GetBin(refs[i])];
+			bin.boxMin = glm::min(bin.boxMin, refs[i].boxMin);
+			bin.boxMax = glm::max(bin.boxMax, refs[i].boxMax);
+			bin.count++;
+		}
+
+		// cost of the right side of every split, swept from
+		// the last bin, then the left side swept from the first
+		float rightCost[g_BinCount];
+		glm::vec3 boxMin = glm::vec3(FLT_MAX);
+		glm::vec3 boxMax = glm::vec3(-FLT_MAX);
+		int nItems = 0;
+		for (int b = g_BinCount - 1; b > 0; b--)
+		{
+			boxMin = glm::min(boxMin, bins[b].boxMin);
+			boxMax = glm::max(boxMax, bins[b].boxMax);
+			nItems += bins[b].count;
+			rightCost[b] = (nItems > 0) ? SurfaceArea(boxMin, boxMax) * (float)nItems : 0.0f;
+		}
+
+		int bestSplit = -1;
+		float bestCost = FLT_MAX;
+		boxMin = glm::vec3(FLT_MAX);
+		boxMax = glm::vec3(-FLT_MAX);
+		nItems = 0;
+		for (int b = 0; b < g_BinCount - 1; b++)
+		{
+			boxMin = glm::min(boxMin, bins[b].boxMin);
+			boxMax = glm::max(boxMax, bins[b].boxMax);
+			nItems += bins[b].count;
+			if ((nItems == 0) || (nItems == count))
+			{
+				continue;
+			}
+			float cost = SurfaceArea(boxMin, boxMax) * (float)nItems + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit >= 0)
+		{
+			BUILD_REF* middle = std::partition(refs, refs + count, [&](const BUILD_REF& ref)
+			{
+				return(GetBin(ref) <= bestSplit);
+			});
+			nLeft = (int)(middle - refs);
+		}
+	}
+
+	if ((nLeft == 0) || (nLeft == count))
+	{
+		nLeft = count / 2;
+		std::nth_element(refs, refs + nLeft, refs + count, [axis](const BUILD_REF& a, const BUILD_REF& b)
+		{
+			return(a.centroid[axis] < b.centroid[axis]);
+		});
+	}
+
+	return(nLeft);
+}
+
+/***********************************************************
+ *  GetRangeBox()
+ *
+ *  This method is used for getting the box around a range
+ *  of references.
+ ***********************************************************/
+void SceneBvh::GetRangeBox(int first, int count, glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	boxMin = glm::vec3(FLT_MAX);
+	boxMax = glm::vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		boxMin = glm::min(boxMin, m_buildRefs[i].boxMin);
+		boxMax = glm::max(boxMax, m_buildRefs[i].boxMax);
+	}
+}
+
+/***********************************************************
+ *  GetSlotBox()
+ *
+ *  This method is used for computing the box of a child
+ *  slot from the current boxes below it.
+ ***********************************************************/
+void SceneBvh::GetSlotBox(int node, int slot, glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	boxMin = glm::vec3(FLT_MAX);
+	boxMax = glm::vec3(-FLT_MAX);
+
+	const BVH_NODE& parent = m_nodes[node];
+	int child = parent.child[slot];
+	if (child < 0)
+	{
+		return;
+	}
+
+	if (parent.count[slot] > 0)
+	{
+		for (int i = child; i < child + parent.count[slot]; i++)
+		{
+			const BVH_ITEM& item = m_items[m_leafItems[i]];
+			boxMin = glm::min(boxMin, item.boxMin);
+			boxMax = glm::max(boxMax, item.boxMax);
+		}
+		return;
+	}
+
+	const BVH_NODE& children = m_nodes[child];
+	for (int i = 0; i < NODE_WIDTH; i++)
+	{
+		if (children.child[i] < 0)
+		{
+			continue;
+		}
+		boxMin = glm::min(boxMin, glm::vec3(children.minX[i], children.minY[i], children.minZ[i]));
+		boxMax = glm::max(boxMax, glm::vec3(children.maxX[i], children.maxY[i], children.maxZ[i]));
+	}
+}
+
+/***********************************************************
+ *  SetSlotBox()
+ *
+ *  This method is used for storing the box of a child slot
+ *  in the component arrays of its node.
+ ***********************************************************/
+void SceneBvh::SetSlotBox(int node, int slot, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	BVH_NODE& parent = m_nodes[node];
+	parent.minX[slot] = boxMin.x;
+	parent.minY[slot] = boxMin.y;
+	parent.minZ[slot] = boxMin.z;
+	parent.maxX[slot] = boxMax.x;
+	parent.maxY[slot] = boxMax.y;
+	parent.maxZ[slot] = boxMax.z;
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the boxes above the
+ *  items that moved.  Each item recomputes the box of its
+ *  leaf, then of each node above it, and stops at the
+ *  first box that did not change.  Items that were added
+ *  or removed make this a full build.
+ ***********************************************************/
+void SceneBvh::Refit()
+{
+	if (m_bNeedsBuild == true)
+	{
+		Build();
+		return;
+	}
+
+	for (size_t i = 0; i < m_movedItems.size(); i++)
+	{
+		BVH_ITEM& item = m_items[m_movedItems[i]];
+		item.bMoved = false;
+
+		int node = item.node;
+		int slot = item.slot;
+		while (node >= 0)
+		{
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			GetSlotBox(node, slot, boxMin, boxMax);
+
+			const BVH_NODE& current = m_nodes[node];
+			if ((boxMin == glm::vec3(current.minX[slot], current.minY[slot], current.minZ[slot])) &&
+				(boxMax == glm::vec3(current.maxX[slot], current.maxY[slot], current.maxZ[slot])))
+			{
+				break;
+			}
+			SetSlotBox(node, slot, boxMin, boxMax);
+
+			slot = current.parentSlot;
+			node = current.parent;
+		}
+	}
+	m_movedItems.clear();
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for collecting the items inside the
+ *  planes.  For each plane the child corners farthest
+ *  along its normal are tested, chosen per axis by the
+ *  sign of the normal, and a child is skipped when that
+ *  corner is behind any plane.
+ ***********************************************************/
+void SceneBvh::QueryFrustum(const glm::vec4 planes[6], std::vector<int>& ids) const
+{
+	ids.clear();
+	if (m_nodes.empty() == true)
+	{
+		return;
+	}
+
+	FLOATS4 planeValues[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			planeValues[p][c] = SetFloats4(planes[p][c]);
+		}
+	}
+	FLOATS4 zero = SetFloats4(0.0f);
+
+	int stack[g_StackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--top]];
+
+		FLOATS4 outside = Less(zero, zero);
+		for (int p = 0; p < 6; p++)
+		{
+			const float* x = (planes[p].x > 0.0f) ? node.maxX : node.minX;
+			const float* y = (planes[p].y > 0.0f) ? node.maxY : node.minY;
+			const float* z = (planes[p].z > 0.0f) ? node.maxZ : node.minZ;
+			FLOATS4 distance = Add(
+				Add(Mul(planeValues[p][0], LoadFloats4(x)), Mul(planeValues[p][1], LoadFloats4(y))),
+				Add(Mul(planeValues[p][2], LoadFloats4(z)), planeValues[p][3]));
+			outside = Or(outside, Less(distance, zero));
+		}
+		int outsideBits = MaskBits(outside);
+
+		for (int slot = 0; slot < NODE_WIDTH; slot++)
+		{
+			int child = node.child[slot];
+			if ((child < 0) || (((outsideBits >> slot) & 1) != 0))
+			{
+				continue;
+			}
+			if (node.count[slot] == 0)
+			{
+				stack[top++] = child;
+				continue;
+			}
+
+			// the items of a leaf are tested one at a time
+			for (int i = child; i < child + node.count[slot]; i++)
+			{
+				const BVH_ITEM& item = m_items[m_leafItems[i]];
+				if (item.bLive == false)
+				{
+					continue;
+				}
+				bool bOutside = false;
+				for (int p = 0; (p < 6) && (bOutside == false); p++)
+				{
+					glm::vec3 corner = glm::vec3(
+						(planes[p].x > 0.0f) ? item.boxMax.x : item.boxMin.x,
+						(planes[p].y > 0.0f) ? item.boxMax.y : item.boxMin.y,
+						(planes[p].z > 0.0f) ? item.boxMax.z : item.boxMin.z);
+					bOutside = (glm::dot(glm::vec3(planes[p]), corner) + planes[p].w < 0.0f);
+				}
+				if (bOutside == false)
+				{
+					ids.push_back(m_leafItems[i]);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RayCast()
+ *
+ *  This method is used for finding the first item box
+ *  along a ray.  The slab test runs on the four children
+ *  at once, the children that are hit are visited nearest
+ *  first, and nodes that start beyond the nearest hit so
+ *  far are skipped when they come off the stack.
+ ***********************************************************/
+int SceneBvh::RayCast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance) const
+{
+	hitDistance = maxDistance;
+	if (m_nodes.empty() == true)
+	{
+		return(-1);
+	}
+
+	// axis parallel rays divide by a tiny value instead of
+	// zero, which keeps the slabs free of NaN
+	glm::vec3 inverseDirection;
+	for (int c = 0; c < 3; c++)
+	{
+		float value = direction[c];
+		if (std::fabs(value) < 1e-20f)
+		{
+			value = (value < 0.0f) ? -1e-20f : 1e-20f;
+		}
+		inverseDirection[c] = 1.0f / value;
+	}
+	FLOATS4 originX = SetFloats4(origin.x);
+	FLOATS4 originY = SetFloats4(origin.y);
+	FLOATS4 originZ = SetFloats4(origin.z);
+	FLOATS4 inverseX = SetFloats4(inverseDirection.x);
+	FLOATS4 inverseY = SetFloats4(inverseDirection.y);
+	FLOATS4 inverseZ = SetFloats4(inverseDirection.z);
+	FLOATS4 zero = SetFloats4(0.0f);
+
+	int hitItem = -1;
+	int stack[g_StackSize];
+	float stackDistances[g_StackSize];
+	int top = 0;
+	stack[top] = 0;
+	stackDistances[top] = 0.0f;
+	top++;
+	while (top > 0)
+	{
+		top--;
+		if (stackDistances[top] > hitDistance)
+		{
+			continue;
+		}
+		const BVH_NODE& node = m_nodes[stack[top]];
+
+		FLOATS4 x1 = Mul(Sub(LoadFloats4(node.minX), originX), inverseX);
+		FLOATS4 x2 = Mul(Sub(LoadFloats4(node.maxX), originX), inverseX);
+		FLOATS4 y1 = Mul(Sub(LoadFloats4(node.minY), originY), inverseY);
+		FLOATS4 y2 = Mul(Sub(LoadFloats4(node.maxY), originY), inverseY);
+		FLOATS4 z1 = Mul(Sub(LoadFloats4(node.minZ), originZ), inverseZ);
+		FLOATS4 z2 = Mul(Sub(LoadFloats4(node.maxZ), originZ), inverseZ);
+		FLOATS4 enter = Max(Max(Min(x1, x2), Min(y1, y2)), Max(Min(z1, z2), zero));
+		FLOATS4 leave = Min(Min(Max(x1, x2), Max(y1, y2)), Min(Max(z1, z2), SetFloats4(hitDistance)));
+		int hitBits = MaskBits(LessEqual(enter, leave));
+		float enterDistances[NODE_WIDTH];
+		StoreFloats4(enterDistances, enter);
+
+		int slots[NODE_WIDTH];
+		int nSlots = 0;
+		for (int slot = 0; slot < NODE_WIDTH; slot++)
+		{
+			if ((node.child[slot] >= 0) && (((hitBits >> slot) & 1) != 0))
+			{
+				slots[nSlots++] = slot;
+			}
+		}
+		SortSlots(slots, enterDistances, nSlots);
+
+		// leaves are tested nearest first, and the nodes are
+		// pushed farthest first so the nearest comes off next
+		for (int i = 0; i < nSlots; i++)
+		{
+			int slot = slots[i];
+			if ((node.count[slot] == 0) || (enterDistances[slot] > hitDistance))
+			{
+				continue;
+			}
+			for (int j = node.child[slot]; j < node.child[slot] + node.count[slot]; j++)
+			{
+				const BVH_ITEM& item = m_items[m_leafItems[j]];
+				float distance = 0.0f;
+				if ((item.bLive == true) &&
+					(RayBox(item.boxMin, item.boxMax, origin, inverseDirection, hitDistance, distance) == true) &&
+					((distance < hitDistance) || (hitItem < 0)))
+				{
+					hitDistance = distance;
+					hitItem = m_leafItems[j];
+				}
+			}
+		}
+		for (int i = nSlots - 1; i >= 0; i--)
+		{
+			int slot = slots[i];
+			if (node.count[slot] == 0)
+			{
+				stack[top] = node.child[slot];
+				stackDistances[top] = enterDistances[slot];
+				top++;
+			}
+		}
+	}
+
+	return(hitItem);
+}
+
+/***********************************************************
+ *  FindNearest()
+ *
+ *  This method is used for finding the item box closest to
+ *  a position.  The distances to the four children are
+ *  computed at once, the children are visited nearest
+ *  first, and everything farther than the nearest item so
+ *  far is skipped.
+ ***********************************************************/
+int SceneBvh::FindNearest(
+	const glm::vec3& position,
+	float maxDistance,
+	float& distance) const
+{
+	distance = maxDistance;
+	if (m_nodes.empty() == true)
+	{
+		return(-1);
+	}
+
+	float bestSquared = maxDistance * maxDistance;
+	FLOATS4 positionX = SetFloats4(position.x);
+	FLOATS4 positionY = SetFloats4(position.y);
+	FLOATS4 positionZ = SetFloats4(position.z);
+	FLOATS4 zero = SetFloats4(0.0f);
+
+	int nearestItem = -1;
+	int stack[g_StackSize];
+	float stackDistances[g_StackSize];
+	int top = 0;
+	stack[top] = 0;
+	stackDistances[top] = 0.0f;
+	top++;
+	while (top > 0)
+	{
+		top--;
+		if (stackDistances[top] > bestSquared)
+		{
+			continue;
+		}
+		const BVH_NODE& node = m_nodes[stack[top]];
+
+		FLOATS4 dx = Max(Max(Sub(LoadFloats4(node.minX), positionX), Sub(positionX, LoadFloats4(node.maxX))), zero);
+		FLOATS4 dy = Max(Max(Sub(LoadFloats4(node.minY), positionY), Sub(positionY, LoadFloats4(node.maxY))), zero);
+		FLOATS4 dz = Max(Max(Sub(LoadFloats4(node.minZ), positionZ), Sub(positionZ, LoadFloats4(node.maxZ))), zero);
+		FLOATS4 squared = Add(Add(Mul(dx, dx), Mul(dy, dy)), Mul(dz, dz));
+		int nearBits = MaskBits(LessEqual(squared, SetFloats4(bestSquared)));
+		float squaredDistances[NODE_WIDTH];
+		StoreFloats4(squaredDistances, squared);
+
+		int slots[NODE_WIDTH];
+		int nSlots = 0;
+		for (int slot = 0; slot < NODE_WIDTH; slot++)
+		{
+			if ((node.child[slot] >= 0) && (((nearBits >> slot) & 1) != 0))
+			{
+				slots[nSlots++] = slot;
+			}
+		}
+		SortSlots(slots, squaredDistances, nSlots);
+
+		for (int i = 0; i < nSlots; i++)
+		{
+			int slot = slots[i];
+			if ((node.count[slot] == 0) || (squaredDistances[slot] > bestSquared))
+			{
+				continue;
+			}
+			for (int j = node.child[slot]; j < node.child[slot] + node.count[slot]; j++)
+			{
+				const BVH_ITEM& item = m_items[m_leafItems[j]];
+				if (item.bLive == false)
+				{
+					continue;
+				}
+				float itemSquared = PointBoxDistanceSquared(item.boxMin, item.boxMax, position);
+				if ((itemSquared < bestSquared) || ((itemSquared == bestSquared) && (nearestItem < 0)))
+				{
+					bestSquared = itemSquared;
+					nearestItem = m_leafItems[j];
+				}
+			}
+		}
+		for (int i = nSlots - 1; i >= 0; i--)
+		{
+			int slot = slots[i];
+			if (node.count[slot] == 0)
+			{
+				stack[top] = node.child[slot];
+				stackDistances[top] = squaredDistances[slot];
+				top++;
+			}
+		}
+	}
+
+	if (nearestItem >= 0)
+	{
+		distance = std::sqrt(bestSquared);
+	}
+	return(nearestItem);
+}
+
+/***********************************************************
+ *  GetItemCount()
+ *
+ *  This method is used for getting the number of items.
+ ***********************************************************/
+int SceneBvh::GetItemCount() const
+{
+	return(m_itemCount);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes of
+ *  the last build.
+ ***********************************************************/
+int SceneBvh::GetNodeCount() const
+{
+	return((int)m_nodes.size());
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the world boxes of the scene objects, for
+// frustum, ray and nearest object queries that do not visit every object
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBvh
+ *
+ *  This class keeps items - ids with a world space box -
+ *  in a tree of four-wide nodes.  Each node holds the boxes
+ *  of its four children as one array per component, so a
+ *  query tests all four children with a single instruction
+ *  per component, and queries walk the tree with an
+ *  explicit stack.  The tree is built with the surface area
+ *  heuristic over binned centroids.  Items that move only
+ *  refit the boxes above them, while adding or removing
+ *  items needs a new build.
+ ***********************************************************/
+class SceneBvh
+{
+public:
+	// constructor
+	SceneBvh();
+	// destructor
+	~SceneBvh();
+
+	// children per node, and most items of a leaf
+	static const int NODE_WIDTH = 4;
+	static const int MAX_LEAF_ITEMS = 4;
+
+	// add an item, or set the new box of an item
+	void SetItem(int id, const glm::vec3& boxMin, const glm::vec3& boxMax);
+	// remove an item
+	void RemoveItem(int id);
+	// remove all the items and the tree
+	void Clear();
+
+	// whether items were added or removed since the last build
+	bool NeedsBuild() const;
+	// build the tree over all the items
+	void Build();
+	// bring the boxes above the items that moved up to date
+	void Refit();
+
+	// collect the items whose box is not entirely outside any
+	// of the planes, which point inside
+	void QueryFrustum(const glm::vec4 planes[6], std::vector<int>& ids) const;
+	// get the item whose box the ray enters first within the
+	// passed in distance, -1 when there is none.  The
+	// direction does not need to be normalized, and the hit
+	// distance is in units of its length
+	int RayCast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance) const;
+	// get the item whose box is closest to a position within
+	// the passed in distance, -1 when there is none
+	int FindNearest(
+		const glm::vec3& position,
+		float maxDistance,
+		float& distance) const;
+
+	int GetItemCount() const;
+	int GetNodeCount() const;
+
+private:
+	// box of an item, and the node slot of its leaf
+	struct BVH_ITEM
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		int node;
+		int slot;
+		bool bLive;
+		bool bMoved;
+	};
+
+	// boxes of the four children, one array per component.
+	// A child is an inner node when its count is 0, a leaf
+	// of m_leafItems[child, child + count) otherwise, and an
+	// empty slot, with an inverted box, when child is -1
+	struct BVH_NODE
+	{
+		float minX[NODE_WIDTH];
+		float minY[NODE_WIDTH];
+		float minZ[NODE_WIDTH];
+		float maxX[NODE_WIDTH];
+		float maxY[NODE_WIDTH];
+		float maxZ[NODE_WIDTH];
+		int child[NODE_WIDTH];
+		int count[NODE_WIDTH];
+		int parent;
+		int parentSlot;
+	};
+
+	// item box and centroid while the tree is built
+	struct BUILD_REF
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		glm::vec3 centroid;
+		int id;
+	};
+
+	// build the node over the passed in range of references
+	int BuildNode(int first, int count, int parent, int parentSlot, int depth);
+	// reorder a range of references into two and return the
+	// number of references on the left, splitting at the
+	// median centroid instead of the best binned split when
+	// asked to
+	int SplitRange(int first, int count, bool bMedian);
+	// box around a range of references
+	void GetRangeBox(int first, int count, glm::vec3& boxMin, glm::vec3& boxMax) const;
+	// box around the items or the node of a child slot
+	void GetSlotBox(int node, int slot, glm::vec3& boxMin, glm::vec3& boxMax) const;
+	// store the box of a child slot
+	void SetSlotBox(int node, int slot, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	std::vector<BVH_ITEM> m_items;
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<int> m_leafItems;
+	std::vector<int> m_movedItems;
+	std::vector<BUILD_REF> m_buildRefs;
+	int m_itemCount;
+	bool m_bNeedsBuild;
+};
\ No newline at end of file
@@ -0,0 +1,687 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read scene descriptions - textures, materials, lights, groups and objects -
+// from editable JSON text, or from a compiled binary that is used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "JsonValue.h"
+#include "ShapeMeshes.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+// declaration of global variables
+namespace
+{
+	// "SCNB" read as a little endian number
+	const uint32_t g_SceneMagic = 0x424E4353;
+	const uint32_t g_SceneVersion = 2;
+
+	// shape names of the text form, in MESH_SHAPE order
+	const char* const g_ShapeNames[] = {
+		"box",
+		"cone",
+		"cylinder",
+		"plane",
+		"prism",
+		"pyramid3",
+		"pyramid4",
+		"sphere",
+		"tapered_cylinder",
+		"torus"
+	};
+	const int g_ShapeCount = sizeof(g_ShapeNames) / sizeof(g_ShapeNames[0]);
+	static_assert(g_ShapeCount == ShapeMeshes::IMPORTED_MESH, "every built-in shape needs a name");
+
+	/***********************************************************
+	 *  ReadFloats()
+	 *
+	 *  Copy the numbers of a JSON array member into the passed
+	 *  in floats.  Missing members and elements keep the
+	 *  values the floats already have.
+	 ***********************************************************/
+	void ReadFloats(const JsonValue& object, const char* key, float* values, int count)
+	{
+		const JsonValue* array = object.Find(key);
+		if ((array == NULL) || (array->GetType() != JsonValue::JSON_ARRAY))
+		{
+			return;
+		}
+
+		for (int i = 0; (i < count) && (i < (int)array->GetSize()); i++)
+		{
+			values[i] = (float)array->GetElement(i).GetNumber((double)values[i]);
+		}
+	}
+
+	// string member of an object, empty when it is missing
+	std::string ReadString(const JsonValue& object, const char* key)
+	{
+		const JsonValue* value = object.Find(key);
+		if ((value == NULL) || (value->GetType() != JsonValue::JSON_STRING))
+		{
+			return(std::string());
+		}
+		return(value->GetString());
+	}
+
+	// array member of an object, NULL when it is missing
+	const JsonValue* FindArray(const JsonValue& object, const char* key)
+	{
+		const JsonValue* value = object.Find(key);
+		if ((value == NULL) || (value->GetType() != JsonValue::JSON_ARRAY))
+		{
+			return(NULL);
+		}
+		return(value);
+	}
+
+	/***********************************************************
+	 *  StringTable
+	 *
+	 *  Collects the strings of a scene being compiled, storing
+	 *  each distinct string once.  Offset 0 is the empty
+	 *  string.
+	 ***********************************************************/
+	class StringTable
+	{
+	public:
+		StringTable()
+		{
+			m_bytes.push_back('\0');
+		}
+
+		uint32_t Add(const std::string& text)
+		{
+			if (text.empty() == true)
+			{
+				return(0);
+			}
+
+			std::map<std::string, uint32_t>::const_iterator found = m_offsets.find(text);
+			if (found != m_offsets.end())
+			{
+				return(found->second);
+			}
+
+			uint32_t offset = (uint32_t)m_bytes.size();
+			m_bytes.insert(m_bytes.end(), text.begin(), text.end());
+			m_bytes.push_back('\0');
+			m_offsets[text] = offset;
+			return(offset);
+		}
+
+		const std::vector<char>& GetBytes() const
+		{
+			return(m_bytes);
+		}
+
+	private:
+		std::vector<char> m_bytes;
+		std::map<std::string, uint32_t> m_offsets;
+	};
+
+	// append records to the compiled scene, starting on a 4 byte
+	// boundary, and return their section
+	template <typename T>
+	SceneFile::SCENE_SECTION AppendSection(
+		std::vector<unsigned char>& image,
+		const T* records,
+		size_t count)
+	{
+		image.resize((image.size() + 3) & ~(size_t)3);
+
+		SceneFile::SCENE_SECTION section;
+		section.offset = (uint32_t)image.size();
+		section.count = (uint32_t)count;
+		if (count > 0)
+		{
+			const unsigned char* bytes = (const unsigned char*)records;
+			image.insert(image.end(), bytes, bytes + count * sizeof(T));
+		}
+		return(section);
+	}
+
+	// check that a section lies inside the image
+	bool IsSectionValid(const SceneFile::SCENE_SECTION& section, size_t recordSize, size_t size)
+	{
+		return(((section.offset & 3) == 0) &&
+			(section.offset <= size) &&
+			((size_t)section.count <= (size - section.offset) / recordSize));
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_data = NULL;
+	m_header = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene file.  Binary
+ *  files stay mapped and their records are only checked,
+ *  never parsed or copied.  Any other file is compiled from
+ *  its JSON text.
+ ***********************************************************/
+bool SceneFile::Load(const char* filename)
+{
+	Close();
+
+	if (m_file.Open(filename) == false)
+	{
+		std::cout << "Could not open scene file: " << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* data = m_file.GetData();
+	size_t size = m_file.GetSize();
+	uint32_t magic = 0;
+	if (size >= sizeof(magic))
+	{
+		memcpy(&magic, data, sizeof(magic));
+	}
+
+	if (magic == g_SceneMagic)
+	{
+		if (SetImage(data, size) == false)
+		{
+			std::cout << "Invalid binary scene file: " << filename << std::endl;
+			Close();
+			return(false);
+		}
+		return(true);
+	}
+
+	std::string error;
+	bool bCompiled = Compile((const char*)data, size, error);
+	m_file.Close();
+	if (bCompiled == false)
+	{
+		std::cout << "Could not compile scene file: " << filename
+			<< " (" << error << ")" << std::endl;
+		Close();
+		return(false);
+	}
+
+	return(SetImage(m_compiled.data(), m_compiled.size()));
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the loaded scene as a
+ *  binary file, which later loads without compiling.
+ ***********************************************************/
+bool SceneFile::Save(const char* filename) const
+{
+	if (NULL == m_header)
+	{
+		return(false);
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not write scene file: " << filename << std::endl;
+		return(false);
+	}
+	file.write((const char*)m_data, (std::streamsize)m_header->size);
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for releasing the scene.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	m_file.Close();
+	m_compiled.clear();
+	m_compiled.shrink_to_fit();
+	m_data = NULL;
+	m_header = NULL;
+}
+
+/***********************************************************
+ *  SetImage()
+ *
+ *  This method is used for checking a compiled scene before
+ *  it is used.  Every section must lie in the image, and
+ *  every index and string offset of the records must be in
+ *  range, so the records can be used without checks.
+ ***********************************************************/
+bool SceneFile::SetImage(const unsigned char* data, size_t size)
+{
+	if (size < sizeof(SCENE_HEADER))
+	{
+		return(false);
+	}
+
+	const SCENE_HEADER* header = (const SCENE_HEADER*)data;
+	if ((header->magic != g_SceneMagic) ||
+		(header->version != g_SceneVersion) ||
+		(header->size > size) ||
+		(header->size < sizeof(SCENE_HEADER)))
+	{
+		return(false);
+	}
+
+	size = header->size;
+	if ((IsSectionValid(header->textures, sizeof(SCENE_TEXTURE), size) == false) ||
+		(IsSectionValid(header->materials, sizeof(SCENE_MATERIAL), size) == false) ||
+		(IsSectionValid(header->lights, sizeof(SCENE_LIGHT), size) == false) ||
+		(IsSectionValid(header->groups, sizeof(SCENE_GROUP), size) == false) ||
+		(IsSectionValid(header->objects, sizeof(SCENE_OBJECT), size) == false) ||
+		(header->strings.offset > size) ||
+		(header->strings.count > size - header->strings.offset) ||
+		(header->strings.count == 0) ||
+		(data[header->strings.offset + header->strings.count - 1] != '\0'))
+	{
+		return(false);
+	}
+
+	const SCENE_TEXTURE* textures = (const SCENE_TEXTURE*)(data + header->textures.offset);
+	for (uint32_t i = 0; i < header->textures.count; i++)
+	{
+		if ((textures[i].filename >= header->strings.count) ||
+			(textures[i].tag >= header->strings.count))
+		{
+			return(false);
+		}
+	}
+
+	const SCENE_MATERIAL* materials = (const SCENE_MATERIAL*)(data + header->materials.offset);
+	for (uint32_t i = 0; i < header->materials.count; i++)
+	{
+		if (materials[i].tag >= header->strings.count)
+		{
+			return(false);
+		}
+	}
+
+	// parents before children, so the groups can be created
+	// in order
+	const SCENE_GROUP* groups = (const SCENE_GROUP*)(data + header->groups.offset);
+	for (uint32_t i = 0; i < header->groups.count; i++)
+	{
+		if (groups[i].parent >= (int32_t)i)
+		{
+			return(false);
+		}
+	}
+
+	const SCENE_OBJECT* objects = (const SCENE_OBJECT*)(data + header->objects.offset);
+	for (uint32_t i = 0; i < header->objects.count; i++)
+	{
+		const SCENE_OBJECT& object = objects[i];
+		if ((object.shape >= (uint32_t)g_ShapeCount) ||
+			(object.group >= (int32_t)header->groups.count) ||
+			(object.texture >= (int32_t)header->textures.count) ||
+			(object.material >= (int32_t)header->materials.count))
+		{
+			return(false);
+		}
+	}
+
+	m_data = data;
+	m_header = header;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for compiling the JSON text of a
+ *  scene.  Objects refer to textures and materials by tag
+ *  and to groups by name, which become indices, and the
+ *  strings are collected into the string section.
+ ***********************************************************/
+bool SceneFile::Compile(const char* text, size_t length, std::string& error)
+{
+	JsonValue root;
+	if (JsonValue::Parse(text, length, root, error) == false)
+	{
+		return(false);
+	}
+	if (root.GetType() != JsonValue::JSON_OBJECT)
+	{
+		error = "the scene is not a JSON object";
+		return(false);
+	}
+
+	StringTable strings;
+	std::map<std::string, int32_t> textureIndices;
+	std::map<std::string, int32_t> materialIndices;
+	std::map<std::string, int32_t> groupIndices;
+
+	std::vector<SCENE_TEXTURE> textures;
+	const JsonValue* array = FindArray(root, "textures");
+	for (size_t i = 0; (array != NULL) && (i < array->GetSize()); i++)
+	{
+		const JsonValue& json = array->GetElement(i);
+		SCENE_TEXTURE texture;
+		std::string tag = ReadString(json, "tag");
+		texture.filename = strings.Add(ReadString(json, "file"));
+		texture.tag = strings.Add(tag);
+		textureIndices[tag] = (int32_t)textures.size();
+		textures.push_back(texture);
+	}
+
+	std::vector<SCENE_MATERIAL> materials;
+	array = FindArray(root, "materials");
+	for (size_t i = 0; (array != NULL) && (i < array->GetSize()); i++)
+	{
+		const JsonValue& json = array->GetElement(i);
+		SCENE_MATERIAL material;
+		memset(&material, 0, sizeof(material));
+		std::string tag = ReadString(json, "tag");
+		material.tag = strings.Add(tag);
+		ReadFloats(json, "ambientColor", material.ambientColor, 3);
+		material.ambientStrength = (float)json.GetNumber("ambientStrength", 0.0);
+		ReadFloats(json, "diffuseColor", material.diffuseColor, 3);
+		ReadFloats(json, "specularColor", material.specularColor, 3);
+		material.shininess = (float)json.GetNumber("shininess", 0.0);
+		materialIndices[tag] = (int32_t)materials.size();
+		materials.push_back(material);
+	}
+
+	std::vector<SCENE_LIGHT> lights;
+	array = FindArray(root, "lights");
+	for (size_t i = 0; (array != NULL) && (i < array->GetSize()); i++)
+	{
+		const JsonValue& json = array->GetElement(i);
+		SCENE_LIGHT light;
+		memset(&light, 0, sizeof(light));
+		ReadFloats(json, "position", light.position, 3);
+		ReadFloats(json, "ambientColor", light.ambientColor, 3);
+		ReadFloats(json, "diffuseColor", light.diffuseColor, 3);
+		ReadFloats(json, "specularColor", light.specularColor, 3);
+		light.focalStrength = (float)json.GetNumber("focalStrength", 0.0);
+		light.specularIntensity = (float)json.GetNumber("specularIntensity", 0.0);
+		light.range = (float)json.GetNumber("range", 0.0);
+		lights.push_back(light);
+	}
+
+	std::vector<SCENE_GROUP> groups;
+	array = FindArray(root, "groups");
+	for (size_t i = 0; (array != NULL) && (i < array->GetSize()); i++)
+	{
+		const JsonValue& json = array->GetElement(i);
+		SCENE_GROUP group;
+		memset(&group, 0, sizeof(group));
+		group.parent = -1;
+		std::string parent = ReadString(json, "parent");
+		if (parent.empty() == false)
+		{
+			std::map<std::string, int32_t>::const_iterator found = groupIndices.find(parent);
+			if (found == groupIndices.end())
+			{
+				error = "group " + ReadString(json, "name") + " comes before its parent " + parent;
+				return(false);
+			}
+			group.parent = found->second;
+		}
+		ReadFloats(json, "position", group.position, 3);
+		groupIndices[ReadString(json, "name")] = (int32_t)groups.size();
+		groups.push_back(group);
+	}
+
+	std::vector<SCENE_OBJECT> objects;
+	array = FindArray(root, "objects");
+	if (array != NULL)
+	{
+		objects.reserve(array->GetSize());
+	}
+	for (size_t i = 0; (array != NULL) && (i < array->GetSize()); i++)
+	{
+		const JsonValue& json = array->GetElement(i);
+		SCENE_OBJECT object;
+		memset(&object, 0, sizeof(object));
+
+		std::string shape = ReadString(json, "shape");
+		int shapeIndex = FindShape(shape);
+		if (shapeIndex < 0)
+		{
+			error = "unknown shape " + shape + " of object " + std::to_string(i);
+			return(false);
+		}
+		object.shape = (uint32_t)shapeIndex;
+
+		object.group = -1;
+		std::string group = ReadString(json, "group");
+		if (group.empty() == false)
+		{
+			std::map<std::string, int32_t>::const_iterator found = groupIndices.find(group);
+			if (found == groupIndices.end())
+			{
+				error = "unknown group " + group + " of object " + std::to_string(i);
+				return(false);
+			}
+			object.group = found->second;
+		}
+
+		// textures that are not listed are reported by the
+		// scene manager, like tags without a loaded texture
+		object.texture = -1;
+		std::string texture = ReadString(json, "texture");
+		if (texture.empty() == false)
+		{
+			std::map<std::string, int32_t>::const_iterator found = textureIndices.find(texture);
+			if (found == textureIndices.end())
+			{
+				error = "unknown texture " + texture + " of object " + std::to_string(i);
+				return(false);
+			}
+			object.texture = found->second;
+		}
+
+		object.material = -1;
+		std::string material = ReadString(json, "material");
+		if (material.empty() == false)
+		{
+			std::map<std::string, int32_t>::const_iterator found = materialIndices.find(material);
+			if (found == materialIndices.end())
+			{
+				error = "unknown material " + material + " of object " + std::to_string(i);
+				return(false);
+			}
+			object.material = found->second;
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			object.scale[c] = 1.0f;
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			object.color[c] = 1.0f;
+		}
+		ReadFloats(json, "scale", object.scale, 3);
+		ReadFloats(json, "rotation", object.rotationDegrees, 3);
+		ReadFloats(json, "position", object.position, 3);
+		ReadFloats(json, "color", object.color, 4);
+
+		const JsonValue* bStatic = json.Find("static");
+		if ((bStatic != NULL) && (bStatic->GetBool(false) == true))
+		{
+			object.flags |= STATIC_OBJECT;
+		}
+
+		objects.push_back(object);
+	}
+
+	SCENE_HEADER header;
+	memset(&header, 0, sizeof(header));
+
+	m_compiled.assign(sizeof(SCENE_HEADER), 0);
+	header.magic = g_SceneMagic;
+	header.version = g_SceneVersion;
+	header.textures = AppendSection(m_compiled, textures.data(), textures.size());
+	header.materials = AppendSection(m_compiled, materials.data(), materials.size());
+	header.lights = AppendSection(m_compiled, lights.data(), lights.size());
+	header.groups = AppendSection(m_compiled, groups.data(), groups.size());
+	header.objects = AppendSection(m_compiled, objects.data(), objects.size());
+	header.strings = AppendSection(m_compiled, strings.GetBytes().data(), strings.GetBytes().size());
+	header.size = (uint32_t)m_compiled.size();
+	memcpy(m_compiled.data(), &header, sizeof(header));
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures.
+ ***********************************************************/
+uint32_t SceneFile::GetTextureCount() const
+{
+	return((NULL != m_header) ? m_header->textures.count : 0);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials.
+ ***********************************************************/
+uint32_t SceneFile::GetMaterialCount() const
+{
+	return((NULL != m_header) ? m_header->materials.count : 0);
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+uint32_t SceneFile::GetLightCount() const
+{
+	return((NULL != m_header) ? m_header->lights.count : 0);
+}
+
+/***********************************************************
+ *  GetGroupCount()
+ *
+ *  This method is used for getting the number of groups.
+ ***********************************************************/
+uint32_t SceneFile::GetGroupCount() const
+{
+	return((NULL != m_header) ? m_header->groups.count : 0);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects.
+ ***********************************************************/
+uint32_t SceneFile::GetObjectCount() const
+{
+	return((NULL != m_header) ? m_header->objects.count : 0);
+}
+
+/***********************************************************
+ *  GetTextures()
+ *
+ *  This method is used for getting the texture records.
+ ***********************************************************/
+const SceneFile::SCENE_TEXTURE* SceneFile::GetTextures() const
+{
+	return((NULL != m_header) ? (const SCENE_TEXTURE*)(m_data + m_header->textures.offset) : NULL);
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method is used for getting the material records.
+ ***********************************************************/
+const SceneFile::SCENE_MATERIAL* SceneFile::GetMaterials() const
+{
+	return((NULL != m_header) ? (const SCENE_MATERIAL*)(m_data + m_header->materials.offset) : NULL);
+}
+
+/***********************************************************
+ *  GetLights()
+ *
+ *  This method is used for getting the light records.
+ ***********************************************************/
+const SceneFile::SCENE_LIGHT* SceneFile::GetLights() const
+{
+	return((NULL != m_header) ? (const SCENE_LIGHT*)(m_data + m_header->lights.offset) : NULL);
+}
+
+/***********************************************************
+ *  GetGroups()
+ *
+ *  This method is used for getting the group records.
+ ***********************************************************/
+const SceneFile::SCENE_GROUP* SceneFile::GetGroups() const
+{
+	return((NULL != m_header) ? (const SCENE_GROUP*)(m_data + m_header->groups.offset) : NULL);
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method is used for getting the object records.
+ ***********************************************************/
+const SceneFile::SCENE_OBJECT* SceneFile::GetObjects() const
+{
+	return((NULL != m_header) ? (const SCENE_OBJECT*)(m_data + m_header->objects.offset) : NULL);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string of the string
+ *  section by its offset.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+	if ((NULL == m_header) || (offset >= m_header->strings.count))
+	{
+		return("");
+	}
+	return((const char*)(m_data + m_header->strings.offset + offset));
+}
+
+/***********************************************************
+ *  FindShape()
+ *
+ *  This method is used for getting the shape of a shape
+ *  name of the text form.
+ ***********************************************************/
+int SceneFile::FindShape(const std::string& name)
+{
+	for (int i = 0; i < g_ShapeCount; i++)
+	{
+		if (name.compare(g_ShapeNames[i]) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read scene descriptions - textures, materials, lights, groups and objects -
+// from editable JSON text, or from a compiled binary that is used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class holds a scene description in its compiled
+ *  binary form - a header, one array of fixed size records
+ *  per section, and a block of null terminated strings.
+ *  Records refer to strings and to each other with offsets
+ *  and indices instead of pointers, so a binary file is
+ *  mapped and read in place without any parsing.  Text
+ *  files are compiled into the same form in memory when
+ *  they are loaded, and can be saved as binary files.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// offset and number of records of a section
+	struct SCENE_SECTION
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t size;				// bytes of the whole file
+		SCENE_SECTION textures;
+		SCENE_SECTION materials;
+		SCENE_SECTION lights;
+		SCENE_SECTION groups;
+		SCENE_SECTION objects;
+		SCENE_SECTION strings;		// count is the size in bytes
+	};
+
+	// strings are offsets into the string section
+	struct SCENE_TEXTURE
+	{
+		uint32_t filename;
+		uint32_t tag;
+	};
+
+	// the fields of SceneManager::OBJECT_MATERIAL
+	struct SCENE_MATERIAL
+	{
+		uint32_t tag;
+		float ambientColor[3];
+		float ambientStrength;
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+	};
+
+	// the fields of the lights of the shader
+	struct SCENE_LIGHT
+	{
+		float position[3];
+		float ambientColor[3];
+		float diffuseColor[3];
+		float specularColor[3];
+		float focalStrength;
+		float specularIntensity;
+		float range;				// 0 reaches the whole scene
+	};
+
+	// a scene graph node that objects and other groups are
+	// placed relative to.  Parents come before their children
+	struct SCENE_GROUP
+	{
+		int32_t parent;				// group index, -1 for none
+		float position[3];
+	};
+
+	// bits of SCENE_OBJECT::flags
+	enum OBJECT_FLAG
+	{
+		STATIC_OBJECT = 0x01
+	};
+
+	struct SCENE_OBJECT
+	{
+		uint32_t shape;				// ShapeMeshes::MESH_SHAPE
+		int32_t group;				// group index, -1 for none
+		int32_t texture;			// texture index, -1 for a flat color
+		int32_t material;			// material index, -1 for none
+		float scale[3];
+		float rotationDegrees[3];
+		float position[3];
+		float color[4];
+		uint32_t flags;
+	};
+
+	// load a binary file, or compile a text file, depending on
+	// the first bytes of the file
+	bool Load(const char* filename);
+	// write the compiled scene as a binary file
+	bool Save(const char* filename) const;
+	// release the scene
+	void Close();
+
+	uint32_t GetTextureCount() const;
+	uint32_t GetMaterialCount() const;
+	uint32_t GetLightCount() const;
+	uint32_t GetGroupCount() const;
+	uint32_t GetObjectCount() const;
+
+	const SCENE_TEXTURE* GetTextures() const;
+	const SCENE_MATERIAL* GetMaterials() const;
+	const SCENE_LIGHT* GetLights() const;
+	const SCENE_GROUP* GetGroups() const;
+	const SCENE_OBJECT* GetObjects() const;
+
+	// string at an offset of the string section
+	const char* GetString(uint32_t offset) const;
+
+	// number of the shape with the passed in name, such as
+	// "box", -1 when there is no such shape
+	static int FindShape(const std::string& name);
+
+private:
+	// scenes cannot be copied, since they may be mapped
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+
+	// check and use a compiled scene
+	bool SetImage(const unsigned char* data, size_t size);
+	// compile JSON text into m_compiled
+	bool Compile(const char* text, size_t length, std::string& error);
+
+	// the mapped binary file
+	MappedFile m_file;
+	// the compiled text file
+	std::vector<unsigned char> m_compiled;
+	// the scene in use, in either of them
+	const unsigned char* m_data;
+	const SCENE_HEADER* m_header;
+};
\ No newline at end of file
@@ -0,0 +1,349 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// parent-child hierarchy of scene transforms, with cached world matrices
+// that are only recomputed when a node or one of its ancestors changes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+#include "TransformKernel.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_firstDirty = 0;
+}
+
+/***********************************************************
+ *  ~SceneGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneGraph::~SceneGraph()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  CreateNode()
+ *
+ *  This method is used for adding a node with the passed in
+ *  local transform.  Parents that do not exist yet are
+ *  treated as no parent, which keeps the creation order
+ *  valid for the update.
+ ***********************************************************/
+int SceneGraph::CreateNode(
+	int parent,
+	const glm::vec3& position,
+	const glm::quat& rotation,
+	const glm::vec3& scale)
+{
+	int node = (int)m_parents.size();
+	if ((parent < 0) || (parent >= node))
+	{
+		parent = -1;
+	}
+
+	m_parents.push_back(parent);
+	for (int i = 0; i < LOCAL_COMPONENT_COUNT; i++)
+	{
+		m_local[i].push_back(0.0f);
+	}
+	m_dirty.push_back(0);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_normalMatrices.push_back(glm::mat3(1.0f));
+	m_worldScales.push_back(1.0f);
+
+	SetLocalTransform(node, position, rotation, scale);
+	return(node);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the nodes.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	for (int i = 0; i < LOCAL_COMPONENT_COUNT; i++)
+	{
+		m_local[i].clear();
+	}
+	m_dirty.clear();
+	m_worldMatrices.clear();
+	m_normalMatrices.clear();
+	m_worldScales.clear();
+	m_firstDirty = 0;
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  This method is used for replacing the whole local
+ *  transform of a node.
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(
+	int node,
+	const glm::vec3& position,
+	const glm::quat& rotation,
+	const glm::vec3& scale)
+{
+	SetLocalPosition(node, position);
+	SetLocalRotation(node, rotation);
+	SetLocalScale(node, scale);
+}
+
+/***********************************************************
+ *  SetLocalPosition()
+ *
+ *  This method is used for moving a node relative to its
+ *  parent.
+ ***********************************************************/
+void SceneGraph::SetLocalPosition(int node, const glm::vec3& position)
+{
+	m_local[POSITION_X][node] = position.x;
+	m_local[POSITION_Y][node] = position.y;
+	m_local[POSITION_Z][node] = position.z;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetLocalRotation()
+ *
+ *  This method is used for rotating a node relative to its
+ *  parent.
+ ***********************************************************/
+void SceneGraph::SetLocalRotation(int node, const glm::quat& rotation)
+{
+	m_local[ROTATION_X][node] = rotation.x;
+	m_local[ROTATION_Y][node] = rotation.y;
+	m_local[ROTATION_Z][node] = rotation.z;
+	m_local[ROTATION_W][node] = rotation.w;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetLocalScale()
+ *
+ *  This method is used for scaling a node, which also
+ *  scales its children.
+ ***********************************************************/
+void SceneGraph::SetLocalScale(int node, const glm::vec3& scale)
+{
+	m_local[SCALE_X][node] = scale.x;
+	m_local[SCALE_Y][node] = scale.y;
+	m_local[SCALE_Z][node] = scale.z;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a node for the next
+ *  update.  Only the node is flagged here, the update
+ *  passes the flag on to the descendants.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int node)
+{
+	m_dirty[node] = 1;
+	m_firstDirty = std::min(m_firstDirty, node);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for recomputing the world matrices
+ *  of the dirty nodes and their descendants.  Nodes before
+ *  the first dirty node cannot be affected, so the pass
+ *  starts there, and a scene where nothing changed returns
+ *  without touching any node.  The changed nodes are
+ *  gathered first, so the kernel builds all their local
+ *  matrices in one call, and the parents are applied
+ *  afterwards in node order.
+ ***********************************************************/
+int SceneGraph::Update()
+{
+	int nNodes = (int)m_parents.size();
+	if (m_firstDirty >= nNodes)
+	{
+		m_updateNodes.clear();
+		return(0);
+	}
+
+	m_updateNodes.clear();
+	for (int i = m_firstDirty; i < nNodes; i++)
+	{
+		int parent = m_parents[i];
+		if ((parent >= 0) && (m_dirty[parent] != 0))
+		{
+			m_dirty[i] = 1;
+		}
+		if (m_dirty[i] != 0)
+		{
+			m_updateNodes.push_back(i);
+		}
+	}
+
+	// the flags are cleared after the pass, since children
+	// read the flags of their parents during it
+	std::fill(m_dirty.begin() + m_firstDirty, m_dirty.end(), (unsigned char)0);
+	m_firstDirty = nNodes;
+
+	size_t nUpdated = m_updateNodes.size();
+	for (int c = 0; c < LOCAL_COMPONENT_COUNT; c++)
+	{
+		m_updateLocal[c].resize(nUpdated);
+		for (size_t i = 0; i < nUpdated; i++)
+		{
+			m_updateLocal[c][i] = m_local[c][m_updateNodes[i]];
+		}
+	}
+	m_updateModels.resize(nUpdated * TransformKernel::FLOATS_PER_MODEL_MATRIX);
+	m_updateNormals.resize(nUpdated * TransformKernel::FLOATS_PER_NORMAL_MATRIX);
+
+	TransformKernel::TRANSFORM_ARRAYS transforms;
+	transforms.positionX = m_updateLocal[POSITION_X].data();
+	transforms.positionY = m_updateLocal[POSITION_Y].data();
+	transforms.positionZ = m_updateLocal[POSITION_Z].data();
+	transforms.rotationX = m_updateLocal[ROTATION_X].data();
+	transforms.rotationY = m_updateLocal[ROTATION_Y].data();
+	transforms.rotationZ = m_updateLocal[ROTATION_Z].data();
+	transforms.rotationW = m_updateLocal[ROTATION_W].data();
+	transforms.scaleX = m_updateLocal[SCALE_X].data();
+	transforms.scaleY = m_updateLocal[SCALE_Y].data();
+	transforms.scaleZ = m_updateLocal[SCALE_Z].data();
+	TransformKernel::ComposeTransforms(transforms, nUpdated, m_updateModels.data(), m_updateNormals.data());
+
+	for (size_t i = 0; i < nUpdated; i++)
+	{
+		int node = m_updateNodes[i];
+		int parent = m_parents[node];
+
+		const GLfloat* model = &m_updateModels[i * TransformKernel::FLOATS_PER_MODEL_MATRIX];
+		const GLfloat* normal = &m_updateNormals[i * TransformKernel::FLOATS_PER_NORMAL_MATRIX];
+		glm::mat4 matrix(
+			model[0], model[1], model[2], model[3],
+			model[4], model[5], model[6], model[7],
+			model[8], model[9], model[10], model[11],
+			model[12], model[13], model[14], model[15]);
+		glm::mat3 normalMatrix(
+			normal[0], normal[1], normal[2],
+			normal[4], normal[5], normal[6],
+			normal[8], normal[9], normal[10]);
+
+		// the inverse transpose of a product is the product of
+		// the inverse transposes, in the same order
+		if (parent >= 0)
+		{
+			matrix = m_worldMatrices[parent] * matrix;
+			normalMatrix = m_normalMatrices[parent] * normalMatrix;
+		}
+
+		glm::mat3 axes = glm::mat3(matrix);
+		m_worldMatrices[node] = matrix;
+		m_normalMatrices[node] = normalMatrix;
+		m_worldScales[node] = glm::max(glm::length(axes[0]), glm::max(glm::length(axes[1]), glm::length(axes[2])));
+	}
+
+	return((int)nUpdated);
+}
+
+/***********************************************************
+ *  GetUpdatedNodes()
+ *
+ *  This method is used for getting the nodes whose world
+ *  matrices the last update recomputed.
+ ***********************************************************/
+const std::vector<int>& SceneGraph::GetUpdatedNodes() const
+{
+	return(m_updateNodes);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+int SceneGraph::GetNodeCount() const
+{
+	return((int)m_parents.size());
+}
+
+/***********************************************************
+ *  GetParent()
+ *
+ *  This method is used for getting the parent of a node,
+ *  -1 for root nodes.
+ ***********************************************************/
+int SceneGraph::GetParent(int node) const
+{
+	return(m_parents[node]);
+}
+
+/***********************************************************
+ *  GetWorldMatrix()
+ *
+ *  This method is used for getting the world matrix of a
+ *  node as of the last update.
+ ***********************************************************/
+const glm::mat4& SceneGraph::GetWorldMatrix(int node) const
+{
+	return(m_worldMatrices[node]);
+}
+
+/***********************************************************
+ *  GetWorldMatrices()
+ *
+ *  This method is used for getting the world matrices of
+ *  all the nodes, in node order.
+ ***********************************************************/
+const glm::mat4* SceneGraph::GetWorldMatrices() const
+{
+	return(m_worldMatrices.data());
+}
+
+/***********************************************************
+ *  GetNormalMatrix()
+ *
+ *  This method is used for getting the normal matrix of a
+ *  node as of the last update.
+ ***********************************************************/
+const glm::mat3& SceneGraph::GetNormalMatrix(int node) const
+{
+	return(m_normalMatrices[node]);
+}
+
+/***********************************************************
+ *  GetWorldScale()
+ *
+ *  This method is used for getting the largest axis scale
+ *  of the world matrix of a node.
+ ***********************************************************/
+float SceneGraph::GetWorldScale(int node) const
+{
+	return(m_worldScales[node]);
+}
+
+/***********************************************************
+ *  RotationFromDegrees()
+ *
+ *  This method is used for converting the Euler angles of
+ *  the scene objects to a quaternion.  The model matrix
+ *  applies the Z rotation first, so it is the rightmost.
+ ***********************************************************/
+glm::quat SceneGraph::RotationFromDegrees(
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	return(glm::angleAxis(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f)) *
+		glm::angleAxis(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f)) *
+		glm::angleAxis(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f)));
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// parent-child hierarchy of scene transforms, with cached world matrices
+// that are only recomputed when a node or one of its ancestors changes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class keeps the local translation, rotation and
+ *  scale of every node, and the world matrices made from
+ *  them.  A node is always created after its parent, so one
+ *  pass in creation order visits every parent before its
+ *  children, and the world matrices of all the nodes live
+ *  in one contiguous array that can be uploaded as is.
+ *  Changing a node only marks it dirty, and nodes that are
+ *  not dirty, and have no dirty ancestor, are never
+ *  recomputed.  The local transforms are kept one array per
+ *  component, so the local matrices of all the changed
+ *  nodes are built together by the transform kernel.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+	// destructor
+	~SceneGraph();
+
+	// add a node below the passed in parent, or a root node
+	// when the parent is -1, and return its index
+	int CreateNode(
+		int parent,
+		const glm::vec3& position,
+		const glm::quat& rotation,
+		const glm::vec3& scale);
+	// remove all the nodes
+	void Clear();
+
+	// change the local transform of a node, which marks it
+	// and its descendants for the next update
+	void SetLocalTransform(
+		int node,
+		const glm::vec3& position,
+		const glm::quat& rotation,
+		const glm::vec3& scale);
+	void SetLocalPosition(int node, const glm::vec3& position);
+	void SetLocalRotation(int node, const glm::quat& rotation);
+	void SetLocalScale(int node, const glm::vec3& scale);
+
+	// recompute the world matrices of the changed nodes and
+	// return how many were recomputed
+	int Update();
+	// nodes recomputed by the last update, in node order
+	const std::vector<int>& GetUpdatedNodes() const;
+
+	int GetNodeCount() const;
+	int GetParent(int node) const;
+	// world matrices as of the last update
+	const glm::mat4& GetWorldMatrix(int node) const;
+	const glm::mat4* GetWorldMatrices() const;
+	// inverse transpose of the world matrix, for the normals
+	const glm::mat3& GetNormalMatrix(int node) const;
+	// largest scale of the world matrix axes
+	float GetWorldScale(int node) const;
+
+	// rotation matching the Euler angles of the scene objects,
+	// applied around X, then Y, then Z in the model matrix
+	static glm::quat RotationFromDegrees(
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees);
+
+private:
+	// one array per component of the local transforms, in the
+	// member order of TransformKernel::TRANSFORM_ARRAYS
+	enum LOCAL_COMPONENT
+	{
+		POSITION_X,
+		POSITION_Y,
+		POSITION_Z,
+		ROTATION_X,
+		ROTATION_Y,
+		ROTATION_Z,
+		ROTATION_W,
+		SCALE_X,
+		SCALE_Y,
+		SCALE_Z,
+		LOCAL_COMPONENT_COUNT
+	};
+
+	// mark a node for the next update
+	void MarkDirty(int node);
+
+	std::vector<int> m_parents;
+	std::vector<float> m_local[LOCAL_COMPONENT_COUNT];
+	// set on changed nodes, and on their descendants during
+	// the update
+	std::vector<unsigned char> m_dirty;
+	// lowest dirty node, the node count when nothing changed
+	int m_firstDirty;
+
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<glm::mat3> m_normalMatrices;
+	std::vector<float> m_worldScales;
+
+	// local transforms of the changed nodes, and the matrices
+	// the kernel builds from them, reused between updates
+	std::vector<int> m_updateNodes;
+	std::vector<float> m_updateLocal[LOCAL_COMPONENT_COUNT];
+	std::vector<GLfloat> m_updateModels;
+	std::vector<GLfloat> m_updateNormals;
+};
\ No newline at end of file
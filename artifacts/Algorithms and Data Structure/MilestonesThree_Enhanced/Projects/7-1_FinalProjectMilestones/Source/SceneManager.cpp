@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "JobSystem.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,6 +16,12 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
 
 // declaration of global variables
 namespace
@@ -24,6 +31,72 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_NormalMatrixName = "normalMatrix";
+	const char* g_UseBatchMaterialsName = "bUseBatchMaterials";
+	const char* g_ViewName = "view";
+	const char* g_ImpostorCaptureName = "bImpostorCapture";
+	const char* g_ProjectionName = "projection";
+	const char* g_GBufferPassName = "bGBufferPass";
+
+	// size of the material table in the fragment shader
+	const int g_MaxBatchMaterials = 8;
+	// objects whose bounding sphere covers fewer pixels than
+	// this are culled unless another size is selected
+	const float g_DefaultMinPixels = 1.0f;
+	// boxes and planes whose bounding sphere covers at least
+	// this many pixels of the occlusion depth buffer are
+	// occluders, the largest ones first
+	const float g_MinOccluderPixels = 16.0f;
+	const size_t g_MaxOccluders = 32;
+
+	// scene built by PrepareScene() unless another is selected
+	const char* g_DefaultSceneFile = "../../Utilities/scenes/desk_scene.json";
+
+	// generic attribute slot selecting where the vertex shader
+	// reads vertices, and the values used by the impostors
+	const GLuint g_VertexSourceAttrib = 6;
+	const GLuint g_VertexSourceAttributes = 0;
+	const GLuint g_VertexSourceImpostor = 3;
+	// storage buffer binding of the impostor spheres
+	const GLuint g_ImpostorInstancesBinding = 1;
+	// texture units of the impostor atlas, after the units
+	// of the loaded textures
+	const GLuint g_ImpostorColorUnit = 16;
+	const GLuint g_ImpostorNormalDepthUnit = 17;
+	// texture unit of the static batch lightmap, after the
+	// units of the G-buffer and of the visibility buffer
+	const GLuint g_LightmapUnit = 23;
+	const char* g_UseLightmapName = "bUseLightmap";
+	// surfaces closer than this darken the ambient light of
+	// the lightmap, when ambient occlusion is selected
+	const float g_LightmapOcclusionDistance = 1.0f;
+	// texture unit of the shadow cube maps, after the lightmap
+	const GLuint g_ShadowMapUnit = 24;
+	const char* g_UseShadowsName = "bUseShadows";
+
+	// check whether a world box is on the inner side of all the
+	// planes of a frustum
+	bool IsBoxInside(const glm::vec4 planes[6], const glm::vec3& center, const glm::vec3& extent)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			glm::vec3 normal = glm::vec3(planes[p]);
+			if (glm::dot(normal, center) + planes[p].w + glm::dot(glm::abs(normal), extent) < 0.0f)
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	// last write time of a file, or the default time when it
+	// cannot be read
+	std::filesystem::file_time_type GetFileTime(const char* filename)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(filename, error);
+		return((error) ? std::filesystem::file_time_type() : time);
+	}
 }
 
 /***********************************************************
@@ -43,6 +116,67 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 		m_textureIDs[i].ID = -1;
 	}
 	m_loadedTextures = 0;
+	m_clusteredLights = new ClusteredLights();
+
+	m_staticBatch = new StaticBatch();
+	m_bUseStaticBatching = true;
+	m_sceneGraph = new SceneGraph();
+	m_entities = new EntityStore();
+
+	// full detail until the first view is set
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_viewportHeight = 0;
+	m_cameraPosition = glm::vec3(0.0f);
+
+	m_bUseImpostors = false;
+	m_impostorDistance = 0.0f;
+	m_impostorVao = 0;
+	m_impostorBuffer = 0;
+
+	m_frustumCuller = new FrustumCuller();
+	m_frustumCuller->SetMinPixels(g_DefaultMinPixels);
+	m_bUseCulling = true;
+	m_cullingStats.submitted = 0;
+	m_cullingStats.outsideFrustum = 0;
+	m_cullingStats.tooSmall = 0;
+	m_cullingStats.occluded = 0;
+	m_occlusionCuller = new OcclusionCuller();
+	m_bUseOcclusion = true;
+	m_gpuCuller = new GpuCuller();
+	m_cullProgram = 0;
+	m_bUseGpuCulling = false;
+	m_bGpuDrawsDirty = true;
+	m_bStaticBatchCulled = false;
+	m_depthShaderManager = NULL;
+	m_impostorShaderManager = NULL;
+	m_bUseDepthPrepass = false;
+	m_bDepthOnlyPass = false;
+	m_bDepthPrepassDrawn = false;
+	m_fragmentQuery = 0;
+	m_bCountFragments = false;
+	// the query type needs OpenGL 4.6 or the extension on
+	// the 4.4 context
+	m_bFragmentQuerySupported = (GLEW_VERSION_4_6 == GL_TRUE) || (GLEW_ARB_pipeline_statistics_query == GL_TRUE);
+	m_deferredRenderer = new DeferredRenderer();
+	m_bUseDeferred = false;
+	m_bGBufferPass = false;
+	m_bTranslucentPass = false;
+	m_visibilityBuffer = new VisibilityBuffer();
+	m_bUseVisibilityBuffer = false;
+	m_bVisibilityPass = false;
+	m_lightmapBaker = new LightmapBaker();
+	m_bUseLightmaps = false;
+	m_bLightmapDirty = true;
+	m_shadowMaps = new ShadowMaps();
+	m_bUseShadows = false;
+	m_sceneBvh = new SceneBvh();
+
+	m_sceneFilename = g_DefaultSceneFile;
+	for (int i = 0; i < ShapeMeshes::IMPORTED_MESH; i++)
+	{
+		m_bShapeLoaded[i] = false;
+	}
 }
 
 /***********************************************************
@@ -56,6 +190,62 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_staticBatch;
+	m_staticBatch = NULL;
+	delete m_clusteredLights;
+	m_clusteredLights = NULL;
+	delete m_sceneGraph;
+	m_sceneGraph = NULL;
+	delete m_frustumCuller;
+	m_frustumCuller = NULL;
+	delete m_occlusionCuller;
+	m_occlusionCuller = NULL;
+	delete m_gpuCuller;
+	m_gpuCuller = NULL;
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+		m_cullProgram = 0;
+	}
+	if (m_depthShaderManager != NULL)
+	{
+		glDeleteProgram(m_depthShaderManager->m_programID);
+		delete m_depthShaderManager;
+		m_depthShaderManager = NULL;
+	}
+	if (m_impostorShaderManager != NULL)
+	{
+		glDeleteProgram(m_impostorShaderManager->m_programID);
+		delete m_impostorShaderManager;
+		m_impostorShaderManager = NULL;
+	}
+	if (m_fragmentQuery != 0)
+	{
+		glDeleteQueries(1, &m_fragmentQuery);
+		m_fragmentQuery = 0;
+	}
+	delete m_deferredRenderer;
+	m_deferredRenderer = NULL;
+	delete m_visibilityBuffer;
+	m_visibilityBuffer = NULL;
+	delete m_lightmapBaker;
+	m_lightmapBaker = NULL;
+	delete m_shadowMaps;
+	m_shadowMaps = NULL;
+	delete m_sceneBvh;
+	m_sceneBvh = NULL;
+	delete m_entities;
+	m_entities = NULL;
+	for (size_t i = 0; i < m_impostors.size(); i++)
+	{
+		delete m_impostors[i].atlas;
+	}
+	m_impostors.clear();
+	if (m_impostorVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_impostorVao);
+		glDeleteBuffers(1, &m_impostorBuffer);
+	}
 	// destroy the created OpenGL textures
 	DestroyGLTextures();
 }
@@ -69,11 +259,44 @@ SceneManager::~SceneManager()
  *  the next available texture slot in memory.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+{
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "No free texture slot for image:" << filename << std::endl;
+		return false;
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	if (UploadGLTexture(filename, textureID) == false)
+	{
+		glDeleteTextures(1, &textureID);
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = tag;
+	m_textureIDs[m_loadedTextures].filename = filename;
+	m_textureIDs[m_loadedTextures].fileTime = GetFileTime(filename);
+	m_loadedTextures++;
+
+	return true;
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for decoding an image file into the
+ *  passed in OpenGL texture, replacing its old image and
+ *  mipmaps.  The texture unit bindings must be restored
+ *  with BindGLTextures() afterwards.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(const char* filename, GLuint textureID)
 {
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
@@ -91,7 +314,6 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	{
 		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
 
-		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
 
 		// set the texture wrapping parameters
@@ -110,6 +332,8 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		else
 		{
 			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			stbi_image_free(image);
+			glBindTexture(GL_TEXTURE_2D, 0);
 			return false;
 		}
 
@@ -120,11 +344,6 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
 		return true;
 	}
 
@@ -160,7 +379,7 @@ void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		glDeleteTextures(1, &m_textureIDs[i].ID);
 	}
 }
 
@@ -248,16 +467,36 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 		}
 	}
 
-	return(true);
+	return(bFound);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for getting the index of the defined
+ *  material associated with the passed in tag, -1 when no
+ *  material has the tag.
  ***********************************************************/
-void SceneManager::SetTransformations(
+int SceneManager::FindMaterialIndex(std::string tag)
+{
+	for (int i = 0; i < (int)m_objectMaterials.size(); i++)
+	{
+		if (m_objectMaterials[i].tag.compare(tag) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  CalculateModelMatrix()
+ *
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.
+ ***********************************************************/
+glm::mat4 SceneManager::CalculateModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -283,9 +522,53 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
 
+	return(modelView);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView = CalculateModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		// normals need the inverse transpose to stay perpendicular
+		// to non-uniformly scaled surfaces
+		m_pShaderManager->setMat3Value(g_NormalMatrixName, glm::transpose(glm::inverse(glm::mat3(modelView))));
+	}
+}
+
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting an already calculated
+ *  model matrix, such as a cached scene graph matrix, and
+ *  its normal matrix into the shader.
+ ***********************************************************/
+void SceneManager::SetModelMatrix(
+	const glm::mat4& model,
+	const glm::mat3& normalMatrix)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setMat4Value(g_ModelName, model);
+		m_pShaderManager->setMat3Value(g_NormalMatrixName, normalMatrix);
 	}
 }
 
@@ -375,254 +658,2594 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the material values of
+ *  the defined material at the passed in index into the
+ *  shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int material)
+{
+	if ((NULL == m_pShaderManager) || (material < 0) || (material >= (int)m_objectMaterials.size()))
+	{
+		return;
+	}
 
+	const OBJECT_MATERIAL& values = m_objectMaterials[material];
+	m_pShaderManager->setVec3Value("material.ambientColor", values.ambientColor);
+	m_pShaderManager->setFloatValue("material.ambientStrength", values.ambientStrength);
+	m_pShaderManager->setVec3Value("material.diffuseColor", values.diffuseColor);
+	m_pShaderManager->setVec3Value("material.specularColor", values.specularColor);
+	m_pShaderManager->setFloatValue("material.shininess", values.shininess);
+	// the G-buffer stores the index into the material table
+	m_pShaderManager->setIntValue("materialIndex", material);
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  SetSceneFile()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for selecting the scene file that
+ *  PrepareScene() builds the scene from, keeping the desk
+ *  scene when the name is empty.  Saving the text form of a
+ *  scene as a binary file lets the next run load it without
+ *  compiling.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::SetSceneFile(
+	std::string filename,
+	std::string binaryFilename)
 {
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	if (filename.empty() == false)
+	{
+		m_sceneFilename = filename;
+	}
+	m_sceneBinaryFilename = binaryFilename;
+}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->DrawTorusMesh();
+/***********************************************************
+ *  SetStaticBatching()
+ *
+ *  This method is used for selecting whether the static
+ *  objects are drawn from the static batch, or with one
+ *  draw call per object like the dynamic objects.
+ ***********************************************************/
+void SceneManager::SetStaticBatching(bool bEnable)
+{
+	m_bUseStaticBatching = bEnable;
+}
 
-	CreateGLTexture("../../Utilities/textures/knife_handle.jpg","tabletop");
-	CreateGLTexture("../../Utilities/textures/abstract.jpg", "lampshade");
-	CreateGLTexture("../../Utilities/textures/tilesf2.jpg", "lampbase");
-	CreateGLTexture("../../Utilities/textures/backdrop.jpg", "background");
-	CreateGLTexture("../../Utilities/textures/cheese_wheel.jpg", "book");
-	CreateGLTexture("../../Utilities/textures/gold-seamless-texture.jpg", "cup");
-	CreateGLTexture("../../Utilities/textures/stainless.jpg", "laptopscreen");
-	
+/***********************************************************
+ *  SetVertexFetch()
+ *
+ *  This method is used for selecting how the vertices of
+ *  the meshes are fetched.  The meshes are loaded with the
+ *  selected path, so it must be called before the scene is
+ *  prepared.
+ ***********************************************************/
+void SceneManager::SetVertexFetch(ShapeMeshes::VERTEX_FETCH fetch)
+{
+	m_basicMeshes->SetVertexFetch(fetch);
+}
 
+/***********************************************************
+ *  SetSceneView()
+ *
+ *  This method is used for setting the view and projection
+ *  of the current frame.  They are used to estimate the
+ *  screen size of each object, so its mesh is drawn at the
+ *  coarsest level of detail that is not visibly different.
+ ***********************************************************/
+void SceneManager::SetSceneView(
+	glm::mat4 view,
+	glm::mat4 projection,
+	int viewportHeight)
+{
+	m_view = view;
+	m_projection = projection;
+	m_viewportHeight = viewportHeight;
+	m_cameraPosition = glm::vec3(glm::inverse(view)[3]);
+	m_frustumCuller->SetView(view, projection, viewportHeight);
+}
 
-	BindGLTextures();
+/***********************************************************
+ *  SetImpostors()
+ *
+ *  This method is used for selecting whether distant objects
+ *  are drawn as impostors.  The atlas of an impostor is
+ *  captured the first time an object that looks like it is
+ *  beyond the distance, and shared by all such objects.
+ ***********************************************************/
+void SceneManager::SetImpostors(bool bEnable, float distance)
+{
+	m_bUseImpostors = bEnable;
+	m_impostorDistance = distance;
 }
 
 /***********************************************************
- *  RenderScene()
+ *  SetCulling()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for selecting whether the objects
+ *  are tested against the view before they are drawn, and
+ *  the smallest size on screen of the objects that are
+ *  kept, 0 to keep objects of any size.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::SetCulling(bool bEnable, float minPixels)
 {
-	// Define lighting properties
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	glassMaterial.ambientStrength = 0.3f;
-	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
-	glassMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	glassMaterial.shininess = 85.0;
-	glassMaterial.tag = "glass";
-
-	m_objectMaterials.push_back(glassMaterial);
-
-	OBJECT_MATERIAL backdropMaterial;
-	backdropMaterial.ambientColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	backdropMaterial.ambientStrength = 0.6f;
-	backdropMaterial.diffuseColor = glm::vec3(0.6f, 0.5f, 0.1f);
-	backdropMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	backdropMaterial.shininess = 0.0;
-	backdropMaterial.tag = "backdrop";
-
-	// Send lighting information to the shader
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseCulling = bEnable;
+	m_frustumCuller->SetMinPixels(minPixels);
+}
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", -3.0f, 4.0f, 6.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.5f, 0.5f, 0.5f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.2f);
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// Set the XYZ scale for the desk top
-	scaleXYZ = glm::vec3(5.0f, 0.2f, 2.0f); // Thin tabletop
-
-	// Set the XYZ rotation for the desk top
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// Set the height for the tabletop
-	float tabletopHeight = 10.0f; // Height for the tabletop
-	positionXYZ = glm::vec3(0.0f, tabletopHeight / 2.0f, 5.f); // Positioned above ground
-
-	// Set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for selecting whether the objects
+ *  kept by the view test are also tested against the
+ *  occlusion depth buffer.
+ ***********************************************************/
+void SceneManager::SetOcclusionCulling(bool bEnable)
+{
+	m_bUseOcclusion = bEnable;
+}
 
-	//SetShaderColor(0.7f, 0.6f, 0.5f, 1.0f); // Light brown for the wood top
-	SetShaderTexture("tabletop");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawBoxMesh(); // Draw the tabletop
-	/******************************************************************/
+/***********************************************************
+ *  SetGpuCulling()
+ *
+ *  This method is used for selecting whether the static
+ *  batch entries are tested against the view in a compute
+ *  shader.  The CPU path is kept when the context has no
+ *  compute shaders or the shader does not load.
+ ***********************************************************/
+void SceneManager::SetGpuCulling(bool bEnable)
+{
+	m_bUseGpuCulling = bEnable;
+}
 
-	// Draw the lamp base
-	scaleXYZ = glm::vec3(0.3f, 0.05f, 0.3f); // Small base
-	positionXYZ = glm::vec3(-2.0f, tabletopHeight / 2.0f + 0.15f, 5.0f); // Positioned to the left above the tabletop
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for selecting whether the depth of
+ *  the opaque objects is drawn before they are shaded.  It
+ *  can be changed between frames, to compare the number of
+ *  shaded fragments of a scene with and without it.
+ ***********************************************************/
+void SceneManager::SetDepthPrepass(bool bEnable)
+{
+	m_bUseDepthPrepass = bEnable;
+}
 
-	// Set the transformations into memory for the lamp base
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+bool SceneManager::GetDepthPrepass() const
+{
+	return(m_bUseDepthPrepass);
+}
 
-	// Set the color for the lamp base to orange
-	//SetShaderColor(1.0f, 0.5f, 0.0f, 1.0f); // Orange color for the base
-	SetShaderTexture("lampbase");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawBoxMesh(); // Draw the lamp base
-
-	// Draw the lamp pole
-	scaleXYZ = glm::vec3(0.05f, 0.5f, 0.05f); // Half the length of the pole
-	positionXYZ = glm::vec3(-2.0f, tabletopHeight / 2.0f + 0.2f, 5.0f); // Positioned higher above the base
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.4f, 0.4f, 0.4f, 1.0f); // Gray for the pole
-	m_basicMeshes->DrawCylinderMesh(); // Draw the lamp pole
-
-	// Draw the lamp shade
-	scaleXYZ = glm::vec3(0.3f, 0.1f, 0.3f); // Wide shade
-	positionXYZ = glm::vec3(-2.0f, tabletopHeight / 2.0f + 0.6f, 5.0f); // Positioned higher above the pole on the left
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(1.0f, 1.0f, 0.8f, 1.0f); // Light color for the shade
-	SetShaderTexture("lampshade");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawConeMesh(); // Draw the lamp shade
+/***********************************************************
+ *  SetDeferredShading()
+ *
+ *  This method is used for selecting the deferred path.
+ *  The forward path is used when the G-buffer or the
+ *  lighting shader cannot be created.  The depth pre-pass
+ *  only applies to the forward path.
+ ***********************************************************/
+void SceneManager::SetDeferredShading(bool bEnable)
+{
+	m_bUseDeferred = bEnable;
+}
 
-	/******************************************************************/
-	// Draw the cup on the tabletop
+/***********************************************************
+ *  SetVisibilityBuffer()
+ *
+ *  This method is used for selecting the visibility buffer
+ *  path, which is used before the deferred path.  It needs
+ *  the meshes in the shared buffers, and the forward path
+ *  is used when they are not, or when the IDs or the
+ *  shaders cannot be created.
+ ***********************************************************/
+void SceneManager::SetVisibilityBuffer(bool bEnable)
+{
+	m_bUseVisibilityBuffer = bEnable;
+}
 
-	// Set the XYZ scale for the pencil cup holder
-	scaleXYZ = glm::vec3(0.2f, 0.5f, 0.2f); // Width, height, depth of the cup holder
+/***********************************************************
+ *  SetLightmaps()
+ *
+ *  This method is used for selecting whether the static
+ *  batch reads its ambient and diffuse light from a baked
+ *  lightmap.  The lightmap coordinates are made when the
+ *  batch is built, and the lightmap is baked before the
+ *  batch is drawn, again whenever the lights or materials
+ *  change.  The deferred and visibility buffer paths light
+ *  every pixel themselves and do not use it.
+ ***********************************************************/
+void SceneManager::SetLightmaps(bool bEnable, int aoSamples)
+{
+	m_bUseLightmaps = bEnable;
+	m_lightmapBaker->SetAmbientOcclusion(aoSamples, g_LightmapOcclusionDistance);
+	m_bLightmapDirty = true;
+}
 
-	// Set the XYZ position for the pencil cup holder
-	// Positioned above the tabletop
-	positionXYZ = glm::vec3(2.0f, tabletopHeight / 2.0f - 0.1f, 5.0f); // Adjusted Y to be above the tabletop
+/***********************************************************
+ *  SetShadows()
+ *
+ *  This method is used for selecting whether the first
+ *  lights of the scene file cast shadows.  The shadow maps
+ *  are drawn again after they were off, since the casters
+ *  were not tracked meanwhile.  The deferred and visibility
+ *  buffer paths do not read them.
+ ***********************************************************/
+void SceneManager::SetShadows(bool bEnable)
+{
+	m_bUseShadows = bEnable;
+	m_shadowMaps->Invalidate();
+}
 
-	// Set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetFragmentCounting()
+ *
+ *  This method is used for selecting whether RenderScene()
+ *  counts the fragment shader invocations of each frame
+ *  with a pipeline statistics query.  Counting stays off
+ *  when the driver does not support the query.
+ ***********************************************************/
+void SceneManager::SetFragmentCounting(bool bEnable)
+{
+	m_bCountFragments = (bEnable == true) && (m_bFragmentQuerySupported == true);
+}
 
-	// Set the color for the pencil cup holder to blue
-	//SetShaderColor(0.0f, 0.0f, 1.0f, 1.0f); // RGB for blue color
-	SetShaderTexture("cup");
-	SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  IsCountingFragments()
+ *
+ *  This method is used for checking whether the fragments
+ *  are counted, which needs pipeline statistics queries.
+ ***********************************************************/
+bool SceneManager::IsCountingFragments() const
+{
+	return(m_bCountFragments);
+}
 
-	// Draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh(); // Draw pencil cup holder
-	/******************************************************************/
-//  Draw the laptop base (body)
-	scaleXYZ = glm::vec3(1.2f, 0.1f, 0.8f); // Laptop body dimensions
-	positionXYZ = glm::vec3(0.0f, tabletopHeight / 2.0f + 0.15f, 5.0f); // Positioned above the tabletop
+/***********************************************************
+ *  GetFragmentCount()
+ *
+ *  This method is used for getting the fragment shader
+ *  invocations of the last counted frame, which waits for
+ *  the frame to finish on the GPU.
+ ***********************************************************/
+GLuint64 SceneManager::GetFragmentCount() const
+{
+	GLuint64 count = 0;
+	if (m_fragmentQuery != 0)
+	{
+		glGetQueryObjectui64v(m_fragmentQuery, GL_QUERY_RESULT, &count);
+	}
+	return(count);
+}
 
-	// Set the transformations into memory for the laptop body
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
+/***********************************************************
+ *  GetCullingStats()
+ *
+ *  This method is used for getting the number of objects
+ *  that were drawn, and that were culled, in the last
+ *  frame.  Batched objects count as drawn when their index
+ *  range is part of a batch draw call.
+ ***********************************************************/
+const SceneManager::CULLING_STATS& SceneManager::GetCullingStats() const
+{
+	return(m_cullingStats);
+}
 
-	// Set the color for the laptop body
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f); // Dark gray for the laptop body
-	m_basicMeshes->DrawBoxMesh(); // Draw the laptop body
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for collecting the entities that a
+ *  view can see, for example for a shadow or a reflection
+ *  view, from the spatial index instead of every entity.
+ ***********************************************************/
+void SceneManager::QueryFrustum(const glm::mat4& viewProjection, std::vector<int>& entities)
+{
+	UpdateSpatialIndex();
 
-	// Draw the laptop screen (half-closed)
-	scaleXYZ = glm::vec3(1.2f, 0.4f, 0.05f); // Laptop screen dimensions
-	positionXYZ = glm::vec3(0.0f, tabletopHeight / 2.0f + 0.35f, 4.7f); // Increased Y position for better alignment
+	glm::vec4 planes[6];
+	FrustumCuller::ExtractPlanes(viewProjection, planes);
+	m_sceneBvh->QueryFrustum(planes, entities);
+}
 
-	// Set the transformations into memory for the laptop screen
-	SetTransformations(scaleXYZ, 30.0f, 0.0f, 0.0f, positionXYZ); // Tilted 30 degrees for half-closed effect
+/***********************************************************
+ *  RayCast()
+ *
+ *  This method is used for picking the entity along a ray,
+ *  for example under the mouse.  The world boxes are
+ *  tested, not the triangles of the meshes.
+ ***********************************************************/
+int SceneManager::RayCast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance)
+{
+	UpdateSpatialIndex();
+	return(m_sceneBvh->RayCast(origin, direction, maxDistance, hitDistance));
+}
 
-	// Set the color for the laptop screen
-	//SetShaderColor(0.1f, 0.1f, 0.1f, 1.0f); // Dark gray for the screen
-	SetShaderTexture("laptopscreen");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawBoxMesh(); // Draw the laptop screen
-	/******************************************************************/
-	// Draw the first book (bottom)
-	scaleXYZ = glm::vec3(0.5f, 0.1f, 0.3f); // Dimensions for the first book
-	positionXYZ = glm::vec3(-1.5f, tabletopHeight / 2.0f + 0.15f, 5.1f); // Raised slightly higher
-
-	// Set the transformations for the first book
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-
-	// Set the color for the first book
-	//SetShaderColor(0.8f, 0.2f, 0.2f, 1.0f); // Red color for the first book
-	SetShaderTexture("book");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawBoxMesh(); // Draw the first book
+/***********************************************************
+ *  FindNearestObject()
+ *
+ *  This method is used for finding the entity closest to a
+ *  position, measured to the surface of its world box.
+ ***********************************************************/
+int SceneManager::FindNearestObject(
+	const glm::vec3& position,
+	float maxDistance,
+	float& distance)
+{
+	UpdateSpatialIndex();
+	return(m_sceneBvh->FindNearest(position, maxDistance, distance));
+}
 
-	// Draw the second book (top)
-	scaleXYZ = glm::vec3(0.5f, 0.1f, 0.3f); // Dimensions for the second book
-	positionXYZ = glm::vec3(-1.5f, tabletopHeight / 2.0f + 0.25f, 5.1f); // Positioned directly above the first book
+/***********************************************************
+ *  AddBenchmarkObjects()
+ *
+ *  This method is used for adding a grid of small dynamic
+ *  objects behind the desk.  Consecutive objects use
+ *  different meshes, so every draw call switches meshes.
+ ***********************************************************/
+void SceneManager::AddBenchmarkObjects(int count)
+{
+	const ShapeMeshes::MESH_SHAPE shapes[] = {
+		ShapeMeshes::BOX_MESH,
+		ShapeMeshes::CONE_MESH,
+		ShapeMeshes::CYLINDER_MESH,
+		ShapeMeshes::TORUS_MESH
+	};
+	const int shapeCount = sizeof(shapes) / sizeof(shapes[0]);
+	const int columns = 64;
+
+	for (int i = 0; i < count; i++)
+	{
+		float x = -9.5f + 0.3f * (float)(i % columns);
+		float y = 0.5f + 0.3f * (float)((i / columns) % 48);
+		float z = -7.0f + 0.3f * (float)(i / (columns * 48));
+
+		AddSceneObject(shapes[i % shapeCount],
+			glm::vec3(0.1f, 0.1f, 0.1f), 0.0f, 0.0f, 0.0f,
+			glm::vec3(x, y, z),
+			"", glm::vec4(0.2f + 0.6f * (float)(i % shapeCount) / shapeCount, 0.5f, 0.7f, 1.0f),
+			"glass", false);
+	}
+}
 
-	// Set the transformations for the second book
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
+/***********************************************************
+ *  AddBenchmarkLights()
+ *
+ *  This method is used for adding a grid of small colored
+ *  lights in front of the benchmark objects.  Each light
+ *  only reaches the objects around it, so the cost of the
+ *  lights depends on how many overlap, not on the count.
+ ***********************************************************/
+void SceneManager::AddBenchmarkLights(int count)
+{
+	const int columns = 32;
 
-	// Set the color for the second book
-	//SetShaderColor(0.2f, 0.8f, 0.2f, 1.0f); // Green color for the second book
-	SetShaderTexture("book");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawBoxMesh(); // Draw the second book
+	for (int i = 0; i < count; i++)
+	{
+		SceneFile::SCENE_LIGHT light = {};
+		light.position[0] = -9.5f + 0.6f * (float)(i % columns);
+		light.position[1] = 0.5f + 0.6f * (float)((i / columns) % 24);
+		light.position[2] = -6.5f + 0.6f * (float)(i / (columns * 24));
+		light.diffuseColor[0] = 0.2f + 0.6f * (float)(i % 3) / 2.0f;
+		light.diffuseColor[1] = 0.2f + 0.6f * (float)((i / 3) % 3) / 2.0f;
+		light.diffuseColor[2] = 0.2f + 0.6f * (float)((i / 9) % 3) / 2.0f;
+		light.specularColor[0] = 0.1f;
+		light.specularColor[1] = 0.1f;
+		light.specularColor[2] = 0.1f;
+		light.focalStrength = 16.0f;
+		light.specularIntensity = 0.2f;
+		light.range = 1.0f;
+		m_lights.push_back(light);
+	}
+	m_clusteredLights->SetLights(m_lights, m_shadowMaps->GetLightCount());
+	m_bLightmapDirty = true;
+}
 
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 20.0f);
+/***********************************************************
+ *  AddModel()
+ *
+ *  This method is used for importing the meshes of a .glb
+ *  file and placing them in the scene with the passed in
+ *  transformation.  The meshes keep their own buffers, so
+ *  they are drawn per object instead of from the batch.
+ ***********************************************************/
+bool SceneManager::AddModel(
+	const char* filename,
+	glm::vec3 scaleXYZ,
+	glm::vec3 positionXYZ)
+{
+	int firstMesh = m_basicMeshes->GetImportedMeshCount();
+	m_basicMeshes->SetLodGeneration(true);
+	m_basicMeshes->SetMeshletGeneration(true);
+	if (m_basicMeshes->LoadGltfFile(filename) == false)
+	{
+		return(false);
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	for (int i = firstMesh; i < m_basicMeshes->GetImportedMeshCount(); i++)
+	{
+		int entity = AddSceneObject(ShapeMeshes::IMPORTED_MESH,
+			scaleXYZ, 0.0f, 0.0f, 0.0f,
+			positionXYZ,
+			"", glm::vec4(0.7f, 0.7f, 0.7f, 1.0f), "glass");
+		m_entities->GetMesh(entity)->importedMesh = i;
+		SetLocalBounds(m_entities->GetBounds(entity), ShapeMeshes::IMPORTED_MESH, i);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 15.0f, -8.0f);
+	return(true);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the 3D scene.
+ *  Objects without a texture tag are drawn with the passed
+ *  in color.  The transformation is relative to the parent
+ *  node, or to the world for objects without a parent.
+ *  Textured objects have a texture component, so they are
+ *  kept in other chunks than the flat colored ones.
+ ***********************************************************/
+int SceneManager::AddSceneObject(
+	ShapeMeshes::MESH_SHAPE shape,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	std::string textureTag,
+	glm::vec4 color,
+	std::string materialTag,
+	bool bStatic,
+	int parentNode)
+{
+	// the slot stays -1 for texture tags that were never loaded
+	int textureSlot = -1;
+	if (textureTag.empty() == false)
+	{
+		textureSlot = FindTextureSlot(textureTag);
+	}
+
+	return(CreateSceneEntity(shape,
+		scaleXYZ,
+		SceneGraph::RotationFromDegrees(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ,
+		textureTag.empty() == false, textureSlot,
+		color, FindMaterialIndex(materialTag),
+		bStatic, parentNode));
+}
+
+/***********************************************************
+ *  CreateSceneEntity()
+ *
+ *  This method is used for creating the entity of a scene
+ *  object.  Textured objects have a texture component, so
+ *  they are kept in other chunks than the flat colored
+ *  ones.
+ ***********************************************************/
+int SceneManager::CreateSceneEntity(
+	ShapeMeshes::MESH_SHAPE shape,
+	glm::vec3 scaleXYZ,
+	glm::quat rotation,
+	glm::vec3 positionXYZ,
+	bool bTextured,
+	int textureSlot,
+	glm::vec4 color,
+	int material,
+	bool bStatic,
+	int parentNode)
+{
+	unsigned int mask = EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::MATERIAL |
+		EntityStore::BOUNDS | EntityStore::FLAGS;
+	if (bTextured == true)
+	{
+		mask |= EntityStore::TEXTURE;
+	}
+	int entity = m_entities->CreateEntity(mask);
+
+	m_entities->GetTransform(entity)->node = m_sceneGraph->CreateNode(
+		parentNode,
+		positionXYZ,
+		rotation,
+		scaleXYZ);
+
+	EntityStore::MESH_COMPONENT* mesh = m_entities->GetMesh(entity);
+	mesh->shape = shape;
+	mesh->importedMesh = -1;
+
+	EntityStore::MATERIAL_COMPONENT* materialComponent = m_entities->GetMaterial(entity);
+	materialComponent->material = material;
+	materialComponent->color = color;
+
+	EntityStore::TEXTURE_COMPONENT* texture = m_entities->GetTexture(entity);
+	if (texture != NULL)
+	{
+		texture->textureSlot = textureSlot;
+		texture->UVscale = glm::vec2(1.0f, 1.0f);
+	}
+
+	EntityStore::BOUNDS_COMPONENT* bounds = m_entities->GetBounds(entity);
+	SetLocalBounds(bounds, shape, -1);
+	bounds->worldSphere = glm::vec4(positionXYZ, 0.0f);
+	bounds->worldCenter = positionXYZ;
+	bounds->worldExtent = glm::vec3(0.0f);
+
+	EntityStore::FLAGS_COMPONENT* flags = m_entities->GetFlags(entity);
+	flags->flags = (bStatic == true) ? EntityStore::STATIC_FLAG : 0;
+	flags->impostor = -1;
+	flags->batchEntry = -1;
+
+	return(entity);
+}
+
+/***********************************************************
+ *  LoadShapeMesh()
+ *
+ *  This method is used for loading the mesh of a built-in
+ *  shape, so only the shapes a scene uses are loaded.
+ ***********************************************************/
+void SceneManager::LoadShapeMesh(ShapeMeshes::MESH_SHAPE shape)
+{
+	switch (shape)
+	{
+	case ShapeMeshes::BOX_MESH:
+		m_basicMeshes->LoadBoxMesh();
+		break;
+	case ShapeMeshes::CONE_MESH:
+		m_basicMeshes->LoadConeMesh();
+		break;
+	case ShapeMeshes::CYLINDER_MESH:
+		m_basicMeshes->LoadCylinderMesh();
+		break;
+	case ShapeMeshes::PLANE_MESH:
+		m_basicMeshes->LoadPlaneMesh();
+		break;
+	case ShapeMeshes::PRISM_MESH:
+		m_basicMeshes->LoadPrismMesh();
+		break;
+	case ShapeMeshes::PYRAMID3_MESH:
+		m_basicMeshes->LoadPyramid3Mesh();
+		break;
+	case ShapeMeshes::PYRAMID4_MESH:
+		m_basicMeshes->LoadPyramid4Mesh();
+		break;
+	case ShapeMeshes::SPHERE_MESH:
+		m_basicMeshes->LoadSphereMesh();
+		break;
+	case ShapeMeshes::TAPERED_CYLINDER_MESH:
+		m_basicMeshes->LoadTaperedCylinderMesh();
+		break;
+	case ShapeMeshes::TORUS_MESH:
+		m_basicMeshes->LoadTorusMesh();
+		break;
+	case ShapeMeshes::IMPORTED_MESH:
+		return;
+	}
+	m_bShapeLoaded[shape] = true;
+}
+
+/***********************************************************
+ *  ApplyScene()
+ *
+ *  This method is used for bringing the live scene in line
+ *  with a scene file, which builds the whole scene the
+ *  first time.  Textures are decoded again only when their
+ *  file changed, materials are changed in place, so the
+ *  objects keep their indices, and meshes are only loaded
+ *  for new shapes.  The objects of the file are matched to
+ *  the live ones by position, and only their changed parts
+ *  are set.  Batched objects that moved or changed material
+ *  are written over their old vertices in the batch, which
+ *  is only built again when objects join or leave it.
+ ***********************************************************/
+SceneManager::SCENE_CHANGES SceneManager::ApplyScene(const SceneFile& scene)
+{
+	SCENE_CHANGES changes;
+	changes.textures = 0;
+	changes.materials = 0;
+	changes.meshes = 0;
+	changes.objects = 0;
+	changes.patchedObjects = 0;
+	changes.bRebuiltBatch = false;
+	bool bRebuildBatch = false;
+
+	// textures, by tag
+	const SceneFile::SCENE_TEXTURE* textures = scene.GetTextures();
+	std::vector<int> textureSlots(scene.GetTextureCount());
+	for (uint32_t i = 0; i < scene.GetTextureCount(); i++)
+	{
+		const char* filename = scene.GetString(textures[i].filename);
+		const char* tag = scene.GetString(textures[i].tag);
+		int slot = FindTextureSlot(tag);
+		if (slot < 0)
+		{
+			if (CreateGLTexture(filename, tag) == true)
+			{
+				slot = m_loadedTextures - 1;
+				changes.textures++;
+			}
+		}
+		else if ((m_textureIDs[slot].filename.compare(filename) != 0) ||
+			(m_textureIDs[slot].fileTime != GetFileTime(filename)))
+		{
+			if (UploadGLTexture(filename, m_textureIDs[slot].ID) == true)
+			{
+				m_textureIDs[slot].filename = filename;
+				m_textureIDs[slot].fileTime = GetFileTime(filename);
+				changes.textures++;
+			}
+		}
+		textureSlots[i] = slot;
+	}
+	if (changes.textures > 0)
+	{
+		BindGLTextures();
+	}
+
+	// materials, by tag
+	const SceneFile::SCENE_MATERIAL* materials = scene.GetMaterials();
+	std::vector<int> materialIndices(scene.GetMaterialCount());
+	for (uint32_t i = 0; i < scene.GetMaterialCount(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.ambientColor = glm::make_vec3(materials[i].ambientColor);
+		material.ambientStrength = materials[i].ambientStrength;
+		material.diffuseColor = glm::make_vec3(materials[i].diffuseColor);
+		material.specularColor = glm::make_vec3(materials[i].specularColor);
+		material.shininess = materials[i].shininess;
+		material.tag = scene.GetString(materials[i].tag);
+
+		int index = FindMaterialIndex(material.tag);
+		if (index < 0)
+		{
+			m_objectMaterials.push_back(material);
+			index = (int)m_objectMaterials.size() - 1;
+			changes.materials++;
+		}
+		else if ((m_objectMaterials[index].ambientColor != material.ambientColor) ||
+			(m_objectMaterials[index].ambientStrength != material.ambientStrength) ||
+			(m_objectMaterials[index].diffuseColor != material.diffuseColor) ||
+			(m_objectMaterials[index].specularColor != material.specularColor) ||
+			(m_objectMaterials[index].shininess != material.shininess))
+		{
+			m_objectMaterials[index] = material;
+			changes.materials++;
+		}
+		materialIndices[i] = index;
+	}
+	if (changes.materials > 0)
+	{
+		SetBatchMaterials();
+	}
+
+	// the baked light of the static batch follows the lights
+	// and the materials of the file
+	if ((changes.materials > 0) || (m_lights.size() != scene.GetLightCount()) ||
+		((m_lights.empty() == false) &&
+			(std::memcmp(m_lights.data(), scene.GetLights(), sizeof(SceneFile::SCENE_LIGHT) * m_lights.size()) != 0)))
+	{
+		m_bLightmapDirty = true;
+	}
+	m_lights.assign(scene.GetLights(), scene.GetLights() + scene.GetLightCount());
+	m_shadowMaps->SetLights(m_lights);
+	m_clusteredLights->SetLights(m_lights, m_shadowMaps->GetLightCount());
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	const SceneFile::SCENE_OBJECT* objects = scene.GetObjects();
+	uint32_t nObjects = scene.GetObjectCount();
+	for (uint32_t i = 0; i < nObjects; i++)
+	{
+		if (m_bShapeLoaded[objects[i].shape] == false)
+		{
+			LoadShapeMesh((ShapeMeshes::MESH_SHAPE)objects[i].shape);
+			changes.meshes++;
+		}
+	}
+
+	// groups come after their parents.  A group that moved to
+	// another parent gets a new node, and the old node is
+	// left without objects
+	const SceneFile::SCENE_GROUP* groups = scene.GetGroups();
+	std::vector<int> groupNodes(scene.GetGroupCount());
+	for (uint32_t i = 0; i < scene.GetGroupCount(); i++)
+	{
+		int parentNode = (groups[i].parent >= 0) ? groupNodes[groups[i].parent] : -1;
+		glm::vec3 position = glm::make_vec3(groups[i].position);
+		if ((i < m_sceneGroupNodes.size()) && (m_sceneGraph->GetParent(m_sceneGroupNodes[i]) == parentNode))
+		{
+			groupNodes[i] = m_sceneGroupNodes[i];
+			if (memcmp(groups[i].position, m_sceneGroups[i].position, sizeof(groups[i].position)) != 0)
+			{
+				m_sceneGraph->SetLocalPosition(groupNodes[i], position);
+			}
+		}
+		else
+		{
+			groupNodes[i] = AddSceneNode(position, parentNode);
+		}
+	}
+	m_sceneGroups.assign(groups, groups + scene.GetGroupCount());
+	m_sceneGroupNodes = groupNodes;
+
+	// nodes of batched objects whose material or color changed
+	std::vector<int> changedNodes;
+	std::vector<int> entities(nObjects);
+	for (uint32_t i = 0; i < nObjects; i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = objects[i];
+		ShapeMeshes::MESH_SHAPE shape = (ShapeMeshes::MESH_SHAPE)object.shape;
+		glm::vec3 scale = glm::make_vec3(object.scale);
+		glm::quat rotation = SceneGraph::RotationFromDegrees(object.rotationDegrees[0], object.rotationDegrees[1], object.rotationDegrees[2]);
+		glm::vec3 position = glm::make_vec3(object.position);
+		bool bTextured = (object.texture >= 0);
+		int textureSlot = (bTextured == true) ? textureSlots[object.texture] : -1;
+		glm::vec4 color = glm::make_vec4(object.color);
+		int material = (object.material >= 0) ? materialIndices[object.material] : -1;
+		bool bStatic = ((object.flags & SceneFile::STATIC_OBJECT) != 0);
+		int parentNode = (object.group >= 0) ? groupNodes[object.group] : -1;
+
+		if (i >= m_sceneEntities.size())
+		{
+			entities[i] = CreateSceneEntity(shape, scale, rotation, position,
+				bTextured, textureSlot, color, material, bStatic, parentNode);
+			bRebuildBatch = (bRebuildBatch == true) || (bStatic == true);
+			changes.objects++;
+			continue;
+		}
+
+		int entity = m_sceneEntities[i];
+		const SceneFile::SCENE_OBJECT& live = m_sceneObjects[i];
+		entities[i] = entity;
+
+		// changes that move the object to another batch group,
+		// or in or out of the batch
+		bool bRegroup = false;
+		bool bChanged = false;
+
+		unsigned int mask = m_entities->GetComponents(entity);
+		bool bWasTextured = ((mask & EntityStore::TEXTURE) != 0);
+		if (bTextured != bWasTextured)
+		{
+			m_entities->SetComponents(entity, mask ^ EntityStore::TEXTURE);
+			bRegroup = true;
+		}
+
+		EntityStore::TRANSFORM_COMPONENT* transform = m_entities->GetTransform(entity);
+		if (m_sceneGraph->GetParent(transform->node) != parentNode)
+		{
+			transform->node = m_sceneGraph->CreateNode(parentNode, position, rotation, scale);
+			bChanged = true;
+		}
+		else if ((memcmp(object.scale, live.scale, sizeof(object.scale)) != 0) ||
+			(memcmp(object.rotationDegrees, live.rotationDegrees, sizeof(object.rotationDegrees)) != 0) ||
+			(memcmp(object.position, live.position, sizeof(object.position)) != 0))
+		{
+			m_sceneGraph->SetLocalTransform(transform->node, position, rotation, scale);
+			bChanged = true;
+		}
+		int node = transform->node;
+
+		EntityStore::MESH_COMPONENT* mesh = m_entities->GetMesh(entity);
+		if (mesh->shape != shape)
+		{
+			mesh->shape = shape;
+			SetLocalBounds(m_entities->GetBounds(entity), shape, -1);
+			bRegroup = true;
+		}
+
+		EntityStore::TEXTURE_COMPONENT* texture = m_entities->GetTexture(entity);
+		if ((texture != NULL) && ((bTextured != bWasTextured) || (texture->textureSlot != textureSlot)))
+		{
+			texture->textureSlot = textureSlot;
+			texture->UVscale = glm::vec2(1.0f, 1.0f);
+			bRegroup = true;
+		}
+
+		EntityStore::FLAGS_COMPONENT* flags = m_entities->GetFlags(entity);
+		bool bStaticCaster = (bStatic == true) || ((flags->flags & EntityStore::STATIC_FLAG) != 0);
+		if (bStatic != ((flags->flags & EntityStore::STATIC_FLAG) != 0))
+		{
+			flags->flags ^= EntityStore::STATIC_FLAG;
+			bRegroup = true;
+		}
+
+		EntityStore::MATERIAL_COMPONENT* materialComponent = m_entities->GetMaterial(entity);
+		if ((materialComponent->material != material) || (materialComponent->color != color))
+		{
+			materialComponent->material = material;
+			materialComponent->color = color;
+			changedNodes.push_back(node);
+			bChanged = true;
+		}
+
+		if ((bChanged == false) && (bRegroup == false))
+		{
+			continue;
+		}
+
+		flags->impostor = -1;
+		changes.objects++;
+		if ((flags->batchEntry >= 0) ? (bRegroup == true) : (bStatic == true))
+		{
+			bRebuildBatch = true;
+		}
+
+		// a changed object may no longer cast a shadow where it
+		// was, and a move is traced by the transform update
+		if (m_bUseShadows == true)
+		{
+			const EntityStore::BOUNDS_COMPONENT* bounds = m_entities->GetBounds(entity);
+			m_shadowMaps->MarkChanged(bounds->worldCenter - bounds->worldExtent,
+				bounds->worldCenter + bounds->worldExtent, bStaticCaster);
+		}
+	}
+
+	// objects that are no longer in the file
+	for (size_t i = nObjects; i < m_sceneEntities.size(); i++)
+	{
+		const EntityStore::FLAGS_COMPONENT* flags = m_entities->GetFlags(m_sceneEntities[i]);
+		if (flags->batchEntry >= 0)
+		{
+			bRebuildBatch = true;
+		}
+		if (m_bUseShadows == true)
+		{
+			const EntityStore::BOUNDS_COMPONENT* bounds = m_entities->GetBounds(m_sceneEntities[i]);
+			m_shadowMaps->MarkChanged(bounds->worldCenter - bounds->worldExtent,
+				bounds->worldCenter + bounds->worldExtent, (flags->flags & EntityStore::STATIC_FLAG) != 0);
+		}
+		m_sceneBvh->RemoveItem(m_sceneEntities[i]);
+		m_entities->DestroyEntity(m_sceneEntities[i]);
+		changes.objects++;
+	}
+	m_sceneObjects.assign(objects, objects + nObjects);
+	m_sceneEntities = entities;
+
+	if ((bRebuildBatch == false) &&
+		(PatchStaticBatch(changedNodes, changes.patchedObjects) == false))
+	{
+		bRebuildBatch = true;
+	}
+	if (bRebuildBatch == true)
+	{
+		BuildStaticBatch();
+		changes.bRebuiltBatch = true;
+		changes.patchedObjects = 0;
+	}
+
+	return(changes);
+}
+
+/***********************************************************
+ *  PatchStaticBatch()
+ *
+ *  This method is used for updating the batched objects
+ *  whose nodes were recomputed by the transform update, or
+ *  are in the passed in list.  Each object is transformed
+ *  again and written over its own vertices in the batch.
+ ***********************************************************/
+bool SceneManager::PatchStaticBatch(const std::vector<int>& changedNodes, int& nPatched)
+{
+	nPatched = 0;
+	UpdateTransforms();
+
+	std::vector<unsigned char> bNodeChanged(m_sceneGraph->GetNodeCount(), 0);
+	const std::vector<int>& updatedNodes = m_sceneGraph->GetUpdatedNodes();
+	for (size_t i = 0; i < updatedNodes.size(); i++)
+	{
+		bNodeChanged[updatedNodes[i]] = 1;
+	}
+	for (size_t i = 0; i < changedNodes.size(); i++)
+	{
+		bNodeChanged[changedNodes[i]] = 1;
+	}
+
+	std::vector<GLfloat> verts;
+	std::vector<GLuint> indices;
+	size_t nBatchMaterials = m_batchMaterials.size();
+
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::MATERIAL | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			int node = chunk->transforms[i].node;
+			int entry = chunk->flags[i].batchEntry;
+			if ((entry < 0) || (bNodeChanged[node] == 0))
+			{
+				continue;
+			}
+
+			glm::vec2 UVscale = (chunk->textures != NULL) ? chunk->textures[i].UVscale : glm::vec2(1.0f, 1.0f);
+			int materialIndex = FindBatchMaterial(chunk->materials[i].material, chunk->materials[i].color);
+			if ((materialIndex < 0) ||
+				(m_basicMeshes->GetMeshGeometry(chunk->meshes[i].shape, verts, indices) == false) ||
+				(m_staticBatch->UpdateGeometry(entry, materialIndex, verts,
+					m_sceneGraph->GetWorldMatrix(node), UVscale) == false))
+			{
+				return(false);
+			}
+			nPatched++;
+		}
+	}
+
+	if (m_batchMaterials.size() != nBatchMaterials)
+	{
+		SetBatchMaterials();
+	}
+	m_bGpuDrawsDirty = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadScene()
+ *
+ *  This method is used for loading the scene file again
+ *  while the scene is shown, and applying only what
+ *  changed.  The live scene is kept when the file cannot
+ *  be loaded, so a file with a mistake can be fixed and
+ *  reloaded.
+ ***********************************************************/
+bool SceneManager::ReloadScene()
+{
+	SceneFile scene;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (scene.Load(m_sceneFilename.c_str()) == false)
+	{
+		return(false);
+	}
+	if (m_sceneBinaryFilename.empty() == false)
+	{
+		scene.Save(m_sceneBinaryFilename.c_str());
+	}
+
+	SCENE_CHANGES changes = ApplyScene(scene);
+	std::chrono::duration<double, std::milli> reloadTime = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Reloaded scene file: " << m_sceneFilename << " in " << reloadTime.count() << " ms - "
+		<< changes.textures << " textures, "
+		<< changes.materials << " materials, "
+		<< changes.meshes << " meshes, "
+		<< changes.objects << " objects changed, static batch "
+		<< ((changes.bRebuiltBatch == true) ? "rebuilt" : std::to_string(changes.patchedObjects) + " objects patched")
+		<< std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddSceneNode()
+ *
+ *  This method is used for adding a group to the 3D scene.
+ *  Objects and groups added with the returned node as their
+ *  parent are placed relative to the group, so related
+ *  parts are positioned once and move together.
+ ***********************************************************/
+int SceneManager::AddSceneNode(
+	glm::vec3 positionXYZ,
+	int parentNode)
+{
+	return(m_sceneGraph->CreateNode(
+		parentNode,
+		positionXYZ,
+		glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec3(1.0f, 1.0f, 1.0f)));
+}
+
+/***********************************************************
+ *  SetLocalBounds()
+ *
+ *  This method is used for setting the object space bounds
+ *  of an entity to the bounding box and bounding sphere of
+ *  its mesh.  Meshes that are not loaded get empty bounds
+ *  at the origin.
+ ***********************************************************/
+void SceneManager::SetLocalBounds(
+	EntityStore::BOUNDS_COMPONENT* bounds,
+	ShapeMeshes::MESH_SHAPE shape,
+	int importedMesh)
+{
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	glm::vec4 sphere = glm::vec4(0.0f);
+	if ((m_basicMeshes->GetMeshBounds(shape, importedMesh, boundsMin, boundsMax) == false) ||
+		(m_basicMeshes->GetMeshSphere(shape, importedMesh, sphere) == false))
+	{
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+		sphere = glm::vec4(0.0f);
+	}
+
+	bounds->localSphere = sphere;
+	bounds->localCenter = (boundsMin + boundsMax) * 0.5f;
+	bounds->localExtent = (boundsMax - boundsMin) * 0.5f;
+}
+
+/***********************************************************
+ *  FindBatchMaterial()
+ *
+ *  This method is used for getting the index of the static
+ *  batch material table entry for the passed in material
+ *  and color, adding the entry if needed.  Returns -1 when
+ *  the table of the shader is full.
+ ***********************************************************/
+int SceneManager::FindBatchMaterial(int material, glm::vec4 color)
+{
+	for (int i = 0; i < (int)m_batchMaterials.size(); i++)
+	{
+		if ((m_batchMaterials[i].material == material) &&
+			(m_batchMaterials[i].color == color))
+		{
+			return(i);
+		}
+	}
+
+	if ((int)m_batchMaterials.size() >= g_MaxBatchMaterials)
+	{
+		return(-1);
+	}
+
+	BATCH_MATERIAL entry;
+	entry.material = material;
+	entry.color = color;
+	m_batchMaterials.push_back(entry);
+
+	return((int)m_batchMaterials.size() - 1);
+}
+
+/***********************************************************
+ *  BuildStaticBatch()
+ *
+ *  This method is used for transforming the geometry of the
+ *  static objects into world space once, grouped by texture
+ *  so each texture needs a single draw call.  The material
+ *  of each object is selected per vertex in the shader.
+ *  Objects that do not fit in the material table keep the
+ *  per-object draw path.  The chunks are walked in order,
+ *  so the batch follows the memory order of the entities.
+ ***********************************************************/
+void SceneManager::BuildStaticBatch()
+{
+	std::vector<GLfloat> verts;
+	std::vector<GLuint> indices;
+
+	m_staticBatch->Destroy();
+	m_batchMaterials.clear();
+	UpdateTransforms();
+
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::MATERIAL | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			EntityStore::FLAGS_COMPONENT& flags = chunk->flags[i];
+			flags.flags &= ~EntityStore::BATCHED_FLAG;
+			flags.batchEntry = -1;
+
+			// see-through objects are drawn per object, after the
+			// depth pre-pass
+			if (((flags.flags & EntityStore::STATIC_FLAG) == 0) || (IsTranslucent(chunk, i) == true))
+			{
+				continue;
+			}
+
+			// objects with a flat color share the group without a texture
+			int textureSlot = -1;
+			glm::vec2 UVscale(1.0f, 1.0f);
+			if (chunk->textures != NULL)
+			{
+				textureSlot = chunk->textures[i].textureSlot;
+				UVscale = chunk->textures[i].UVscale;
+				if (textureSlot < 0)
+				{
+					continue;
+				}
+			}
+
+			const EntityStore::MATERIAL_COMPONENT& material = chunk->materials[i];
+			int materialIndex = FindBatchMaterial(material.material, material.color);
+			if ((materialIndex < 0) ||
+				(m_basicMeshes->GetMeshGeometry(chunk->meshes[i].shape, verts, indices) == false))
+			{
+				continue;
+			}
+
+			flags.batchEntry = m_staticBatch->AddGeometry(textureSlot, materialIndex, verts, indices,
+				m_sceneGraph->GetWorldMatrix(chunk->transforms[i].node), UVscale);
+			flags.flags |= EntityStore::BATCHED_FLAG;
+		}
+	}
+
+	// the lightmap coordinates follow the world positions, so
+	// the charts are made again with the batch
+	if (m_bUseLightmaps == true)
+	{
+		if (m_staticBatch->GenerateLightmapUVs(*m_lightmapBaker) == false)
+		{
+			std::cout << "The static batch does not fit in the lightmap atlas, it is lit per fragment" << std::endl;
+			m_bUseLightmaps = false;
+		}
+		m_bLightmapDirty = true;
+	}
+
+	m_staticBatch->Build();
+	SetBatchMaterials();
+	m_bGpuDrawsDirty = true;
+}
+
+/***********************************************************
+ *  SetBatchMaterials()
+ *
+ *  This method is used for passing the static batch material
+ *  table into the shader.  The values stay in the shader
+ *  program, so this is only needed when the table changes.
+ ***********************************************************/
+void SceneManager::SetBatchMaterials()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_batchMaterials.size(); i++)
+	{
+		OBJECT_MATERIAL material;
+		std::string name = "batchMaterials[" + std::to_string(i) + "]";
+
+		int index = m_batchMaterials[i].material;
+		if ((index >= 0) && (index < (int)m_objectMaterials.size()))
+		{
+			material = m_objectMaterials[index];
+		}
+		else
+		{
+			material.ambientColor = glm::vec3(0.0f);
+			material.ambientStrength = 0.0f;
+			material.diffuseColor = glm::vec3(0.0f);
+			material.specularColor = glm::vec3(0.0f);
+			material.shininess = 0.0f;
+		}
+
+		m_pShaderManager->setVec3Value(name + ".ambientColor", material.ambientColor);
+		m_pShaderManager->setFloatValue(name + ".ambientStrength", material.ambientStrength);
+		m_pShaderManager->setVec3Value(name + ".diffuseColor", material.diffuseColor);
+		m_pShaderManager->setVec3Value(name + ".specularColor", material.specularColor);
+		m_pShaderManager->setFloatValue(name + ".shininess", material.shininess);
+		m_pShaderManager->setVec4Value("batchColors[" + std::to_string(i) + "]", m_batchMaterials[i].color);
+		m_pShaderManager->setIntValue("batchMaterialIndices[" + std::to_string(i) + "]", m_batchMaterials[i].material);
+	}
+}
+
+/***********************************************************
+ *  DrawStaticBatch()
+ *
+ *  This method is used for drawing all the batched static
+ *  objects, with one draw call per texture group.  The
+ *  batch is only culled by the first draw of a frame.
+ ***********************************************************/
+void SceneManager::DrawStaticBatch()
+{
+	if ((NULL == m_pShaderManager) || (m_staticBatch->GetGroupCount() == 0))
+	{
+		return;
+	}
+
+	// the batch vertices are already in world space
+	SetModelMatrix(glm::mat4(1.0f), glm::mat3(1.0f));
+	m_pShaderManager->setBoolValue(g_UseBatchMaterialsName, true);
+	SetTextureUVScale(1.0, 1.0);
+
+	// the ambient and diffuse light is read from the lightmap
+	// when the batch is shaded forward
+	bool bLightmap = (m_bUseLightmaps == true) && (m_bDepthOnlyPass == false) &&
+		(m_bGBufferPass == false) && (BakeLightmap() == true);
+	if (bLightmap == true)
+	{
+		m_lightmapBaker->Bind(g_LightmapUnit);
+		m_pShaderManager->setSampler2DValue("lightmapTexture", g_LightmapUnit);
+		m_pShaderManager->setBoolValue(g_UseLightmapName, true);
+	}
+
+	// the GPU culler tests the entries itself, once its
+	// compute shader is loaded
+	bool bGpuCulling = (m_bUseCulling == true) && (m_bUseGpuCulling == true) && (GpuCuller::IsSupported() == true);
+	if ((bGpuCulling == true) && (m_gpuCuller->HasProgram() == false))
+	{
+		if (m_cullProgram == 0)
+		{
+			m_cullProgram = m_pShaderManager->LoadComputeShader("../../Utilities/shaders/cullShader.glsl");
+		}
+		if (m_cullProgram == 0)
+		{
+			// keep the CPU path rather than trying every frame
+			m_bUseGpuCulling = false;
+			bGpuCulling = false;
+		}
+		else
+		{
+			m_gpuCuller->SetProgram(m_cullProgram);
+		}
+	}
+	if (m_bStaticBatchCulled == true)
+	{
+		// the pre-pass of this frame already culled the batch,
+		// so the shading pass draws the same entries
+	}
+	else if (bGpuCulling == true)
+	{
+		if (m_bGpuDrawsDirty == true)
+		{
+			UploadGpuDraws();
+		}
+		m_gpuCuller->Cull(m_view, m_projection, m_viewportHeight, m_frustumCuller->GetMinPixels());
+		m_pShaderManager->use();
+		m_bStaticBatchCulled = true;
+	}
+	// the culled batched objects are left out of the draws
+	else if (m_bUseCulling == true)
+	{
+		m_batchEntryVisible.assign(m_staticBatch->GetEntryCount(), 1);
+		m_entities->GetChunks(EntityStore::FLAGS, m_chunks);
+		for (size_t c = 0; c < m_chunks.size(); c++)
+		{
+			const EntityStore::CHUNK* chunk = m_chunks[c];
+			for (int i = 0; i < chunk->count; i++)
+			{
+				const EntityStore::FLAGS_COMPONENT& flags = chunk->flags[i];
+				if ((flags.batchEntry >= 0) && ((flags.flags & EntityStore::CULLED_FLAG) != 0))
+				{
+					m_batchEntryVisible[flags.batchEntry] = 0;
+				}
+			}
+		}
+		m_bStaticBatchCulled = true;
+	}
+
+	m_staticBatch->Bind();
+	for (int i = 0; i < m_staticBatch->GetGroupCount(); i++)
+	{
+		int textureSlot = m_staticBatch->GetGroupKey(i);
+		if (textureSlot < 0)
+		{
+			m_pShaderManager->setIntValue(g_UseTextureName, false);
+		}
+		else
+		{
+			m_pShaderManager->setIntValue(g_UseTextureName, true);
+			m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+		}
+		if (bGpuCulling == true)
+		{
+			m_gpuCuller->DrawGroup(i);
+		}
+		else if (m_bUseCulling == true)
+		{
+			m_staticBatch->DrawGroupEntries(i, m_batchEntryVisible);
+		}
+		else
+		{
+			m_staticBatch->DrawGroup(i);
+		}
+	}
+	glBindVertexArray(0);
+
+	m_pShaderManager->setBoolValue(g_UseBatchMaterialsName, false);
+	if (bLightmap == true)
+	{
+		m_pShaderManager->setBoolValue(g_UseLightmapName, false);
+	}
+}
+
+/***********************************************************
+ *  BakeLightmap()
+ *
+ *  This method is used for baking the lightmap of the static
+ *  batch with the lights of the scene and the materials of
+ *  the batch material table, when they changed since the
+ *  last bake.  The lightmap is turned off when it cannot be
+ *  baked, so the batch is lit per fragment.
+ ***********************************************************/
+bool SceneManager::BakeLightmap()
+{
+	if (m_bLightmapDirty == false)
+	{
+		return(m_lightmapBaker->IsBaked());
+	}
+	m_bLightmapDirty = false;
+
+	std::vector<LightmapBaker::BAKE_MATERIAL> materials(m_batchMaterials.size());
+	for (size_t i = 0; i < m_batchMaterials.size(); i++)
+	{
+		LightmapBaker::BAKE_MATERIAL& material = materials[i];
+		int index = m_batchMaterials[i].material;
+		if ((index >= 0) && (index < (int)m_objectMaterials.size()))
+		{
+			material.ambientColor = m_objectMaterials[index].ambientColor;
+			material.ambientStrength = m_objectMaterials[index].ambientStrength;
+			material.diffuseColor = m_objectMaterials[index].diffuseColor;
+		}
+		else
+		{
+			material.ambientColor = glm::vec3(0.0f);
+			material.ambientStrength = 0.0f;
+			material.diffuseColor = glm::vec3(0.0f);
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (m_lightmapBaker->Bake(m_lights, materials) == false)
+	{
+		m_bUseLightmaps = false;
+		return(false);
+	}
+	std::chrono::duration<double, std::milli> bakeTime = std::chrono::steady_clock::now() - start;
+
+	int atlasSize = m_lightmapBaker->GetAtlasSize();
+	std::cout << "Baked lightmap: " << m_lightmapBaker->GetChartCount() << " charts in a "
+		<< atlasSize << "x" << atlasSize << " atlas at " << m_lightmapBaker->GetPackedDensity()
+		<< " texels per unit in " << bakeTime.count() << " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadGpuDraws()
+ *
+ *  This method is used for passing the world box and index
+ *  range of every static batch entry to the GPU culler.
+ *  The boxes are kept by the batch, so this is only needed
+ *  when the batch is built or patched.
+ ***********************************************************/
+void SceneManager::UploadGpuDraws()
+{
+	std::vector<GpuCuller::DRAW_TEMPLATE> draws(m_staticBatch->GetEntryCount());
+	for (int i = 0; i < m_staticBatch->GetEntryCount(); i++)
+	{
+		int group = 0;
+		GLuint firstIndex = 0;
+		GLuint nIndices = 0;
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		m_staticBatch->GetEntryDraw(i, group, firstIndex, nIndices, boxMin, boxMax);
+
+		glm::vec3 center = (boxMin + boxMax) * 0.5f;
+		glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+		GpuCuller::DRAW_TEMPLATE& draw = draws[i];
+		for (int c = 0; c < 3; c++)
+		{
+			draw.center[c] = center[c];
+			draw.extent[c] = extent[c];
+		}
+		draw.firstIndex = firstIndex;
+		draw.nIndices = nIndices;
+		draw.group = (GLuint)group;
+		draw.commandBase = 0;
+		draw.padding[0] = 0;
+		draw.padding[1] = 0;
+	}
+	m_gpuCuller->SetDraws(draws, m_staticBatch->GetGroupCount());
+	m_bGpuDrawsDirty = false;
+}
+
+/***********************************************************
+ *  UpdateShadowMaps()
+ *
+ *  This method is used for drawing the shadow maps of the
+ *  lights whose casters changed, with the depth only
+ *  program in place of the scene program, and binding the
+ *  shadow maps for the shading programs.  The casters are
+ *  drawn at full detail, so the shadows do not change with
+ *  the distance to the camera.
+ ***********************************************************/
+void SceneManager::UpdateShadowMaps()
+{
+	if ((m_bUseShadows == true) && (m_shadowMaps->GetLightCount() > 0) && (LoadDepthShader() == false))
+	{
+		m_bUseShadows = false;
+	}
+	if ((m_bUseShadows == false) || (m_shadowMaps->GetLightCount() == 0))
+	{
+		return;
+	}
+
+	ShaderManager* pShaderManager = m_pShaderManager;
+	int viewportHeight = m_viewportHeight;
+	m_pShaderManager = m_depthShaderManager;
+	m_pShaderManager->use();
+	m_viewportHeight = 0;
+
+	m_shadowMaps->Update([this](const glm::mat4& view, const glm::mat4& projection, bool bStatic)
+	{
+		DrawShadowCasters(view, projection, bStatic);
+	});
+
+	m_viewportHeight = viewportHeight;
+	m_pShaderManager->setMat4Value(g_ViewName, m_view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, m_projection);
+	m_pShaderManager = pShaderManager;
+	m_pShaderManager->use();
+
+	m_shadowMaps->Bind(g_ShadowMapUnit);
+}
+
+/***********************************************************
+ *  SetLightingValues()
+ *
+ *  This method is used for passing the light counts, the
+ *  cluster slices and the shadow maps of the frame into the
+ *  current program, which is the scene program or the
+ *  impostor program.
+ ***********************************************************/
+void SceneManager::SetLightingValues()
+{
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_pShaderManager->setIntValue("lightCount", m_clusteredLights->GetLightCount());
+	m_pShaderManager->setIntValue("globalLightCount", m_clusteredLights->GetGlobalLightCount());
+	m_pShaderManager->setBoolValue("bClusterLogDepth", m_clusteredLights->IsLogDepth());
+	m_pShaderManager->setFloatValue("clusterDepthScale", m_clusteredLights->GetDepthScale());
+	m_pShaderManager->setFloatValue("clusterDepthBias", m_clusteredLights->GetDepthBias());
+
+	// the sampler keeps a unit of its own even when unused
+	m_pShaderManager->setIntValue("shadowMaps", g_ShadowMapUnit);
+	bool bShadows = (m_bUseShadows == true) && (m_shadowMaps->GetLightCount() > 0);
+	m_pShaderManager->setBoolValue(g_UseShadowsName, bShadows);
+	if (bShadows == true)
+	{
+		m_pShaderManager->setFloatValue("shadowNearPlane", m_shadowMaps->GetNearPlane());
+		m_pShaderManager->setFloatValue("shadowTexelSize", 2.0f / (float)ShadowMaps::MAP_SIZE);
+		for (int i = 0; i < m_shadowMaps->GetLightCount(); i++)
+		{
+			m_pShaderManager->setFloatValue("shadowFarPlanes[" + std::to_string(i) + "]", m_shadowMaps->GetFarPlane(i));
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawShadowCasters()
+ *
+ *  This method is used for drawing the opaque static or
+ *  dynamic objects whose world box is inside a cube face
+ *  of a shadow map.  The static batch is drawn by entry,
+ *  and the culling results of the camera are not used.
+ ***********************************************************/
+void SceneManager::DrawShadowCasters(const glm::mat4& view, const glm::mat4& projection, bool bStatic)
+{
+	m_pShaderManager->setMat4Value(g_ViewName, view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+	glm::vec4 planes[6];
+	FrustumCuller::ExtractPlanes(projection * view, planes);
+
+	if ((bStatic == true) && (m_bUseStaticBatching == true) && (m_staticBatch->GetGroupCount() > 0))
+	{
+		m_shadowEntryVisible.resize(m_staticBatch->GetEntryCount());
+		for (int i = 0; i < m_staticBatch->GetEntryCount(); i++)
+		{
+			int group = 0;
+			GLuint firstIndex = 0;
+			GLuint nIndices = 0;
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			m_staticBatch->GetEntryDraw(i, group, firstIndex, nIndices, boxMin, boxMax);
+			m_shadowEntryVisible[i] = (IsBoxInside(planes, (boxMin + boxMax) * 0.5f, (boxMax - boxMin) * 0.5f) == true) ? 1 : 0;
+		}
+
+		SetModelMatrix(glm::mat4(1.0f), glm::mat3(1.0f));
+		m_staticBatch->Bind();
+		for (int i = 0; i < m_staticBatch->GetGroupCount(); i++)
+		{
+			m_staticBatch->DrawGroupEntries(i, m_shadowEntryVisible);
+		}
+		glBindVertexArray(0);
+	}
+
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::MATERIAL |
+		EntityStore::BOUNDS | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		const EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			unsigned int flags = chunk->flags[i].flags;
+			if ((((flags & EntityStore::STATIC_FLAG) != 0) != bStatic) ||
+				((m_bUseStaticBatching == true) && ((flags & EntityStore::BATCHED_FLAG) != 0)) ||
+				(IsTranslucent(chunk, i) == true) ||
+				(IsBoxInside(planes, chunk->bounds[i].worldCenter, chunk->bounds[i].worldExtent) == false))
+			{
+				continue;
+			}
+			DrawEntity(chunk, i);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for running the transform system.
+ *  Only the nodes that moved since the last frame, and the
+ *  nodes below them, get new world matrices, and the world
+ *  bounds are refreshed when any node changed.  The shadow
+ *  maps around the boxes that moved are marked as changed.
+ ***********************************************************/
+void SceneManager::UpdateTransforms()
+{
+	if (m_sceneGraph->Update() == 0)
+	{
+		return;
+	}
+
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::BOUNDS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			int node = chunk->transforms[i].node;
+			EntityStore::BOUNDS_COMPONENT& bounds = chunk->bounds[i];
+			glm::vec3 oldMin = bounds.worldCenter - bounds.worldExtent;
+			glm::vec3 oldMax = bounds.worldCenter + bounds.worldExtent;
+			const glm::mat4& world = m_sceneGraph->GetWorldMatrix(node);
+			glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(bounds.localSphere), 1.0f));
+			bounds.worldSphere = glm::vec4(center, bounds.localSphere.w * m_sceneGraph->GetWorldScale(node));
+
+			// the world box around the transformed local box
+			// reaches as far along each axis as the absolute
+			// values of the matrix carry the half size
+			glm::mat3 absolute = glm::mat3(
+				glm::abs(glm::vec3(world[0])),
+				glm::abs(glm::vec3(world[1])),
+				glm::abs(glm::vec3(world[2])));
+			bounds.worldCenter = glm::vec3(world * glm::vec4(bounds.localCenter, 1.0f));
+			bounds.worldExtent = absolute * bounds.localExtent;
+			glm::vec3 boxMin = bounds.worldCenter - bounds.worldExtent;
+			glm::vec3 boxMax = bounds.worldCenter + bounds.worldExtent;
+
+			// only the boxes that changed are refit
+			m_sceneBvh->SetItem(chunk->entities[i], boxMin, boxMax);
+
+			// a caster that moved changes the shadows around its
+			// old and its new box
+			if ((m_bUseShadows == true) && ((boxMin != oldMin) || (boxMax != oldMax)))
+			{
+				bool bStatic = (chunk->flags != NULL) && ((chunk->flags[i].flags & EntityStore::STATIC_FLAG) != 0);
+				m_shadowMaps->MarkChanged(glm::min(oldMin, boxMin), glm::max(oldMax, boxMax), bStatic);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateSpatialIndex()
+ *
+ *  This method is used for bringing the spatial index up
+ *  to date before a query.  Moved entities refit the boxes
+ *  above them, and added or removed entities build the
+ *  tree again.
+ ***********************************************************/
+void SceneManager::UpdateSpatialIndex()
+{
+	UpdateTransforms();
+	if (m_sceneBvh->NeedsBuild() == true)
+	{
+		m_sceneBvh->Build();
+	}
+	else
+	{
+		m_sceneBvh->Refit();
+	}
+}
+
+/***********************************************************
+ *  CullEntities()
+ *
+ *  This method is used for running the culling system.  The
+ *  world bounds of each chunk are copied into one array per
+ *  component and tested a group of entities at a time, and
+ *  the entities that are outside the view, or too small to
+ *  see, are flagged so the batch and the render system
+ *  skip them.
+ ***********************************************************/
+void SceneManager::CullEntities()
+{
+	m_cullingStats.submitted = 0;
+	m_cullingStats.outsideFrustum = 0;
+	m_cullingStats.tooSmall = 0;
+
+	m_entities->GetChunks(EntityStore::BOUNDS | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		if (m_bUseCulling == false)
+		{
+			for (int i = 0; i < chunk->count; i++)
+			{
+				chunk->flags[i].flags &= ~EntityStore::CULLED_FLAG;
+			}
+			m_cullingStats.submitted += chunk->count;
+			continue;
+		}
+
+		for (int b = 0; b < 7; b++)
+		{
+			m_cullBounds[b].resize(chunk->count);
+		}
+		for (int i = 0; i < chunk->count; i++)
+		{
+			const EntityStore::BOUNDS_COMPONENT& bounds = chunk->bounds[i];
+			m_cullBounds[0][i] = bounds.worldCenter.x;
+			m_cullBounds[1][i] = bounds.worldCenter.y;
+			m_cullBounds[2][i] = bounds.worldCenter.z;
+			m_cullBounds[3][i] = bounds.worldExtent.x;
+			m_cullBounds[4][i] = bounds.worldExtent.y;
+			m_cullBounds[5][i] = bounds.worldExtent.z;
+			m_cullBounds[6][i] = bounds.worldSphere.w;
+		}
+
+		FrustumCuller::BOUNDS_ARRAYS arrays;
+		arrays.centerX = m_cullBounds[0].data();
+		arrays.centerY = m_cullBounds[1].data();
+		arrays.centerZ = m_cullBounds[2].data();
+		arrays.extentX = m_cullBounds[3].data();
+		arrays.extentY = m_cullBounds[4].data();
+		arrays.extentZ = m_cullBounds[5].data();
+		arrays.radius = m_cullBounds[6].data();
+		m_cullResults.resize(chunk->count);
+		m_frustumCuller->CullBounds(arrays, chunk->count, m_cullResults.data());
+
+		for (int i = 0; i < chunk->count; i++)
+		{
+			unsigned int& flags = chunk->flags[i].flags;
+			switch (m_cullResults[i])
+			{
+			case FrustumCuller::VISIBLE:
+				flags &= ~EntityStore::CULLED_FLAG;
+				m_cullingStats.submitted++;
+				break;
+			case FrustumCuller::OUTSIDE_FRUSTUM:
+				flags |= EntityStore::CULLED_FLAG;
+				m_cullingStats.outsideFrustum++;
+				break;
+			case FrustumCuller::TOO_SMALL:
+				flags |= EntityStore::CULLED_FLAG;
+				m_cullingStats.tooSmall++;
+				break;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  OccludeEntities()
+ *
+ *  This method is used for running the occlusion system.
+ *  The box and plane entities that cover the most of the
+ *  screen are rasterized into the occlusion depth buffer,
+ *  then the world boxes of the entities the culling system
+ *  kept are tested against it, a chunk per job.  Occluders
+ *  are tested too, since one may hide another.
+ ***********************************************************/
+void SceneManager::OccludeEntities()
+{
+	m_cullingStats.occluded = 0;
+	if ((m_bUseCulling == false) || (m_bUseOcclusion == false))
+	{
+		return;
+	}
+
+	m_occlusionCuller->SetView(m_view, m_projection);
+
+	m_occluders.clear();
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::BOUNDS | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		const EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			ShapeMeshes::MESH_SHAPE shape = chunk->meshes[i].shape;
+			if (((chunk->flags[i].flags & EntityStore::CULLED_FLAG) != 0) ||
+				((shape != ShapeMeshes::BOX_MESH) && (shape != ShapeMeshes::PLANE_MESH)))
+			{
+				continue;
+			}
+			OCCLUDER occluder;
+			occluder.screenSize = m_occlusionCuller->GetScreenSize(chunk->bounds[i].worldSphere);
+			occluder.node = chunk->transforms[i].node;
+			occluder.shape = shape;
+			if (occluder.screenSize >= g_MinOccluderPixels)
+			{
+				m_occluders.push_back(occluder);
+			}
+		}
+	}
+	if (m_occluders.empty() == true)
+	{
+		return;
+	}
+	if (m_occluders.size() > g_MaxOccluders)
+	{
+		std::partial_sort(m_occluders.begin(), m_occluders.begin() + g_MaxOccluders, m_occluders.end(),
+			[](const OCCLUDER& a, const OCCLUDER& b)
+		{
+			return(a.screenSize > b.screenSize);
+		});
+		m_occluders.resize(g_MaxOccluders);
+	}
+
+	for (size_t i = 0; i < m_occluders.size(); i++)
+	{
+		const glm::mat4& world = m_sceneGraph->GetWorldMatrix(m_occluders[i].node);
+		if (m_occluders[i].shape == ShapeMeshes::BOX_MESH)
+		{
+			m_occlusionCuller->AddOccluderBox(world);
+		}
+		else
+		{
+			m_occlusionCuller->AddOccluderPlane(world);
+		}
+	}
+	m_occlusionCuller->RasterizeOccluders();
+
+	m_entities->GetChunks(EntityStore::BOUNDS | EntityStore::FLAGS, m_chunks);
+	m_chunkOccluded.assign(m_chunks.size(), 0);
+	JobSystem::Get().ParallelFor(m_chunks.size(), [this](size_t c)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			unsigned int& flags = chunk->flags[i].flags;
+			const EntityStore::BOUNDS_COMPONENT& bounds = chunk->bounds[i];
+			if (((flags & EntityStore::CULLED_FLAG) == 0) &&
+				(m_occlusionCuller->IsOccluded(bounds.worldCenter, bounds.worldExtent) == true))
+			{
+				flags |= EntityStore::CULLED_FLAG;
+				m_chunkOccluded[c]++;
+			}
+		}
+	});
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		m_cullingStats.occluded += m_chunkOccluded[c];
+	}
+	m_cullingStats.submitted -= m_cullingStats.occluded;
+}
+
+/***********************************************************
+ *  RenderEntities()
+ *
+ *  This method is used for running the render system.  The
+ *  entities that are not in the static batch, and were not
+ *  culled, are drawn one at a time, chunk by chunk, and the
+ *  distant ones are collected for the impostor pass.
+ ***********************************************************/
+void SceneManager::RenderEntities()
+{
+	m_entities->GetChunks(EntityStore::TRANSFORM | EntityStore::MESH | EntityStore::MATERIAL | EntityStore::FLAGS, m_chunks);
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		EntityStore::CHUNK* chunk = m_chunks[c];
+		for (int i = 0; i < chunk->count; i++)
+		{
+			// the static batch is not in the shared mesh buffers, so
+			// the visibility buffer draws its objects one at a time
+			if ((m_bUseStaticBatching == true) && (m_bVisibilityPass == false) &&
+				((chunk->flags[i].flags & EntityStore::BATCHED_FLAG) != 0))
+			{
+				continue;
+			}
+			if ((chunk->flags[i].flags & EntityStore::CULLED_FLAG) != 0)
+			{
+				continue;
+			}
+
+			// the G-buffer and the visibility buffer only hold
+			// opaque surfaces, so the see-through objects are drawn
+			// forward after lighting
+			bool bTranslucent = IsTranslucent(chunk, i);
+			if (((m_bGBufferPass == true) || (m_bVisibilityPass == true)) && (bTranslucent == true))
+			{
+				continue;
+			}
+			if (m_bTranslucentPass == true)
+			{
+				if (bTranslucent == true)
+				{
+					DrawEntity(chunk, i);
+				}
+				continue;
+			}
+
+			// impostors write their depth from the atlas, and
+			// see-through objects must not hide what is behind them,
+			// so both are left out of the depth pre-pass.  The
+			// visibility buffer draws the meshes of the impostors
+			bool bImpostorDistance = (m_bVisibilityPass == false) && (chunk->bounds != NULL) &&
+				(IsImpostorDistance(chunk->bounds[i].worldSphere) == true);
+			bool bSkipsPrepass = (bImpostorDistance == true) || (bTranslucent == true);
+			if ((m_bDepthOnlyPass == true) && (bSkipsPrepass == true))
+			{
+				continue;
+			}
+
+			// distant objects are collected and drawn as impostors
+			if (bImpostorDistance == true)
+			{
+				int impostor = FindImpostor(chunk, i);
+				if (impostor >= 0)
+				{
+					const ImpostorAtlas* atlas = m_impostors[impostor].atlas;
+					m_impostors[impostor].instances.push_back(glm::vec4(
+						glm::vec3(m_sceneGraph->GetWorldMatrix(chunk->transforms[i].node)[3]) + atlas->GetCenter(),
+						atlas->GetRadius()));
+					continue;
+				}
+			}
+
+			// objects without depth in the pre-pass are depth
+			// tested as usual
+			if ((m_bDepthPrepassDrawn == true) && (bSkipsPrepass == true))
+			{
+				glDepthFunc(GL_LESS);
+				glDepthMask(GL_TRUE);
+				DrawEntity(chunk, i);
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+				continue;
+			}
+			DrawEntity(chunk, i);
+		}
+	}
+}
+
+/***********************************************************
+ *  IsTranslucent()
+ *
+ *  This method is used for checking whether an entity is
+ *  drawn with a flat color that is not fully opaque.
+ ***********************************************************/
+bool SceneManager::IsTranslucent(const EntityStore::CHUNK* chunk, int index) const
+{
+	return((chunk->textures == NULL) && (chunk->materials[index].color.a < 1.0f));
+}
 
-	SetShaderTexture("background");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("backdrop");
+/***********************************************************
+ *  DrawEntity()
+ *
+ *  This method is used for drawing a single entity of a
+ *  chunk with its own transformations, texture and material.
+ ***********************************************************/
+void SceneManager::DrawEntity(const EntityStore::CHUNK* chunk, int index)
+{
+	int node = chunk->transforms[index].node;
+	const EntityStore::MESH_COMPONENT& mesh = chunk->meshes[index];
+	const EntityStore::MATERIAL_COMPONENT& material = chunk->materials[index];
+
+	// the matrices are cached by the scene graph
+	const glm::mat4& model = m_sceneGraph->GetWorldMatrix(node);
+	SetModelMatrix(model, m_sceneGraph->GetNormalMatrix(node));
+
+	if (chunk->textures == NULL)
+	{
+		SetShaderColor(material.color.r, material.color.g, material.color.b, material.color.a);
+	}
+	else
+	{
+		const EntityStore::TEXTURE_COMPONENT& texture = chunk->textures[index];
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pShaderManager->setSampler2DValue(g_TextureValueName, texture.textureSlot);
+		SetTextureUVScale(texture.UVscale.x, texture.UVscale.y);
+	}
+	SetShaderMaterial(material.material);
+
+	// the resolve pass of the visibility buffer shades the draws
+	// of the entity with the same matrices, color and material
+	if (m_bVisibilityPass == true)
+	{
+		VisibilityBuffer::VISIBLE_OBJECT object;
+		const glm::mat3& normalMatrix = m_sceneGraph->GetNormalMatrix(node);
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				object.model[(column * 4) + row] = model[column][row];
+			}
+			object.color[column] = material.color[column];
+		}
+		// the normal matrix only has three columns, each padded
+		// to four floats
+		for (int column = 0; column < 3; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				object.normalMatrix[(column * 4) + row] = (row < 3) ? normalMatrix[column][row] : 0.0f;
+			}
+		}
+		object.UVscale[0] = 1.0f;
+		object.UVscale[1] = 1.0f;
+		object.material = material.material;
+		object.textureSlot = -1;
+		if (chunk->textures != NULL)
+		{
+			object.UVscale[0] = chunk->textures[index].UVscale.x;
+			object.UVscale[1] = chunk->textures[index].UVscale.y;
+			object.textureSlot = chunk->textures[index].textureSlot;
+		}
+		m_basicMeshes->SetRecordedObject((GLuint)m_visibleObjects.size());
+		m_visibleObjects.push_back(object);
+	}
+
+	// pixels covered by one object space unit at the object
+	// position, using the largest scale of the object
+	float pixelsPerUnit = 0.0f;
+	if (m_viewportHeight > 0)
+	{
+		float scale = m_sceneGraph->GetWorldScale(node);
+		float pixelsPerViewUnit = m_projection[1][1] * 0.5f * (float)m_viewportHeight;
+		// perspective projections shrink objects with their distance
+		float depth = -(m_view * model[3]).z;
+		if (m_projection[3][3] == 1.0f)
+		{
+			pixelsPerUnit = scale * pixelsPerViewUnit;
+		}
+		else if (depth > 0.0f)
+		{
+			pixelsPerUnit = scale * pixelsPerViewUnit / depth;
+		}
+	}
+	m_basicMeshes->SetLodScale(pixelsPerUnit);
+
+	// imported meshes cull their meshlets in object space
+	if ((mesh.shape == ShapeMeshes::IMPORTED_MESH) && (m_viewportHeight > 0))
+	{
+		glm::vec4 cameraPosition = glm::inverse(model) * glm::inverse(m_view)[3];
+		m_basicMeshes->SetCullingView(m_projection * m_view * model, glm::vec3(cameraPosition));
+	}
+	else
+	{
+		m_basicMeshes->ClearCullingView();
+	}
+
+	DrawObjectMesh(mesh.shape, mesh.importedMesh);
+}
+
+/***********************************************************
+ *  DrawObjectMesh()
+ *
+ *  This method is used for drawing the mesh of a shape with
+ *  the transformations and material already in the shader.
+ ***********************************************************/
+void SceneManager::DrawObjectMesh(ShapeMeshes::MESH_SHAPE shape, int importedMesh)
+{
+	switch (shape)
+	{
+	case ShapeMeshes::BOX_MESH:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case ShapeMeshes::CONE_MESH:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case ShapeMeshes::CYLINDER_MESH:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case ShapeMeshes::PLANE_MESH:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case ShapeMeshes::PRISM_MESH:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case ShapeMeshes::PYRAMID3_MESH:
+		m_basicMeshes->DrawPyramid3Mesh();
+		break;
+	case ShapeMeshes::PYRAMID4_MESH:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	case ShapeMeshes::SPHERE_MESH:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case ShapeMeshes::TAPERED_CYLINDER_MESH:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case ShapeMeshes::TORUS_MESH:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	case ShapeMeshes::IMPORTED_MESH:
+		m_basicMeshes->DrawImportedMesh(importedMesh);
+		break;
+	}
+}
+
+/***********************************************************
+ *  IsImpostorDistance()
+ *
+ *  This method is used for checking whether an object is
+ *  far enough from the camera to be drawn as an impostor,
+ *  using the center of its world bounds.  Orthographic
+ *  views have no distance, so they always draw the real
+ *  objects.
+ ***********************************************************/
+bool SceneManager::IsImpostorDistance(const glm::vec4& worldSphere)
+{
+	if ((m_bUseImpostors == false) || (m_viewportHeight <= 0) || (m_projection[3][3] == 1.0f))
+	{
+		return(false);
+	}
+
+	return(glm::length(glm::vec3(worldSphere) - m_cameraPosition) > m_impostorDistance);
+}
+
+/***********************************************************
+ *  FindImpostor()
+ *
+ *  This method is used for getting the impostor of an
+ *  object.  Objects with the same mesh, orientation, scale
+ *  and surface share an impostor, which is captured when
+ *  the first of them needs it.  Objects whose capture
+ *  failed keep being drawn as themselves.
+ ***********************************************************/
+int SceneManager::FindImpostor(EntityStore::CHUNK* chunk, int index)
+{
+	EntityStore::FLAGS_COMPONENT& flags = chunk->flags[index];
+	const EntityStore::MESH_COMPONENT& mesh = chunk->meshes[index];
+	const EntityStore::MATERIAL_COMPONENT& material = chunk->materials[index];
+	int node = chunk->transforms[index].node;
+	glm::mat3 orientation = glm::mat3(m_sceneGraph->GetWorldMatrix(node));
+
+	EntityStore::TEXTURE_COMPONENT texture;
+	texture.textureSlot = -1;
+	texture.UVscale = glm::vec2(1.0f, 1.0f);
+	if (chunk->textures != NULL)
+	{
+		texture = chunk->textures[index];
+	}
+
+	if (flags.impostor < 0)
+	{
+		for (size_t i = 0; (i < m_impostors.size()) && (flags.impostor < 0); i++)
+		{
+			const IMPOSTOR& impostor = m_impostors[i];
+			if ((impostor.mesh.shape == mesh.shape) &&
+				(impostor.mesh.importedMesh == mesh.importedMesh) &&
+				(impostor.orientation == orientation) &&
+				(impostor.texture.textureSlot == texture.textureSlot) &&
+				(impostor.texture.UVscale == texture.UVscale) &&
+				(impostor.material.color == material.color) &&
+				(impostor.material.material == material.material))
+			{
+				flags.impostor = (int)i;
+			}
+		}
+	}
+
+	if (flags.impostor < 0)
+	{
+		IMPOSTOR impostor;
+		impostor.mesh = mesh;
+		impostor.material = material;
+		impostor.texture = texture;
+		impostor.orientation = orientation;
+		impostor.node = node;
+		impostor.atlas = new ImpostorAtlas();
+		impostor.bCaptured = CaptureImpostor(impostor);
+		m_impostors.push_back(impostor);
+		flags.impostor = (int)m_impostors.size() - 1;
+	}
+
+	return((m_impostors[flags.impostor].bCaptured == true) ? flags.impostor : -1);
+}
+
+/***********************************************************
+ *  CaptureImpostor()
+ *
+ *  This method is used for rendering the source object of
+ *  an impostor into its atlas.  The object keeps its
+ *  orientation and scale, so the atlas holds world space
+ *  normals and the impostor only needs a position.  The
+ *  shader writes the unlit surface and its normal instead
+ *  of the lit color while capturing.
+ ***********************************************************/
+bool SceneManager::CaptureImpostor(IMPOSTOR& impostor)
+{
+	const EntityStore::MESH_COMPONENT& mesh = impostor.mesh;
+
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	if ((NULL == m_pShaderManager) ||
+		(m_basicMeshes->GetMeshBounds(mesh.shape, mesh.importedMesh, boundsMin, boundsMax) == false))
+	{
+		return(false);
+	}
+
+	// the source object at the origin, keeping its rotation
+	// and scale
+	glm::mat4 model = glm::mat4(impostor.orientation);
+
+	// bounding sphere of the transformed corners of the box
+	glm::vec3 corners[8];
+	glm::vec3 cornersMin(FLT_MAX);
+	glm::vec3 cornersMax(-FLT_MAX);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(
+			((i & 1) != 0) ? boundsMax.x : boundsMin.x,
+			((i & 2) != 0) ? boundsMax.y : boundsMin.y,
+			((i & 4) != 0) ? boundsMax.z : boundsMin.z);
+		corners[i] = glm::vec3(model * glm::vec4(corner, 1.0f));
+		cornersMin = glm::min(cornersMin, corners[i]);
+		cornersMax = glm::max(cornersMax, corners[i]);
+	}
+	glm::vec3 center = (cornersMin + cornersMax) * 0.5f;
+	float radius = 0.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		radius = glm::max(radius, glm::length(corners[i] - center));
+	}
+
+	SetModelMatrix(model, m_sceneGraph->GetNormalMatrix(impostor.node));
+	const EntityStore::MATERIAL_COMPONENT& material = impostor.material;
+	if (impostor.texture.textureSlot < 0)
+	{
+		SetShaderColor(material.color.r, material.color.g, material.color.b, material.color.a);
+	}
+	else
+	{
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pShaderManager->setSampler2DValue(g_TextureValueName, impostor.texture.textureSlot);
+		SetTextureUVScale(impostor.texture.UVscale.x, impostor.texture.UVscale.y);
+	}
+
+	// every frame shows the full detail of the whole mesh
+	m_basicMeshes->SetLodScale(0.0f);
+	m_basicMeshes->ClearCullingView();
+
+	m_pShaderManager->setBoolValue(g_ImpostorCaptureName, true);
+	bool bCaptured = impostor.atlas->Capture(center, radius,
+		[this, &mesh](const glm::mat4& view, const glm::mat4& projection)
+	{
+		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		DrawObjectMesh(mesh.shape, mesh.importedMesh);
+	});
+	m_pShaderManager->setBoolValue(g_ImpostorCaptureName, false);
+
+	// back to the view of the frame
+	m_pShaderManager->setMat4Value(g_ViewName, m_view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, m_projection);
+
+	std::cout << "Captured impostor atlas: radius " << radius
+		<< ((bCaptured == true) ? "" : " (failed)") << std::endl;
+
+	return(bCaptured);
+}
+
+/***********************************************************
+ *  DrawImpostors()
+ *
+ *  This method is used for drawing the impostors collected
+ *  during the frame.  The spheres of all the impostors go
+ *  into one storage buffer, and each atlas is drawn with a
+ *  single instanced draw of a camera facing quad, whose
+ *  corners the vertex shader makes from gl_VertexID.
+ ***********************************************************/
+void SceneManager::DrawImpostors()
+{
+	m_impostorInstances.clear();
+	for (size_t i = 0; i < m_impostors.size(); i++)
+	{
+		m_impostorInstances.insert(m_impostorInstances.end(),
+			m_impostors[i].instances.begin(), m_impostors[i].instances.end());
+	}
+	if ((NULL == m_pShaderManager) || (m_impostorInstances.empty() == true))
+	{
+		return;
+	}
+	if (LoadImpostorShader() == false)
+	{
+		std::cout << "Impostor program could not be loaded, impostors are turned off" << std::endl;
+		m_bUseImpostors = false;
+		for (size_t i = 0; i < m_impostors.size(); i++)
+		{
+			m_impostors[i].instances.clear();
+		}
+		return;
+	}
+
+	if (m_impostorVao == 0)
+	{
+		glGenVertexArrays(1, &m_impostorVao);
+		glGenBuffers(1, &m_impostorBuffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_impostorBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::vec4) * m_impostorInstances.size(),
+		m_impostorInstances.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ImpostorInstancesBinding, m_impostorBuffer);
+
+	// the impostor program is the only one that writes the
+	// depth of its fragments, so the other draws keep the
+	// early depth test
+	ShaderManager* pShaderManager = m_pShaderManager;
+	m_pShaderManager = m_impostorShaderManager;
+	m_pShaderManager->use();
+	m_pShaderManager->setMat4Value(g_ViewName, m_view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, m_projection);
+	m_pShaderManager->setVec3Value("viewPosition", m_cameraPosition);
+	m_pShaderManager->setBoolValue(g_GBufferPassName, m_bGBufferPass);
+	SetLightingValues();
+
+	glBindVertexArray(m_impostorVao);
+	glVertexAttribI1ui(g_VertexSourceAttrib, g_VertexSourceImpostor);
+	m_pShaderManager->setIntValue("impostorFrames", ImpostorAtlas::GetFramesPerSide());
+	m_pShaderManager->setSampler2DValue("impostorColor", g_ImpostorColorUnit);
+	m_pShaderManager->setSampler2DValue("impostorNormalDepth", g_ImpostorNormalDepthUnit);
+
+	int firstInstance = 0;
+	for (size_t i = 0; i < m_impostors.size(); i++)
+	{
+		IMPOSTOR& impostor = m_impostors[i];
+		if (impostor.instances.empty() == true)
+		{
+			continue;
+		}
+
+		SetShaderMaterial(impostor.material.material);
+		impostor.atlas->Bind(g_ImpostorColorUnit, g_ImpostorNormalDepthUnit);
+		m_pShaderManager->setIntValue("impostorFirstInstance", firstInstance);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)impostor.instances.size());
+
+		firstInstance += (int)impostor.instances.size();
+		impostor.instances.clear();
+	}
+
+	glVertexAttribI1ui(g_VertexSourceAttrib, g_VertexSourceAttributes);
+	glBindVertexArray(0);
+	m_pShaderManager = pShaderManager;
+	m_pShaderManager->use();
+}
 
-	// draw the mesh with transformation values - this plane is used for the backdrop
-	m_basicMeshes->DrawPlaneMesh();
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+
+
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// use the compact quantized vertex format to halve the
+	// vertex bandwidth and buffer memory of the loaded meshes
+	m_basicMeshes->SetCompactVertexFormat(true);
+	// simplified levels for the meshes that are drawn small
+	m_basicMeshes->SetLodGeneration(true);
+
+	// the textures, materials, lights and objects come from
+	// the scene file, so the scene changes without rebuilding
+	SceneFile scene;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (scene.Load(m_sceneFilename.c_str()) == false)
+	{
+		return;
+	}
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - start;
+	std::cout << "Loaded scene file: " << m_sceneFilename
+		<< " (" << scene.GetObjectCount() << " objects) in " << loadTime.count() << " ms" << std::endl;
+
+	if (m_sceneBinaryFilename.empty() == false)
+	{
+		scene.Save(m_sceneBinaryFilename.c_str());
+	}
+
+	// the static objects are transformed into world space
+	// once instead of every frame, when the scene is applied
+	ApplyScene(scene);
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// Send lighting information to the shader.  The lights
+	// with a range are assigned to the clusters of the view,
+	// so each fragment only shades with the lights near it
+	m_clusteredLights->AssignLights(m_view, m_projection);
+	m_clusteredLights->Bind();
+	m_bStaticBatchCulled = false;
+
+	// only the objects that moved since the last frame, and
+	// the objects below them, get new world matrices
+	UpdateTransforms();
+
+	// the shadow maps are kept from the last frame unless a
+	// light or a caster around it changed
+	UpdateShadowMaps();
+	SetLightingValues();
+
+	// objects outside the view, too small to see, or hidden
+	// behind large boxes and planes, are skipped by the batch
+	// and by the render system
+	CullEntities();
+	OccludeEntities();
+
+	if (m_bCountFragments == true)
+	{
+		if (m_fragmentQuery == 0)
+		{
+			glGenQueries(1, &m_fragmentQuery);
+		}
+		glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, m_fragmentQuery);
+	}
+
+	bool bShaded = (m_bUseVisibilityBuffer == true) && (RenderVisibility() == true);
+	if (bShaded == false)
+	{
+		bShaded = (m_bUseDeferred == true) && (RenderDeferred() == true);
+	}
+	if (bShaded == false)
+	{
+		// with the depth of the opaque objects drawn first, only
+		// the fragment that ends up in a pixel passes the equal
+		// test, so each pixel is shaded once
+		m_bDepthPrepassDrawn = (m_bUseDepthPrepass == true) && (DrawDepthPrepass() == true);
+		if (m_bDepthPrepassDrawn == true)
+		{
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+
+		// the static environment is drawn with a few batched draw calls
+		if (m_bUseStaticBatching == true)
+		{
+			DrawStaticBatch();
+		}
+
+		// dynamic objects, and static objects that could not be
+		// batched, are transformed and drawn one at a time
+		RenderEntities();
+
+		if (m_bDepthPrepassDrawn == true)
+		{
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+		}
+
+		DrawImpostors();
+	}
+
+	if (m_bCountFragments == true)
+	{
+		glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+	}
+}
+
+/***********************************************************
+ *  RenderDeferred()
+ *
+ *  This method is used for drawing the opaque objects and
+ *  the impostors into the G-buffer with the scene program,
+ *  lighting the G-buffer into the frame, and then drawing
+ *  the see-through objects forward on top of it.
+ ***********************************************************/
+bool SceneManager::RenderDeferred()
+{
+	if (m_deferredRenderer->BeginGeometryPass() == false)
+	{
+		m_bUseDeferred = false;
+		return(false);
+	}
+	m_bDepthPrepassDrawn = false;
+
+	m_pShaderManager->setBoolValue(g_GBufferPassName, true);
+	m_bGBufferPass = true;
+	if (m_bUseStaticBatching == true)
+	{
+		DrawStaticBatch();
+	}
+	RenderEntities();
+	DrawImpostors();
+	m_bGBufferPass = false;
+	m_pShaderManager->setBoolValue(g_GBufferPassName, false);
+	m_deferredRenderer->EndGeometryPass();
+
+	UploadGpuMaterials();
+	m_deferredRenderer->LightScene(m_view, m_projection, m_cameraPosition, *m_clusteredLights);
+	m_pShaderManager->use();
+
+	m_bTranslucentPass = true;
+	RenderEntities();
+	m_bTranslucentPass = false;
+	return(true);
+}
+
+/***********************************************************
+ *  UploadGpuMaterials()
+ *
+ *  This method is used for copying the defined materials
+ *  into the material table the deferred lighting pass and
+ *  the visibility buffer resolve pass read.  The table is
+ *  only sent to the GPU when a material changed.
+ ***********************************************************/
+void SceneManager::UploadGpuMaterials()
+{
+	std::vector<DeferredRenderer::GPU_MATERIAL> materials(m_objectMaterials.size());
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		DeferredRenderer::GPU_MATERIAL& gpuMaterial = materials[i];
+		for (int c = 0; c < 3; c++)
+		{
+			gpuMaterial.ambientColor[c] = material.ambientColor[c];
+			gpuMaterial.diffuseColor[c] = material.diffuseColor[c];
+			gpuMaterial.specularColor[c] = material.specularColor[c];
+		}
+		gpuMaterial.ambientStrength = material.ambientStrength;
+		gpuMaterial.shininess = material.shininess;
+		gpuMaterial.padding = 0.0f;
+	}
+	m_deferredRenderer->SetMaterials(materials);
+	m_deferredRenderer->BindMaterials();
+}
+
+/***********************************************************
+ *  RenderVisibility()
+ *
+ *  This method is used for drawing the IDs of the opaque
+ *  objects with the geometry program of the visibility
+ *  buffer, recording every draw call of the meshes, then
+ *  shading the IDs into the frame, and drawing the see-
+ *  through objects forward on top of it.  The static batch
+ *  and the impostors are not in the shared mesh buffers,
+ *  so their objects are drawn one at a time as meshes.  A
+ *  frame with draws that could not be recorded falls back
+ *  to the forward path from the next frame on.
+ ***********************************************************/
+bool SceneManager::RenderVisibility()
+{
+	GLuint maxTriangles = m_basicMeshes->GetMaxSharedTriangles();
+	if (maxTriangles == 0)
+	{
+		std::cout << "The visibility buffer needs shared or pulled vertices, using forward shading" << std::endl;
+		m_bUseVisibilityBuffer = false;
+		return(false);
+	}
+	if (m_visibilityBuffer->BeginGeometryPass(maxTriangles) == false)
+	{
+		m_bUseVisibilityBuffer = false;
+		return(false);
+	}
+	m_bDepthPrepassDrawn = false;
+
+	ShaderManager* pShaderManager = m_pShaderManager;
+	m_pShaderManager = m_visibilityBuffer->GetGeometryShader();
+	m_pShaderManager->setMat4Value(g_ViewName, m_view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, m_projection);
+	m_visibleObjects.clear();
+	m_basicMeshes->BeginDrawRecording(m_visibilityBuffer->GetMaxDraws());
+	m_bVisibilityPass = true;
+	RenderEntities();
+	m_bVisibilityPass = false;
+	m_basicMeshes->EndDrawRecording();
+	m_pShaderManager = pShaderManager;
+	m_visibilityBuffer->EndGeometryPass();
+
+	if (m_basicMeshes->GetDroppedDrawCount() > 0)
+	{
+		std::cout << m_basicMeshes->GetDroppedDrawCount()
+			<< " draws are not in the visibility buffer, using forward shading" << std::endl;
+		m_bUseVisibilityBuffer = false;
+	}
 
+	UploadGpuMaterials();
+	m_visibilityBuffer->Resolve(m_view, m_projection, m_cameraPosition, *m_clusteredLights,
+		*m_basicMeshes, m_visibleObjects, m_deferredRenderer->GetMaterialCount());
+	m_pShaderManager->use();
 
+	m_bTranslucentPass = true;
+	RenderEntities();
+	m_bTranslucentPass = false;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadDepthShader()
+ *
+ *  This method is used for loading the depth only program
+ *  the first time it is needed.  It shares the vertex
+ *  shader of the scene program, so the depth pre-pass and
+ *  the shadow maps place the geometry the same way.
+ ***********************************************************/
+bool SceneManager::LoadDepthShader()
+{
+	if (m_depthShaderManager == NULL)
+	{
+		m_depthShaderManager = new ShaderManager();
+		m_depthShaderManager->m_programID = 0;
+		m_depthShaderManager->LoadShaders(
+			"../../Utilities/shaders/vertexShader.glsl",
+			"../../Utilities/shaders/depthShader.glsl");
+	}
+	GLint linked = GL_FALSE;
+	glGetProgramiv(m_depthShaderManager->m_programID, GL_LINK_STATUS, &linked);
+	return(linked == GL_TRUE);
+}
+
+/***********************************************************
+ *  LoadImpostorShader()
+ *
+ *  This method is used for loading the impostor variant of
+ *  the scene program the first time it is needed, and
+ *  returns whether it linked.
+ ***********************************************************/
+bool SceneManager::LoadImpostorShader()
+{
+	if (m_impostorShaderManager == NULL)
+	{
+		m_impostorShaderManager = new ShaderManager();
+		m_impostorShaderManager->m_programID = 0;
+		m_impostorShaderManager->LoadShaders(
+			"../../Utilities/shaders/vertexShader.glsl",
+			"../../Utilities/shaders/fragmentShader.glsl",
+			"#define IMPOSTOR_PROGRAM");
+	}
+	GLint linked = GL_FALSE;
+	glGetProgramiv(m_impostorShaderManager->m_programID, GL_LINK_STATUS, &linked);
+	return(linked == GL_TRUE);
 }
+
+/***********************************************************
+ *  DrawDepthPrepass()
+ *
+ *  This method is used for drawing the opaque objects into
+ *  the depth buffer only.  The depth only program is
+ *  loaded the first time, and the draw functions run with
+ *  it in place of the scene program, so both passes draw
+ *  the same geometry.  Impostors and see-through objects
+ *  are left out.
+ ***********************************************************/
+bool SceneManager::DrawDepthPrepass()
+{
+	if (LoadDepthShader() == false)
+	{
+		m_bUseDepthPrepass = false;
+		return(false);
+	}
+
+	ShaderManager* pShaderManager = m_pShaderManager;
+	m_pShaderManager = m_depthShaderManager;
+	m_pShaderManager->use();
+	m_pShaderManager->setMat4Value(g_ViewName, m_view);
+	m_pShaderManager->setMat4Value(g_ProjectionName, m_projection);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	m_bDepthOnlyPass = true;
+
+	if (m_bUseStaticBatching == true)
+	{
+		DrawStaticBatch();
+	}
+	RenderEntities();
+
+	m_bDepthOnlyPass = false;
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	m_pShaderManager = pShaderManager;
+	m_pShaderManager->use();
+	return(true);
+}
\ No newline at end of file
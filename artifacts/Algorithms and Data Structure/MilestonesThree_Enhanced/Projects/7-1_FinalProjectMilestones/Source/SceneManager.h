@@ -11,7 +11,22 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "StaticBatch.h"
+#include "SceneGraph.h"
+#include "EntityStore.h"
+#include "ImpostorAtlas.h"
+#include "SceneFile.h"
+#include "FrustumCuller.h"
+#include "SceneBvh.h"
+#include "OcclusionCuller.h"
+#include "GpuCuller.h"
+#include "ClusteredLights.h"
+#include "DeferredRenderer.h"
+#include "VisibilityBuffer.h"
+#include "LightmapBaker.h"
+#include "ShadowMaps.h"
 
+#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -29,10 +44,22 @@ public:
 	// destructor
 	~SceneManager();
 
+	// objects of a frame that were drawn and culled
+	struct CULLING_STATS
+	{
+		int submitted;
+		int outsideFrustum;
+		int tooSmall;
+		int occluded;
+	};
+
 	struct TEXTURE_INFO
 	{
 		std::string tag;
 		uint32_t ID;
+		// image file, and its write time when it was decoded
+		std::string filename;
+		std::filesystem::file_time_type fileTime;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,6 +72,13 @@ public:
 		std::string tag;
 	};
 
+	// material table entry of the static batch
+	struct BATCH_MATERIAL
+	{
+		int material;
+		glm::vec4 color;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -56,9 +90,165 @@ private:
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// lights of the scene file, and the clusters of the view
+	// they are assigned to every frame
+	std::vector<SceneFile::SCENE_LIGHT> m_lights;
+	ClusteredLights* m_clusteredLights;
+	// scene file the scene is built from, and the binary file
+	// it is saved to when not empty
+	std::string m_sceneFilename;
+	std::string m_sceneBinaryFilename;
+	// records of the scene file as last applied, and what was
+	// made from them, so a reload only touches what changed
+	std::vector<SceneFile::SCENE_GROUP> m_sceneGroups;
+	std::vector<int> m_sceneGroupNodes;
+	std::vector<SceneFile::SCENE_OBJECT> m_sceneObjects;
+	std::vector<int> m_sceneEntities;
+	// built-in shape meshes that are loaded
+	bool m_bShapeLoaded[ShapeMeshes::IMPORTED_MESH];
+
+	// what applying a scene file changed in the live scene
+	struct SCENE_CHANGES
+	{
+		int textures;			// textures decoded and uploaded
+		int materials;			// materials added or changed
+		int meshes;				// meshes loaded
+		int objects;			// objects added, removed or changed
+		int patchedObjects;		// static batch objects patched in place
+		bool bRebuiltBatch;		// the static batch was built again
+	};
+	// components of the objects of the 3D scene
+	EntityStore* m_entities;
+	// transforms of the objects and of the groups they belong to
+	SceneGraph* m_sceneGraph;
+	// chunks of the current system, reused between frames
+	std::vector<EntityStore::CHUNK*> m_chunks;
+	// pre-transformed geometry of the static objects
+	StaticBatch* m_staticBatch;
+	// materials referenced by the static batch vertices
+	std::vector<BATCH_MATERIAL> m_batchMaterials;
+	// draw the static objects from the static batch
+	bool m_bUseStaticBatching;
+	// view of the current frame, for the level of detail selection
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	int m_viewportHeight;
+	glm::vec3 m_cameraPosition;
+
+	// view frustum test of the world bounds, the bounds of the
+	// chunk being tested, one array per component, and the
+	// results
+	FrustumCuller* m_frustumCuller;
+	bool m_bUseCulling;
+	std::vector<float> m_cullBounds[7];
+	std::vector<unsigned char> m_cullResults;
+	// static batch entries that are not culled this frame
+	std::vector<unsigned char> m_batchEntryVisible;
+	CULLING_STATS m_cullingStats;
+
+	// depth buffer of the largest boxes and planes of the
+	// frame, which hides the entities behind them, and the
+	// occluders picked for the frame
+	struct OCCLUDER
+	{
+		float screenSize;
+		int node;
+		ShapeMeshes::MESH_SHAPE shape;
+	};
+	OcclusionCuller* m_occlusionCuller;
+	bool m_bUseOcclusion;
+	std::vector<OCCLUDER> m_occluders;
+	// entities occluded in each chunk by the parallel test
+	std::vector<int> m_chunkOccluded;
+
+	// view test of the static batch entries in a compute
+	// shader, which writes the draws of the visible ones.  The
+	// draws are uploaded again when the batch changes.  The
+	// batch is culled once a frame, and the shading pass after
+	// the pre-pass draws what the pre-pass culled
+	GpuCuller* m_gpuCuller;
+	GLuint m_cullProgram;
+	bool m_bUseGpuCulling;
+	bool m_bGpuDrawsDirty;
+	bool m_bStaticBatchCulled;
+
+	// depth only program of the pre-pass, which shares the
+	// vertex shader, and whether the pre-pass is selected, is
+	// being drawn, or was drawn this frame
+	ShaderManager* m_depthShaderManager;
+	bool m_bUseDepthPrepass;
+	bool m_bDepthOnlyPass;
+	bool m_bDepthPrepassDrawn;
+	// variant of the scene program that draws the impostors,
+	// the only one that writes the depth of its fragments
+	ShaderManager* m_impostorShaderManager;
+	// fragment shader invocations of a frame, when counted,
+	// and whether the driver has pipeline statistics queries
+	GLuint m_fragmentQuery;
+	bool m_bCountFragments;
+	bool m_bFragmentQuerySupported;
+
+	// G-buffer and lighting pass of the deferred path, and
+	// whether the opaque objects are being drawn into the
+	// G-buffer or the see-through ones forward after it
+	DeferredRenderer* m_deferredRenderer;
+	bool m_bUseDeferred;
+	bool m_bGBufferPass;
+	bool m_bTranslucentPass;
+
+	// IDs and resolve pass of the visibility buffer path, the
+	// objects of the recorded draws, and whether the IDs are
+	// being drawn
+	VisibilityBuffer* m_visibilityBuffer;
+	bool m_bUseVisibilityBuffer;
+	bool m_bVisibilityPass;
+	std::vector<VisibilityBuffer::VISIBLE_OBJECT> m_visibleObjects;
+
+	// baked ambient and diffuse light of the static batch,
+	// whether it is selected, and whether the lights or the
+	// materials changed since it was baked
+	LightmapBaker* m_lightmapBaker;
+	bool m_bUseLightmaps;
+	bool m_bLightmapDirty;
+
+	// depth cube maps of the first lights of the scene, drawn
+	// again only when the light or a caster around it changes,
+	// whether they are selected, and the static batch entries
+	// inside the cube face being drawn
+	ShadowMaps* m_shadowMaps;
+	bool m_bUseShadows;
+	std::vector<unsigned char> m_shadowEntryVisible;
+
+	// world boxes of the entities, for the spatial queries
+	SceneBvh* m_sceneBvh;
+
+	// atlas captured from an object, shared by all the objects
+	// that look the same, and the spheres of the objects that
+	// are drawn with it in the current frame
+	struct IMPOSTOR
+	{
+		EntityStore::MESH_COMPONENT mesh;
+		EntityStore::MATERIAL_COMPONENT material;
+		EntityStore::TEXTURE_COMPONENT texture;	// texture slot -1 without a texture
+		glm::mat3 orientation;					// rotation and scale of the world matrix
+		int node;
+		ImpostorAtlas* atlas;
+		bool bCaptured;
+		std::vector<glm::vec4> instances;
+	};
+	std::vector<IMPOSTOR> m_impostors;
+	// draw the objects beyond the impostor distance as impostors
+	bool m_bUseImpostors;
+	float m_impostorDistance;
+	// empty vertex array and instance buffer of the impostor quads
+	GLuint m_impostorVao;
+	GLuint m_impostorBuffer;
+	std::vector<glm::vec4> m_impostorInstances;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// decode an image file into an existing OpenGL texture
+	bool UploadGLTexture(const char* filename, GLuint textureID);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
@@ -68,6 +258,16 @@ private:
 	int FindTextureSlot(std::string tag);
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string tag);
+
+	// calculate the model matrix from the
+	// passed in transformation values
+	glm::mat4 CalculateModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -78,6 +278,11 @@ private:
 		float ZrotationDegrees,
 		glm::vec3 positionXYZ);
 
+	// set a model matrix and its normal matrix into the shader
+	void SetModelMatrix(
+		const glm::mat4& model,
+		const glm::mat3& normalMatrix);
+
 	// set the color values into the shader
 	void SetShaderColor(
 		float redColorValue,
@@ -96,6 +301,132 @@ private:
 	// set the object material into the shader
 	void SetShaderMaterial(
 		std::string materialTag);
+	void SetShaderMaterial(
+		int material);
+
+	// add an object to the 3D scene and return its entity
+	int AddSceneObject(
+		ShapeMeshes::MESH_SHAPE shape,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		std::string textureTag,
+		glm::vec4 color,
+		std::string materialTag,
+		bool bStatic = true,
+		int parentNode = -1);
+
+	// create the entity of a scene object, with its texture
+	// and material already resolved to a slot and an index
+	int CreateSceneEntity(
+		ShapeMeshes::MESH_SHAPE shape,
+		glm::vec3 scaleXYZ,
+		glm::quat rotation,
+		glm::vec3 positionXYZ,
+		bool bTextured,
+		int textureSlot,
+		glm::vec4 color,
+		int material,
+		bool bStatic,
+		int parentNode);
+
+	// load the mesh of a built-in shape
+	void LoadShapeMesh(ShapeMeshes::MESH_SHAPE shape);
+	// bring the textures, materials, lights, groups and
+	// objects of the live scene in line with a scene file
+	SCENE_CHANGES ApplyScene(const SceneFile& scene);
+	// write the batched objects whose nodes changed over their
+	// old vertices, false when the batch must be built again
+	bool PatchStaticBatch(const std::vector<int>& changedNodes, int& nPatched);
+
+	// add a group node that moves the objects and groups
+	// added below it, and return the node index
+	int AddSceneNode(
+		glm::vec3 positionXYZ,
+		int parentNode = -1);
+
+	// set the object space bounds of an entity from its mesh
+	void SetLocalBounds(
+		EntityStore::BOUNDS_COMPONENT* bounds,
+		ShapeMeshes::MESH_SHAPE shape,
+		int importedMesh);
+
+	// find or add an entry of the static batch material table
+	int FindBatchMaterial(int material, glm::vec4 color);
+	// merge the static objects into the static batch
+	void BuildStaticBatch();
+	// set the static batch material table into the shader
+	void SetBatchMaterials();
+	// draw the static batch
+	void DrawStaticBatch();
+	// bake the lightmap of the static batch again when the
+	// lights or the materials changed, false without one
+	bool BakeLightmap();
+	// upload the static batch entries to the GPU culler
+	void UploadGpuDraws();
+	// draw the shadow maps that changed, and set them into the
+	// shader
+	void UpdateShadowMaps();
+	// set the lights and the shadow maps of the frame into the
+	// current program
+	void SetLightingValues();
+	// draw the static or the dynamic shadow casters inside a
+	// cube face of a shadow map with the depth only program
+	void DrawShadowCasters(const glm::mat4& view, const glm::mat4& projection, bool bStatic);
+	// transform system - update the world matrices and the
+	// world bounds of the entities that moved
+	void UpdateTransforms();
+	// bring the world boxes of the spatial index up to date,
+	// building it again when entities were added or removed
+	void UpdateSpatialIndex();
+	// culling system - mark the entities whose world bounds
+	// are outside the view or too small to see
+	void CullEntities();
+	// occlusion system - mark the entities that are hidden
+	// behind the largest boxes and planes of the frame
+	void OccludeEntities();
+	// render system - draw the entities that are not in the
+	// static batch, or collect them as impostors
+	void RenderEntities();
+	// draw a single entity of a chunk with its own draw call
+	void DrawEntity(const EntityStore::CHUNK* chunk, int index);
+	// draw the mesh of a shape with the current shader settings
+	void DrawObjectMesh(ShapeMeshes::MESH_SHAPE shape, int importedMesh);
+
+	// check whether a bounding sphere is far enough for the
+	// entity to be an impostor
+	bool IsImpostorDistance(const glm::vec4& worldSphere);
+	// find or capture the impostor of an entity of a chunk,
+	// -1 when it has none
+	int FindImpostor(EntityStore::CHUNK* chunk, int index);
+	// render the atlas of an impostor from its source object
+	bool CaptureImpostor(IMPOSTOR& impostor);
+	// draw the impostors collected during the frame
+	void DrawImpostors();
+
+	// load the depth only program the first time, false when
+	// it could not be loaded
+	bool LoadDepthShader();
+	// load the impostor variant of the scene program the first
+	// time, false when it could not be loaded
+	bool LoadImpostorShader();
+	// draw the depth of the opaque objects with the depth only
+	// program, false when the program could not be loaded
+	bool DrawDepthPrepass();
+	// check whether an entity is see-through, so it is left
+	// out of the depth pre-pass and of the static batch
+	bool IsTranslucent(const EntityStore::CHUNK* chunk, int index) const;
+	// upload the material table of the deferred and the
+	// visibility buffer paths, and bind it
+	void UploadGpuMaterials();
+	// draw the frame with the deferred path, false when the
+	// G-buffer is not available
+	bool RenderDeferred();
+	// draw the frame with the visibility buffer path, false
+	// when the IDs cannot be drawn or resolved
+	bool RenderVisibility();
 
 public:
 
@@ -104,4 +435,104 @@ public:
 	void PrepareScene();
 	void RenderScene();
 
+	// select the scene file that PrepareScene() builds the
+	// scene from, in text or binary form, and a file the
+	// compiled binary form is written to.  Empty names keep
+	// the desk scene and skip the binary file
+	void SetSceneFile(
+		std::string filename,
+		std::string binaryFilename);
+
+	// load the scene file again and apply only what changed
+	// since it was last loaded
+	bool ReloadScene();
+
+	// select whether static objects are drawn from the
+	// static batch or with one draw call per object
+	void SetStaticBatching(bool bEnable);
+
+	// select how the mesh vertices are fetched, which
+	// must be called before PrepareScene()
+	void SetVertexFetch(ShapeMeshes::VERTEX_FETCH fetch);
+
+	// set the view of the current frame, which selects
+	// the level of detail of the drawn objects
+	void SetSceneView(
+		glm::mat4 view,
+		glm::mat4 projection,
+		int viewportHeight);
+
+	// draw the objects that are not in the static batch as
+	// impostors when they are farther than the passed in
+	// distance from the camera
+	void SetImpostors(bool bEnable, float distance);
+
+	// select whether objects outside the view, or whose
+	// bounding sphere covers fewer than the passed in number
+	// of pixels, are skipped before they are drawn
+	void SetCulling(bool bEnable, float minPixels);
+	// select whether objects hidden behind large boxes and
+	// planes are skipped too, while culling is on
+	void SetOcclusionCulling(bool bEnable);
+	// select whether the static batch entries are tested on
+	// the GPU, which then draws the visible ones itself
+	void SetGpuCulling(bool bEnable);
+	// select whether the depth of the opaque objects is drawn
+	// first, so each pixel is only shaded once
+	void SetDepthPrepass(bool bEnable);
+	bool GetDepthPrepass() const;
+	// select whether the frame is drawn with the deferred
+	// path, which lights every pixel once from a G-buffer,
+	// instead of shading every object as it is drawn
+	void SetDeferredShading(bool bEnable);
+	// select whether the frame is drawn with the visibility
+	// buffer path, which only draws triangle IDs and shades
+	// every pixel once from the triangle it shows
+	void SetVisibilityBuffer(bool bEnable);
+	// select whether the ambient and diffuse light of the
+	// static batch is baked into a lightmap, darkened by the
+	// passed in number of ambient occlusion rays per texel,
+	// which must be called before PrepareScene()
+	void SetLightmaps(bool bEnable, int aoSamples);
+	// select whether the first lights of the scene cast
+	// shadows from cube maps that are kept between frames
+	void SetShadows(bool bEnable);
+	// select whether the fragment shader invocations of each
+	// frame are counted, check whether they are, and get the
+	// count of the last frame
+	void SetFragmentCounting(bool bEnable);
+	bool IsCountingFragments() const;
+	GLuint64 GetFragmentCount() const;
+	// get the culling counters of the last frame
+	const CULLING_STATS& GetCullingStats() const;
+
+	// get the entities whose world box is inside or crosses
+	// the frustum of the passed in view projection matrix
+	void QueryFrustum(const glm::mat4& viewProjection, std::vector<int>& entities);
+	// get the entity whose world box a ray enters first,
+	// -1 when none is within the passed in distance
+	int RayCast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance);
+	// get the entity whose world box is closest to a
+	// position, -1 when none is within the passed in distance
+	int FindNearestObject(
+		const glm::vec3& position,
+		float maxDistance,
+		float& distance);
+
+	// add a grid of dynamic objects that switch meshes
+	// on every draw, for benchmarking the vertex fetch
+	void AddBenchmarkObjects(int count);
+	// add a grid of small lights over the benchmark objects
+	void AddBenchmarkLights(int count);
+
+	// import the meshes of a binary glTF file and add
+	// them to the scene as one object
+	bool AddModel(
+		const char* filename,
+		glm::vec3 scaleXYZ,
+		glm::vec3 positionXYZ);
 };
\ No newline at end of file
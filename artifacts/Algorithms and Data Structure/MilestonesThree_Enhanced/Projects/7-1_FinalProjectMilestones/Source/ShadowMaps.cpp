@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.cpp
+// ============
+// keep a depth cube map for each shadowed light of the scene, and only draw
+// it again when the light or a shadow caster around it changes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowMaps.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// near plane of the cube faces, and the far plane of the
+	// lights without a range
+	const float g_NearPlane = 0.05f;
+	const float g_GlobalLightReach = 40.0f;
+
+	// slope and constant depth bias of the drawn casters, so
+	// a surface does not shadow itself
+	const float g_SlopeBias = 2.0f;
+	const float g_ConstantBias = 4.0f;
+
+	// view direction and up vector of each cube face, in the
+	// order of the cube map faces
+	const glm::vec3 g_FaceDirections[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_FaceUps[6] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+/***********************************************************
+ *  ShadowMaps()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowMaps::ShadowMaps()
+{
+	for (int i = 0; i < MAP_COUNT; i++)
+	{
+		m_maps[i] = 0;
+	}
+	m_mapLayers = 0;
+	m_framebuffer = 0;
+	m_bFailed = false;
+}
+
+/***********************************************************
+ *  ~ShadowMaps()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowMaps::~ShadowMaps()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the lights of the
+ *  scene, of which the first ones are shadowed.  It can be
+ *  passed the same lights again, since only the lights
+ *  that changed are drawn again.
+ ***********************************************************/
+void ShadowMaps::SetLights(const std::vector<SceneFile::SCENE_LIGHT>& lights)
+{
+	size_t count = std::min(lights.size(), (size_t)MAX_SHADOW_LIGHTS);
+	size_t oldCount = m_lights.size();
+	m_lights.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 position = glm::vec3(lights[i].position[0], lights[i].position[1], lights[i].position[2]);
+		float farPlane = (lights[i].range > 0.0f) ? lights[i].range : g_GlobalLightReach;
+
+		SHADOW_LIGHT& light = m_lights[i];
+		if ((i >= oldCount) || (light.position != position) || (light.farPlane != farPlane))
+		{
+			light.position = position;
+			light.farPlane = farPlane;
+			light.bBaseDirty = true;
+			light.bShadowDirty = true;
+		}
+	}
+}
+
+int ShadowMaps::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+float ShadowMaps::GetNearPlane() const
+{
+	return(g_NearPlane);
+}
+
+float ShadowMaps::GetFarPlane(int light) const
+{
+	return(m_lights[light].farPlane);
+}
+
+/***********************************************************
+ *  MarkChanged()
+ *
+ *  This method is used for marking the cube maps that a
+ *  caster was or is now inside of.  A caster outside the
+ *  far plane of a light cannot change its shadows, so the
+ *  cube map of that light is kept.
+ ***********************************************************/
+void ShadowMaps::MarkChanged(const glm::vec3& boxMin, const glm::vec3& boxMax, bool bStatic)
+{
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		SHADOW_LIGHT& light = m_lights[i];
+		glm::vec3 offset = glm::clamp(light.position, boxMin, boxMax) - light.position;
+		if (glm::dot(offset, offset) > light.farPlane * light.farPlane)
+		{
+			continue;
+		}
+
+		if (bStatic == true)
+		{
+			light.bBaseDirty = true;
+		}
+		light.bShadowDirty = true;
+	}
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for drawing every cube map again,
+ *  when the casters changed in a way that cannot be traced
+ *  to their boxes.
+ ***********************************************************/
+void ShadowMaps::Invalidate()
+{
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		m_lights[i].bBaseDirty = true;
+		m_lights[i].bShadowDirty = true;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for bringing the shadow layers up to
+ *  date.  A changed base layer is cleared and drawn with
+ *  the static casters.  A changed shadow layer is copied
+ *  from its base layer, and the dynamic casters are drawn
+ *  over the copy.
+ ***********************************************************/
+int ShadowMaps::Update(const DRAW_FUNCTION& drawCasters)
+{
+	if ((m_lights.empty() == true) || (m_bFailed == true))
+	{
+		return(0);
+	}
+	if ((m_mapLayers != (int)m_lights.size()) && (CreateMaps() == false))
+	{
+		std::cout << "Shadow maps could not be created, the scene is drawn without shadows" << std::endl;
+		m_bFailed = true;
+		return(0);
+	}
+
+	// the maps can be drawn in the middle of a frame
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	bool bOffsetEnabled = (glIsEnabled(GL_POLYGON_OFFSET_FILL) == GL_TRUE);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, MAP_SIZE, MAP_SIZE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(g_SlopeBias, g_ConstantBias);
+
+	int nFaces = 0;
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		SHADOW_LIGHT& light = m_lights[i];
+		if (light.bBaseDirty == true)
+		{
+			DrawFaces(m_maps[BASE_MAP], (int)i, light.position, light.farPlane, true, true, drawCasters);
+			light.bBaseDirty = false;
+			light.bShadowDirty = true;
+			nFaces += 6;
+		}
+		if (light.bShadowDirty == true)
+		{
+			glCopyImageSubData(
+				m_maps[BASE_MAP], GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, (GLint)i * 6,
+				m_maps[SHADOW_MAP], GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, (GLint)i * 6,
+				MAP_SIZE, MAP_SIZE, 6);
+			DrawFaces(m_maps[SHADOW_MAP], (int)i, light.position, light.farPlane, false, false, drawCasters);
+			light.bShadowDirty = false;
+			nFaces += 6;
+		}
+	}
+
+	if (bOffsetEnabled == false)
+	{
+		glDisable(GL_POLYGON_OFFSET_FILL);
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	return(nFaces);
+}
+
+/***********************************************************
+ *  DrawFaces()
+ *
+ *  This method is used for drawing the casters into the six
+ *  faces of a layer, each with a 90 degree view from the
+ *  light, so the faces meet at their edges.
+ ***********************************************************/
+void ShadowMaps::DrawFaces(
+	GLuint texture,
+	int layer,
+	const glm::vec3& position,
+	float farPlane,
+	bool bStatic,
+	bool bClear,
+	const DRAW_FUNCTION& drawCasters)
+{
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, g_NearPlane, farPlane);
+	for (int face = 0; face < 6; face++)
+	{
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, (layer * 6) + face);
+		if (bClear == true)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+		glm::mat4 view = glm::lookAt(position, position + g_FaceDirections[face], g_FaceUps[face]);
+		drawCasters(view, projection, bStatic);
+	}
+}
+
+/***********************************************************
+ *  CreateMaps()
+ *
+ *  This method is used for creating the base and shadow
+ *  cube map arrays with a layer per light.  The shadow
+ *  layers compare the depth when they are sampled, and the
+ *  filter blends four comparisons at the shadow edges.
+ ***********************************************************/
+bool ShadowMaps::CreateMaps()
+{
+	if (m_maps[0] != 0)
+	{
+		glDeleteTextures(MAP_COUNT, m_maps);
+	}
+	m_mapLayers = (int)m_lights.size();
+
+	glGenTextures(MAP_COUNT, m_maps);
+	for (int i = 0; i < MAP_COUNT; i++)
+	{
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_maps[i]);
+		glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_DEPTH_COMPONENT24, MAP_SIZE, MAP_SIZE, m_mapLayers * 6);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+	if (m_framebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_framebuffer);
+	}
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_maps[BASE_MAP], 0, 0);
+	glDrawBuffer(GL_NONE);
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+
+	// every layer is new
+	Invalidate();
+	return(bComplete);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the shadow layers, the
+ *  ones with the dynamic casters, to a texture unit.
+ ***********************************************************/
+void ShadowMaps::Bind(GLuint unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_maps[SHADOW_MAP]);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the cube maps and the
+ *  framebuffer they are drawn with.
+ ***********************************************************/
+void ShadowMaps::Destroy()
+{
+	if (m_maps[0] != 0)
+	{
+		glDeleteTextures(MAP_COUNT, m_maps);
+		for (int i = 0; i < MAP_COUNT; i++)
+		{
+			m_maps[i] = 0;
+		}
+	}
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	m_mapLayers = 0;
+	m_bFailed = false;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.h
+// ============
+// keep a depth cube map for each shadowed light of the scene, and only draw
+// it again when the light or a shadow caster around it changes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  ShadowMaps
+ *
+ *  This class keeps one depth cube map per shadowed light,
+ *  as layers of two cube map arrays.  The base layer of a
+ *  light holds the depth of the static casters, and is only
+ *  drawn again when the light moves or a static caster
+ *  inside its reach changes.  The shadow layer the shader
+ *  reads is a copy of the base layer with the dynamic
+ *  casters drawn over it, which is only made again when
+ *  the base layer was drawn or a dynamic caster inside the
+ *  reach changed.  A frame where nothing moved draws no
+ *  shadow faces at all.
+ ***********************************************************/
+class ShadowMaps
+{
+public:
+	// called to draw the static or the dynamic casters with
+	// the passed in view and projection of a cube face
+	typedef std::function<void(const glm::mat4& view, const glm::mat4& projection, bool bStatic)> DRAW_FUNCTION;
+
+	// constructor
+	ShadowMaps();
+	// destructor
+	~ShadowMaps();
+
+	// number of lights with a shadow map, the first ones of
+	// the scene, and texels across each cube face
+	static const int MAX_SHADOW_LIGHTS = 4;
+	static const int MAP_SIZE = 512;
+
+	// set the lights of the scene.  The lights that moved, or
+	// whose reach changed, draw their cube maps again
+	void SetLights(const std::vector<SceneFile::SCENE_LIGHT>& lights);
+	int GetLightCount() const;
+	// distance of the near plane of every cube face, and of
+	// the far plane of a light, which is its range or the
+	// reach of the lights without one
+	float GetNearPlane() const;
+	float GetFarPlane(int light) const;
+
+	// mark the cube maps that can see a world box as changed,
+	// the base layers for a static caster and only the shadow
+	// layers for a dynamic one
+	void MarkChanged(const glm::vec3& boxMin, const glm::vec3& boxMax, bool bStatic);
+	// draw every cube map again
+	void Invalidate();
+
+	// draw the layers that changed, and return the number of
+	// cube faces drawn.  The current framebuffer and viewport
+	// are restored afterwards
+	int Update(const DRAW_FUNCTION& drawCasters);
+
+	// bind the shadow layers to the passed in texture unit
+	void Bind(GLuint unit) const;
+
+	// free the cube maps
+	void Destroy();
+
+private:
+	// create the cube map arrays for the current light count
+	bool CreateMaps();
+	// draw the casters into the six faces of a layer of a
+	// cube map array
+	void DrawFaces(GLuint texture, int layer, const glm::vec3& position, float farPlane,
+		bool bStatic, bool bClear, const DRAW_FUNCTION& drawCasters);
+
+	// shadowed light, and what changed since its layers were
+	// drawn
+	struct SHADOW_LIGHT
+	{
+		glm::vec3 position;
+		float farPlane;
+		bool bBaseDirty;
+		bool bShadowDirty;
+	};
+	std::vector<SHADOW_LIGHT> m_lights;
+
+	enum MAP
+	{
+		BASE_MAP,
+		SHADOW_MAP,
+		MAP_COUNT
+	};
+
+	GLuint m_maps[MAP_COUNT];
+	int m_mapLayers;
+	GLuint m_framebuffer;
+	bool m_bFailed;
+};
\ No newline at end of file
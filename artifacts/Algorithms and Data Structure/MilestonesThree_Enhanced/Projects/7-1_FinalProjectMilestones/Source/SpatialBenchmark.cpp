@@ -0,0 +1,318 @@
+///////////////////////////////////////////////////////////////////////////////
+// spatialbenchmark.cpp
+// ============
+// compare the queries of the scene bounding volume hierarchy with testing
+// every object, for growing numbers of objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SpatialBenchmark.h"
+#include "SceneBvh.h"
+#include "FrustumCuller.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// boxes per case
+	const int g_BoxCounts[] = { 1000, 10000, 100000, 1000000 };
+	// the boxes are spread over a cube this many units across
+	const float g_WorldSize = 1000.0f;
+	// share of the boxes that move before a refit
+	const float g_MovedShare = 0.01f;
+	// queries of each kind per timed round
+	const int g_FrustumQueries = 20;
+	const int g_PointQueries = 1000;
+	const int g_Rounds = 5;
+
+	// boxes of a case, as corners and in the component arrays
+	// of the frustum culler
+	struct BOX_ARRAYS
+	{
+		std::vector<glm::vec3> boxMin;
+		std::vector<glm::vec3> boxMax;
+		std::vector<float> bounds[7];
+	};
+
+	// linear congruential generator, in [0, 1)
+	float NextRandom(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return((float)(seed >> 8) / 16777216.0f);
+	}
+
+	glm::vec3 NextPosition(unsigned int& seed)
+	{
+		return(glm::vec3(NextRandom(seed), NextRandom(seed), NextRandom(seed)) * g_WorldSize);
+	}
+
+	/***********************************************************
+	 *  FillBoxes()
+	 *
+	 *  Make repeatable boxes of 0.5 to 4.5 units across for
+	 *  the passed in number of objects.
+	 ***********************************************************/
+	void FillBoxes(int count, BOX_ARRAYS& boxes)
+	{
+		boxes.boxMin.resize(count);
+		boxes.boxMax.resize(count);
+		for (int b = 0; b < 7; b++)
+		{
+			boxes.bounds[b].resize(count);
+		}
+
+		unsigned int seed = 12345;
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 center = NextPosition(seed);
+			glm::vec3 extent = glm::vec3(NextRandom(seed), NextRandom(seed), NextRandom(seed)) * 2.0f + 0.25f;
+			boxes.boxMin[i] = center - extent;
+			boxes.boxMax[i] = center + extent;
+			for (int c = 0; c < 3; c++)
+			{
+				boxes.bounds[c][i] = center[c];
+				boxes.bounds[3 + c][i] = extent[c];
+			}
+			boxes.bounds[6][i] = glm::length(extent);
+		}
+	}
+
+	/***********************************************************
+	 *  TimeRounds()
+	 *
+	 *  Run a case in rounds and return the fastest round in
+	 *  milliseconds, which is the least disturbed by the rest
+	 *  of the system.
+	 ***********************************************************/
+	double TimeRounds(const std::function<void()>& round)
+	{
+		double bestMs = 0.0;
+		for (int i = 0; i < g_Rounds; i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			round();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			bestMs = (i == 0) ? elapsed.count() : std::min(bestMs, elapsed.count());
+		}
+		return(bestMs);
+	}
+
+	void PrintQueries(
+		const char* label,
+		int count,
+		int nQueries,
+		double flatMs,
+		double bvhMs,
+		size_t flatHits,
+		size_t bvhHits)
+	{
+		std::cout << "BENCHMARK: bvh | " << label
+			<< " | objects: " << count
+			<< " | flat: " << flatMs * 1000.0 / (double)nQueries << " us/query"
+			<< " | bvh: " << bvhMs * 1000.0 / (double)nQueries << " us/query"
+			<< " | speedup: " << flatMs / bvhMs << "x"
+			<< " | hits: " << bvhHits;
+		if (flatHits != bvhHits)
+		{
+			std::cout << " | flat hits differ: " << flatHits;
+		}
+		std::cout << std::endl;
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This function is used for running the benchmark.  The
+ *  flat frustum pass is the culling pass of the renderer,
+ *  and the flat ray and nearest passes test every box the
+ *  way the tree tests its leaves.  Each query kind counts
+ *  its hits both ways, so a mismatch shows in the output.
+ ***********************************************************/
+void SpatialBenchmark::Run()
+{
+	for (size_t countIndex = 0; countIndex < sizeof(g_BoxCounts) / sizeof(g_BoxCounts[0]); countIndex++)
+	{
+		int count = g_BoxCounts[countIndex];
+
+		BOX_ARRAYS boxes;
+		FillBoxes(count, boxes);
+
+		SceneBvh bvh;
+		double buildMs = TimeRounds([&]()
+		{
+			bvh.Clear();
+			for (int i = 0; i < count; i++)
+			{
+				bvh.SetItem(i, boxes.boxMin[i], boxes.boxMax[i]);
+			}
+			bvh.Build();
+		});
+
+		// each round moves other boxes by a small step, so the
+		// refit is timed on a tree that stays close to the build
+		unsigned int seed = 777;
+		int nMoved = std::max(1, (int)((float)count * g_MovedShare));
+		double refitMs = TimeRounds([&]()
+		{
+			for (int i = 0; i < nMoved; i++)
+			{
+				int id = (int)(NextRandom(seed) * (float)count);
+				glm::vec3 step = glm::vec3(NextRandom(seed), NextRandom(seed), NextRandom(seed)) - 0.5f;
+				boxes.boxMin[id] += step;
+				boxes.boxMax[id] += step;
+				bvh.SetItem(id, boxes.boxMin[id], boxes.boxMax[id]);
+			}
+			bvh.Refit();
+		});
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 center = (boxes.boxMin[i] + boxes.boxMax[i]) * 0.5f;
+			for (int c = 0; c < 3; c++)
+			{
+				boxes.bounds[c][i] = center[c];
+			}
+		}
+
+		std::cout << "BENCHMARK: bvh | build"
+			<< " | objects: " << count
+			<< " | nodes: " << bvh.GetNodeCount()
+			<< " | build: " << buildMs << " ms"
+			<< " | refit " << nMoved << " moved: " << refitMs << " ms" << std::endl;
+
+		// cameras inside the world looking in random directions,
+		// with a far plane that sees part of it
+		std::vector<glm::mat4> views(g_FrustumQueries);
+		seed = 4242;
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, g_WorldSize * 0.25f);
+		for (int q = 0; q < g_FrustumQueries; q++)
+		{
+			glm::vec3 eye = NextPosition(seed);
+			glm::vec3 target = NextPosition(seed);
+			views[q] = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+
+		FrustumCuller culler;
+		FrustumCuller::BOUNDS_ARRAYS arrays;
+		arrays.centerX = boxes.bounds[0].data();
+		arrays.centerY = boxes.bounds[1].data();
+		arrays.centerZ = boxes.bounds[2].data();
+		arrays.extentX = boxes.bounds[3].data();
+		arrays.extentY = boxes.bounds[4].data();
+		arrays.extentZ = boxes.bounds[5].data();
+		arrays.radius = boxes.bounds[6].data();
+		std::vector<unsigned char> results(count);
+		size_t flatHits = 0;
+		double flatMs = TimeRounds([&]()
+		{
+			flatHits = 0;
+			for (int q = 0; q < g_FrustumQueries; q++)
+			{
+				culler.SetView(views[q], projection, 0);
+				flatHits += culler.CullBounds(arrays, count, results.data());
+			}
+		});
+		std::vector<int> ids;
+		size_t bvhHits = 0;
+		double bvhMs = TimeRounds([&]()
+		{
+			bvhHits = 0;
+			for (int q = 0; q < g_FrustumQueries; q++)
+			{
+				glm::vec4 planes[6];
+				FrustumCuller::ExtractPlanes(projection * views[q], planes);
+				bvh.QueryFrustum(planes, ids);
+				bvhHits += ids.size();
+			}
+		});
+		PrintQueries("frustum", count, g_FrustumQueries, flatMs, bvhMs, flatHits, bvhHits);
+
+		// rays and points from random positions
+		std::vector<glm::vec3> origins(g_PointQueries);
+		std::vector<glm::vec3> directions(g_PointQueries);
+		seed = 99;
+		for (int q = 0; q < g_PointQueries; q++)
+		{
+			origins[q] = NextPosition(seed);
+			directions[q] = NextPosition(seed) - origins[q];
+		}
+		const float maxDistance = 1.0f;
+		const float nearestDistance = g_WorldSize * 0.05f;
+
+		flatHits = 0;
+		flatMs = TimeRounds([&]()
+		{
+			flatHits = 0;
+			for (int q = 0; q < g_PointQueries; q++)
+			{
+				glm::vec3 inverseDirection = 1.0f / directions[q];
+				float best = maxDistance;
+				bool bHit = false;
+				for (int i = 0; i < count; i++)
+				{
+					glm::vec3 t1 = (boxes.boxMin[i] - origins[q]) * inverseDirection;
+					glm::vec3 t2 = (boxes.boxMax[i] - origins[q]) * inverseDirection;
+					glm::vec3 tNear = glm::min(t1, t2);
+					glm::vec3 tFar = glm::max(t1, t2);
+					float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+					float leave = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, best));
+					if (enter <= leave)
+					{
+						best = enter;
+						bHit = true;
+					}
+				}
+				flatHits += (bHit == true) ? 1 : 0;
+			}
+		});
+		bvhMs = TimeRounds([&]()
+		{
+			bvhHits = 0;
+			for (int q = 0; q < g_PointQueries; q++)
+			{
+				float hitDistance = 0.0f;
+				bvhHits += (bvh.RayCast(origins[q], directions[q], maxDistance, hitDistance) >= 0) ? 1 : 0;
+			}
+		});
+		PrintQueries("ray", count, g_PointQueries, flatMs, bvhMs, flatHits, bvhHits);
+
+		flatMs = TimeRounds([&]()
+		{
+			flatHits = 0;
+			for (int q = 0; q < g_PointQueries; q++)
+			{
+				float bestSquared = nearestDistance * nearestDistance;
+				bool bFound = false;
+				for (int i = 0; i < count; i++)
+				{
+					glm::vec3 offset = glm::max(glm::max(boxes.boxMin[i] - origins[q], origins[q] - boxes.boxMax[i]), glm::vec3(0.0f));
+					float squared = glm::dot(offset, offset);
+					if (squared <= bestSquared)
+					{
+						bestSquared = squared;
+						bFound = true;
+					}
+				}
+				flatHits += (bFound == true) ? 1 : 0;
+			}
+		});
+		bvhMs = TimeRounds([&]()
+		{
+			bvhHits = 0;
+			for (int q = 0; q < g_PointQueries; q++)
+			{
+				float distance = 0.0f;
+				bvhHits += (bvh.FindNearest(origins[q], nearestDistance, distance) >= 0) ? 1 : 0;
+			}
+		});
+		PrintQueries("nearest", count, g_PointQueries, flatMs, bvhMs, flatHits, bvhHits);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+///////////////////////////////////////////////////////////////////////////////
+// spatialbenchmark.h
+// ============
+// compare the queries of the scene bounding volume hierarchy with testing
+// every object, for growing numbers of objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  SpatialBenchmark
+ *
+ *  This function times building and refitting the scene
+ *  bounding volume hierarchy over 1k, 10k, 100k and 1M
+ *  random boxes, and its frustum, ray and nearest object
+ *  queries against a flat pass over every box, and prints
+ *  one line per case.
+ ***********************************************************/
+namespace SpatialBenchmark
+{
+	// run all the cases, which only use the CPU
+	void Run();
+}
\ No newline at end of file
@@ -0,0 +1,555 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatch.cpp
+// ============
+// merge the geometry of static scene objects into pre-transformed world
+// space buffers, so the static environment renders in a few draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatch.h"
+
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// interleaved floats per source mesh vertex - position, normal, texture coords
+	const GLuint g_FloatsPerMeshVertex = 8;
+
+	// vertex shader attribute locations
+	const GLuint g_PositionScaleAttrib = 3;
+	const GLuint g_PositionOffsetAttrib = 4;
+	const GLuint g_MaterialIndexAttrib = 5;
+	const GLuint g_VertexSourceAttrib = 6;
+	const GLuint g_LightmapUvAttrib = 9;
+}
+
+/***********************************************************
+ *  StaticBatch()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatch::StaticBatch()
+{
+	m_vao = 0;
+	m_vbos[0] = 0;
+	m_vbos[1] = 0;
+	m_bBuilt = false;
+	m_bLightmapped = false;
+}
+
+/***********************************************************
+ *  ~StaticBatch()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticBatch::~StaticBatch()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AddGeometry()
+ *
+ *  This method is used for transforming the passed in mesh
+ *  vertices into world space and appending them, along with
+ *  the material index and the rebased indices, to the group
+ *  with the passed in key.  The UV scale is baked into the
+ *  texture coordinates, which relies on repeat wrapping.
+ ***********************************************************/
+int StaticBatch::AddGeometry(
+	int groupKey,
+	GLuint materialIndex,
+	const std::vector<GLfloat>& verts,
+	const std::vector<GLuint>& indices,
+	const glm::mat4& model,
+	glm::vec2 uvScale)
+{
+	int groupIndex = -1;
+	for (size_t i = 0; i < m_groups.size(); i++)
+	{
+		if (m_groups[i].key == groupKey)
+		{
+			groupIndex = (int)i;
+			break;
+		}
+	}
+	if (groupIndex < 0)
+	{
+		m_groups.push_back(BATCH_GROUP());
+		groupIndex = (int)m_groups.size() - 1;
+		m_groups.back().key = groupKey;
+		m_groups.back().firstIndex = 0;
+		m_groups.back().nIndices = 0;
+	}
+	BATCH_GROUP* group = &m_groups[groupIndex];
+
+	GLuint baseVertex = (GLuint)group->vertices.size();
+	GLuint firstIndex = (GLuint)group->indices.size();
+	TransformVertices(materialIndex, verts, model, uvScale, group->vertices);
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		group->indices.push_back(baseVertex + indices[i]);
+	}
+
+	BATCH_ENTRY entry;
+	entry.group = groupIndex;
+	entry.firstVertex = baseVertex;
+	entry.nVertices = (GLuint)group->vertices.size() - baseVertex;
+	entry.firstIndex = firstIndex;
+	entry.nIndices = (GLuint)indices.size();
+	SetEntryBox(entry, group->vertices.data() + baseVertex);
+	m_entries.push_back(entry);
+	group->entries.push_back((int)m_entries.size() - 1);
+
+	return((int)m_entries.size() - 1);
+}
+
+/***********************************************************
+ *  UpdateGeometry()
+ *
+ *  This method is used for moving or recoloring one object
+ *  of a built batch.  Only the vertices of the entry are
+ *  sent to the GPU, the rest of the batch is untouched.
+ ***********************************************************/
+bool StaticBatch::UpdateGeometry(
+	int entry,
+	GLuint materialIndex,
+	const std::vector<GLfloat>& verts,
+	const glm::mat4& model,
+	glm::vec2 uvScale)
+{
+	if ((m_bBuilt == false) || (m_bLightmapped == true) || (entry < 0) || (entry >= (int)m_entries.size()) ||
+		(verts.size() / g_FloatsPerMeshVertex != m_entries[entry].nVertices))
+	{
+		return(false);
+	}
+
+	m_updateVertices.clear();
+	TransformVertices(materialIndex, verts, model, uvScale, m_updateVertices);
+	SetEntryBox(m_entries[entry], m_updateVertices.data());
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferSubData(GL_ARRAY_BUFFER,
+		sizeof(BATCH_VERTEX) * m_entries[entry].firstVertex,
+		sizeof(BATCH_VERTEX) * m_updateVertices.size(),
+		m_updateVertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  TransformVertices()
+ *
+ *  This method is used for transforming interleaved mesh
+ *  vertices into world space batch vertices, appended to
+ *  the passed in vertices.
+ ***********************************************************/
+void StaticBatch::TransformVertices(
+	GLuint materialIndex,
+	const std::vector<GLfloat>& verts,
+	const glm::mat4& model,
+	glm::vec2 uvScale,
+	std::vector<BATCH_VERTEX>& vertices) const
+{
+	// normals need the inverse transpose to stay perpendicular
+	// to non-uniformly scaled surfaces
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+	for (size_t i = 0; (i + g_FloatsPerMeshVertex) <= verts.size(); i += g_FloatsPerMeshVertex)
+	{
+		glm::vec3 position = glm::vec3(model * glm::vec4(verts[i], verts[i + 1], verts[i + 2], 1.0f));
+		glm::vec3 normal = normalMatrix * glm::vec3(verts[i + 3], verts[i + 4], verts[i + 5]);
+		if (glm::dot(normal, normal) > 0.0f)
+		{
+			normal = glm::normalize(normal);
+		}
+
+		BATCH_VERTEX vertex;
+		vertex.position[0] = position.x;
+		vertex.position[1] = position.y;
+		vertex.position[2] = position.z;
+		vertex.normal[0] = normal.x;
+		vertex.normal[1] = normal.y;
+		vertex.normal[2] = normal.z;
+		vertex.uv[0] = verts[i + 6] * uvScale.x;
+		vertex.uv[1] = verts[i + 7] * uvScale.y;
+		vertex.materialIndex = materialIndex;
+		vertex.lightmapUv[0] = 0.0f;
+		vertex.lightmapUv[1] = 0.0f;
+		vertices.push_back(vertex);
+	}
+}
+
+/***********************************************************
+ *  SetEntryBox()
+ *
+ *  This method is used for setting the world box of an
+ *  entry around its transformed vertices.
+ ***********************************************************/
+void StaticBatch::SetEntryBox(BATCH_ENTRY& entry, const BATCH_VERTEX* vertices) const
+{
+	entry.boxMin = glm::vec3(0.0f);
+	entry.boxMax = glm::vec3(0.0f);
+	for (GLuint i = 0; i < entry.nVertices; i++)
+	{
+		glm::vec3 position = glm::vec3(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+		entry.boxMin = (i == 0) ? position : glm::min(entry.boxMin, position);
+		entry.boxMax = (i == 0) ? position : glm::max(entry.boxMax, position);
+	}
+}
+
+/***********************************************************
+ *  GenerateLightmapUVs()
+ *
+ *  This method is used for passing the world space geometry
+ *  of every entry to the lightmap baker, which splits it
+ *  into charts.  A vertex that is shared by two charts is
+ *  copied, so the vertices and indices of each group are
+ *  written again in the charted order, and the ranges of
+ *  the entries move.  The batch only takes them once the
+ *  charts are packed, and every vertex then gets its
+ *  position in the atlas.  When the charts do not fit the
+ *  batch is left as it was.
+ ***********************************************************/
+bool StaticBatch::GenerateLightmapUVs(LightmapBaker& baker)
+{
+	if (m_bBuilt == true)
+	{
+		return(false);
+	}
+	baker.Clear();
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+	std::vector<GLuint> chartedVertices;
+	std::vector<GLuint> chartedIndices;
+	std::vector<int> entryMeshes(m_entries.size(), -1);
+	std::vector<BATCH_ENTRY> chartedEntries(m_entries);
+	std::vector<std::vector<BATCH_VERTEX>> chartedGroupVertices(m_groups.size());
+	std::vector<std::vector<GLuint>> chartedGroupIndices(m_groups.size());
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		const BATCH_GROUP& group = m_groups[g];
+		std::vector<BATCH_VERTEX>& vertices = chartedGroupVertices[g];
+		std::vector<GLuint>& groupIndices = chartedGroupIndices[g];
+		for (size_t e = 0; e < group.entries.size(); e++)
+		{
+			const BATCH_ENTRY& entry = m_entries[group.entries[e]];
+			const BATCH_VERTEX* source = group.vertices.data() + entry.firstVertex;
+			positions.resize(entry.nVertices);
+			normals.resize(entry.nVertices);
+			for (GLuint i = 0; i < entry.nVertices; i++)
+			{
+				positions[i] = glm::vec3(source[i].position[0], source[i].position[1], source[i].position[2]);
+				normals[i] = glm::vec3(source[i].normal[0], source[i].normal[1], source[i].normal[2]);
+			}
+			indices.resize(entry.nIndices);
+			for (GLuint i = 0; i < entry.nIndices; i++)
+			{
+				indices[i] = group.indices[entry.firstIndex + i] - entry.firstVertex;
+			}
+
+			// all the vertices of an entry share its material
+			int material = (entry.nVertices > 0) ? (int)source[0].materialIndex : -1;
+			entryMeshes[group.entries[e]] = baker.AddMesh(positions, normals, indices, material, chartedVertices, chartedIndices);
+
+			GLuint baseVertex = (GLuint)vertices.size();
+			for (size_t i = 0; i < chartedVertices.size(); i++)
+			{
+				vertices.push_back(source[chartedVertices[i]]);
+			}
+			BATCH_ENTRY& charted = chartedEntries[group.entries[e]];
+			charted.firstIndex = (GLuint)groupIndices.size();
+			for (size_t i = 0; i < chartedIndices.size(); i++)
+			{
+				groupIndices.push_back(baseVertex + chartedIndices[i]);
+			}
+			charted.firstVertex = baseVertex;
+			charted.nVertices = (GLuint)chartedVertices.size();
+			charted.nIndices = (GLuint)chartedIndices.size();
+		}
+	}
+
+	if (baker.PackCharts() == false)
+	{
+		m_bLightmapped = false;
+		return(false);
+	}
+
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		m_groups[g].vertices.swap(chartedGroupVertices[g]);
+		m_groups[g].indices.swap(chartedGroupIndices[g]);
+	}
+	m_entries.swap(chartedEntries);
+	m_bLightmapped = true;
+
+	std::vector<glm::vec2> coordinates;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		const BATCH_ENTRY& entry = m_entries[i];
+		baker.GetMeshCoordinates(entryMeshes[i], coordinates);
+		BATCH_VERTEX* vertices = m_groups[entry.group].vertices.data() + entry.firstVertex;
+		for (size_t v = 0; (v < coordinates.size()) && (v < entry.nVertices); v++)
+		{
+			vertices[v].lightmapUv[0] = coordinates[v].x;
+			vertices[v].lightmapUv[1] = coordinates[v].y;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for concatenating the collected
+ *  groups into one vertex buffer and one index buffer and
+ *  sending them to the GPU.  The CPU copies are released
+ *  afterwards, only the index range of each group and the
+ *  vertex range of each entry are kept.
+ ***********************************************************/
+void StaticBatch::Build()
+{
+	std::vector<BATCH_VERTEX> vertices;
+	std::vector<GLuint> indices;
+	std::vector<GLuint> groupBaseVertices(m_groups.size());
+
+	for (size_t i = 0; i < m_groups.size(); i++)
+	{
+		GLuint baseVertex = (GLuint)vertices.size();
+		groupBaseVertices[i] = baseVertex;
+
+		m_groups[i].firstIndex = (GLuint)indices.size();
+		m_groups[i].nIndices = (GLuint)m_groups[i].indices.size();
+
+		vertices.insert(vertices.end(), m_groups[i].vertices.begin(), m_groups[i].vertices.end());
+		for (size_t j = 0; j < m_groups[i].indices.size(); j++)
+		{
+			indices.push_back(baseVertex + m_groups[i].indices[j]);
+		}
+
+		m_groups[i].vertices.clear();
+		m_groups[i].vertices.shrink_to_fit();
+		m_groups[i].indices.clear();
+		m_groups[i].indices.shrink_to_fit();
+	}
+
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		m_entries[i].firstVertex += groupBaseVertices[m_entries[i].group];
+		m_entries[i].firstIndex += m_groups[m_entries[i].group].firstIndex;
+	}
+
+	if (indices.size() == 0)
+	{
+		return;
+	}
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(2, m_vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BATCH_VERTEX) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+
+	GLint stride = sizeof(BATCH_VERTEX);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, uv));
+	glEnableVertexAttribArray(2);
+
+	// the material index stays an integer in the shader
+	glVertexAttribIPointer(g_MaterialIndexAttrib, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(BATCH_VERTEX, materialIndex));
+	glEnableVertexAttribArray(g_MaterialIndexAttrib);
+
+	glVertexAttribPointer(g_LightmapUvAttrib, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, lightmapUv));
+	glEnableVertexAttribArray(g_LightmapUvAttrib);
+
+	glBindVertexArray(0);
+	m_bBuilt = true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the GPU buffers and the
+ *  collected groups.
+ ***********************************************************/
+void StaticBatch::Destroy()
+{
+	if (m_bBuilt == true)
+	{
+		glDeleteBuffers(2, m_vbos);
+		glDeleteVertexArrays(1, &m_vao);
+		m_bBuilt = false;
+	}
+	m_bLightmapped = false;
+	m_groups.clear();
+	m_entries.clear();
+}
+
+/***********************************************************
+ *  GetGroupCount()
+ *
+ *  This method is used for getting the number of groups.
+ ***********************************************************/
+int StaticBatch::GetGroupCount() const
+{
+	return((int)m_groups.size());
+}
+
+/***********************************************************
+ *  GetGroupKey()
+ *
+ *  This method is used for getting the key that the passed
+ *  in group was created with.
+ ***********************************************************/
+int StaticBatch::GetGroupKey(int group) const
+{
+	return(m_groups[group].key);
+}
+
+/***********************************************************
+ *  GetEntryCount()
+ *
+ *  This method is used for getting the number of entries.
+ ***********************************************************/
+int StaticBatch::GetEntryCount() const
+{
+	return((int)m_entries.size());
+}
+
+/***********************************************************
+ *  GetEntryDraw()
+ *
+ *  This method is used for getting what a draw of one entry
+ *  needs, for building draw commands on the GPU.
+ ***********************************************************/
+void StaticBatch::GetEntryDraw(
+	int entry,
+	int& group,
+	GLuint& firstIndex,
+	GLuint& nIndices,
+	glm::vec3& boxMin,
+	glm::vec3& boxMax) const
+{
+	const BATCH_ENTRY& batchEntry = m_entries[entry];
+	group = batchEntry.group;
+	firstIndex = batchEntry.firstIndex;
+	nIndices = batchEntry.nIndices;
+	boxMin = batchEntry.boxMin;
+	boxMax = batchEntry.boxMax;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for activating the batch buffers.
+ *  The vertices are already in world space, so the position
+ *  dequantization of the vertex shader is set to identity.
+ ***********************************************************/
+void StaticBatch::Bind() const
+{
+	glBindVertexArray(m_vao);
+	glVertexAttrib3f(g_PositionScaleAttrib, 1.0f, 1.0f, 1.0f);
+	glVertexAttrib3f(g_PositionOffsetAttrib, 0.0f, 0.0f, 0.0f);
+	// the batch is always read through its vertex attributes
+	glVertexAttribI1ui(g_VertexSourceAttrib, 0);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing all the geometry of the
+ *  passed in group with a single draw call.
+ ***********************************************************/
+void StaticBatch::DrawGroup(int group) const
+{
+	if ((m_bBuilt == false) || (m_groups[group].nIndices == 0))
+	{
+		return;
+	}
+
+	glDrawElements(
+		GL_TRIANGLES,
+		m_groups[group].nIndices,
+		GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * m_groups[group].firstIndex));
+}
+
+/***********************************************************
+ *  DrawGroupEntries()
+ *
+ *  This method is used for drawing only the visible entries
+ *  of the passed in group.  The entries of a group are
+ *  consecutive in the index buffer, so each run of visible
+ *  entries is one index range, and all the ranges are
+ *  drawn with a single multi-draw call.
+ ***********************************************************/
+int StaticBatch::DrawGroupEntries(int group, const std::vector<unsigned char>& bEntryVisible)
+{
+	if ((m_bBuilt == false) || (m_groups[group].nIndices == 0))
+	{
+		return(0);
+	}
+
+	m_drawCounts.clear();
+	m_drawOffsets.clear();
+	int nDrawn = 0;
+	GLuint runFirst = 0;
+	GLuint runEnd = 0;
+	const std::vector<int>& entries = m_groups[group].entries;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		int entryIndex = entries[i];
+		if ((entryIndex < (int)bEntryVisible.size()) && (bEntryVisible[entryIndex] == 0))
+		{
+			continue;
+		}
+
+		const BATCH_ENTRY& entry = m_entries[entryIndex];
+		if ((runEnd > runFirst) && (entry.firstIndex == runEnd))
+		{
+			runEnd += entry.nIndices;
+		}
+		else
+		{
+			if (runEnd > runFirst)
+			{
+				m_drawCounts.push_back((GLsizei)(runEnd - runFirst));
+				m_drawOffsets.push_back((const void*)(sizeof(GLuint) * runFirst));
+			}
+			runFirst = entry.firstIndex;
+			runEnd = entry.firstIndex + entry.nIndices;
+		}
+		nDrawn++;
+	}
+	if (runEnd > runFirst)
+	{
+		m_drawCounts.push_back((GLsizei)(runEnd - runFirst));
+		m_drawOffsets.push_back((const void*)(sizeof(GLuint) * runFirst));
+	}
+
+	if (m_drawCounts.empty() == false)
+	{
+		glMultiDrawElements(
+			GL_TRIANGLES,
+			m_drawCounts.data(),
+			GL_UNSIGNED_INT,
+			m_drawOffsets.data(),
+			(GLsizei)m_drawCounts.size());
+	}
+
+	return(nDrawn);
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatch.h
+// ============
+// merge the geometry of static scene objects into pre-transformed world
+// space buffers, so the static environment renders in a few draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightmapBaker.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  StaticBatch
+ *
+ *  This class collects mesh geometry in world space into
+ *  groups that share the same draw state, such as a texture.
+ *  All the groups live in one vertex buffer and one index
+ *  buffer, and each vertex carries the index of its material
+ *  so objects with different materials share a draw call.
+ *  The vertices can also be given coordinates in a baked
+ *  lightmap atlas.
+ ***********************************************************/
+class StaticBatch
+{
+public:
+	// constructor
+	StaticBatch();
+	// destructor
+	~StaticBatch();
+
+	// transform the interleaved mesh vertices into world
+	// space and append them to the group with the passed in
+	// key, returning the entry of the added geometry
+	int AddGeometry(
+		int groupKey,
+		GLuint materialIndex,
+		const std::vector<GLfloat>& verts,
+		const std::vector<GLuint>& indices,
+		const glm::mat4& model,
+		glm::vec2 uvScale);
+	// transform the vertices of a built entry again and write
+	// them over the old ones in the vertex buffer.  The mesh
+	// must have as many vertices as when it was added, and
+	// the batch must not have lightmap coordinates
+	bool UpdateGeometry(
+		int entry,
+		GLuint materialIndex,
+		const std::vector<GLfloat>& verts,
+		const glm::mat4& model,
+		glm::vec2 uvScale);
+
+	// split the collected entries into the charts of the
+	// lightmap baker and give the vertices their coordinates
+	// in its atlas, before Build().  False when the charts do
+	// not fit in the atlas
+	bool GenerateLightmapUVs(LightmapBaker& baker);
+
+	// send the collected groups to the GPU
+	void Build();
+	// free the GPU buffers and the collected groups
+	void Destroy();
+
+	// number of groups and the key of each group
+	int GetGroupCount() const;
+	int GetGroupKey(int group) const;
+	// number of entries, the values AddGeometry() returned
+	int GetEntryCount() const;
+	// get the group, the index range in the index buffer and
+	// the world box of a built entry
+	void GetEntryDraw(
+		int entry,
+		int& group,
+		GLuint& firstIndex,
+		GLuint& nIndices,
+		glm::vec3& boxMin,
+		glm::vec3& boxMax) const;
+
+	// activate the batch buffers before drawing groups
+	void Bind() const;
+	// draw all the geometry of one group
+	void DrawGroup(int group) const;
+	// draw the entries of one group that are visible, by
+	// entry, and return the number of entries drawn
+	int DrawGroupEntries(int group, const std::vector<unsigned char>& bEntryVisible);
+
+private:
+	// world space vertex with the material index of its object
+	struct BATCH_VERTEX
+	{
+		GLfloat position[3];
+		GLfloat normal[3];
+		GLfloat uv[2];
+		GLuint materialIndex;
+		GLfloat lightmapUv[2];
+	};
+
+	// geometry that is drawn with the same draw state
+	struct BATCH_GROUP
+	{
+		int key;
+		std::vector<BATCH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+		GLuint firstIndex;	// offset of the group in the index buffer
+		GLuint nIndices;	// number of indices of the group
+		std::vector<int> entries;	// entries of the group, in index order
+	};
+
+	// vertex and index ranges of one AddGeometry() call, in
+	// its group until the batch is built, then in the buffers
+	struct BATCH_ENTRY
+	{
+		int group;
+		GLuint firstVertex;
+		GLuint nVertices;
+		GLuint firstIndex;
+		GLuint nIndices;
+		glm::vec3 boxMin;	// world box of the vertices
+		glm::vec3 boxMax;
+	};
+
+	// transform mesh vertices into batch vertices
+	void TransformVertices(
+		GLuint materialIndex,
+		const std::vector<GLfloat>& verts,
+		const glm::mat4& model,
+		glm::vec2 uvScale,
+		std::vector<BATCH_VERTEX>& vertices) const;
+	// set the world box of an entry from its vertices
+	void SetEntryBox(BATCH_ENTRY& entry, const BATCH_VERTEX* vertices) const;
+
+	std::vector<BATCH_GROUP> m_groups;
+	std::vector<BATCH_ENTRY> m_entries;
+	// vertices transformed by the last UpdateGeometry()
+	std::vector<BATCH_VERTEX> m_updateVertices;
+	// index ranges of the last DrawGroupEntries()
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+
+	GLuint m_vao;
+	GLuint m_vbos[2];
+	bool m_bBuilt;
+	// the entries were split into lightmap charts, so their
+	// vertices no longer match the meshes they came from
+	bool m_bLightmapped;
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbenchmark.cpp
+// ============
+// compare the per-object transform path with the batch transform kernel
+// for growing numbers of moving objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBenchmark.h"
+#include "TransformKernel.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// objects transformed per case
+	const size_t g_ObjectCounts[] = { 1000, 10000, 100000 };
+	// every case runs until about this many objects are done,
+	// split into this many timed rounds
+	const size_t g_ObjectsPerRound = 2000000;
+	const int g_Rounds = 5;
+
+	// transforms of the moving objects in structure of arrays
+	// form, with the Euler angles of the scene objects
+	struct OBJECT_ARRAYS
+	{
+		std::vector<float> position[3];
+		std::vector<float> degrees[3];
+		std::vector<float> rotation[4];
+		std::vector<float> scale[3];
+	};
+
+	// linear congruential generator, in [0, 1)
+	float NextRandom(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return((float)(seed >> 8) / 16777216.0f);
+	}
+
+	/***********************************************************
+	 *  FillObjects()
+	 *
+	 *  Make repeatable transforms for the passed in number of
+	 *  objects.
+	 ***********************************************************/
+	void FillObjects(size_t count, OBJECT_ARRAYS& objects)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			objects.position[c].resize(count);
+			objects.degrees[c].resize(count);
+			objects.scale[c].resize(count);
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			objects.rotation[c].resize(count);
+		}
+
+		unsigned int seed = 12345;
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				objects.position[c][i] = NextRandom(seed) * 20.0f - 10.0f;
+				objects.degrees[c][i] = NextRandom(seed) * 360.0f;
+				objects.scale[c][i] = 0.1f + NextRandom(seed);
+			}
+		}
+
+		TransformKernel::EulerToQuaternions(
+			objects.degrees[0].data(), objects.degrees[1].data(), objects.degrees[2].data(), count,
+			objects.rotation[0].data(), objects.rotation[1].data(), objects.rotation[2].data(), objects.rotation[3].data());
+	}
+
+	TransformKernel::TRANSFORM_ARRAYS GetTransformArrays(const OBJECT_ARRAYS& objects)
+	{
+		TransformKernel::TRANSFORM_ARRAYS transforms;
+		transforms.positionX = objects.position[0].data();
+		transforms.positionY = objects.position[1].data();
+		transforms.positionZ = objects.position[2].data();
+		transforms.rotationX = objects.rotation[0].data();
+		transforms.rotationY = objects.rotation[1].data();
+		transforms.rotationZ = objects.rotation[2].data();
+		transforms.rotationW = objects.rotation[3].data();
+		transforms.scaleX = objects.scale[0].data();
+		transforms.scaleY = objects.scale[1].data();
+		transforms.scaleZ = objects.scale[2].data();
+		return(transforms);
+	}
+
+	/***********************************************************
+	 *  TimeCase()
+	 *
+	 *  Run a case in rounds of repeated passes over all the
+	 *  objects, and print the fastest round, which is the
+	 *  least disturbed by the rest of the system.
+	 ***********************************************************/
+	double TimeCase(
+		const char* label,
+		size_t count,
+		double baselineNs,
+		const std::function<void()>& pass)
+	{
+		size_t passes = std::max((size_t)1, g_ObjectsPerRound / count / g_Rounds);
+
+		// the first pass warms up the caches and the buffer
+		pass();
+
+		double bestNs = 0.0;
+		for (int round = 0; round < g_Rounds; round++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < passes; i++)
+			{
+				pass();
+			}
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			double ns = elapsed.count() / (double)(passes * count);
+			bestNs = (round == 0) ? ns : std::min(bestNs, ns);
+		}
+
+		std::cout << "BENCHMARK: transforms | " << label
+			<< " | objects: " << count
+			<< " | " << bestNs << " ns/object"
+			<< " | " << bestNs * (double)count / 1000000.0 << " ms/frame";
+		if (baselineNs > 0.0)
+		{
+			std::cout << " | speedup: " << baselineNs / bestNs << "x";
+		}
+		std::cout << std::endl;
+
+		return(bestNs);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This function is used for running the benchmark.  The
+ *  per-object case builds the same five matrices and the
+ *  general inverse that SetTransformations() does, without
+ *  the uniform uploads, so only the math is compared.
+ ***********************************************************/
+void TransformBenchmark::Run()
+{
+	// the mapped buffer needs buffer storage, core in OpenGL 4.4
+	bool bMappedBuffer = (glBufferStorage != NULL);
+
+	for (size_t countIndex = 0; countIndex < sizeof(g_ObjectCounts) / sizeof(g_ObjectCounts[0]); countIndex++)
+	{
+		size_t count = g_ObjectCounts[countIndex];
+
+		OBJECT_ARRAYS objects;
+		FillObjects(count, objects);
+		TransformKernel::TRANSFORM_ARRAYS transforms = GetTransformArrays(objects);
+
+		std::vector<glm::mat4> models(count);
+		std::vector<glm::mat3> normals(count);
+		double baselineNs = TimeCase("per object glm", count, 0.0, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::mat4 scale = glm::scale(glm::vec3(objects.scale[0][i], objects.scale[1][i], objects.scale[2][i]));
+				glm::mat4 rotationX = glm::rotate(glm::radians(objects.degrees[0][i]), glm::vec3(1.0f, 0.0f, 0.0f));
+				glm::mat4 rotationY = glm::rotate(glm::radians(objects.degrees[1][i]), glm::vec3(0.0f, 1.0f, 0.0f));
+				glm::mat4 rotationZ = glm::rotate(glm::radians(objects.degrees[2][i]), glm::vec3(0.0f, 0.0f, 1.0f));
+				glm::mat4 translation = glm::translate(glm::vec3(objects.position[0][i], objects.position[1][i], objects.position[2][i]));
+				models[i] = translation * rotationX * rotationY * rotationZ * scale;
+				normals[i] = glm::transpose(glm::inverse(glm::mat3(models[i])));
+			}
+		});
+
+		std::vector<GLfloat> modelFloats(count * TransformKernel::FLOATS_PER_MODEL_MATRIX);
+		std::vector<GLfloat> normalFloats(count * TransformKernel::FLOATS_PER_NORMAL_MATRIX);
+		OBJECT_ARRAYS converted;
+		FillObjects(count, converted);
+		TimeCase("kernel from euler", count, baselineNs, [&]()
+		{
+			TransformKernel::EulerToQuaternions(
+				objects.degrees[0].data(), objects.degrees[1].data(), objects.degrees[2].data(), count,
+				converted.rotation[0].data(), converted.rotation[1].data(), converted.rotation[2].data(), converted.rotation[3].data());
+			TransformKernel::ComposeTransforms(GetTransformArrays(converted), count, modelFloats.data(), normalFloats.data());
+		});
+		TimeCase("kernel from quaternion", count, baselineNs, [&]()
+		{
+			TransformKernel::ComposeTransforms(transforms, count, modelFloats.data(), normalFloats.data());
+		});
+
+		if (bMappedBuffer == false)
+		{
+			continue;
+		}
+
+		// a persistently mapped buffer the kernel writes into,
+		// laid out as all the model matrices, then all the
+		// normal matrices
+		GLsizeiptr modelBytes = (GLsizeiptr)(modelFloats.size() * sizeof(GLfloat));
+		GLsizeiptr normalBytes = (GLsizeiptr)(normalFloats.size() * sizeof(GLfloat));
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, modelBytes + normalBytes, NULL, flags);
+		GLfloat* mapped = (GLfloat*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, modelBytes + normalBytes, flags);
+		if (mapped != NULL)
+		{
+			TimeCase("kernel to mapped buffer", count, baselineNs, [&]()
+			{
+				TransformKernel::ComposeTransforms(transforms, count, mapped, mapped + modelFloats.size());
+			});
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+}
\ No newline at end of file
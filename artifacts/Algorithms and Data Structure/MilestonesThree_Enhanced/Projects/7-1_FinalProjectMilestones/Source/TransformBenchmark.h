@@ -0,0 +1,24 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbenchmark.h
+// ============
+// compare the per-object transform path with the batch transform kernel
+// for growing numbers of moving objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  TransformBenchmark
+ *
+ *  This function times building the model and normal
+ *  matrices of 1k, 10k and 100k objects - one object at a
+ *  time with the glm matrix chain of SetTransformations(),
+ *  and with the batch kernel writing to memory and to a
+ *  mapped GPU buffer - and prints one line per case.
+ ***********************************************************/
+namespace TransformBenchmark
+{
+	// run all the cases.  The mapped buffer case needs a
+	// current OpenGL context, and is skipped without one
+	void Run();
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernel.cpp
+// ============
+// compose the model and normal matrices of many objects at once from
+// structure of arrays translations, rotations and scales
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformKernel.h"
+#include "SimdFloats.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// components of TRANSFORM_ARRAYS, in member order
+	const int g_InputCount = 10;
+	// values of the components that pad the last group
+	const float g_PaddingValues[g_InputCount] = {
+		0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, 1.0f };
+
+	// the three columns of the rotation and scale part, the
+	// translation, and the three columns of the normal matrix
+	const int g_ResultCount = 21;
+
+	/***********************************************************
+	 *  ComposeGroup()
+	 *
+	 *  Build the matrices of one group of lanes.  The rotation
+	 *  matrix of a unit quaternion is orthonormal, so the
+	 *  inverse transpose of rotation * scale is the rotation
+	 *  divided by the scale, with no general inverse needed.
+	 ***********************************************************/
+	void ComposeGroup(
+		const FLOATS* inputs,
+		size_t nObjects,
+		GLfloat* modelMatrices,
+		GLfloat* normalMatrices)
+	{
+		const FLOATS& qx = inputs[3];
+		const FLOATS& qy = inputs[4];
+		const FLOATS& qz = inputs[5];
+		const FLOATS& qw = inputs[6];
+
+		FLOATS x2 = Add(qx, qx);
+		FLOATS y2 = Add(qy, qy);
+		FLOATS z2 = Add(qz, qz);
+		FLOATS xx = Mul(qx, x2);
+		FLOATS yy = Mul(qy, y2);
+		FLOATS zz = Mul(qz, z2);
+		FLOATS xy = Mul(qx, y2);
+		FLOATS xz = Mul(qx, z2);
+		FLOATS yz = Mul(qy, z2);
+		FLOATS wx = Mul(qw, x2);
+		FLOATS wy = Mul(qw, y2);
+		FLOATS wz = Mul(qw, z2);
+		FLOATS one = SetFloats(1.0f);
+
+		// rotation columns
+		FLOATS rotation[9] = {
+			Sub(one, Add(yy, zz)), Add(xy, wz), Sub(xz, wy),
+			Sub(xy, wz), Sub(one, Add(xx, zz)), Add(yz, wx),
+			Add(xz, wy), Sub(yz, wx), Sub(one, Add(xx, yy)) };
+
+		float results[g_ResultCount][g_Lanes];
+		for (int column = 0; column < 3; column++)
+		{
+			FLOATS scale = inputs[7 + column];
+			for (int row = 0; row < 3; row++)
+			{
+				StoreFloats(results[3 * column + row], Mul(rotation[3 * column + row], scale));
+				StoreFloats(results[12 + 3 * column + row], Div(rotation[3 * column + row], scale));
+			}
+			StoreFloats(results[9 + column], inputs[column]);
+		}
+
+		// the matrices of the lanes are written one after another
+		for (size_t lane = 0; lane < nObjects; lane++)
+		{
+			GLfloat* model = modelMatrices + lane * TransformKernel::FLOATS_PER_MODEL_MATRIX;
+			for (int column = 0; column < 4; column++)
+			{
+				model[4 * column] = results[3 * column][lane];
+				model[4 * column + 1] = results[3 * column + 1][lane];
+				model[4 * column + 2] = results[3 * column + 2][lane];
+				model[4 * column + 3] = (column == 3) ? 1.0f : 0.0f;
+			}
+
+			if (normalMatrices != NULL)
+			{
+				GLfloat* normal = normalMatrices + lane * TransformKernel::FLOATS_PER_NORMAL_MATRIX;
+				for (int column = 0; column < 3; column++)
+				{
+					normal[4 * column] = results[12 + 3 * column][lane];
+					normal[4 * column + 1] = results[12 + 3 * column + 1][lane];
+					normal[4 * column + 2] = results[12 + 3 * column + 2][lane];
+					normal[4 * column + 3] = 0.0f;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ComposeTransforms()
+ *
+ *  This function is used for building the matrices of all
+ *  the objects.  Full groups load straight from the arrays,
+ *  and the last partial group is copied and padded with an
+ *  identity transform, so the arrays need no padding.
+ ***********************************************************/
+void TransformKernel::ComposeTransforms(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	GLfloat* modelMatrices,
+	GLfloat* normalMatrices)
+{
+	const float* arrays[g_InputCount] = {
+		transforms.positionX, transforms.positionY, transforms.positionZ,
+		transforms.rotationX, transforms.rotationY, transforms.rotationZ, transforms.rotationW,
+		transforms.scaleX, transforms.scaleY, transforms.scaleZ };
+
+	FLOATS inputs[g_InputCount];
+	for (size_t first = 0; first < count; first += g_Lanes)
+	{
+		size_t nObjects = std::min(g_Lanes, count - first);
+		for (int i = 0; i < g_InputCount; i++)
+		{
+			if (nObjects == g_Lanes)
+			{
+				inputs[i] = LoadFloats(arrays[i] + first);
+			}
+			else
+			{
+				float padded[g_Lanes];
+				for (size_t lane = 0; lane < g_Lanes; lane++)
+				{
+					padded[lane] = (lane < nObjects) ? arrays[i][first + lane] : g_PaddingValues[i];
+				}
+				inputs[i] = LoadFloats(padded);
+			}
+		}
+
+		ComposeGroup(inputs, nObjects,
+			modelMatrices + first * FLOATS_PER_MODEL_MATRIX,
+			(normalMatrices != NULL) ? normalMatrices + first * FLOATS_PER_NORMAL_MATRIX : NULL);
+	}
+}
+
+/***********************************************************
+ *  EulerToQuaternions()
+ *
+ *  This function is used for converting Euler angles to
+ *  quaternions.  The product of the three axis rotations,
+ *  X * Y * Z, is written out so each object needs only the
+ *  sine and cosine of its three half angles.
+ ***********************************************************/
+void TransformKernel::EulerToQuaternions(
+	const float* XrotationDegrees,
+	const float* YrotationDegrees,
+	const float* ZrotationDegrees,
+	size_t count,
+	float* rotationX,
+	float* rotationY,
+	float* rotationZ,
+	float* rotationW)
+{
+	// degrees to radians, halved for the quaternion
+	const float halfRadians = 3.14159265358979f / 360.0f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float cx = std::cos(XrotationDegrees[i] * halfRadians);
+		float sx = std::sin(XrotationDegrees[i] * halfRadians);
+		float cy = std::cos(YrotationDegrees[i] * halfRadians);
+		float sy = std::sin(YrotationDegrees[i] * halfRadians);
+		float cz = std::cos(ZrotationDegrees[i] * halfRadians);
+		float sz = std::sin(ZrotationDegrees[i] * halfRadians);
+
+		// X * Y, then times Z
+		float w = cx * cy;
+		float x = sx * cy;
+		float y = cx * sy;
+		float z = sx * sy;
+		rotationW[i] = w * cz - z * sz;
+		rotationX[i] = x * cz + y * sz;
+		rotationY[i] = y * cz - x * sz;
+		rotationZ[i] = z * cz + w * sz;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernel.h
+// ============
+// compose the model and normal matrices of many objects at once from
+// structure of arrays translations, rotations and scales
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  TransformKernel
+ *
+ *  These functions build the matrices of eight (AVX) or
+ *  four (SSE) objects per instruction.  Every component of
+ *  the inputs is its own array, so a group of objects loads
+ *  with one instruction per component, and the matrices are
+ *  written in order, one object after another, which suits
+ *  write-combined memory such as a mapped GPU buffer.
+ ***********************************************************/
+namespace TransformKernel
+{
+	// floats written per object - a column major mat4, and a
+	// mat3 as three vec4 columns, the std430 layout of a mat3
+	const size_t FLOATS_PER_MODEL_MATRIX = 16;
+	const size_t FLOATS_PER_NORMAL_MATRIX = 12;
+
+	// local transforms of the objects, one array per component.
+	// The rotations are unit quaternions
+	struct TRANSFORM_ARRAYS
+	{
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+		const float* rotationX;
+		const float* rotationY;
+		const float* rotationZ;
+		const float* rotationW;
+		const float* scaleX;
+		const float* scaleY;
+		const float* scaleZ;
+	};
+
+	// write translation * rotation * scale of every object,
+	// and its inverse transpose for the normals.  The normal
+	// matrices are skipped when the pointer is NULL
+	void ComposeTransforms(
+		const TRANSFORM_ARRAYS& transforms,
+		size_t count,
+		GLfloat* modelMatrices,
+		GLfloat* normalMatrices);
+
+	// convert the Euler angles of the scene objects, applied
+	// around X, then Y, then Z in the model matrix, to unit
+	// quaternions
+	void EulerToQuaternions(
+		const float* XrotationDegrees,
+		const float* YrotationDegrees,
+		const float* ZrotationDegrees,
+		size_t count,
+		float* rotationX,
+		float* rotationY,
+		float* rotationZ,
+		float* rotationW);
+}
\ No newline at end of file
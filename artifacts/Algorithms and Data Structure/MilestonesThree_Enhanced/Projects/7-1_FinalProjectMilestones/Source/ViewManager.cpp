@@ -52,6 +52,8 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.5f, 8.0f);
@@ -289,6 +291,10 @@ void ViewManager::PrepareSceneView()
 		}
 	}
 
+	// keep the matrices for the CPU side of the rendering
+	m_view = view;
+	m_projection = projection;
+
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
@@ -299,4 +305,37 @@ void ViewManager::PrepareSceneView()
 		// set the view position of the camera into the shader for proper rendering
 		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
 	}
+}
+
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for getting the view matrix of the
+ *  current frame
+ ***********************************************************/
+glm::mat4 ViewManager::GetViewMatrix()
+{
+	return(m_view);
+}
+
+/***********************************************************
+ *  GetProjectionMatrix()
+ *
+ *  This method is used for getting the projection matrix of
+ *  the current frame
+ ***********************************************************/
+glm::mat4 ViewManager::GetProjectionMatrix()
+{
+	return(m_projection);
+}
+
+/***********************************************************
+ *  GetViewportHeight()
+ *
+ *  This method is used for getting the height of the
+ *  viewport the projection was set up for
+ ***********************************************************/
+int ViewManager::GetViewportHeight()
+{
+	return(WINDOW_HEIGHT);
 }
\ No newline at end of file
@@ -32,6 +32,9 @@ private:
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices of the current frame
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -42,4 +45,10 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// get the matrices set by the last PrepareSceneView() call
+	glm::mat4 GetViewMatrix();
+	glm::mat4 GetProjectionMatrix();
+	// get the height of the viewport in pixels
+	int GetViewportHeight();
 };
\ No newline at end of file
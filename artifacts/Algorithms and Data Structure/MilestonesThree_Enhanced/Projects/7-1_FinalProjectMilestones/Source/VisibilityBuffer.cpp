@@ -0,0 +1,371 @@
+///////////////////////////////////////////////////////////////////////////////
+// visibilitybuffer.cpp
+// ============
+// draw only the draw and triangle IDs of the scene, and shade every pixel
+// once from the triangle it shows, fetched from the shared mesh buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VisibilityBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const char* g_SceneVertexShaderFile = "../../Utilities/shaders/vertexShader.glsl";
+	const char* g_GeometryFragmentShaderFile = "../../Utilities/shaders/visibilityShader.glsl";
+	const char* g_ResolveVertexShaderFile = "../../Utilities/shaders/deferredVertexShader.glsl";
+	const char* g_ResolveFragmentShaderFile = "../../Utilities/shaders/visibilityResolveShader.glsl";
+
+	// storage buffer bindings of the resolve shader, within the
+	// 0 to 7 that GL guarantees.  The shared vertices keep the
+	// binding of the pulled vertices, and the rest reuse the
+	// bindings of the impostors and the culling shader, which
+	// are bound again before those draws
+	const GLuint g_SharedVerticesBinding = 0;
+	const GLuint g_SharedIndicesBinding = 1;
+	const GLuint g_DrawsBinding = 3;
+	const GLuint g_ObjectsBinding = 4;
+	// texture units of the targets, after the G-buffer
+	const GLuint g_IdUnit = 21;
+	const GLuint g_DepthUnit = 22;
+	// ID of a pixel nothing was drawn to
+	const GLuint g_EmptyId = 0xFFFFFFFF;
+
+	// load a program, NULL when it does not link
+	ShaderManager* LoadProgram(const char* vertexShaderFile, const char* fragmentShaderFile)
+	{
+		ShaderManager* pShaderManager = new ShaderManager();
+		pShaderManager->m_programID = 0;
+		pShaderManager->LoadShaders(vertexShaderFile, fragmentShaderFile);
+		GLint linked = GL_FALSE;
+		if (pShaderManager->m_programID != 0)
+		{
+			glGetProgramiv(pShaderManager->m_programID, GL_LINK_STATUS, &linked);
+		}
+		if (linked == GL_FALSE)
+		{
+			if (pShaderManager->m_programID != 0)
+			{
+				glDeleteProgram(pShaderManager->m_programID);
+			}
+			delete pShaderManager;
+			return(NULL);
+		}
+		return(pShaderManager);
+	}
+
+	// free a program loaded by LoadProgram()
+	void DestroyProgram(ShaderManager*& pShaderManager)
+	{
+		if (pShaderManager != NULL)
+		{
+			glDeleteProgram(pShaderManager->m_programID);
+			delete pShaderManager;
+			pShaderManager = NULL;
+		}
+	}
+}
+
+/***********************************************************
+ *  VisibilityBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VisibilityBuffer::VisibilityBuffer()
+{
+	m_framebuffer = 0;
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		m_targets[i] = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_previousFramebuffer = 0;
+	m_geometryShader = NULL;
+	m_resolveShader = NULL;
+	m_bShaderFailed = false;
+	m_emptyVao = 0;
+	m_primitiveBits = 16;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~VisibilityBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VisibilityBuffer::~VisibilityBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for loading the program of the
+ *  geometry pass, which writes the IDs from the vertex
+ *  shader of the scene, and the program of the resolve
+ *  pass, which draws a full screen triangle.
+ ***********************************************************/
+bool VisibilityBuffer::LoadShaders()
+{
+	m_geometryShader = LoadProgram(g_SceneVertexShaderFile, g_GeometryFragmentShaderFile);
+	m_resolveShader = LoadProgram(g_ResolveVertexShaderFile, g_ResolveFragmentShaderFile);
+	if ((m_geometryShader == NULL) || (m_resolveShader == NULL))
+	{
+		std::cout << "Visibility buffer shaders failed, using forward shading" << std::endl;
+		DestroyProgram(m_geometryShader);
+		DestroyProgram(m_resolveShader);
+		m_bShaderFailed = true;
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVao);
+	glGenBuffers(BUFFER_COUNT, m_buffers);
+	return(true);
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the targets for the
+ *  geometry pass.  The triangle of a draw takes as many
+ *  low bits of the ID as the largest draw needs, and the
+ *  draw the rest.  The shaders are loaded the first time,
+ *  and the targets are created again when the size of the
+ *  viewport changes.
+ ***********************************************************/
+bool VisibilityBuffer::BeginGeometryPass(GLuint maxTriangles)
+{
+	if (m_bShaderFailed == true)
+	{
+		return(false);
+	}
+	if ((m_geometryShader == NULL) && (LoadShaders() == false))
+	{
+		return(false);
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (((viewport[2] != m_width) || (viewport[3] != m_height)) &&
+		(CreateTargets(viewport[2], viewport[3]) == false))
+	{
+		return(false);
+	}
+
+	m_primitiveBits = 1;
+	while ((m_primitiveBits < 31) && (((GLuint)1 << m_primitiveBits) < maxTriangles))
+	{
+		m_primitiveBits++;
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	const GLuint emptyId[4] = { g_EmptyId, g_EmptyId, g_EmptyId, g_EmptyId };
+	const GLfloat farDepth = 1.0f;
+	glClearBufferuiv(GL_COLOR, 0, emptyId);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	m_geometryShader->use();
+	m_geometryShader->setIntValue("primitiveBits", m_primitiveBits);
+	return(true);
+}
+
+ShaderManager* VisibilityBuffer::GetGeometryShader() const
+{
+	return(m_geometryShader);
+}
+
+/***********************************************************
+ *  GetMaxDraws()
+ *
+ *  This method is used for getting how many draws the ID
+ *  has room for.  The last draw would make the ID of an
+ *  empty pixel, so it is left out.
+ ***********************************************************/
+GLuint VisibilityBuffer::GetMaxDraws() const
+{
+	return((GLuint)((1ull << (32 - m_primitiveBits)) - 1));
+}
+
+/***********************************************************
+ *  EndGeometryPass()
+ *
+ *  This method is used for binding the framebuffer that
+ *  was bound before the geometry pass.
+ ***********************************************************/
+void VisibilityBuffer::EndGeometryPass()
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_previousFramebuffer);
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the targets.  The IDs
+ *  are unsigned integers, which are never blended, and the
+ *  depth is a texture so the resolve pass can read it.
+ ***********************************************************/
+bool VisibilityBuffer::CreateTargets(int width, int height)
+{
+	if (m_targets[0] != 0)
+	{
+		glDeleteTextures(TARGET_COUNT, m_targets);
+	}
+	if (m_framebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_framebuffer);
+	}
+	m_width = width;
+	m_height = height;
+
+	const GLenum formats[TARGET_COUNT] = { GL_R32UI, GL_DEPTH_COMPONENT24 };
+	glGenTextures(TARGET_COUNT, m_targets);
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_targets[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_targets[ID_TARGET], 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_targets[DEPTH_TARGET], 0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "Visibility buffer is not complete, using forward shading" << std::endl;
+		m_bShaderFailed = true;
+	}
+	return(bComplete);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for shading every covered pixel of
+ *  the IDs with one full screen triangle.  The recorded
+ *  draws and their objects are uploaded for the frame, and
+ *  the shared mesh buffers are bound so the shader can
+ *  fetch the triangle of each pixel.  The depth test passes
+ *  everywhere, and the depth of the geometry pass is
+ *  written with the color.
+ ***********************************************************/
+void VisibilityBuffer::Resolve(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition,
+	const ClusteredLights& lights,
+	const ShapeMeshes& meshes,
+	const std::vector<VISIBLE_OBJECT>& objects,
+	int materialCount)
+{
+	const std::vector<ShapeMeshes::DRAW_RANGE>& draws = meshes.GetRecordedDraws();
+	if ((m_resolveShader == NULL) || (m_bShaderFailed == true) ||
+		(meshes.BindSharedBuffers(g_SharedVerticesBinding, g_SharedIndicesBinding) == false))
+	{
+		return;
+	}
+
+	// the buffers are never empty, so they can always be bound
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DRAW_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ShapeMeshes::DRAW_RANGE) * std::max(draws.size(), (size_t)1),
+		NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ShapeMeshes::DRAW_RANGE) * draws.size(), draws.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[OBJECT_BUFFER]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(VISIBLE_OBJECT) * std::max(objects.size(), (size_t)1),
+		NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(VISIBLE_OBJECT) * objects.size(), objects.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_DrawsBinding, m_buffers[DRAW_BUFFER]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectsBinding, m_buffers[OBJECT_BUFFER]);
+
+	m_resolveShader->use();
+	m_resolveShader->setMat4Value("view", view);
+	m_resolveShader->setMat4Value("projection", projection);
+	m_resolveShader->setVec3Value("viewPosition", viewPosition);
+	m_resolveShader->setIntValue("primitiveBits", m_primitiveBits);
+	m_resolveShader->setIntValue("lightCount", lights.GetLightCount());
+	m_resolveShader->setIntValue("globalLightCount", lights.GetGlobalLightCount());
+	m_resolveShader->setBoolValue("bClusterLogDepth", lights.IsLogDepth());
+	m_resolveShader->setFloatValue("clusterDepthScale", lights.GetDepthScale());
+	m_resolveShader->setFloatValue("clusterDepthBias", lights.GetDepthBias());
+	m_resolveShader->setIntValue("materialCount", materialCount);
+	m_resolveShader->setSampler2DValue("visibilityIds", g_IdUnit);
+	m_resolveShader->setSampler2DValue("visibilityDepth", g_DepthUnit);
+	for (int i = 0; i < MAX_SCENE_TEXTURES; i++)
+	{
+		m_resolveShader->setSampler2DValue("sceneTextures[" + std::to_string(i) + "]", i);
+	}
+
+	const GLuint units[TARGET_COUNT] = { g_IdUnit, g_DepthUnit };
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + units[i]);
+		glBindTexture(GL_TEXTURE_2D, m_targets[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	glDepthFunc(GL_ALWAYS);
+	glBindVertexArray(m_emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthFunc(GL_LESS);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the targets, the buffers
+ *  and the programs.
+ ***********************************************************/
+void VisibilityBuffer::Destroy()
+{
+	if (m_targets[0] != 0)
+	{
+		glDeleteTextures(TARGET_COUNT, m_targets);
+		for (int i = 0; i < TARGET_COUNT; i++)
+		{
+			m_targets[i] = 0;
+		}
+	}
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	if (m_buffers[0] != 0)
+	{
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	if (m_emptyVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVao);
+		m_emptyVao = 0;
+	}
+	DestroyProgram(m_geometryShader);
+	DestroyProgram(m_resolveShader);
+	m_bShaderFailed = false;
+}
\ No newline at end of file
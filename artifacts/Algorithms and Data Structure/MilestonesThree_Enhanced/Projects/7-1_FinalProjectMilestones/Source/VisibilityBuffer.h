@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// visibilitybuffer.h
+// ============
+// draw only the draw and triangle IDs of the scene, and shade every pixel
+// once from the triangle it shows, fetched from the shared mesh buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShapeMeshes.h"
+#include "ClusteredLights.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  VisibilityBuffer
+ *
+ *  This class keeps the targets of the visibility buffer
+ *  path.  The geometry pass writes one 32-bit ID per pixel,
+ *  the recorded draw in the high bits and the triangle of
+ *  the draw in the low bits, besides the depth, so its cost
+ *  does not grow with the materials and small triangles
+ *  only touch 4 bytes of color.  The resolve pass fetches
+ *  the three vertices of the triangle from the shared mesh
+ *  buffers, interpolates them with the barycentrics of the
+ *  pixel and shades it once with the lights of its cluster.
+ ***********************************************************/
+class VisibilityBuffer
+{
+public:
+	// constructor
+	VisibilityBuffer();
+	// destructor
+	~VisibilityBuffer();
+
+	// an object the recorded draws belong to, laid out like
+	// the VisibleObject of the resolve shader
+	struct VISIBLE_OBJECT
+	{
+		GLfloat model[16];
+		GLfloat normalMatrix[12];	// three columns padded to four floats
+		GLfloat color[4];
+		GLfloat UVscale[2];
+		GLint material;				// -1 without a material
+		GLint textureSlot;			// -1 without a texture
+	};
+
+	// texture units the resolve pass reads the scene
+	// textures from
+	static const int MAX_SCENE_TEXTURES = 16;
+
+	// bind and clear the ID and depth targets, sized to the
+	// current viewport, with enough low bits in the ID for
+	// the passed in most triangles of a draw.  The geometry
+	// program is made current.  False when the shaders or
+	// the targets could not be created
+	bool BeginGeometryPass(GLuint maxTriangles);
+	// program of the geometry pass, which shares the vertex
+	// shader of the scene
+	ShaderManager* GetGeometryShader() const;
+	// most draws the high bits of the ID can tell apart
+	GLuint GetMaxDraws() const;
+	// go back to the framebuffer that was bound before
+	void EndGeometryPass();
+
+	// shade the pixels of the IDs into the bound framebuffer
+	// from the draws recorded by the meshes, and write their
+	// depth there for the forward draws that follow.  The
+	// material table is read from its storage buffer, and
+	// the current program is changed
+	void Resolve(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition,
+		const ClusteredLights& lights,
+		const ShapeMeshes& meshes,
+		const std::vector<VISIBLE_OBJECT>& objects,
+		int materialCount);
+
+	// free the targets, the buffers and the shaders
+	void Destroy();
+
+private:
+	// load the geometry and resolve programs
+	bool LoadShaders();
+	// create the ID and depth targets at the passed in size
+	bool CreateTargets(int width, int height);
+
+	enum TARGET
+	{
+		ID_TARGET,
+		DEPTH_TARGET,
+		TARGET_COUNT
+	};
+
+	enum BUFFER
+	{
+		DRAW_BUFFER,
+		OBJECT_BUFFER,
+		BUFFER_COUNT
+	};
+
+	GLuint m_framebuffer;
+	GLuint m_targets[TARGET_COUNT];
+	int m_width;
+	int m_height;
+	GLint m_previousFramebuffer;
+
+	ShaderManager* m_geometryShader;
+	ShaderManager* m_resolveShader;
+	bool m_bShaderFailed;
+	// no vertex buffers, the full screen triangle comes from
+	// the vertex index
+	GLuint m_emptyVao;
+
+	// bits of the ID holding the triangle of the draw
+	int m_primitiveBits;
+	GLuint m_buffers[BUFFER_COUNT];
+};
\ No newline at end of file
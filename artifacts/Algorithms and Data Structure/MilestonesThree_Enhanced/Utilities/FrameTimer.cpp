@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimer.cpp
+// ============
+// measure the CPU and GPU time spent rendering frames, for comparing
+// rendering paths on different drivers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTimer.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  FrameTimer()
+ *
+ *  The constructor for the class, which needs a current
+ *  OpenGL context for creating the timer queries.
+ ***********************************************************/
+FrameTimer::FrameTimer()
+{
+	glGenQueries(QUERY_COUNT, m_queries);
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_bQueryPending[i] = false;
+	}
+	m_frameIndex = 0;
+
+	m_cpuFrames = 0;
+	m_gpuFrames = 0;
+	m_totalCpuMs = 0.0;
+	m_totalGpuMs = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameTimer::~FrameTimer()
+{
+	glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the measurement of a
+ *  frame.  The result of the query that is about to be
+ *  reused is collected first.
+ ***********************************************************/
+void FrameTimer::BeginFrame()
+{
+	int slot = m_frameIndex % QUERY_COUNT;
+
+	if (m_bQueryPending[slot] == true)
+	{
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &elapsedNs);
+		m_totalGpuMs += (double)elapsedNs / 1000000.0;
+		m_gpuFrames++;
+		m_bQueryPending[slot] = false;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[slot]);
+	m_frameStart = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for ending the measurement of a
+ *  frame.
+ ***********************************************************/
+void FrameTimer::EndFrame()
+{
+	int slot = m_frameIndex % QUERY_COUNT;
+
+	std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - m_frameStart;
+	m_totalCpuMs += cpuTime.count();
+	m_cpuFrames++;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bQueryPending[slot] = true;
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  GetFrameCount()
+ *
+ *  This method is used for getting the number of measured
+ *  frames.
+ ***********************************************************/
+int FrameTimer::GetFrameCount() const
+{
+	return(m_cpuFrames);
+}
+
+/***********************************************************
+ *  GetAverageCpuMs()
+ *
+ *  This method is used for getting the average CPU time of
+ *  the measured frames in milliseconds.
+ ***********************************************************/
+double FrameTimer::GetAverageCpuMs() const
+{
+	if (m_cpuFrames == 0)
+	{
+		return(0.0);
+	}
+	return(m_totalCpuMs / m_cpuFrames);
+}
+
+/***********************************************************
+ *  GetAverageGpuMs()
+ *
+ *  This method is used for getting the average GPU time of
+ *  the measured frames in milliseconds.  The last few
+ *  frames are still in flight and not included.
+ ***********************************************************/
+double FrameTimer::GetAverageGpuMs() const
+{
+	if (m_gpuFrames == 0)
+	{
+		return(0.0);
+	}
+	return(m_totalGpuMs / m_gpuFrames);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the averages, along
+ *  with the renderer they were measured on.
+ ***********************************************************/
+void FrameTimer::PrintReport(const char* label) const
+{
+	std::cout << "BENCHMARK: " << label
+		<< " | renderer: " << glGetString(GL_RENDERER)
+		<< " | frames: " << m_cpuFrames
+		<< " | cpu: " << GetAverageCpuMs() << " ms"
+		<< " | gpu: " << GetAverageGpuMs() << " ms" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimer.h
+// ============
+// measure the CPU and GPU time spent rendering frames, for comparing
+// rendering paths on different drivers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+
+/***********************************************************
+ *  FrameTimer
+ *
+ *  This class measures the CPU time between BeginFrame()
+ *  and EndFrame(), and the GPU time of the commands issued
+ *  in between with timer queries.  The queries are read a
+ *  few frames later so the measurement never stalls the
+ *  pipeline.
+ ***********************************************************/
+class FrameTimer
+{
+public:
+	// constructor
+	FrameTimer();
+	// destructor
+	~FrameTimer();
+
+	// mark the start and the end of the measured commands
+	void BeginFrame();
+	void EndFrame();
+
+	// number of measured frames
+	int GetFrameCount() const;
+	// average times in milliseconds
+	double GetAverageCpuMs() const;
+	double GetAverageGpuMs() const;
+
+	// print the averages with the passed in label
+	void PrintReport(const char* label) const;
+
+private:
+	// frames in flight before a query result is read
+	static const int QUERY_COUNT = 4;
+
+	GLuint m_queries[QUERY_COUNT];
+	bool m_bQueryPending[QUERY_COUNT];
+	int m_frameIndex;
+
+	std::chrono::steady_clock::time_point m_frameStart;
+
+	int m_cpuFrames;
+	int m_gpuFrames;
+	double m_totalCpuMs;
+	double m_totalGpuMs;
+};
\ No newline at end of file
@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// spread independent jobs, such as mesh conversions, across worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+// declaration of global variables
+namespace
+{
+	// set on the worker threads, so nested ParallelFor() calls run serially
+	thread_local bool g_bIsWorkerThread = false;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class, which starts the worker
+ *  threads.
+ ***********************************************************/
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	m_job = NULL;
+	m_count = 0;
+	m_nextIndex = 0;
+	m_completed = 0;
+	m_generation = 0;
+	m_activeWorkers = 0;
+	m_bStop = false;
+
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? (hardwareThreads - 1) : 1;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class, which stops and joins the
+ *  worker threads.
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_wakeWorkers.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  Get()
+ *
+ *  This method is used for getting the job system shared by
+ *  the whole application, which is created on first use.
+ ***********************************************************/
+JobSystem& JobSystem::Get()
+{
+	static JobSystem jobSystem;
+	return(jobSystem);
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used for getting the number of workers.
+ ***********************************************************/
+unsigned int JobSystem::GetWorkerCount() const
+{
+	return((unsigned int)m_workers.size());
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for calling the passed in job for
+ *  every index in [0, count).  The iterations are claimed
+ *  one at a time by the workers and the calling thread, so
+ *  uneven jobs still balance, and the method returns once
+ *  every iteration has completed.
+ ***********************************************************/
+void JobSystem::ParallelFor(
+	size_t count,
+	const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// small or nested loops are not worth waking the workers
+	if ((count == 1) || (g_bIsWorkerThread == true) || (m_workers.size() == 0))
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> parallelForLock(m_parallelForMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &job;
+		m_count = count;
+		m_nextIndex = 0;
+		m_completed = 0;
+		m_generation++;
+	}
+	m_wakeWorkers.notify_all();
+
+	RunIterations(&job);
+
+	// wait for the last iterations, and for every worker that joined
+	// this job to let go of it before the job goes out of scope
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobDone.wait(lock, [this]()
+	{
+		return((m_completed == m_count) && (m_activeWorkers == 0));
+	});
+	m_job = NULL;
+}
+
+/***********************************************************
+ *  RunIterations()
+ *
+ *  This method is used for claiming and running iterations
+ *  of the current job until none are left.
+ ***********************************************************/
+void JobSystem::RunIterations(const std::function<void(size_t)>* job)
+{
+	size_t index = m_nextIndex.fetch_add(1);
+	while (index < m_count)
+	{
+		(*job)(index);
+		if ((m_completed.fetch_add(1) + 1) == m_count)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobDone.notify_all();
+		}
+		index = m_nextIndex.fetch_add(1);
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is executed by every worker thread.  It waits
+ *  for a new job and helps running its iterations.
+ ***********************************************************/
+void JobSystem::WorkerLoop()
+{
+	g_bIsWorkerThread = true;
+	unsigned int seenGeneration = 0;
+
+	while (true)
+	{
+		const std::function<void(size_t)>* job = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeWorkers.wait(lock, [this, seenGeneration]()
+			{
+				return((m_bStop == true) || (m_generation != seenGeneration));
+			});
+			if (m_bStop == true)
+			{
+				return;
+			}
+			seenGeneration = m_generation;
+
+			// the job may already be finished when this worker wakes up late
+			job = m_job;
+			if (job == NULL)
+			{
+				continue;
+			}
+			m_activeWorkers++;
+		}
+
+		RunIterations(job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeWorkers--;
+		}
+		m_jobDone.notify_all();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// spread independent jobs, such as mesh conversions, across worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class keeps a pool of worker threads that execute
+ *  the iterations of ParallelFor() together with the calling
+ *  thread.  Jobs must not call ParallelFor() themselves; a
+ *  nested call runs serially on the calling worker instead.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor - zero workers selects one less than the
+	// number of hardware threads
+	JobSystem(unsigned int workerCount = 0);
+	// destructor
+	~JobSystem();
+
+	// the job system shared by the whole application
+	static JobSystem& Get();
+
+	// call the job for every index in [0, count) and wait
+	// until all of them have completed
+	void ParallelFor(
+		size_t count,
+		const std::function<void(size_t)>& job);
+
+	// number of worker threads, not counting the caller
+	unsigned int GetWorkerCount() const;
+
+private:
+	// executed by each worker thread
+	void WorkerLoop();
+	// claim and run iterations of the current job
+	void RunIterations(const std::function<void(size_t)>* job);
+
+	std::vector<std::thread> m_workers;
+
+	// serializes ParallelFor() calls from different threads
+	std::mutex m_parallelForMutex;
+
+	// protects the job state below
+	std::mutex m_mutex;
+	std::condition_variable m_wakeWorkers;
+	std::condition_variable m_jobDone;
+
+	const std::function<void(size_t)>* m_job;
+	size_t m_count;
+	std::atomic<size_t> m_nextIndex;
+	std::atomic<size_t> m_completed;
+	unsigned int m_generation;
+	unsigned int m_activeWorkers;
+	bool m_bStop;
+};
\ No newline at end of file
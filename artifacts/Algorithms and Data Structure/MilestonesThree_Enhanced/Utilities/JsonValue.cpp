@@ -0,0 +1,547 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonvalue.cpp
+// ============
+// parse JSON text, such as the scene description of glTF files, into a
+// tree of values
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JsonValue.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// deeper nesting is rejected instead of overflowing the stack
+	const int g_MaxNestingDepth = 128;
+
+	// returned for missing strings and out of range elements
+	const std::string g_EmptyString;
+	const JsonValue g_NullValue;
+}
+
+/***********************************************************
+ *  JsonParser
+ *
+ *  This class is a recursive descent parser that fills in
+ *  the values of a JsonValue tree.
+ ***********************************************************/
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length)
+	{
+		m_text = text;
+		m_length = length;
+		m_position = 0;
+	}
+
+	bool ParseDocument(JsonValue& root, std::string& error)
+	{
+		bool bSuccess = ParseValue(root, 0);
+		if (bSuccess == true)
+		{
+			SkipWhitespace();
+			if (m_position < m_length)
+			{
+				m_error = "unexpected text after the root value";
+				bSuccess = false;
+			}
+		}
+		if (bSuccess == false)
+		{
+			error = m_error + " at offset " + std::to_string(m_position);
+		}
+		return(bSuccess);
+	}
+
+private:
+	void SkipWhitespace()
+	{
+		while ((m_position < m_length) &&
+			((m_text[m_position] == ' ') || (m_text[m_position] == '\t') ||
+			 (m_text[m_position] == '\n') || (m_text[m_position] == '\r')))
+		{
+			m_position++;
+		}
+	}
+
+	bool MatchLiteral(const char* literal)
+	{
+		size_t literalLength = strlen(literal);
+		if ((m_length - m_position < literalLength) ||
+			(memcmp(m_text + m_position, literal, literalLength) != 0))
+		{
+			m_error = "invalid literal";
+			return(false);
+		}
+		m_position += literalLength;
+		return(true);
+	}
+
+	bool ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > g_MaxNestingDepth)
+		{
+			m_error = "nesting is too deep";
+			return(false);
+		}
+
+		SkipWhitespace();
+		if (m_position >= m_length)
+		{
+			m_error = "unexpected end of text";
+			return(false);
+		}
+
+		switch (m_text[m_position])
+		{
+		case '{':
+			return(ParseObject(value, depth));
+		case '[':
+			return(ParseArray(value, depth));
+		case '"':
+			value.m_type = JsonValue::JSON_STRING;
+			return(ParseString(value.m_string));
+		case 't':
+			value.m_type = JsonValue::JSON_BOOL;
+			value.m_bool = true;
+			return(MatchLiteral("true"));
+		case 'f':
+			value.m_type = JsonValue::JSON_BOOL;
+			value.m_bool = false;
+			return(MatchLiteral("false"));
+		case 'n':
+			value.m_type = JsonValue::JSON_NULL;
+			return(MatchLiteral("null"));
+		default:
+			return(ParseNumber(value));
+		}
+	}
+
+	bool ParseObject(JsonValue& value, int depth)
+	{
+		value.m_type = JsonValue::JSON_OBJECT;
+		m_position++;
+
+		SkipWhitespace();
+		if ((m_position < m_length) && (m_text[m_position] == '}'))
+		{
+			m_position++;
+			return(true);
+		}
+
+		while (true)
+		{
+			SkipWhitespace();
+			if ((m_position >= m_length) || (m_text[m_position] != '"'))
+			{
+				m_error = "expected a member name";
+				return(false);
+			}
+
+			value.m_keys.push_back(std::string());
+			if (ParseString(value.m_keys.back()) == false)
+			{
+				return(false);
+			}
+
+			SkipWhitespace();
+			if ((m_position >= m_length) || (m_text[m_position] != ':'))
+			{
+				m_error = "expected ':'";
+				return(false);
+			}
+			m_position++;
+
+			value.m_elements.push_back(JsonValue());
+			if (ParseValue(value.m_elements.back(), depth + 1) == false)
+			{
+				return(false);
+			}
+
+			SkipWhitespace();
+			if (m_position >= m_length)
+			{
+				m_error = "unterminated object";
+				return(false);
+			}
+			if (m_text[m_position] == '}')
+			{
+				m_position++;
+				return(true);
+			}
+			if (m_text[m_position] != ',')
+			{
+				m_error = "expected ',' or '}'";
+				return(false);
+			}
+			m_position++;
+		}
+	}
+
+	bool ParseArray(JsonValue& value, int depth)
+	{
+		value.m_type = JsonValue::JSON_ARRAY;
+		m_position++;
+
+		SkipWhitespace();
+		if ((m_position < m_length) && (m_text[m_position] == ']'))
+		{
+			m_position++;
+			return(true);
+		}
+
+		while (true)
+		{
+			value.m_elements.push_back(JsonValue());
+			if (ParseValue(value.m_elements.back(), depth + 1) == false)
+			{
+				return(false);
+			}
+
+			SkipWhitespace();
+			if (m_position >= m_length)
+			{
+				m_error = "unterminated array";
+				return(false);
+			}
+			if (m_text[m_position] == ']')
+			{
+				m_position++;
+				return(true);
+			}
+			if (m_text[m_position] != ',')
+			{
+				m_error = "expected ',' or ']'";
+				return(false);
+			}
+			m_position++;
+		}
+	}
+
+	bool ParseHexDigits(unsigned int& codePoint)
+	{
+		if (m_length - m_position < 4)
+		{
+			m_error = "truncated unicode escape";
+			return(false);
+		}
+
+		codePoint = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char digit = m_text[m_position++];
+			codePoint <<= 4;
+			if ((digit >= '0') && (digit <= '9'))
+			{
+				codePoint |= (unsigned int)(digit - '0');
+			}
+			else if ((digit >= 'a') && (digit <= 'f'))
+			{
+				codePoint |= (unsigned int)(digit - 'a' + 10);
+			}
+			else if ((digit >= 'A') && (digit <= 'F'))
+			{
+				codePoint |= (unsigned int)(digit - 'A' + 10);
+			}
+			else
+			{
+				m_error = "invalid unicode escape";
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	void AppendUtf8(std::string& text, unsigned int codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			text += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			text += (char)(0xC0 | (codePoint >> 6));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			text += (char)(0xE0 | (codePoint >> 12));
+			text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			text += (char)(0xF0 | (codePoint >> 18));
+			text += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			text += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	bool ParseString(std::string& text)
+	{
+		// skip the opening quote
+		m_position++;
+
+		while (m_position < m_length)
+		{
+			char character = m_text[m_position++];
+			if (character == '"')
+			{
+				return(true);
+			}
+			if (character != '\\')
+			{
+				text += character;
+				continue;
+			}
+
+			if (m_position >= m_length)
+			{
+				break;
+			}
+			character = m_text[m_position++];
+			switch (character)
+			{
+			case '"':  text += '"';  break;
+			case '\\': text += '\\'; break;
+			case '/':  text += '/';  break;
+			case 'b':  text += '\b'; break;
+			case 'f':  text += '\f'; break;
+			case 'n':  text += '\n'; break;
+			case 'r':  text += '\r'; break;
+			case 't':  text += '\t'; break;
+			case 'u':
+			{
+				unsigned int codePoint = 0;
+				if (ParseHexDigits(codePoint) == false)
+				{
+					return(false);
+				}
+				// combine surrogate pairs into one code point
+				if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF) &&
+					(m_length - m_position >= 6) &&
+					(m_text[m_position] == '\\') && (m_text[m_position + 1] == 'u'))
+				{
+					m_position += 2;
+					unsigned int lowSurrogate = 0;
+					if (ParseHexDigits(lowSurrogate) == false)
+					{
+						return(false);
+					}
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				}
+				AppendUtf8(text, codePoint);
+				break;
+			}
+			default:
+				m_error = "invalid escape sequence";
+				return(false);
+			}
+		}
+
+		m_error = "unterminated string";
+		return(false);
+	}
+
+	bool ParseNumber(JsonValue& value)
+	{
+		size_t start = m_position;
+		while ((m_position < m_length) &&
+			(strchr("+-0123456789.eE", m_text[m_position]) != NULL) &&
+			(m_text[m_position] != '\0'))
+		{
+			m_position++;
+		}
+
+		// the text is not null terminated, so convert a copy
+		std::string number(m_text + start, m_position - start);
+		char* numberEnd = NULL;
+		value.m_type = JsonValue::JSON_NUMBER;
+		value.m_number = strtod(number.c_str(), &numberEnd);
+		if ((number.empty() == true) || (*numberEnd != '\0'))
+		{
+			m_position = start;
+			m_error = "invalid value";
+			return(false);
+		}
+		return(true);
+	}
+
+	const char* m_text;
+	size_t m_length;
+	size_t m_position;
+	std::string m_error;
+};
+
+/***********************************************************
+ *  JsonValue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JsonValue::JsonValue()
+{
+	m_type = JSON_NULL;
+	m_bool = false;
+	m_number = 0.0;
+}
+
+/***********************************************************
+ *  Parse()
+ *
+ *  This method is used for parsing the passed in text into
+ *  the root value.
+ ***********************************************************/
+bool JsonValue::Parse(
+	const char* text,
+	size_t length,
+	JsonValue& root,
+	std::string& error)
+{
+	root = JsonValue();
+	JsonParser parser(text, length);
+	return(parser.ParseDocument(root, error));
+}
+
+/***********************************************************
+ *  GetType()
+ *
+ *  This method is used for getting the type of the value.
+ ***********************************************************/
+JsonValue::JSON_TYPE JsonValue::GetType() const
+{
+	return(m_type);
+}
+
+/***********************************************************
+ *  GetBool()
+ *
+ *  This method is used for getting a boolean value.
+ ***********************************************************/
+bool JsonValue::GetBool(bool defaultValue) const
+{
+	if (m_type != JSON_BOOL)
+	{
+		return(defaultValue);
+	}
+	return(m_bool);
+}
+
+/***********************************************************
+ *  GetNumber()
+ *
+ *  This method is used for getting a numeric value.
+ ***********************************************************/
+double JsonValue::GetNumber(double defaultValue) const
+{
+	if (m_type != JSON_NUMBER)
+	{
+		return(defaultValue);
+	}
+	return(m_number);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string value, which is
+ *  empty for values of other types.
+ ***********************************************************/
+const std::string& JsonValue::GetString() const
+{
+	if (m_type != JSON_STRING)
+	{
+		return(g_EmptyString);
+	}
+	return(m_string);
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method is used for getting the number of array
+ *  elements or object members.
+ ***********************************************************/
+size_t JsonValue::GetSize() const
+{
+	return(m_elements.size());
+}
+
+/***********************************************************
+ *  GetElement()
+ *
+ *  This method is used for getting an array element or an
+ *  object member value by position.  A null value is
+ *  returned for positions out of range.
+ ***********************************************************/
+const JsonValue& JsonValue::GetElement(size_t index) const
+{
+	if (index >= m_elements.size())
+	{
+		return(g_NullValue);
+	}
+	return(m_elements[index]);
+}
+
+/***********************************************************
+ *  GetKey()
+ *
+ *  This method is used for getting an object member key by
+ *  position.
+ ***********************************************************/
+const std::string& JsonValue::GetKey(size_t index) const
+{
+	if (index >= m_keys.size())
+	{
+		return(g_EmptyString);
+	}
+	return(m_keys[index]);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for finding an object member by its
+ *  key.  NULL is returned when the member is missing.
+ ***********************************************************/
+const JsonValue* JsonValue::Find(const char* key) const
+{
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		if (m_keys[i] == key)
+		{
+			return(&m_elements[i]);
+		}
+	}
+	return(NULL);
+}
+
+/***********************************************************
+ *  GetNumber()
+ *
+ *  This method is used for getting a numeric object member,
+ *  or the passed in default when it is missing.
+ ***********************************************************/
+double JsonValue::GetNumber(const char* key, double defaultValue) const
+{
+	const JsonValue* member = Find(key);
+	if (member == NULL)
+	{
+		return(defaultValue);
+	}
+	return(member->GetNumber(defaultValue));
+}
+
+/***********************************************************
+ *  GetInt()
+ *
+ *  This method is used for getting an integer object
+ *  member, or the passed in default when it is missing.
+ ***********************************************************/
+int JsonValue::GetInt(const char* key, int defaultValue) const
+{
+	return((int)GetNumber(key, (double)defaultValue));
+}
\ No newline at end of file
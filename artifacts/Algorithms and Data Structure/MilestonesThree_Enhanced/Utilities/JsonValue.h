@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonvalue.h
+// ============
+// parse JSON text, such as the scene description of glTF files, into a
+// tree of values
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  JsonValue
+ *
+ *  This class holds one parsed JSON value.  Arrays and
+ *  objects own their elements, and object members keep the
+ *  order they had in the text.
+ ***********************************************************/
+class JsonValue
+{
+public:
+	enum JSON_TYPE
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// constructor
+	JsonValue();
+
+	// parse the passed in text, which does not need to be null
+	// terminated, returns false and a message on a syntax error
+	static bool Parse(
+		const char* text,
+		size_t length,
+		JsonValue& root,
+		std::string& error);
+
+	JSON_TYPE GetType() const;
+
+	// values of the scalar types, or the passed in default when
+	// the value has a different type
+	bool GetBool(bool defaultValue = false) const;
+	double GetNumber(double defaultValue = 0.0) const;
+	const std::string& GetString() const;
+
+	// number of array elements or object members
+	size_t GetSize() const;
+	// array element or object member by position
+	const JsonValue& GetElement(size_t index) const;
+	// object member key by position
+	const std::string& GetKey(size_t index) const;
+	// object member by key, NULL when it is missing
+	const JsonValue* Find(const char* key) const;
+
+	// numeric object member by key, or the passed in default
+	double GetNumber(const char* key, double defaultValue) const;
+	int GetInt(const char* key, int defaultValue) const;
+
+private:
+	friend class JsonParser;
+
+	JSON_TYPE m_type;
+	bool m_bool;
+	double m_number;
+	std::string m_string;
+	// array elements, or object member values
+	std::vector<JsonValue> m_elements;
+	// object member keys, parallel to m_elements
+	std::vector<std::string> m_keys;
+};
\ No newline at end of file
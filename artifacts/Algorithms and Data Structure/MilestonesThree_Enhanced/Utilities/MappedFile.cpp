@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// map a whole file read-only into memory, so large assets can be read
+// without copying them into intermediate buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#else
+	m_fileDescriptor = -1;
+#endif
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the passed in file
+ *  read-only into memory.  Empty files cannot be mapped.
+ ***********************************************************/
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(m_fileHandle, &fileSize) == FALSE) || (fileSize.QuadPart == 0))
+	{
+		Close();
+		return(false);
+	}
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mappingHandle == NULL)
+	{
+		Close();
+		return(false);
+	}
+
+	m_data = (const unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == NULL)
+	{
+		Close();
+		return(false);
+	}
+	m_size = (size_t)fileSize.QuadPart;
+#else
+	m_fileDescriptor = open(filename, O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(m_fileDescriptor, &fileInfo) != 0) || (fileInfo.st_size == 0))
+	{
+		Close();
+		return(false);
+	}
+
+	void* data = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return(false);
+	}
+
+	// the file is read front to back during import
+	madvise(data, (size_t)fileInfo.st_size, MADV_SEQUENTIAL);
+
+	m_data = (const unsigned char*)data;
+	m_size = (size_t)fileInfo.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file.
+ ***********************************************************/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data != NULL)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mappingHandle != NULL)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_data != NULL)
+	{
+		munmap((void*)m_data, m_size);
+	}
+	if (m_fileDescriptor >= 0)
+	{
+		close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+#endif
+
+	m_data = NULL;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  GetData()
+ *
+ *  This method is used for getting the mapped file bytes.
+ ***********************************************************/
+const unsigned char* MappedFile::GetData() const
+{
+	return(m_data);
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method is used for getting the mapped file size.
+ ***********************************************************/
+size_t MappedFile::GetSize() const
+{
+	return(m_size);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a whole file read-only into memory, so large assets can be read
+// without copying them into intermediate buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a file into the address space of the
+ *  process.  The pages are loaded by the operating system
+ *  when they are first read.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file, returns false on failure
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	// the mapped bytes of the file
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	// files cannot be mapped twice by the same object
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+};
\ No newline at end of file
@@ -14,13 +14,30 @@ using namespace std;
 
 #include "ShaderManager.h"
 
+/***********************************************************
+ *  InsertDefines()
+ *
+ *  This function is called to add the lines that select a
+ *  shader variant after the #version line, which must stay
+ *  the first line of the shader.
+ ***********************************************************/
+static void InsertDefines(std::string& code, const char * defines){
+	size_t lineEnd = code.find('\n', code.find("#version"));
+	if(lineEnd == std::string::npos){
+		code = std::string(defines) + "\n" + code;
+	}else{
+		code.insert(lineEnd + 1, std::string(defines) + "\n");
+	}
+}
+
 /***********************************************************
  *  LoadShaders()
  *
  *  This method is called to load the shader data from 
- *  external GLSL compatible files.
+ *  external GLSL compatible files, with the passed in
+ *  defines added to both shaders when they are not NULL.
  ***********************************************************/
-GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fragment_file_path,const char * defines){
 
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -50,6 +67,11 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		FragmentShaderStream.close();
 	}
 
+	if(defines != NULL){
+		InsertDefines(VertexShaderCode, defines);
+		InsertDefines(FragmentShaderCode, defines);
+	}
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
@@ -116,4 +138,80 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 	return ProgramID;
 }
 
+/***********************************************************
+ *  LoadComputeShader()
+ *
+ *  This method is called to load a compute shader from an
+ *  external GLSL compatible file and link it into its own
+ *  program.  Returns 0 when the file is missing or the
+ *  shader does not compile or link.
+ ***********************************************************/
+GLuint ShaderManager::LoadComputeShader(const char * compute_file_path){
+
+	// Read the Compute Shader code from the file
+	std::string ComputeShaderCode;
+	std::ifstream ComputeShaderStream(compute_file_path, std::ios::in);
+	if(ComputeShaderStream.is_open()){
+		std::stringstream sstr;
+		sstr << ComputeShaderStream.rdbuf();
+		ComputeShaderCode = sstr.str();
+		ComputeShaderStream.close();
+	}else{
+		printf("Impossible to open %s.\n", compute_file_path);
+		return 0;
+	}
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
+	// Compile Compute Shader
+	printf("Compiling shader : %s...", compute_file_path);
+	GLuint ComputeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+	char const * ComputeSourcePointer = ComputeShaderCode.c_str();
+	glShaderSource(ComputeShaderID, 1, &ComputeSourcePointer , NULL);
+	glCompileShader(ComputeShaderID);
+
+	// Check Compute Shader
+	glGetShaderiv(ComputeShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ComputeShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ComputeShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ComputeShaderID, InfoLogLength, NULL, &ComputeShaderErrorMessage[0]);
+		printf("\n%s\n", &ComputeShaderErrorMessage[0]);
+	}
+	if ( Result == GL_FALSE ){
+		glDeleteShader(ComputeShaderID);
+		return 0;
+	}
+
+	printf("success\n");
+
+	// Link the program
+	printf("Linking shader program...");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, ComputeShaderID);
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 1 ){
+		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("\n%s\n", &ProgramErrorMessage[0]);
+	}
+
+	glDetachShader(ProgramID, ComputeShaderID);
+	glDeleteShader(ComputeShaderID);
+
+	if ( Result == GL_FALSE ){
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	printf("success\n");
+
+	return ProgramID;
+}
+
 
@@ -16,9 +16,17 @@ class ShaderManager
 public:
 	unsigned int m_programID;
 	
+	// the defines, when passed, are added after the version
+	// line of both shaders to select a variant of them
 	GLuint LoadShaders(
 		const char* vertex_file_path, 
-		const char* fragment_file_path);
+		const char* fragment_file_path,
+		const char* defines = NULL);
+
+	// load a compute shader into a program of its own, which
+	// leaves m_programID untouched
+	GLuint LoadComputeShader(
+		const char* compute_file_path);
 
 	// activate the shader
 	// ------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// simdfloats.h
+// ============
+// wrappers over the float vector types of the target, so the SIMD kernels
+// are written once and map to AVX, SSE or plain floats
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_FLOATS_AVX
+#define SIMD_FLOATS_SSE
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_FLOATS_SSE
+#endif
+
+// the wrappers have internal linkage, so modules built with a
+// different instruction set never share one copy of them
+namespace
+{
+	// FLOATS4 always holds four floats, for data laid out in
+	// groups of four such as the children of a BVH node.
+	// Comparisons give a mask per lane, and Select() takes a
+	// where the mask is set
+#if defined(SIMD_FLOATS_SSE)
+	typedef __m128 FLOATS4;
+
+	inline FLOATS4 LoadFloats4(const float* data) { return(_mm_loadu_ps(data)); }
+	inline void StoreFloats4(float* data, FLOATS4 value) { _mm_storeu_ps(data, value); }
+	inline FLOATS4 SetFloats4(float value) { return(_mm_set1_ps(value)); }
+	inline FLOATS4 Add(FLOATS4 a, FLOATS4 b) { return(_mm_add_ps(a, b)); }
+	inline FLOATS4 Sub(FLOATS4 a, FLOATS4 b) { return(_mm_sub_ps(a, b)); }
+	inline FLOATS4 Mul(FLOATS4 a, FLOATS4 b) { return(_mm_mul_ps(a, b)); }
+	inline FLOATS4 Div(FLOATS4 a, FLOATS4 b) { return(_mm_div_ps(a, b)); }
+	inline FLOATS4 Sqrt(FLOATS4 a) { return(_mm_sqrt_ps(a)); }
+	inline FLOATS4 Min(FLOATS4 a, FLOATS4 b) { return(_mm_min_ps(a, b)); }
+	inline FLOATS4 Max(FLOATS4 a, FLOATS4 b) { return(_mm_max_ps(a, b)); }
+	inline FLOATS4 Less(FLOATS4 a, FLOATS4 b) { return(_mm_cmplt_ps(a, b)); }
+	inline FLOATS4 LessEqual(FLOATS4 a, FLOATS4 b) { return(_mm_cmple_ps(a, b)); }
+	inline FLOATS4 GreaterEqual(FLOATS4 a, FLOATS4 b) { return(_mm_cmpge_ps(a, b)); }
+	inline FLOATS4 And(FLOATS4 a, FLOATS4 b) { return(_mm_and_ps(a, b)); }
+	inline FLOATS4 Or(FLOATS4 a, FLOATS4 b) { return(_mm_or_ps(a, b)); }
+	inline FLOATS4 Select(FLOATS4 mask, FLOATS4 a, FLOATS4 b) { return(_mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))); }
+	inline int MaskBits(FLOATS4 mask) { return(_mm_movemask_ps(mask)); }
+#else
+	struct FLOATS4
+	{
+		float lane[4];
+	};
+
+	inline FLOATS4 LoadFloats4(const float* data) { FLOATS4 r; for (int i = 0; i < 4; i++) r.lane[i] = data[i]; return(r); }
+	inline void StoreFloats4(float* data, FLOATS4 value) { for (int i = 0; i < 4; i++) data[i] = value.lane[i]; }
+	inline FLOATS4 SetFloats4(float value) { FLOATS4 r; for (int i = 0; i < 4; i++) r.lane[i] = value; return(r); }
+	inline FLOATS4 Add(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] += b.lane[i]; return(a); }
+	inline FLOATS4 Sub(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] -= b.lane[i]; return(a); }
+	inline FLOATS4 Mul(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] *= b.lane[i]; return(a); }
+	inline FLOATS4 Div(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] /= b.lane[i]; return(a); }
+	inline FLOATS4 Sqrt(FLOATS4 a) { for (int i = 0; i < 4; i++) a.lane[i] = std::sqrt(a.lane[i]); return(a); }
+	inline FLOATS4 Min(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (a.lane[i] < b.lane[i]) ? a.lane[i] : b.lane[i]; return(a); }
+	inline FLOATS4 Max(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (a.lane[i] > b.lane[i]) ? a.lane[i] : b.lane[i]; return(a); }
+	inline FLOATS4 Less(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (a.lane[i] < b.lane[i]) ? 1.0f : 0.0f; return(a); }
+	inline FLOATS4 LessEqual(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (a.lane[i] <= b.lane[i]) ? 1.0f : 0.0f; return(a); }
+	inline FLOATS4 GreaterEqual(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (a.lane[i] >= b.lane[i]) ? 1.0f : 0.0f; return(a); }
+	inline FLOATS4 And(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = ((a.lane[i] != 0.0f) && (b.lane[i] != 0.0f)) ? 1.0f : 0.0f; return(a); }
+	inline FLOATS4 Or(FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = ((a.lane[i] != 0.0f) || (b.lane[i] != 0.0f)) ? 1.0f : 0.0f; return(a); }
+	inline FLOATS4 Select(FLOATS4 mask, FLOATS4 a, FLOATS4 b) { for (int i = 0; i < 4; i++) a.lane[i] = (mask.lane[i] != 0.0f) ? a.lane[i] : b.lane[i]; return(a); }
+	inline int MaskBits(FLOATS4 mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= (mask.lane[i] != 0.0f) ? (1 << i) : 0; return(bits); }
+#endif
+
+	// FLOATS is the widest vector of the target, with g_Lanes
+	// floats, for kernels that process any number of lanes
+#if defined(SIMD_FLOATS_AVX)
+	typedef __m256 FLOATS;
+	const size_t g_Lanes = 8;
+
+	inline FLOATS LoadFloats(const float* data) { return(_mm256_loadu_ps(data)); }
+	inline void StoreFloats(float* data, FLOATS value) { _mm256_storeu_ps(data, value); }
+	inline FLOATS SetFloats(float value) { return(_mm256_set1_ps(value)); }
+	inline FLOATS Add(FLOATS a, FLOATS b) { return(_mm256_add_ps(a, b)); }
+	inline FLOATS Sub(FLOATS a, FLOATS b) { return(_mm256_sub_ps(a, b)); }
+	inline FLOATS Mul(FLOATS a, FLOATS b) { return(_mm256_mul_ps(a, b)); }
+	inline FLOATS Div(FLOATS a, FLOATS b) { return(_mm256_div_ps(a, b)); }
+	inline FLOATS Sqrt(FLOATS a) { return(_mm256_sqrt_ps(a)); }
+	inline FLOATS Min(FLOATS a, FLOATS b) { return(_mm256_min_ps(a, b)); }
+	inline FLOATS Max(FLOATS a, FLOATS b) { return(_mm256_max_ps(a, b)); }
+	inline FLOATS Less(FLOATS a, FLOATS b) { return(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	inline FLOATS LessEqual(FLOATS a, FLOATS b) { return(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+	inline FLOATS GreaterEqual(FLOATS a, FLOATS b) { return(_mm256_cmp_ps(a, b, _CMP_GE_OQ)); }
+	inline FLOATS And(FLOATS a, FLOATS b) { return(_mm256_and_ps(a, b)); }
+	inline FLOATS Or(FLOATS a, FLOATS b) { return(_mm256_or_ps(a, b)); }
+	inline FLOATS Select(FLOATS mask, FLOATS a, FLOATS b) { return(_mm256_blendv_ps(b, a, mask)); }
+	inline int MaskBits(FLOATS mask) { return(_mm256_movemask_ps(mask)); }
+#elif defined(SIMD_FLOATS_SSE)
+	typedef FLOATS4 FLOATS;
+	const size_t g_Lanes = 4;
+
+	inline FLOATS LoadFloats(const float* data) { return(LoadFloats4(data)); }
+	inline void StoreFloats(float* data, FLOATS value) { StoreFloats4(data, value); }
+	inline FLOATS SetFloats(float value) { return(SetFloats4(value)); }
+#else
+	typedef float FLOATS;
+	const size_t g_Lanes = 1;
+
+	inline FLOATS LoadFloats(const float* data) { return(*data); }
+	inline void StoreFloats(float* data, FLOATS value) { *data = value; }
+	inline FLOATS SetFloats(float value) { return(value); }
+	inline FLOATS Add(FLOATS a, FLOATS b) { return(a + b); }
+	inline FLOATS Sub(FLOATS a, FLOATS b) { return(a - b); }
+	inline FLOATS Mul(FLOATS a, FLOATS b) { return(a * b); }
+	inline FLOATS Div(FLOATS a, FLOATS b) { return(a / b); }
+	inline FLOATS Sqrt(FLOATS a) { return(std::sqrt(a)); }
+	inline FLOATS Min(FLOATS a, FLOATS b) { return((a < b) ? a : b); }
+	inline FLOATS Max(FLOATS a, FLOATS b) { return((a > b) ? a : b); }
+	inline FLOATS Less(FLOATS a, FLOATS b) { return((a < b) ? 1.0f : 0.0f); }
+	inline FLOATS LessEqual(FLOATS a, FLOATS b) { return((a <= b) ? 1.0f : 0.0f); }
+	inline FLOATS GreaterEqual(FLOATS a, FLOATS b) { return((a >= b) ? 1.0f : 0.0f); }
+	inline FLOATS And(FLOATS a, FLOATS b) { return(((a != 0.0f) && (b != 0.0f)) ? 1.0f : 0.0f); }
+	inline FLOATS Or(FLOATS a, FLOATS b) { return(((a != 0.0f) || (b != 0.0f)) ? 1.0f : 0.0f); }
+	inline FLOATS Select(FLOATS mask, FLOATS a, FLOATS b) { return((mask != 0.0f) ? a : b); }
+	inline int MaskBits(FLOATS mask) { return((mask != 0.0f) ? 1 : 0); }
+#endif
+
+	// test > 0 ? a : b, per lane
+	inline FLOATS SelectPositive(FLOATS test, FLOATS a, FLOATS b)
+	{
+		return(Select(Less(SetFloats(0.0f), test), a, b));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#version 460 core
+// one invocation per static batch entry
+layout (local_size_x = 64) in;
+
+// world box and index range of a static batch entry, and where
+// the commands of its group start in the command buffer
+struct DrawTemplate
+{
+   vec3 center;
+   uint firstIndex;
+   vec3 extent;
+   uint indexCount;
+   uint group;
+   uint commandBase;
+   uint padding0;
+   uint padding1;
+};
+
+// layout of a glMultiDrawElementsIndirect() command
+struct DrawCommand
+{
+   uint count;
+   uint instanceCount;
+   uint firstIndex;
+   int baseVertex;
+   uint baseInstance;
+};
+
+layout (std430, binding = 2) readonly buffer DrawTemplates
+{
+   DrawTemplate drawTemplates[];
+};
+
+layout (std430, binding = 3) writeonly buffer DrawCommands
+{
+   DrawCommand drawCommands[];
+};
+
+// number of commands written for each group, which the draw
+// calls read as their draw count
+layout (std430, binding = 4) buffer DrawCounts
+{
+   uint drawCounts[];
+};
+
+uniform uint drawCount;
+// left, right, bottom, top, near and far, pointing inside
+uniform vec4 frustumPlanes[6];
+// an entry is too small when diameterPixels times its radius is
+// less than the size plane at its center, 0 skips the test
+uniform float diameterPixels;
+uniform vec4 sizePlane;
+
+void main()
+{
+   uint index = gl_GlobalInvocationID.x;
+   if (index >= drawCount)
+   {
+      return;
+   }
+
+   DrawTemplate draw = drawTemplates[index];
+
+   // outside when the box is entirely behind one of the planes
+   for (int i = 0; i < 6; i++)
+   {
+      vec4 plane = frustumPlanes[i];
+      if (dot(plane.xyz, draw.center) + plane.w + dot(abs(plane.xyz), draw.extent) < 0.0)
+      {
+         return;
+      }
+   }
+
+   if ((diameterPixels > 0.0) &&
+      (diameterPixels * length(draw.extent) < dot(sizePlane.xyz, draw.center) + sizePlane.w))
+   {
+      return;
+   }
+
+   uint slot = atomicAdd(drawCounts[draw.group], 1u);
+   drawCommands[draw.commandBase + slot] = DrawCommand(draw.indexCount, 1u, draw.firstIndex, 0, 0u);
+}
\ No newline at end of file
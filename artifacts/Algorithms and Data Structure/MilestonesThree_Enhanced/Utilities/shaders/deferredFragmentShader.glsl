@@ -0,0 +1,171 @@
+#version 440 core
+
+// laid out like DeferredRenderer::GPU_MATERIAL
+struct Material
+{
+   vec3 ambientColor;
+   float ambientStrength;
+   vec3 diffuseColor;
+   float shininess;
+   vec3 specularColor;
+   float padding;
+};
+
+// lights with a range of 0 reach every pixel
+struct LightSource
+{
+   vec3 position;
+   float range;
+   vec3 ambientColor;
+   float focalStrength;
+   vec3 diffuseColor;
+   float specularIntensity;
+   vec3 specularColor;
+   float padding;
+};
+
+// tiles across and down the screen and slices along the depth
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+out vec4 outFragmentColor;
+
+// surface color with the material index in alpha, the world
+// normal folded onto the octahedron, and the depth
+uniform sampler2D gBufferAlbedo;
+uniform sampler2D gBufferNormal;
+uniform sampler2D gBufferDepth;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPosition;
+
+// the same lights and clusters as the forward shader
+layout (std430, binding = 5) readonly buffer Lights
+{
+   LightSource lights[];
+};
+layout (std430, binding = 6) readonly buffer LightClusters
+{
+   uvec2 lightClusters[];
+};
+layout (std430, binding = 7) readonly buffer LightIndices
+{
+   uint lightIndices[];
+};
+uniform int lightCount = 0;
+uniform int globalLightCount = 0;
+uniform bool bClusterLogDepth = true;
+uniform float clusterDepthScale = 0.0;
+uniform float clusterDepthBias = 0.0;
+
+layout (std430, binding = 2) readonly buffer Materials
+{
+   Material materials[];
+};
+uniform int materialCount = 0;
+
+// function prototypes
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+uint GetLightCluster(vec3 position);
+vec3 DecodeOctahedral(vec2 octahedral);
+
+void main()
+{
+   ivec2 pixel = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch(gBufferDepth, pixel, 0).r;
+   // nothing was drawn here, so the cleared frame is kept
+   if(depth >= 1.0)
+   {
+      discard;
+   }
+   gl_FragDepth = depth;
+
+   vec4 albedo = texelFetch(gBufferAlbedo, pixel, 0);
+   vec3 lightNormal = normalize(DecodeOctahedral(texelFetch(gBufferNormal, pixel, 0).xy));
+
+   // the world position from the pixel center and its depth
+   vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(gBufferDepth, 0)) * 2.0 - 1.0;
+   vec4 worldPosition = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+   vec3 surfacePosition = worldPosition.xyz / worldPosition.w;
+   vec3 viewDirection = normalize(viewPosition - surfacePosition);
+
+   // index 255 marks surfaces without a material
+   int materialIndex = int(albedo.a * 255.0 + 0.5);
+   Material material = Material(vec3(0.0), 0.0, vec3(0.0), 0.0, vec3(0.0), 0.0);
+   if(materialIndex < materialCount)
+   {
+      material = materials[materialIndex];
+   }
+
+   vec3 phongResult = vec3(0.0f);
+   for(int i = 0; i < globalLightCount; i++)
+   {
+      phongResult += CalcLightSource(lights[i], material, lightNormal, surfacePosition, viewDirection);
+   }
+   if(lightCount > globalLightCount)
+   {
+      uvec2 cluster = lightClusters[GetLightCluster(surfacePosition)];
+      for(uint i = 0u; i < cluster.y; i++)
+      {
+         phongResult += CalcLightSource(lights[lightIndices[cluster.x + i]], material, lightNormal, surfacePosition, viewDirection);
+      }
+   }
+
+   outFragmentColor = vec4(phongResult * albedo.xyz, 1.0);
+}
+
+// the lighting of the forward shader
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
+
+   vec3 lightDirection = normalize(light.position - vertexPosition);
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   vec3 diffuse = impact * material.diffuseColor;
+
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
+   vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+   float attenuation = 1.0;
+   if(light.range > 0.0)
+   {
+      vec3 toLight = light.position - vertexPosition;
+      float falloff = clamp(1.0 - dot(toLight, toLight) / (light.range * light.range), 0.0, 1.0);
+      attenuation = falloff * falloff;
+   }
+
+   return((ambient + diffuse + specular) * attenuation);
+}
+
+// finds the cluster of a world position, with the same tiles and
+// slices the lights were assigned to
+uint GetLightCluster(vec3 position)
+{
+   vec4 eyePosition = view * vec4(position, 1.0);
+   vec4 clipPosition = projection * eyePosition;
+   vec2 tile = floor((clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+   float depth = -eyePosition.z;
+   if(bClusterLogDepth == true)
+   {
+      depth = log(max(depth, 1.0e-6));
+   }
+   float slice = floor(depth * clusterDepthScale + clusterDepthBias);
+   ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1));
+   return(uint((cluster.z * CLUSTER_GRID_Y + cluster.y) * CLUSTER_GRID_X + cluster.x));
+}
+
+// unfolds a point of the octahedral square to a direction, +Y at the center
+vec3 DecodeOctahedral(vec2 octahedral)
+{
+   vec3 direction = vec3(octahedral.x, 1.0 - abs(octahedral.x) - abs(octahedral.y), octahedral.y);
+   if(direction.y < 0.0)
+   {
+      vec2 signs = vec2(direction.x >= 0.0 ? 1.0 : -1.0, direction.z >= 0.0 ? 1.0 : -1.0);
+      direction.xz = (1.0 - abs(direction.zx)) * signs;
+   }
+   return normalize(direction);
+}
\ No newline at end of file
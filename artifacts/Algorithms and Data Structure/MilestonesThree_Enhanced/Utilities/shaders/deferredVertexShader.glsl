@@ -0,0 +1,9 @@
+#version 440 core
+
+// full screen triangle of the deferred lighting pass, made from
+// the vertex index without any vertex buffer
+void main()
+{
+   vec2 position = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1)) - 1.0;
+   gl_Position = vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
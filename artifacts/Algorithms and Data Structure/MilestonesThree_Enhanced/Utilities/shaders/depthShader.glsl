@@ -0,0 +1,7 @@
+#version 440 core
+
+// depth pre-pass - the vertex shader places the geometry and only
+// its depth is written, with the color outputs masked off
+void main()
+{
+}
\ No newline at end of file
@@ -9,23 +9,51 @@ struct Material
     float shininess;
 }; 
 
+// lights with a range of 0 reach every fragment, and lights with
+// a shadow map layer of -1 cast no shadows
 struct LightSource 
 {
-    vec3 position;	
+    vec3 position;
+    float range;
     vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
     float focalStrength;
+    vec3 diffuseColor;
     float specularIntensity;
+    vec3 specularColor;
+    float shadowLayer;
 };
 
-#define TOTAL_LIGHTS 4
+#define MAX_SHADOW_LIGHTS 4
+
+#define MAX_BATCH_MATERIALS 8
+// tiles across and down the screen and slices along the depth
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+flat in uint fragmentMaterialIndex;
+flat in vec4 fragmentImpostorSphere;
+flat in ivec2 fragmentImpostorFrame;
+flat in vec2 fragmentImpostorBlend;
+in vec2 fragmentLightmapCoordinate;
 
-out vec4 outFragmentColor;
+layout (location = 0) out vec4 outFragmentColor;
+// lighting inputs, only written while capturing impostors
+layout (location = 1) out vec4 outFragmentNormal;
+#ifdef IMPOSTOR_PROGRAM
+// the impostor program pushes its fragments back from the quad,
+// which only this variant writes, so every other draw keeps the
+// depth of its triangle
+layout (depth_greater) out float gl_FragDepth;
+#else
+// nothing else discards or writes depth, so the depth test runs
+// before shading, which the equal test after the pre-pass needs
+// to shade each pixel once
+layout (early_fragment_tests) in;
+#endif
 
 uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
@@ -33,51 +61,190 @@ uniform vec4 objectColor = vec4(1.0f);
 uniform sampler2D objectTexture;
 uniform vec3 viewPosition;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
 uniform Material material;
 
+// all the lights, the lights without a range first, then the
+// first light index and number of lights of each cluster, and
+// the light index list the clusters point into
+layout (std430, binding = 5) readonly buffer Lights
+{
+   LightSource lights[];
+};
+layout (std430, binding = 6) readonly buffer LightClusters
+{
+   uvec2 lightClusters[];
+};
+layout (std430, binding = 7) readonly buffer LightIndices
+{
+   uint lightIndices[];
+};
+uniform int lightCount = 0;
+uniform int globalLightCount = 0;
+// slice of a view depth, from the log of the depth for
+// perspective views
+uniform bool bClusterLogDepth = true;
+uniform float clusterDepthScale = 0.0;
+uniform float clusterDepthBias = 0.0;
+
+// static batches select the material and color per vertex
+uniform bool bUseBatchMaterials = false;
+uniform Material batchMaterials[MAX_BATCH_MATERIALS];
+uniform vec4 batchColors[MAX_BATCH_MATERIALS];
+
+// distant objects are drawn from an octahedral atlas of their
+// surface color, world space normal and depth
+uniform bool bImpostorCapture = false;
+uniform int impostorFrames = 8;
+uniform sampler2D impostorColor;
+uniform sampler2D impostorNormalDepth;
+uniform mat4 view;
+uniform mat4 projection;
+
+// the geometry pass of the deferred path writes the surface
+// color with the material index, and the folded normal, instead
+// of lighting the surface.  Index 255 is a surface without one
+uniform bool bGBufferPass = false;
+uniform int materialIndex = -1;
+uniform int batchMaterialIndices[MAX_BATCH_MATERIALS];
+
+// the static batch can read the ambient and diffuse light of
+// every light from a baked atlas, so only the specular light
+// is computed per fragment
+uniform bool bUseLightmap = false;
+uniform sampler2D lightmapTexture;
+
+// depth cube maps of the shadowed lights, one layer per light,
+// with the near plane of every face and the far plane of each
+// light, and the width of a texel one unit from the light
+uniform bool bUseShadows = false;
+uniform samplerCubeArrayShadow shadowMaps;
+uniform float shadowNearPlane = 0.05;
+uniform float shadowFarPlanes[MAX_SHADOW_LIGHTS];
+uniform float shadowTexelSize = 0.0;
+
 // function prototypes
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLightSpecular(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+float CalcLightShadow(LightSource light, vec3 lightNormal, vec3 vertexPosition);
+uint GetLightCluster(vec3 position);
+#ifdef IMPOSTOR_PROGRAM
+bool ShadeImpostor(out vec4 color, out vec3 normal, out vec3 position);
+#endif
+vec2 EncodeOctahedral(vec3 direction);
 
 void main()
 {
+   Material activeMaterial = material;
+   vec4 activeColor = objectColor;
+   if(bUseBatchMaterials == true)
+   {
+      activeMaterial = batchMaterials[fragmentMaterialIndex];
+      activeColor = batchColors[fragmentMaterialIndex];
+   }
+
+   vec4 textureColor = vec4(1.0f);
+   if(bUseTexture == true)
+   {
+      textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+   }
+
+   if(bImpostorCapture == true)
+   {
+      // the unlit surface with full coverage, and the normal with
+      // the linear depth of the orthographic capture view
+      outFragmentColor = vec4((bUseTexture == true) ? textureColor.xyz : activeColor.xyz, 1.0);
+      outFragmentNormal = vec4(normalize(fragmentVertexNormal), gl_FragCoord.z);
+      return;
+   }
+
+   bool bTextured = bUseTexture;
+   vec3 surfaceNormal = fragmentVertexNormal;
+   vec3 surfacePosition = fragmentPosition;
+#ifdef IMPOSTOR_PROGRAM
+   if(ShadeImpostor(textureColor, surfaceNormal, surfacePosition) == false)
+   {
+      discard;
+   }
+   bTextured = true;
+#endif
+
+   if(bGBufferPass == true)
+   {
+      int index = (bUseBatchMaterials == true) ? batchMaterialIndices[fragmentMaterialIndex] : materialIndex;
+      index = ((index < 0) || (index > 254)) ? 255 : index;
+      outFragmentColor = vec4((bTextured == true) ? textureColor.xyz : activeColor.xyz, float(index) / 255.0);
+      outFragmentNormal = vec4(EncodeOctahedral(normalize(surfaceNormal)), 0.0, 0.0);
+      return;
+   }
+
    if(bUseLighting == true)
    {
       // properties
-      vec3 lightNormal = normalize(fragmentVertexNormal);
-      vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+      vec3 lightNormal = normalize(surfaceNormal);
+      vec3 viewDirection = normalize(viewPosition - surfacePosition);
       vec3 phongResult = vec3(0.0f);
 
-      for(int i = 0; i < TOTAL_LIGHTS; i++)
+      if(bUseLightmap == true)
       {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
-      }   
+         phongResult = texture(lightmapTexture, fragmentLightmapCoordinate).rgb;
+         // materials without a shine have no specular light
+         if(activeMaterial.shininess > 0.0)
+         {
+            for(int i = 0; i < globalLightCount; i++)
+            {
+               phongResult += CalcLightSpecular(lights[i], activeMaterial, lightNormal, surfacePosition, viewDirection);
+            }
+            if(lightCount > globalLightCount)
+            {
+               uvec2 cluster = lightClusters[GetLightCluster(surfacePosition)];
+               for(uint i = 0u; i < cluster.y; i++)
+               {
+                  phongResult += CalcLightSpecular(lights[lightIndices[cluster.x + i]], activeMaterial, lightNormal, surfacePosition, viewDirection);
+               }
+            }
+         }
+      }
+      else
+      {
+         for(int i = 0; i < globalLightCount; i++)
+         {
+            phongResult += CalcLightSource(lights[i], activeMaterial, lightNormal, surfacePosition, viewDirection); 
+         }
+         // the lights with a range only from the cluster of the fragment
+         if(lightCount > globalLightCount)
+         {
+            uvec2 cluster = lightClusters[GetLightCluster(surfacePosition)];
+            for(uint i = 0u; i < cluster.y; i++)
+            {
+               phongResult += CalcLightSource(lights[lightIndices[cluster.x + i]], activeMaterial, lightNormal, surfacePosition, viewDirection);
+            }
+         }
+      }
     
-      if(bUseTexture == true)
+      if(bTextured == true)
       {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
          outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
       }
       else
       {
-         outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
+         outFragmentColor = vec4(phongResult * activeColor.xyz, activeColor.w);
       }
    }
    else 
    {
-      if(bUseTexture == true)
+      if(bTextured == true)
       {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         outFragmentColor = textureColor;
       }
       else
       {
-         outFragmentColor = objectColor;
+         outFragmentColor = activeColor;
       }
    }
 }
 
 // calculates the color when using a directional light.
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
 {
    vec3 ambient;
    vec3 diffuse;
@@ -103,6 +270,202 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
    // Calculate specular component
    float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
    specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+   //**Fade out lights with a range**
+
+   float attenuation = 1.0;
+   if(light.range > 0.0)
+   {
+      vec3 toLight = light.position - vertexPosition;
+      float falloff = clamp(1.0 - dot(toLight, toLight) / (light.range * light.range), 0.0, 1.0);
+      attenuation = falloff * falloff;
+   }
+
+   //**Leave out the direct light in shadow**
+
+   float shadow = CalcLightShadow(light, lightNormal, vertexPosition);
   
-   return(ambient + diffuse + specular);
-}
\ No newline at end of file
+   return((ambient + (diffuse + specular) * shadow) * attenuation);
+}
+
+// calculates only the specular light of a light, whose ambient and
+// diffuse light were baked into the lightmap
+vec3 CalcLightSpecular(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 lightDirection = normalize(light.position - vertexPosition);
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
+   vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+   float attenuation = 1.0;
+   if(light.range > 0.0)
+   {
+      vec3 toLight = light.position - vertexPosition;
+      float falloff = clamp(1.0 - dot(toLight, toLight) / (light.range * light.range), 0.0, 1.0);
+      attenuation = falloff * falloff;
+   }
+
+   return(specular * attenuation * CalcLightShadow(light, lightNormal, vertexPosition));
+}
+
+// calculates how much of the light reaches a position, from the
+// cube map of the light.  The cube faces store the depth of their
+// perspective view, which for a position is the depth along the
+// axis of its face, the largest of its offsets from the light.  The
+// position is moved out along the normal by about a texel, so a
+// surface does not shadow itself
+float CalcLightShadow(LightSource light, vec3 lightNormal, vec3 vertexPosition)
+{
+   if((bUseShadows == false) || (light.shadowLayer < 0.0))
+   {
+      return(1.0);
+   }
+
+   int layer = int(light.shadowLayer);
+   float farPlane = shadowFarPlanes[layer];
+   vec3 fromLight = vertexPosition - light.position;
+   fromLight += lightNormal * (1.5 * shadowTexelSize * length(fromLight));
+   float axisDistance = max(max(abs(fromLight.x), abs(fromLight.y)), abs(fromLight.z));
+   if(axisDistance >= farPlane)
+   {
+      return(1.0);
+   }
+
+   float clipDepth = (farPlane + shadowNearPlane) / (farPlane - shadowNearPlane) -
+      (2.0 * farPlane * shadowNearPlane) / ((farPlane - shadowNearPlane) * axisDistance);
+   return(texture(shadowMaps, vec4(fromLight, float(layer)), clipDepth * 0.5 + 0.5));
+}
+
+// finds the cluster of a world position, with the same tiles and
+// slices the lights were assigned to
+uint GetLightCluster(vec3 position)
+{
+   vec4 eyePosition = view * vec4(position, 1.0);
+   vec4 clipPosition = projection * eyePosition;
+   vec2 tile = floor((clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+   float depth = -eyePosition.z;
+   if(bClusterLogDepth == true)
+   {
+      depth = log(max(depth, 1.0e-6));
+   }
+   float slice = floor(depth * clusterDepthScale + clusterDepthBias);
+   ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1));
+   return(uint((cluster.z * CLUSTER_GRID_Y + cluster.y) * CLUSTER_GRID_X + cluster.x));
+}
+
+// folds a direction onto the octahedral square, +Y at the center
+vec2 EncodeOctahedral(vec3 direction)
+{
+   direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+   vec2 octahedral = direction.xz;
+   if(direction.y < 0.0)
+   {
+      vec2 signs = vec2(octahedral.x >= 0.0 ? 1.0 : -1.0, octahedral.y >= 0.0 ? 1.0 : -1.0);
+      octahedral = (1.0 - abs(octahedral.yx)) * signs;
+   }
+   return octahedral;
+}
+
+// the atlas is only read by the impostor program
+#ifdef IMPOSTOR_PROGRAM
+// unfolds a point of the octahedral square to a direction, +Y at the center
+vec3 DecodeOctahedral(vec2 octahedral)
+{
+   vec3 direction = vec3(octahedral.x, 1.0 - abs(octahedral.x) - abs(octahedral.y), octahedral.y);
+   if(direction.y < 0.0)
+   {
+      vec2 signs = vec2(direction.x >= 0.0 ? 1.0 : -1.0, direction.z >= 0.0 ? 1.0 : -1.0);
+      direction.xz = (1.0 - abs(direction.zx)) * signs;
+   }
+   return normalize(direction);
+}
+
+// samples one atlas frame along the view ray.  The ray first hits the
+// plane through the sphere center, and is then moved to the plane at
+// the depth stored there, which corrects the parallax between frames
+void SampleImpostorFrame(ivec2 frame, vec3 rayDirection, out vec4 color, out vec3 normal, out vec3 position)
+{
+   vec3 center = fragmentImpostorSphere.xyz;
+   float radius = fragmentImpostorSphere.w;
+
+   // the same camera basis the frame was captured with
+   vec3 axis = DecodeOctahedral(vec2(frame) / float(impostorFrames - 1) * 2.0 - 1.0);
+   vec3 upReference = (abs(axis.y) > 0.999) ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+   vec3 right = normalize(cross(upReference, axis));
+   vec3 up = cross(axis, right);
+
+   // half a texel of border keeps the filter inside the frame
+   vec2 border = 0.5 * float(impostorFrames) / vec2(textureSize(impostorColor, 0));
+   float facing = min(dot(rayDirection, axis), -0.001);
+
+   float height = 0.0;
+   vec4 normalDepth = vec4(0.0);
+   color = vec4(0.0);
+   for(int pass = 0; pass < 2; pass++)
+   {
+      position = viewPosition + rayDirection * (dot(center + axis * height - viewPosition, axis) / facing);
+      vec2 frameCoordinate = vec2(dot(position - center, right), dot(position - center, up)) / radius * 0.5 + 0.5;
+      if(any(lessThan(frameCoordinate, vec2(0.0))) || any(greaterThan(frameCoordinate, vec2(1.0))))
+      {
+         color = vec4(0.0);
+         break;
+      }
+
+      vec2 atlasCoordinate = (vec2(frame) + clamp(frameCoordinate, border, 1.0 - border)) / float(impostorFrames);
+      color = texture(impostorColor, atlasCoordinate);
+      normalDepth = texture(impostorNormalDepth, atlasCoordinate);
+      if(color.a <= 0.0)
+      {
+         break;
+      }
+      // the atlas values are premultiplied by the coverage, and
+      // depth 0 is on the side of the capture camera
+      height = radius * (1.0 - 2.0 * normalDepth.w / color.a);
+   }
+
+   position = viewPosition + rayDirection * (dot(center + axis * height - viewPosition, axis) / facing);
+   normal = normalDepth.xyz;
+}
+
+// blends the four frames around the view direction into the surface
+// color, normal and position, and writes the depth of the surface
+bool ShadeImpostor(out vec4 color, out vec3 normal, out vec3 position)
+{
+   vec3 rayDirection = normalize(fragmentPosition - viewPosition);
+   vec2 blend = fragmentImpostorBlend;
+   float weights[4] = float[4]((1.0 - blend.x) * (1.0 - blend.y), blend.x * (1.0 - blend.y), (1.0 - blend.x) * blend.y, blend.x * blend.y);
+   ivec2 offsets[4] = ivec2[4](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+
+   color = vec4(0.0);
+   normal = vec3(0.0);
+   position = vec3(0.0);
+   float coverage = 0.0;
+   for(int i = 0; i < 4; i++)
+   {
+      if(weights[i] <= 0.0)
+      {
+         continue;
+      }
+
+      vec4 frameColor;
+      vec3 frameNormal;
+      vec3 framePosition;
+      SampleImpostorFrame(fragmentImpostorFrame + offsets[i], rayDirection, frameColor, frameNormal, framePosition);
+      color += frameColor * weights[i];
+      normal += frameNormal * weights[i];
+      position += framePosition * (frameColor.a * weights[i]);
+      coverage += frameColor.a * weights[i];
+   }
+
+   if(coverage < 0.5)
+   {
+      return(false);
+   }
+   color = vec4(color.xyz / coverage, 1.0);
+   position /= coverage;
+
+   vec4 clipPosition = projection * view * vec4(position, 1.0);
+   gl_FragDepth = max(clipPosition.z / clipPosition.w * 0.5 + 0.5, gl_FragCoord.z);
+   return(true);
+}
+#endif
\ No newline at end of file
@@ -1,20 +1,150 @@
-#version 330 core
+#version 440 core
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-mesh dequantization for compact vertex positions
+layout (location = 3) in vec3 inPositionScale;
+layout (location = 4) in vec3 inPositionOffset;
+// material table entry of static batch vertices
+layout (location = 5) in uint inMaterialIndex;
+// where the vertices of the current mesh are read from
+layout (location = 6) in uint inVertexSource;
+// recorded draw of the visibility buffer
+layout (location = 8) in uint inDrawRange;
+// position of static batch vertices in the baked lightmap atlas
+layout (location = 9) in vec2 inLightmapCoordinate;
+
+#define VERTEX_SOURCE_ATTRIBUTES 0u
+#define VERTEX_SOURCE_PULLED_FLOAT 1u
+#define VERTEX_SOURCE_PULLED_COMPACT 2u
+#define VERTEX_SOURCE_IMPOSTOR 3u
+
+// vertices of all the shared meshes, read by gl_VertexID,
+// which already includes the base vertex of the draw call
+layout (std430, binding = 0) readonly buffer PulledVertices
+{
+   uint pulledVertexData[];
+};
+
+// world space bounding sphere of every drawn impostor
+layout (std430, binding = 1) readonly buffer ImpostorInstances
+{
+   vec4 impostorInstances[];
+};
+
+// the depth pre-pass and the shading pass run this shader in
+// different programs, and must write the same depths
+invariant gl_Position;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+flat out uint fragmentMaterialIndex;
+// impostor sphere, first atlas frame and blend weights
+flat out vec4 fragmentImpostorSphere;
+flat out ivec2 fragmentImpostorFrame;
+flat out vec2 fragmentImpostorBlend;
+flat out uint fragmentDrawRange;
+out vec2 fragmentLightmapCoordinate;
 
 uniform mat4 model;
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 viewPosition;
+
+// impostor draws read their spheres from this instance on
+uniform int impostorFirstInstance = 0;
+uniform int impostorFrames = 8;
+
+// decode a signed normalized 10-bit field of a 2_10_10_10 word
+float UnpackSnorm10(uint word, int offset)
+{
+   return max(float(bitfieldExtract(int(word), offset, 10)) / 511.0, -1.0);
+}
+
+// fold a direction onto the octahedral square, +Y at the center
+vec2 EncodeOctahedral(vec3 direction)
+{
+   direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+   vec2 octahedral = direction.xz;
+   if (direction.y < 0.0)
+   {
+      vec2 signs = vec2(octahedral.x >= 0.0 ? 1.0 : -1.0, octahedral.y >= 0.0 ? 1.0 : -1.0);
+      octahedral = (1.0 - abs(octahedral.yx)) * signs;
+   }
+   return octahedral;
+}
+
+// camera facing quad around the impostor sphere, moved to the front
+// of the sphere so the depth written by the fragments only grows
+void EmitImpostor()
+{
+   vec4 sphere = impostorInstances[impostorFirstInstance + gl_InstanceID];
+   vec3 toCamera = normalize(viewPosition - sphere.xyz);
+   vec3 upReference = (abs(toCamera.y) > 0.999) ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+   vec3 right = normalize(cross(upReference, toCamera));
+   vec3 up = cross(toCamera, right);
+
+   vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+   vec3 position = sphere.xyz + (toCamera + corner.x * right + corner.y * up) * sphere.w;
+
+   // the four frames around the view direction are blended
+   vec2 grid = (EncodeOctahedral(toCamera) * 0.5 + 0.5) * float(impostorFrames - 1);
+   ivec2 frame = min(ivec2(floor(grid)), ivec2(impostorFrames - 2));
+
+   fragmentPosition = position;
+   fragmentVertexNormal = toCamera;
+   fragmentTextureCoordinate = corner * 0.5 + 0.5;
+   fragmentMaterialIndex = 0u;
+   fragmentImpostorSphere = sphere;
+   fragmentImpostorFrame = frame;
+   fragmentImpostorBlend = clamp(grid - vec2(frame), 0.0, 1.0);
+   fragmentDrawRange = 0u;
+   fragmentLightmapCoordinate = vec2(0.0);
+   gl_Position = projection * view * vec4(position, 1.0);
+}
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
+   if (inVertexSource == VERTEX_SOURCE_IMPOSTOR)
+   {
+      EmitImpostor();
+      return;
+   }
+
+   vec3 vertexPosition = inVertexPosition;
+   vec3 vertexNormal = inVertexNormal;
+   vec2 textureCoordinate = inTextureCoordinate;
+
+   if (inVertexSource == VERTEX_SOURCE_PULLED_FLOAT)
+   {
+      // position, normal and texture coordinates as 8 floats
+      uint base = uint(gl_VertexID) * 8u;
+      vertexPosition = vec3(uintBitsToFloat(pulledVertexData[base]), uintBitsToFloat(pulledVertexData[base + 1u]), uintBitsToFloat(pulledVertexData[base + 2u]));
+      vertexNormal = vec3(uintBitsToFloat(pulledVertexData[base + 3u]), uintBitsToFloat(pulledVertexData[base + 4u]), uintBitsToFloat(pulledVertexData[base + 5u]));
+      textureCoordinate = vec2(uintBitsToFloat(pulledVertexData[base + 6u]), uintBitsToFloat(pulledVertexData[base + 7u]));
+   }
+   else if (inVertexSource == VERTEX_SOURCE_PULLED_COMPACT)
+   {
+      // snorm16 position, 2_10_10_10 normal and half float texture coordinates in 4 words
+      uint base = uint(gl_VertexID) * 4u;
+      vertexPosition = vec3(unpackSnorm2x16(pulledVertexData[base]), unpackSnorm2x16(pulledVertexData[base + 1u]).x);
+      uint packedNormal = pulledVertexData[base + 2u];
+      vertexNormal = vec3(UnpackSnorm10(packedNormal, 0), UnpackSnorm10(packedNormal, 10), UnpackSnorm10(packedNormal, 20));
+      textureCoordinate = unpackHalf2x16(pulledVertexData[base + 3u]);
+   }
+
+   vertexPosition = vertexPosition * inPositionScale + inPositionOffset;
+
+   fragmentPosition = vec3(model * vec4(vertexPosition, 1.0));
+   gl_Position = projection * view * model * vec4(vertexPosition, 1.0f);
+   fragmentVertexNormal = normalMatrix * vertexNormal;
+   fragmentTextureCoordinate = textureCoordinate;
+   fragmentMaterialIndex = inMaterialIndex;
+   fragmentImpostorSphere = vec4(0.0);
+   fragmentImpostorFrame = ivec2(0);
+   fragmentImpostorBlend = vec2(0.0);
+   fragmentDrawRange = inDrawRange;
+   fragmentLightmapCoordinate = inLightmapCoordinate;
 }
\ No newline at end of file
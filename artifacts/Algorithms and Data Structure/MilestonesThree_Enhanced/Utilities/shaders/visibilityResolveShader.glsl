@@ -0,0 +1,304 @@
+#version 440 core
+
+// laid out like DeferredRenderer::GPU_MATERIAL
+struct Material
+{
+   vec3 ambientColor;
+   float ambientStrength;
+   vec3 diffuseColor;
+   float shininess;
+   vec3 specularColor;
+   float padding;
+};
+
+// lights with a range of 0 reach every pixel
+struct LightSource
+{
+   vec3 position;
+   float range;
+   vec3 ambientColor;
+   float focalStrength;
+   vec3 diffuseColor;
+   float specularIntensity;
+   vec3 specularColor;
+   float padding;
+};
+
+// laid out like ShapeMeshes::DRAW_RANGE
+struct DrawRange
+{
+   vec3 positionScale;
+   uint firstIndex;
+   vec3 positionOffset;
+   int baseVertex;
+   uint vertexFormat;
+   uint object;
+   uvec2 padding;
+};
+
+// laid out like VisibilityBuffer::VISIBLE_OBJECT
+struct VisibleObject
+{
+   mat4 model;
+   mat3 normalMatrix;
+   vec4 color;
+   vec2 UVscale;
+   int material;
+   int textureSlot;
+};
+
+#define VERTEX_SOURCE_PULLED_COMPACT 2u
+#define MAX_SCENE_TEXTURES 16
+#define EMPTY_PIXEL 0xFFFFFFFFu
+// tiles across and down the screen and slices along the depth
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+out vec4 outFragmentColor;
+
+// recorded draw and triangle of every pixel, and its depth
+uniform usampler2D visibilityIds;
+uniform sampler2D visibilityDepth;
+uniform int primitiveBits = 16;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPosition;
+
+// the shared vertex and index buffers of the meshes
+layout (std430, binding = 0) readonly buffer SharedVertices
+{
+   uint sharedVertexData[];
+};
+layout (std430, binding = 1) readonly buffer SharedIndices
+{
+   uint sharedIndices[];
+};
+layout (std430, binding = 3) readonly buffer DrawRanges
+{
+   DrawRange drawRanges[];
+};
+layout (std430, binding = 4) readonly buffer VisibleObjects
+{
+   VisibleObject visibleObjects[];
+};
+
+// the same lights and clusters as the forward shader
+layout (std430, binding = 5) readonly buffer Lights
+{
+   LightSource lights[];
+};
+layout (std430, binding = 6) readonly buffer LightClusters
+{
+   uvec2 lightClusters[];
+};
+layout (std430, binding = 7) readonly buffer LightIndices
+{
+   uint lightIndices[];
+};
+uniform int lightCount = 0;
+uniform int globalLightCount = 0;
+uniform bool bClusterLogDepth = true;
+uniform float clusterDepthScale = 0.0;
+uniform float clusterDepthBias = 0.0;
+
+layout (std430, binding = 2) readonly buffer Materials
+{
+   Material materials[];
+};
+uniform int materialCount = 0;
+
+// the scene textures on their texture units
+uniform sampler2D sceneTextures[MAX_SCENE_TEXTURES];
+
+// function prototypes
+void FetchVertex(uint vertex, uint vertexFormat, out vec3 position, out vec3 normal, out vec2 textureCoordinate);
+vec3 CalcBarycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndc, vec2 pixelSize, out vec3 ddx, out vec3 ddy);
+vec4 SampleSceneTexture(int slot, vec2 textureCoordinate, vec2 ddx, vec2 ddy);
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+uint GetLightCluster(vec3 position);
+
+void main()
+{
+   ivec2 pixel = ivec2(gl_FragCoord.xy);
+   uint id = texelFetch(visibilityIds, pixel, 0).r;
+   // nothing was drawn here, so the cleared frame is kept
+   if(id == EMPTY_PIXEL)
+   {
+      discard;
+   }
+   gl_FragDepth = texelFetch(visibilityDepth, pixel, 0).r;
+
+   DrawRange range = drawRanges[id >> uint(primitiveBits)];
+   VisibleObject object = visibleObjects[range.object];
+   uint firstIndex = range.firstIndex + (id & ((1u << uint(primitiveBits)) - 1u)) * 3u;
+
+   // the three corners of the triangle, placed like the vertex
+   // shader places them
+   vec3 positions[3];
+   vec3 normals[3];
+   vec2 textureCoordinates[3];
+   vec4 clipPositions[3];
+   for(int i = 0; i < 3; i++)
+   {
+      uint vertex = uint(int(sharedIndices[firstIndex + uint(i)]) + range.baseVertex);
+      vec3 position;
+      FetchVertex(vertex, range.vertexFormat, position, normals[i], textureCoordinates[i]);
+      position = position * range.positionScale + range.positionOffset;
+      positions[i] = vec3(object.model * vec4(position, 1.0));
+      clipPositions[i] = projection * view * vec4(positions[i], 1.0);
+   }
+
+   // perspective correct barycentrics of the pixel center, and
+   // their change to the next pixel for the texture filter
+   vec2 size = vec2(textureSize(visibilityIds, 0));
+   vec2 ndc = (vec2(pixel) + 0.5) / size * 2.0 - 1.0;
+   vec3 ddx;
+   vec3 ddy;
+   vec3 weights = CalcBarycentrics(clipPositions[0], clipPositions[1], clipPositions[2], ndc, 2.0 / size, ddx, ddy);
+
+   vec3 surfacePosition = positions[0] * weights.x + positions[1] * weights.y + positions[2] * weights.z;
+   vec3 surfaceNormal = normals[0] * weights.x + normals[1] * weights.y + normals[2] * weights.z;
+   vec3 lightNormal = normalize(object.normalMatrix * surfaceNormal);
+   vec3 viewDirection = normalize(viewPosition - surfacePosition);
+
+   vec4 surfaceColor = object.color;
+   if(object.textureSlot >= 0)
+   {
+      mat3x2 corners = mat2(object.UVscale.x, 0.0, 0.0, object.UVscale.y) * mat3x2(textureCoordinates[0], textureCoordinates[1], textureCoordinates[2]);
+      surfaceColor = SampleSceneTexture(object.textureSlot, corners * weights, corners * ddx, corners * ddy);
+   }
+
+   Material material = Material(vec3(0.0), 0.0, vec3(0.0), 0.0, vec3(0.0), 0.0);
+   if((object.material >= 0) && (object.material < materialCount))
+   {
+      material = materials[object.material];
+   }
+
+   vec3 phongResult = vec3(0.0f);
+   for(int i = 0; i < globalLightCount; i++)
+   {
+      phongResult += CalcLightSource(lights[i], material, lightNormal, surfacePosition, viewDirection);
+   }
+   if(lightCount > globalLightCount)
+   {
+      uvec2 cluster = lightClusters[GetLightCluster(surfacePosition)];
+      for(uint i = 0u; i < cluster.y; i++)
+      {
+         phongResult += CalcLightSource(lights[lightIndices[cluster.x + i]], material, lightNormal, surfacePosition, viewDirection);
+      }
+   }
+
+   outFragmentColor = vec4(phongResult * surfaceColor.xyz, 1.0);
+}
+
+// decode a signed normalized 10-bit field of a 2_10_10_10 word
+float UnpackSnorm10(uint word, int offset)
+{
+   return max(float(bitfieldExtract(int(word), offset, 10)) / 511.0, -1.0);
+}
+
+// reads a vertex of the shared buffer like the vertex shader
+void FetchVertex(uint vertex, uint vertexFormat, out vec3 position, out vec3 normal, out vec2 textureCoordinate)
+{
+   if(vertexFormat == VERTEX_SOURCE_PULLED_COMPACT)
+   {
+      uint base = vertex * 4u;
+      position = vec3(unpackSnorm2x16(sharedVertexData[base]), unpackSnorm2x16(sharedVertexData[base + 1u]).x);
+      uint packedNormal = sharedVertexData[base + 2u];
+      normal = vec3(UnpackSnorm10(packedNormal, 0), UnpackSnorm10(packedNormal, 10), UnpackSnorm10(packedNormal, 20));
+      textureCoordinate = unpackHalf2x16(sharedVertexData[base + 3u]);
+      return;
+   }
+
+   uint base = vertex * 8u;
+   position = vec3(uintBitsToFloat(sharedVertexData[base]), uintBitsToFloat(sharedVertexData[base + 1u]), uintBitsToFloat(sharedVertexData[base + 2u]));
+   normal = vec3(uintBitsToFloat(sharedVertexData[base + 3u]), uintBitsToFloat(sharedVertexData[base + 4u]), uintBitsToFloat(sharedVertexData[base + 5u]));
+   textureCoordinate = vec2(uintBitsToFloat(sharedVertexData[base + 6u]), uintBitsToFloat(sharedVertexData[base + 7u]));
+}
+
+// the perspective correct barycentrics of a point of the screen
+// in a triangle, from its clip space corners, with their change
+// one pixel to the right and one pixel up
+vec3 CalcBarycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndc, vec2 pixelSize, out vec3 ddx, out vec3 ddy)
+{
+   vec3 invW = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+   vec2 ndc0 = clip0.xy * invW.x;
+   vec2 ndc1 = clip1.xy * invW.y;
+   vec2 ndc2 = clip2.xy * invW.z;
+
+   // change of the screen linear weights over w along x and y
+   float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+   vec3 dx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+   vec3 dy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+   float dxSum = dot(dx, vec3(1.0));
+   float dySum = dot(dy, vec3(1.0));
+
+   vec2 delta = ndc - ndc0;
+   float interpolatedInvW = invW.x + delta.x * dxSum + delta.y * dySum;
+   vec3 weights = (vec3(invW.x, 0.0, 0.0) + delta.x * dx + delta.y * dy) / interpolatedInvW;
+
+   // the weights at the next pixels, less the weights here
+   dx *= pixelSize.x;
+   dy *= pixelSize.y;
+   ddx = (weights * interpolatedInvW + dx) / (interpolatedInvW + dxSum * pixelSize.x) - weights;
+   ddy = (weights * interpolatedInvW + dy) / (interpolatedInvW + dySum * pixelSize.y) - weights;
+   return weights;
+}
+
+// samples a scene texture by its slot.  Sampler arrays need the
+// same index in every invocation, so each slot is tested in turn
+vec4 SampleSceneTexture(int slot, vec2 textureCoordinate, vec2 ddx, vec2 ddy)
+{
+   vec4 color = vec4(1.0);
+   for(int i = 0; i < MAX_SCENE_TEXTURES; i++)
+   {
+      if(i == slot)
+      {
+         color = textureGrad(sceneTextures[i], textureCoordinate, ddx, ddy);
+      }
+   }
+   return color;
+}
+
+// the lighting of the forward shader
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
+
+   vec3 lightDirection = normalize(light.position - vertexPosition);
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   vec3 diffuse = impact * material.diffuseColor;
+
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
+   vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+   float attenuation = 1.0;
+   if(light.range > 0.0)
+   {
+      vec3 toLight = light.position - vertexPosition;
+      float falloff = clamp(1.0 - dot(toLight, toLight) / (light.range * light.range), 0.0, 1.0);
+      attenuation = falloff * falloff;
+   }
+
+   return((ambient + diffuse + specular) * attenuation);
+}
+
+// finds the cluster of a world position, with the same tiles and
+// slices the lights were assigned to
+uint GetLightCluster(vec3 position)
+{
+   vec4 eyePosition = view * vec4(position, 1.0);
+   vec4 clipPosition = projection * eyePosition;
+   vec2 tile = floor((clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+   float depth = -eyePosition.z;
+   if(bClusterLogDepth == true)
+   {
+      depth = log(max(depth, 1.0e-6));
+   }
+   float slice = floor(depth * clusterDepthScale + clusterDepthBias);
+   ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1));
+   return(uint((cluster.z * CLUSTER_GRID_Y + cluster.y) * CLUSTER_GRID_X + cluster.x));
+}
\ No newline at end of file
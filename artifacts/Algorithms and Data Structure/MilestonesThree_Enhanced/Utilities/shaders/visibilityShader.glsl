@@ -0,0 +1,18 @@
+#version 440 core
+
+// geometry pass of the visibility buffer - only the recorded draw
+// and the triangle of the fragment are written, packed into 32
+// bits, so the pass costs the same whatever the materials are
+layout (early_fragment_tests) in;
+
+flat in uint fragmentDrawRange;
+
+layout (location = 0) out uint outVisibility;
+
+// low bits of the ID holding the triangle of the draw
+uniform int primitiveBits = 16;
+
+void main()
+{
+   outVisibility = (fragmentDrawRange << uint(primitiveBits)) | uint(gl_PrimitiveID);
+}
\ No newline at end of file